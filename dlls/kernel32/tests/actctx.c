@@ -2057,6 +2057,115 @@ static void test_typelib_section(void)
     ReleaseActCtx(handle);
 }
 
+static void test_shared_manifest_cache(void)
+{
+    ACTCTX_SECTION_KEYED_DATA data;
+    ULONG_PTR cookie;
+    HANDLE handle;
+    unsigned int i;
+    BOOL ret;
+
+    /* the common controls manifest is parsed the first time, and may be loaded from the cache after that */
+    for (i = 0; i < 3; i++)
+    {
+        winetest_push_context("%u", i);
+        if (!create_manifest_file("test4.manifest", manifest4, -1, NULL, NULL))
+        {
+            skip("Could not create manifest file\n");
+            winetest_pop_context();
+            return;
+        }
+        handle = test_create("test4.manifest");
+        ok(handle != INVALID_HANDLE_VALUE, "handle == INVALID_HANDLE_VALUE, error %lu\n", GetLastError());
+        DeleteFileA("test4.manifest");
+        if (handle != INVALID_HANDLE_VALUE)
+        {
+            test_detailed_info(handle, &detailed_info2, __LINE__);
+            test_info_in_assembly(handle, 2, &manifest_comctrl_info, __LINE__);
+
+            ret = ActivateActCtx(handle, &cookie);
+            ok(ret, "ActivateActCtx failed: %lu\n", GetLastError());
+            memset(&data, 0, sizeof(data));
+            data.cbSize = sizeof(data);
+            ret = FindActCtxSectionStringW(0, NULL, ACTIVATION_CONTEXT_SECTION_WINDOW_CLASS_REDIRECTION,
+                                           L"Button", &data);
+            ok(ret, "FindActCtxSectionStringW failed: %lu\n", GetLastError());
+            ok(data.ulAssemblyRosterIndex == 2, "got roster index %lu\n", data.ulAssemblyRosterIndex);
+            ret = DeactivateActCtx(0, cookie);
+            ok(ret, "DeactivateActCtx failed: %lu\n", GetLastError());
+            ReleaseActCtx(handle);
+        }
+        winetest_pop_context();
+    }
+}
+
+static void test_large_sections(void)
+{
+    static const GUID tlib_guid = {0x99999999,0x8888,0x7777,{0x66,0x66,0,0,0,0,0,0}};
+    ACTCTX_SECTION_KEYED_DATA data;
+    char *manifest, *ptr;
+    WCHAR nameW[64];
+    ULONG_PTR cookie;
+    unsigned int i;
+    HANDLE handle;
+    GUID guid;
+    BOOL ret;
+
+    /* enough entries for the lookups to go through the hashed indexes */
+    manifest = HeapAlloc(GetProcessHeap(), 0, 65536);
+    ptr = manifest + sprintf(manifest,
+        "<assembly xmlns=\"urn:schemas-microsoft-com:asm.v1\" manifestVersion=\"1.0\">"
+        "<assemblyIdentity version=\"1.2.3.4\" name=\"Wine.Test\" type=\"win32\" />");
+    for (i = 0; i < 100; i++)
+        ptr += sprintf(ptr, "<file name=\"hashlib%u.dll\">"
+                       "<windowClass>hashClass%u</windowClass>"
+                       "<typelib tlbid=\"{99999999-8888-7777-6666-0000000000%02x}\" version=\"1.0\" helpdir=\"\" />"
+                       "</file>", i, i, i);
+    strcpy(ptr, "</assembly>");
+
+    create_manifest_file("large_sections.manifest", manifest, -1, NULL, NULL);
+    HeapFree(GetProcessHeap(), 0, manifest);
+    handle = test_create("large_sections.manifest");
+    ok(handle != INVALID_HANDLE_VALUE, "handle == INVALID_HANDLE_VALUE, error %lu\n", GetLastError());
+    DeleteFileA("large_sections.manifest");
+
+    ret = ActivateActCtx(handle, &cookie);
+    ok(ret, "ActivateActCtx failed: %lu\n", GetLastError());
+
+    for (i = 0; i < 100; i++)
+    {
+        memset(&data, 0, sizeof(data));
+        data.cbSize = sizeof(data);
+        swprintf(nameW, ARRAY_SIZE(nameW), (i & 1) ? L"HASHCLASS%u" : L"hashClass%u", i);
+        ret = FindActCtxSectionStringW(0, NULL, ACTIVATION_CONTEXT_SECTION_WINDOW_CLASS_REDIRECTION, nameW, &data);
+        ok(ret, "%s not found\n", wine_dbgstr_w(nameW));
+
+        swprintf(nameW, ARRAY_SIZE(nameW), L"hashlib%u.dll", i);
+        ret = FindActCtxSectionStringW(0, NULL, ACTIVATION_CONTEXT_SECTION_DLL_REDIRECTION, nameW, &data);
+        ok(ret, "%s not found\n", wine_dbgstr_w(nameW));
+
+        guid = tlib_guid;
+        guid.Data4[7] = i;
+        ret = FindActCtxSectionGuid(0, NULL, ACTIVATION_CONTEXT_SECTION_COM_TYPE_LIBRARY_REDIRECTION, &guid, &data);
+        ok(ret, "%s not found\n", wine_dbgstr_guid(&guid));
+    }
+
+    SetLastError(0xdeadbeef);
+    ret = FindActCtxSectionStringW(0, NULL, ACTIVATION_CONTEXT_SECTION_WINDOW_CLASS_REDIRECTION, L"hashClass100", &data);
+    ok(!ret, "hashClass100 found\n");
+    ok(GetLastError() == ERROR_SXS_KEY_NOT_FOUND, "got error %lu\n", GetLastError());
+
+    guid.Data4[7] = 100;
+    SetLastError(0xdeadbeef);
+    ret = FindActCtxSectionGuid(0, NULL, ACTIVATION_CONTEXT_SECTION_COM_TYPE_LIBRARY_REDIRECTION, &guid, &data);
+    ok(!ret, "typelib found\n");
+    ok(GetLastError() == ERROR_SXS_KEY_NOT_FOUND, "got error %lu\n", GetLastError());
+
+    ret = DeactivateActCtx(0, cookie);
+    ok(ret, "DeactivateActCtx failed: %lu\n", GetLastError());
+    ReleaseActCtx(handle);
+}
+
 static void test_allowDelayedBinding(void)
 {
     HANDLE handle;
@@ -2437,6 +2546,8 @@ static void test_actctx(void)
     }
 
     test_wndclass_section();
+    test_large_sections();
+    test_shared_manifest_cache();
     test_dllredirect_section();
     test_typelib_section();
     test_allowDelayedBinding();
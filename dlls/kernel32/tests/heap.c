@@ -827,11 +827,8 @@ static void test_HeapCreate(void)
     size = 0;
     SetLastError( 0xdeadbeef );
     ret = pHeapQueryInformation( 0, HeapCompatibilityInformation, &compat_info, sizeof(compat_info), &size );
-    todo_wine
     ok( !ret, "HeapQueryInformation succeeded\n" );
-    todo_wine
     ok( GetLastError() == ERROR_NOACCESS, "got error %lu\n", GetLastError() );
-    todo_wine
     ok( size == 0, "got size %Iu\n", size );
 
     size = 0;
@@ -871,7 +868,6 @@ static void test_HeapCreate(void)
     ok( ret, "HeapSetInformation failed, error %lu\n", GetLastError() );
     ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info), &size );
     ok( ret, "HeapQueryInformation failed, error %lu\n", GetLastError() );
-    todo_wine
     ok( compat_info == 2, "got HeapCompatibilityInformation %lu\n", compat_info );
 
     /* cannot be undone */
@@ -879,20 +875,15 @@ static void test_HeapCreate(void)
     compat_info = 0;
     SetLastError( 0xdeadbeef );
     ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info) );
-    todo_wine
     ok( !ret, "HeapSetInformation succeeded\n" );
-    todo_wine
     ok( GetLastError() == ERROR_GEN_FAILURE, "got error %lu\n", GetLastError() );
     compat_info = 1;
     SetLastError( 0xdeadbeef );
     ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info) );
-    todo_wine
     ok( !ret, "HeapSetInformation succeeded\n" );
-    todo_wine
     ok( GetLastError() == ERROR_GEN_FAILURE, "got error %lu\n", GetLastError() );
     ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info), &size );
     ok( ret, "HeapQueryInformation failed, error %lu\n", GetLastError() );
-    todo_wine
     ok( compat_info == 2, "got HeapCompatibilityInformation %lu\n", compat_info );
 
     ret = HeapDestroy( heap );
@@ -931,7 +922,6 @@ static void test_HeapCreate(void)
     ok( ret, "HeapSetInformation failed, error %lu\n", GetLastError() );
     ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info), &size );
     ok( ret, "HeapQueryInformation failed, error %lu\n", GetLastError() );
-    todo_wine
     ok( compat_info == 2, "got HeapCompatibilityInformation %lu\n", compat_info );
 
     for (i = 0; i < 0x11; i++) ptrs[i] = pHeapAlloc( heap, 0, 24 + 2 * sizeof(void *) );
@@ -964,7 +954,6 @@ static void test_HeapCreate(void)
     SetLastError( 0xdeadbeef );
     while ((ret = HeapWalk( heap, &entry ))) entries[count++] = entry;
     ok( GetLastError() == ERROR_NO_MORE_ITEMS, "got error %lu\n", GetLastError() );
-    todo_wine
     ok( count > 24, "got count %lu\n", count );
     if (count < 2) count = 2;
 
@@ -977,7 +966,6 @@ static void test_HeapCreate(void)
 
     for (i = 0; i < 0x12; i++)
     {
-        todo_wine
         ok( entries[4 + i].wFlags == 0, "got wFlags %#x\n", entries[4 + i].wFlags );
         todo_wine
         ok( entries[4 + i].cbData == 0x20, "got cbData %#lx\n", entries[4 + i].cbData );
@@ -996,7 +984,6 @@ static void test_HeapCreate(void)
     rtl_entry.lpData = NULL;
     SetLastError( 0xdeadbeef );
     while (!RtlWalkHeap( heap, &rtl_entry )) rtl_entries[count++] = rtl_entry;
-    todo_wine
     ok( count > 24, "got count %lu\n", count );
     if (count < 2) count = 2;
 
@@ -1039,7 +1026,6 @@ static void test_HeapCreate(void)
     SetLastError( 0xdeadbeef );
     while ((ret = HeapWalk( heap, &entry ))) entries[count++] = entry;
     ok( GetLastError() == ERROR_NO_MORE_ITEMS, "got error %lu\n", GetLastError() );
-    todo_wine
     ok( count > 24, "got count %lu\n", count );
     if (count < 2) count = 2;
 
@@ -1068,7 +1054,6 @@ static void test_HeapCreate(void)
     rtl_entry.lpData = NULL;
     SetLastError( 0xdeadbeef );
     while (!RtlWalkHeap( heap, &rtl_entry )) rtl_entries[count++] = rtl_entry;
-    todo_wine
     ok( count > 24, "got count %lu\n", count );
     if (count < 2) count = 2;
 
@@ -1082,11 +1067,8 @@ static void test_HeapCreate(void)
         if (!entries[i].wFlags)
             ok( rtl_entries[i].wFlags == 0 || rtl_entries[i].wFlags == RTL_HEAP_ENTRY_LFH, "got wFlags %#x\n", rtl_entries[i].wFlags );
         else if (entries[i].wFlags & PROCESS_HEAP_ENTRY_BUSY)
-        {
-            todo_wine
             ok( rtl_entries[i].wFlags == (RTL_HEAP_ENTRY_LFH|RTL_HEAP_ENTRY_BUSY) || broken(rtl_entries[i].wFlags == 1) /* win7 */,
                 "got wFlags %#x\n", rtl_entries[i].wFlags );
-        }
         else if (entries[i].wFlags & PROCESS_HEAP_UNCOMMITTED_RANGE)
             ok( rtl_entries[i].wFlags == RTL_HEAP_ENTRY_UNCOMMITTED || broken(rtl_entries[i].wFlags == 0x100) /* win7 */,
                 "got wFlags %#x\n", rtl_entries[i].wFlags );
@@ -1252,6 +1234,78 @@ static void test_HeapCreate(void)
 }
 
 
+struct lfh_thread_params
+{
+    HANDLE heap;
+    void *slots[256];
+};
+
+static DWORD WINAPI lfh_thread_proc( void *arg )
+{
+    struct lfh_thread_params *params = arg;
+    DWORD seed = GetCurrentThreadId();
+    SIZE_T size, i, j;
+    BYTE *ptr, *old;
+
+    for (i = 0; i < 20000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        size = 1 + (seed >> 16) % 0x600;
+
+        ptr = HeapAlloc( params->heap, 0, size );
+        ok( !!ptr, "HeapAlloc failed, error %lu\n", GetLastError() );
+        if (!ptr) break;
+        memset( ptr, (BYTE)size, size );
+
+        /* blocks are freed by whichever thread replaces them, often not the allocating one */
+        old = InterlockedExchangePointer( &params->slots[seed % ARRAY_SIZE(params->slots)], ptr );
+        if (!old) continue;
+
+        size = HeapSize( params->heap, 0, old );
+        for (j = 0; j < size; j++) if (old[j] != (BYTE)size) break;
+        ok( j == size, "block %p of size %#Ix overwritten at %#Ix\n", old, size, j );
+        HeapFree( params->heap, 0, old );
+    }
+
+    return 0;
+}
+
+static void test_lfh_threads(void)
+{
+    struct lfh_thread_params params = {0};
+    ULONG compat_info = 2;
+    HANDLE threads[8];
+    DWORD res;
+    BOOL ret;
+    UINT i;
+
+    params.heap = HeapCreate( 0, 0, 0 );
+    ok( !!params.heap, "HeapCreate failed, error %lu\n", GetLastError() );
+    ret = pHeapSetInformation( params.heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info) );
+    ok( ret, "HeapSetInformation failed, error %lu\n", GetLastError() );
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread( NULL, 0, lfh_thread_proc, &params, 0, NULL );
+    res = WaitForMultipleObjects( ARRAY_SIZE(threads), threads, TRUE, 60000 );
+    ok( res < WAIT_OBJECT_0 + ARRAY_SIZE(threads), "WaitForMultipleObjects returned %#lx\n", res );
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle( threads[i] );
+
+    ret = HeapValidate( params.heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+    for (i = 0; i < ARRAY_SIZE(params.slots); i++)
+    {
+        if (!params.slots[i]) continue;
+        ret = HeapValidate( params.heap, 0, params.slots[i] );
+        ok( ret, "HeapValidate failed\n" );
+        ret = HeapFree( params.heap, 0, params.slots[i] );
+        ok( ret, "HeapFree failed, error %lu\n", GetLastError() );
+    }
+
+    ret = HeapDestroy( params.heap );
+    ok( ret, "HeapDestroy failed, error %lu\n", GetLastError() );
+}
+
+
 struct mem_entry
 {
     UINT_PTR flags;
@@ -3632,6 +3686,7 @@ START_TEST(heap)
     }
 
     test_HeapCreate();
+    test_lfh_threads();
     test_GlobalAlloc();
     test_LocalAlloc();
 
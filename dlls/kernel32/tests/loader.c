@@ -1587,6 +1587,199 @@ static void test_filenames(void)
     DeleteFileA( long_path );
 }
 
+#define LOOKUP_MODULE_COUNT 500
+
+static void test_module_lookup(void)
+{
+    IMAGE_NT_HEADERS nt_header = nt_header_template;
+    char dll_name[MAX_PATH], path[MAX_PATH], name[MAX_PATH], *p;
+    unsigned int i, j, count;
+    HMODULE *mods, mod = NULL;
+    DWORD start;
+
+    nt_header.FileHeader.NumberOfSections = 1;
+    nt_header.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+
+    nt_header.OptionalHeader.SectionAlignment = page_size;
+    nt_header.OptionalHeader.DllCharacteristics = IMAGE_DLLCHARACTERISTICS_NX_COMPAT;
+    nt_header.OptionalHeader.FileAlignment = page_size;
+    nt_header.OptionalHeader.SizeOfHeaders = sizeof(dos_header) + sizeof(nt_header) + sizeof(IMAGE_SECTION_HEADER);
+    nt_header.OptionalHeader.SizeOfImage = sizeof(dos_header) + sizeof(nt_header) + sizeof(IMAGE_SECTION_HEADER) + page_size;
+
+    create_test_dll( &dos_header, sizeof(dos_header), &nt_header, dll_name );
+    mods = HeapAlloc( GetProcessHeap(), 0, LOOKUP_MODULE_COUNT * sizeof(*mods) );
+
+    for (count = 0; count < LOOKUP_MODULE_COUNT; count++)
+    {
+        sprintf( path, "%s.%u.dll", dll_name, count );
+        if (!CopyFileA( dll_name, path, FALSE ))
+        {
+            ok( 0, "CopyFileA failed err %lu\n", GetLastError() );
+            break;
+        }
+        mods[count] = LoadLibraryA( path );
+        ok( mods[count] != NULL, "loading %s failed err %lu\n", path, GetLastError() );
+        if (!mods[count])
+        {
+            DeleteFileA( path );
+            break;
+        }
+    }
+
+    start = GetTickCount();
+    for (j = 0; j < 20; j++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            sprintf( name, "%s.%u.DLL", strrchr( dll_name, '\\' ) + 1, i );
+            for (p = name; *p; p++) *p = toupper( *p );
+            mod = GetModuleHandleA( name );
+            if (mod != mods[i]) break;
+        }
+        ok( i == count, "wrong module %p for %s, expected %p\n", mod, name, mods[i] );
+    }
+    trace( "%u lookups by base name took %lu ms\n", 20 * count, GetTickCount() - start );
+
+    start = GetTickCount();
+    for (j = 0; j < 20; j++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            sprintf( path, "%s.%u.dll", dll_name, i );
+            mod = GetModuleHandleA( path );
+            if (mod != mods[i]) break;
+        }
+        ok( i == count, "wrong module %p for %s, expected %p\n", mod, path, mods[i] );
+    }
+    trace( "%u lookups by full name took %lu ms\n", 20 * count, GetTickCount() - start );
+
+    sprintf( name, "%s.%u.dll", strrchr( dll_name, '\\' ) + 1, LOOKUP_MODULE_COUNT );
+    mod = GetModuleHandleA( name );
+    ok( !mod, "got module %p for %s\n", mod, name );
+
+    /* a module loaded again through another name of the same file is found by its file id */
+    if (count)
+    {
+        sprintf( path, "%s.%u.dll", dll_name, 0 );
+        sprintf( name, "%s.link.dll", dll_name );
+        if (CreateHardLinkA( name, path, NULL ))
+        {
+            mod = LoadLibraryA( name );
+            ok( mod == mods[0], "got module %p, expected %p\n", mod, mods[0] );
+            FreeLibrary( mod );
+            DeleteFileA( name );
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        FreeLibrary( mods[i] );
+        sprintf( path, "%s.%u.dll", dll_name, i );
+        DeleteFileA( path );
+    }
+    /* unloaded modules are no longer found */
+    if (count)
+    {
+        sprintf( name, "%s.%u.dll", strrchr( dll_name, '\\' ) + 1, 0 );
+        mod = GetModuleHandleA( name );
+        ok( !mod, "got module %p for %s\n", mod, name );
+    }
+    HeapFree( GetProcessHeap(), 0, mods );
+    DeleteFileA( dll_name );
+}
+
+static void test_search_path_changes(void)
+{
+    IMAGE_NT_HEADERS nt_header = nt_header_template;
+    char dll_name[MAX_PATH], dir[MAX_PATH], path[MAX_PATH];
+    HMODULE mod;
+    BOOL ret;
+
+    nt_header.FileHeader.NumberOfSections = 1;
+    nt_header.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+
+    nt_header.OptionalHeader.SectionAlignment = page_size;
+    nt_header.OptionalHeader.DllCharacteristics = IMAGE_DLLCHARACTERISTICS_NX_COMPAT;
+    nt_header.OptionalHeader.FileAlignment = page_size;
+    nt_header.OptionalHeader.SizeOfHeaders = sizeof(dos_header) + sizeof(nt_header) + sizeof(IMAGE_SECTION_HEADER);
+    nt_header.OptionalHeader.SizeOfImage = sizeof(dos_header) + sizeof(nt_header) + sizeof(IMAGE_SECTION_HEADER) + page_size;
+
+    create_test_dll( &dos_header, sizeof(dos_header), &nt_header, dll_name );
+    strcpy( dir, dll_name );
+    strcpy( strrchr( dir, '.' ), ".dir" );
+    ret = CreateDirectoryA( dir, NULL );
+    ok( ret, "CreateDirectoryA failed err %lu\n", GetLastError() );
+    sprintf( path, "%s\\ldr_search_test.dll", dir );
+    SetDllDirectoryA( dir );
+
+    /* let the directory age, so that its listing can be cached */
+    Sleep( 2500 );
+    SetLastError( 0xdeadbeef );
+    mod = LoadLibraryA( "ldr_search_test.dll" );
+    ok( !mod, "dll should not be found\n" );
+    ok( GetLastError() == ERROR_MOD_NOT_FOUND, "got error %lu\n", GetLastError() );
+
+    /* a dll added to a search path directory is found right away */
+    ret = MoveFileA( dll_name, path );
+    ok( ret, "MoveFileA failed err %lu\n", GetLastError() );
+    mod = LoadLibraryA( "LDR_SEARCH_TEST.DLL" );
+    ok( mod != NULL, "loading failed err %lu\n", GetLastError() );
+    FreeLibrary( mod );
+
+    /* and not found anymore once removed */
+    ret = DeleteFileA( path );
+    ok( ret, "DeleteFileA failed err %lu\n", GetLastError() );
+    SetLastError( 0xdeadbeef );
+    mod = LoadLibraryA( "ldr_search_test.dll" );
+    ok( !mod, "dll should not be found\n" );
+    ok( GetLastError() == ERROR_MOD_NOT_FOUND, "got error %lu\n", GetLastError() );
+
+    SetDllDirectoryA( NULL );
+    RemoveDirectoryA( dir );
+}
+
+static void test_export_resolution(void)
+{
+    static const char *dlls[] = { "kernel32.dll", "user32.dll", "gdi32.dll" };
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    unsigned int i, j, round, count = 0;
+    const DWORD *names;
+    FARPROC *procs;
+    HMODULE mod;
+    DWORD start, size;
+
+    start = GetTickCount();
+    for (round = 0; round < 10; round++)
+    {
+        for (i = 0; i < ARRAY_SIZE(dlls); i++)
+        {
+            mod = LoadLibraryA( dlls[i] );
+            ok( mod != NULL, "failed to load %s err %lu\n", dlls[i], GetLastError() );
+            exports = pRtlImageDirectoryEntryToData( mod, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &size );
+            ok( exports != NULL, "no exports in %s\n", dlls[i] );
+            names = (const DWORD *)((const char *)mod + exports->AddressOfNames);
+            procs = HeapAlloc( GetProcessHeap(), 0, exports->NumberOfNames * sizeof(*procs) );
+
+            /* resolving the same name twice, directly or through a forward, gives the same result */
+            for (j = 0; j < exports->NumberOfNames; j++)
+                procs[j] = GetProcAddress( mod, (const char *)mod + names[j] );
+            for (j = 0; j < exports->NumberOfNames; j++)
+            {
+                FARPROC proc = GetProcAddress( mod, (const char *)mod + names[j] );
+                if (proc != procs[j]) break;
+            }
+            ok( j == exports->NumberOfNames, "%s: got different results for %s\n", dlls[i],
+                j < exports->NumberOfNames ? (const char *)mod + names[j] : "" );
+            count += 2 * exports->NumberOfNames;
+
+            ok( !GetProcAddress( mod, "wine_nonexistent_export" ), "found nonexistent export in %s\n", dlls[i] );
+            HeapFree( GetProcessHeap(), 0, procs );
+            FreeLibrary( mod );
+        }
+    }
+    trace( "%u export lookups took %lu ms\n", count, GetTickCount() - start );
+}
+
 /* Verify linking style of import descriptors */
 static void test_ImportDescriptors(void)
 {
@@ -4120,6 +4313,9 @@ START_TEST(loader)
     }
 
     test_filenames();
+    test_module_lookup();
+    test_search_path_changes();
+    test_export_resolution();
     test_ResolveDelayLoadedAPI();
     test_ImportDescriptors();
     test_section_access();
@@ -2752,6 +2752,88 @@ static void test_crit_section(void)
     ok(cs.DebugInfo == NULL, "Unexpected debug info pointer %p.\n", cs.DebugInfo);
 }
 
+static CRITICAL_SECTION contention_cs;
+static SRWLOCK contention_srwlock;
+static volatile LONG contention_value;
+static LONG contention_errors;
+
+static DWORD WINAPI crit_section_contention_thread(void *arg)
+{
+    unsigned int i;
+
+    for (i = 0; i < 100000; i++)
+    {
+        EnterCriticalSection(&contention_cs);
+        contention_value++;
+        LeaveCriticalSection(&contention_cs);
+    }
+    return 0;
+}
+
+static DWORD WINAPI srwlock_contention_thread(void *arg)
+{
+    unsigned int i;
+
+    for (i = 0; i < 100000; i++)
+    {
+        if (i % 4)
+        {
+            pAcquireSRWLockExclusive(&contention_srwlock);
+            contention_value++;
+            pReleaseSRWLockExclusive(&contention_srwlock);
+        }
+        else
+        {
+            LONG value;
+
+            pAcquireSRWLockShared(&contention_srwlock);
+            value = contention_value;
+            YieldProcessor();
+            if (contention_value != value) InterlockedIncrement(&contention_errors);
+            pReleaseSRWLockShared(&contention_srwlock);
+        }
+    }
+    return 0;
+}
+
+static void test_lock_contention(void)
+{
+    HANDLE threads[4];
+    unsigned int i;
+    DWORD start;
+
+    InitializeCriticalSection(&contention_cs);
+    contention_value = 0;
+    start = GetTickCount();
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread(NULL, 0, crit_section_contention_thread, NULL, 0, NULL);
+    WaitForMultipleObjects(ARRAY_SIZE(threads), threads, TRUE, INFINITE);
+    trace("critical section: %u threads in %lu ms\n", (UINT)ARRAY_SIZE(threads), GetTickCount() - start);
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle(threads[i]);
+    ok(contention_value == ARRAY_SIZE(threads) * 100000, "got value %ld\n", contention_value);
+    ok(contention_cs.LockCount == -1, "got LockCount %ld\n", contention_cs.LockCount);
+    ok(!contention_cs.OwningThread, "got OwningThread %p\n", contention_cs.OwningThread);
+    DeleteCriticalSection(&contention_cs);
+
+    if (!pInitializeSRWLock)
+    {
+        win_skip("no srw lock support.\n");
+        return;
+    }
+
+    pInitializeSRWLock(&contention_srwlock);
+    contention_value = 0;
+    start = GetTickCount();
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread(NULL, 0, srwlock_contention_thread, NULL, 0, NULL);
+    WaitForMultipleObjects(ARRAY_SIZE(threads), threads, TRUE, INFINITE);
+    trace("srw lock: %u threads in %lu ms\n", (UINT)ARRAY_SIZE(threads), GetTickCount() - start);
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle(threads[i]);
+    ok(contention_value == ARRAY_SIZE(threads) * 75000, "got value %ld\n", contention_value);
+    ok(!contention_errors, "got %ld errors\n", contention_errors);
+    ok(!contention_srwlock.Ptr, "got lock state %p\n", contention_srwlock.Ptr);
+}
+
 static DWORD WINAPI thread_proc(LPVOID unused)
 {
     Sleep(INFINITE);
@@ -2890,4 +2972,5 @@ START_TEST(sync)
     test_alertable_wait();
     test_apc_deadlock();
     test_crit_section();
+    test_lock_contention();
 }
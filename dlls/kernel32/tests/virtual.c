@@ -2137,6 +2137,23 @@ static void test_write_watch(void)
         "wrong count %Iu\n", count );
     if (count) ok( results[0] == base + 5*pagesize, "wrong result %p\n", results[0] );
 
+    /* recommitted pages are still watched */
+
+    base = VirtualAlloc( base, size, MEM_COMMIT, PAGE_READWRITE );
+    ok( base != NULL, "VirtualAlloc failed %lu\n", GetLastError() );
+    ok( !base[5*pagesize + 200], "page not cleared\n" );
+
+    ret = pResetWriteWatch( base, size );
+    ok( !ret, "pResetWriteWatch failed %lu\n", GetLastError() );
+
+    base[2*pagesize] = 1;
+
+    count = 64;
+    ret = pGetWriteWatch( 0, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+    ok( count == 1, "wrong count %Iu\n", count );
+    ok( results[0] == base + 2*pagesize, "wrong result %p\n", results[0] );
+
     VirtualFree( base, 0, MEM_RELEASE );
 }
 
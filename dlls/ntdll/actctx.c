@@ -34,6 +34,7 @@
 #include "ntdll_misc.h"
 #include "wine/exception.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(actctx);
 
@@ -188,6 +189,13 @@ struct guid_index
     ULONG rosterindex;
 };
 
+/* open addressing hash table of the index entries of a section, built on first lookup */
+struct section_hash
+{
+    ULONG mask;      /* number of slots minus one */
+    ULONG slots[1];  /* index entry number plus one, 0 if free */
+};
+
 struct wndclass_redirect_data
 {
     ULONG size;
@@ -582,14 +590,34 @@ typedef struct _ACTIVATION_CONTEXT
     struct guidsection_header *comserver_section;
     struct guidsection_header *ifaceps_section;
     struct guidsection_header *clrsurrogate_section;
+    /* hashed indexes of the sections */
+    struct section_hash       *wndclass_hash;
+    struct section_hash       *dllredirect_hash;
+    struct section_hash       *progid_hash;
+    struct section_hash       *activatable_class_hash;
+    struct section_hash       *tlib_hash;
+    struct section_hash       *comserver_hash;
+    struct section_hash       *ifaceps_hash;
+    struct section_hash       *clrsurrogate_hash;
 } ACTIVATION_CONTEXT;
 
+/* serialized form of a parsed manifest, stored in the winsxs manifest cache */
+struct manifest_cache_buffer
+{
+    BYTE                     *data;
+    SIZE_T                    size;
+    SIZE_T                    pos;
+    unsigned int              count;   /* number of records */
+    BOOL                      error;
+};
+
 struct actctx_loader
 {
     ACTIVATION_CONTEXT       *actctx;
     struct assembly_identity *dependencies;
     unsigned int              num_dependencies;
     unsigned int              allocated_dependencies;
+    struct manifest_cache_buffer *cache_deps;  /* dependencies of the manifest being cached */
 };
 
 static const xmlstr_t empty_xmlstr;
@@ -653,6 +681,30 @@ static const struct olemisc_entry olemisc_values[] =
 static ACTIVATION_CONTEXT system_actctx = { ACTCTX_MAGIC, 1 };
 static ACTIVATION_CONTEXT *process_actctx = &system_actctx;
 
+/* manifest files found in winsxs, valid as long as the directory isn't modified */
+struct winsxs_cache_entry
+{
+    struct list entry;
+    WCHAR      *key;       /* identity of the assembly looked up */
+    WCHAR      *file;      /* name of the manifest file, NULL if none */
+    USHORT      build;     /* version of the manifest file */
+    USHORT      revision;
+};
+
+#define MAX_WINSXS_CACHE_ENTRIES 256
+static struct list winsxs_cache = LIST_INIT( winsxs_cache );
+static unsigned int winsxs_cache_count;
+static LONGLONG winsxs_cache_mtime;
+
+static RTL_CRITICAL_SECTION winsxs_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG winsxs_cache_critsect_debug =
+{
+    0, 0, &winsxs_cache_section,
+    { &winsxs_cache_critsect_debug.ProcessLocksList, &winsxs_cache_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": winsxs_cache_section") }
+};
+static RTL_CRITICAL_SECTION winsxs_cache_section = { &winsxs_cache_critsect_debug, -1, 0, 0, 0, 0 };
+
 static WCHAR *strdupW(const WCHAR* str)
 {
     WCHAR*      ptr;
@@ -1007,6 +1059,117 @@ static void free_depend_manifests(struct actctx_loader* acl)
     RtlFreeHeap(GetProcessHeap(), 0, acl->dependencies);
 }
 
+static void cache_put( struct manifest_cache_buffer *buf, const void *data, SIZE_T len )
+{
+    SIZE_T new_size;
+    BYTE *ptr;
+
+    if (buf->error) return;
+    if (len > buf->size - buf->pos)
+    {
+        new_size = max( buf->size * 2, buf->pos + len + 256 );
+        if (buf->data) ptr = RtlReAllocateHeap( GetProcessHeap(), 0, buf->data, new_size );
+        else ptr = RtlAllocateHeap( GetProcessHeap(), 0, new_size );
+        if (!ptr)
+        {
+            buf->error = TRUE;
+            return;
+        }
+        buf->data = ptr;
+        buf->size = new_size;
+    }
+    memcpy( buf->data + buf->pos, data, len );
+    buf->pos += len;
+}
+
+static void cache_put_dword( struct manifest_cache_buffer *buf, DWORD value )
+{
+    cache_put( buf, &value, sizeof(value) );
+}
+
+static void cache_put_string( struct manifest_cache_buffer *buf, const WCHAR *str )
+{
+    DWORD len = str ? wcslen( str ) : ~0u;
+
+    cache_put_dword( buf, len );
+    if (str) cache_put( buf, str, len * sizeof(WCHAR) );
+}
+
+static void cache_put_identity( struct manifest_cache_buffer *buf, const struct assembly_identity *ai )
+{
+    cache_put_string( buf, ai->name );
+    cache_put_string( buf, ai->arch );
+    cache_put_string( buf, ai->public_key );
+    cache_put_string( buf, ai->language );
+    cache_put_string( buf, ai->type );
+    cache_put( buf, &ai->version, sizeof(ai->version) );
+    cache_put_dword( buf, ai->optional );
+    cache_put_dword( buf, ai->delayed );
+}
+
+static BOOL cache_get( struct manifest_cache_buffer *buf, void *data, SIZE_T len )
+{
+    if (buf->error || len > buf->size - buf->pos)
+    {
+        buf->error = TRUE;
+        return FALSE;
+    }
+    memcpy( data, buf->data + buf->pos, len );
+    buf->pos += len;
+    return TRUE;
+}
+
+static DWORD cache_get_dword( struct manifest_cache_buffer *buf )
+{
+    DWORD value = 0;
+
+    cache_get( buf, &value, sizeof(value) );
+    return value;
+}
+
+/* get a number of records, each of them taking at least min_size bytes */
+static DWORD cache_get_count( struct manifest_cache_buffer *buf, SIZE_T min_size )
+{
+    DWORD count = cache_get_dword( buf );
+
+    if (buf->error || count > (buf->size - buf->pos) / min_size)
+    {
+        buf->error = TRUE;
+        return 0;
+    }
+    return count;
+}
+
+static WCHAR *cache_get_string( struct manifest_cache_buffer *buf )
+{
+    DWORD len = cache_get_dword( buf );
+    WCHAR *str;
+
+    if (buf->error || len == ~0u) return NULL;
+    if (len > (buf->size - buf->pos) / sizeof(WCHAR) ||
+        !(str = RtlAllocateHeap( GetProcessHeap(), 0, (len + 1) * sizeof(WCHAR) )))
+    {
+        buf->error = TRUE;
+        return NULL;
+    }
+    memcpy( str, buf->data + buf->pos, len * sizeof(WCHAR) );
+    str[len] = 0;
+    buf->pos += len * sizeof(WCHAR);
+    return str;
+}
+
+static void cache_get_identity( struct manifest_cache_buffer *buf, struct assembly_identity *ai )
+{
+    ai->name       = cache_get_string( buf );
+    ai->arch       = cache_get_string( buf );
+    ai->public_key = cache_get_string( buf );
+    ai->language   = cache_get_string( buf );
+    ai->type       = cache_get_string( buf );
+    cache_get( buf, &ai->version, sizeof(ai->version) );
+    ai->optional   = cache_get_dword( buf );
+    ai->delayed    = cache_get_dword( buf );
+}
+
 static WCHAR *build_assembly_dir(struct assembly_identity* ai)
 {
     static const WCHAR mskeyW[] = L"deadbeef";
@@ -1095,29 +1258,37 @@ static inline void actctx_addref( ACTIVATION_CONTEXT *actctx )
     InterlockedIncrement( &actctx->ref_count );
 }
 
+/* free the data parsed from the manifest of an assembly */
+static void free_assembly_data( struct assembly *assembly )
+{
+    unsigned int i;
+
+    for (i = 0; i < assembly->num_dlls; i++)
+    {
+        struct dll_redirect *dll = &assembly->dlls[i];
+        free_entity_array( &dll->entities );
+        RtlFreeHeap( GetProcessHeap(), 0, dll->name );
+        RtlFreeHeap( GetProcessHeap(), 0, dll->load_from );
+        RtlFreeHeap( GetProcessHeap(), 0, dll->hash );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, assembly->dlls );
+    RtlFreeHeap( GetProcessHeap(), 0, assembly->compat_contexts );
+    free_entity_array( &assembly->entities );
+    free_assembly_identity(&assembly->id);
+}
+
 static void actctx_release( ACTIVATION_CONTEXT *actctx )
 {
     if (!InterlockedDecrement( &actctx->ref_count ))
     {
-        unsigned int i, j;
+        unsigned int i;
 
         for (i = 0; i < actctx->num_assemblies; i++)
         {
             struct assembly *assembly = &actctx->assemblies[i];
-            for (j = 0; j < assembly->num_dlls; j++)
-            {
-                struct dll_redirect *dll = &assembly->dlls[j];
-                free_entity_array( &dll->entities );
-                RtlFreeHeap( GetProcessHeap(), 0, dll->name );
-                RtlFreeHeap( GetProcessHeap(), 0, dll->load_from );
-                RtlFreeHeap( GetProcessHeap(), 0, dll->hash );
-            }
-            RtlFreeHeap( GetProcessHeap(), 0, assembly->dlls );
+            free_assembly_data( assembly );
             RtlFreeHeap( GetProcessHeap(), 0, assembly->manifest.info );
             RtlFreeHeap( GetProcessHeap(), 0, assembly->directory );
-            RtlFreeHeap( GetProcessHeap(), 0, assembly->compat_contexts );
-            free_entity_array( &assembly->entities );
-            free_assembly_identity(&assembly->id);
         }
         RtlFreeHeap( GetProcessHeap(), 0, actctx->config.info );
         RtlFreeHeap( GetProcessHeap(), 0, actctx->appdir.info );
@@ -1130,6 +1301,14 @@ static void actctx_release( ACTIVATION_CONTEXT *actctx )
         RtlFreeHeap( GetProcessHeap(), 0, actctx->clrsurrogate_section );
         RtlFreeHeap( GetProcessHeap(), 0, actctx->progid_section );
         RtlFreeHeap( GetProcessHeap(), 0, actctx->activatable_class_section );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->wndclass_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->dllredirect_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->progid_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->activatable_class_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->tlib_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->comserver_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->ifaceps_hash );
+        RtlFreeHeap( GetProcessHeap(), 0, actctx->clrsurrogate_hash );
         actctx->magic = 0;
         RtlFreeHeap( GetProcessHeap(), 0, actctx );
     }
@@ -2176,6 +2355,12 @@ static void parse_dependent_assembly_elem( xmlbuf_t *xmlbuf, struct actctx_loade
         if (xml_elem_cmp(&elem, L"assemblyIdentity", asmv1W))
         {
             parse_assembly_identity_elem(xmlbuf, acl->actctx, &ai, &elem);
+            /* the cache is shared between architectures, record the identity as written */
+            if (acl->cache_deps)
+            {
+                cache_put_identity( acl->cache_deps, &ai );
+                acl->cache_deps->count++;
+            }
             /* store the newly found identity for later loading */
             if (ai.arch && !wcscmp(ai.arch, L"*"))
             {
@@ -2682,6 +2867,20 @@ static void parse_trust_info_elem( xmlbuf_t *xmlbuf, struct assembly *assembly,
     }
 }
 
+static BOOL is_expected_version( const struct assembly *assembly, const struct assembly_identity *expected_ai )
+{
+    /* FIXME: more tests */
+    if (assembly->type == ASSEMBLY_MANIFEST)
+        return !memcmp(&assembly->id.version, &expected_ai->version, sizeof(assembly->id.version));
+    if (assembly->type == ASSEMBLY_SHARED_MANIFEST)
+        return assembly->id.version.major == expected_ai->version.major &&
+               assembly->id.version.minor == expected_ai->version.minor &&
+               (assembly->id.version.build > expected_ai->version.build ||
+                (assembly->id.version.build == expected_ai->version.build &&
+                 assembly->id.version.revision >= expected_ai->version.revision));
+    return TRUE;
+}
+
 static void parse_assembly_elem( xmlbuf_t *xmlbuf, struct assembly* assembly,
                                  struct actctx_loader* acl, const struct xml_elem *parent,
                                  struct assembly_identity* expected_ai)
@@ -2758,29 +2957,17 @@ static void parse_assembly_elem( xmlbuf_t *xmlbuf, struct assembly* assembly,
         {
             parse_assembly_identity_elem(xmlbuf, acl->actctx, &assembly->id, &elem);
 
-            if (!xmlbuf->error && expected_ai)
+            if (!xmlbuf->error && expected_ai && !is_expected_version( assembly, expected_ai ))
             {
-                /* FIXME: more tests */
-                if (assembly->type == ASSEMBLY_MANIFEST &&
-                    memcmp(&assembly->id.version, &expected_ai->version, sizeof(assembly->id.version)))
-                {
+                if (assembly->type == ASSEMBLY_MANIFEST)
                     FIXME("wrong version for assembly manifest: %u.%u.%u.%u / %u.%u.%u.%u\n",
                           expected_ai->version.major, expected_ai->version.minor,
                           expected_ai->version.build, expected_ai->version.revision,
                           assembly->id.version.major, assembly->id.version.minor,
                           assembly->id.version.build, assembly->id.version.revision);
-                    set_error( xmlbuf );
-                }
-                else if (assembly->type == ASSEMBLY_SHARED_MANIFEST &&
-                         (assembly->id.version.major != expected_ai->version.major ||
-                          assembly->id.version.minor != expected_ai->version.minor ||
-                          assembly->id.version.build < expected_ai->version.build ||
-                          (assembly->id.version.build == expected_ai->version.build &&
-                           assembly->id.version.revision < expected_ai->version.revision)))
-                {
+                else
                     FIXME("wrong version for shared assembly manifest\n");
-                    set_error( xmlbuf );
-                }
+                set_error( xmlbuf );
             }
         }
         else if (xml_elem_cmp(&elem, L"compatibility", compatibilityNSW))
@@ -2847,16 +3034,11 @@ static NTSTATUS parse_manifest_buffer( struct actctx_loader* acl, struct assembl
     return STATUS_SUCCESS;
 }
 
-static NTSTATUS parse_manifest( struct actctx_loader* acl, struct assembly_identity* ai,
-                                LPCWSTR filename, HANDLE module, LPCWSTR directory, BOOL shared,
-                                const void *buffer, SIZE_T size )
+static NTSTATUS add_manifest_assembly( struct actctx_loader* acl, LPCWSTR filename, HANDLE module,
+                                       LPCWSTR directory, BOOL shared, struct assembly **ret )
 {
-    xmlbuf_t xmlbuf;
-    NTSTATUS status;
     struct assembly *assembly;
-    int unicode_tests;
-
-    TRACE( "parsing manifest loaded from %s base dir %s\n", debugstr_w(filename), debugstr_w(directory) );
+    NTSTATUS status;
 
     if (!(assembly = add_assembly(acl->actctx, shared ? ASSEMBLY_SHARED_MANIFEST : ASSEMBLY_MANIFEST)))
         return STATUS_SXS_CANT_GEN_ACTCTX;
@@ -2874,6 +3056,23 @@ static NTSTATUS parse_manifest( struct actctx_loader* acl, struct assembly_ident
 
     assembly->manifest.type = assembly->manifest.info ? ACTIVATION_CONTEXT_PATH_TYPE_WIN32_FILE
                                                       : ACTIVATION_CONTEXT_PATH_TYPE_NONE;
+    *ret = assembly;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS parse_manifest( struct actctx_loader* acl, struct assembly_identity* ai,
+                                LPCWSTR filename, HANDLE module, LPCWSTR directory, BOOL shared,
+                                const void *buffer, SIZE_T size )
+{
+    xmlbuf_t xmlbuf;
+    NTSTATUS status;
+    struct assembly *assembly;
+    int unicode_tests;
+
+    TRACE( "parsing manifest loaded from %s base dir %s\n", debugstr_w(filename), debugstr_w(directory) );
+
+    if ((status = add_manifest_assembly( acl, filename, module, directory, shared, &assembly )))
+        return status;
 
     unicode_tests = IS_TEXT_UNICODE_SIGNATURE | IS_TEXT_UNICODE_REVERSE_SIGNATURE;
     if (RtlIsTextUnicode( buffer, size, &unicode_tests ))
@@ -3029,10 +3228,448 @@ static NTSTATUS get_manifest_in_pe_file( struct actctx_loader* acl, struct assem
     return status;
 }
 
+/* persistent cache of the parsed winsxs manifests, keyed by manifest file name, time and size */
+
+#define MANIFEST_CACHE_MAGIC    0x4d435357  /* "WSCM" */
+#define MANIFEST_CACHE_VERSION  1
+#define MANIFEST_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+struct manifest_cache_header
+{
+    DWORD    magic;
+    DWORD    version;
+    LONGLONG mtime;      /* last write time of the manifest */
+    LONGLONG size;       /* size of the manifest */
+    DWORD    sections;   /* context sections that the manifest has entries in */
+    DWORD    data_size;  /* size of the serialized assembly following the header */
+};
+
+static void cache_put_entities( struct manifest_cache_buffer *buf, const struct entity_array *entities )
+{
+    unsigned int i, j;
+
+    cache_put_dword( buf, entities->num );
+    for (i = 0; i < entities->num; i++)
+    {
+        const struct entity *entity = &entities->base[i];
+
+        cache_put_dword( buf, entity->kind );
+        switch (entity->kind)
+        {
+        case ACTIVATION_CONTEXT_SECTION_COM_SERVER_REDIRECTION:
+            cache_put_string( buf, entity->u.comclass.clsid );
+            cache_put_string( buf, entity->u.comclass.tlbid );
+            cache_put_string( buf, entity->u.comclass.progid );
+            cache_put_string( buf, entity->u.comclass.name );
+            cache_put_string( buf, entity->u.comclass.version );
+            cache_put_dword( buf, entity->u.comclass.model );
+            cache_put_dword( buf, entity->u.comclass.miscstatus );
+            cache_put_dword( buf, entity->u.comclass.miscstatuscontent );
+            cache_put_dword( buf, entity->u.comclass.miscstatusthumbnail );
+            cache_put_dword( buf, entity->u.comclass.miscstatusicon );
+            cache_put_dword( buf, entity->u.comclass.miscstatusdocprint );
+            cache_put_dword( buf, entity->u.comclass.progids.num );
+            for (j = 0; j < entity->u.comclass.progids.num; j++)
+                cache_put_string( buf, entity->u.comclass.progids.progids[j] );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_COM_INTERFACE_REDIRECTION:
+            cache_put_string( buf, entity->u.ifaceps.iid );
+            cache_put_string( buf, entity->u.ifaceps.base );
+            cache_put_string( buf, entity->u.ifaceps.tlib );
+            cache_put_string( buf, entity->u.ifaceps.name );
+            cache_put_string( buf, entity->u.ifaceps.ps32 );
+            cache_put_dword( buf, entity->u.ifaceps.mask );
+            cache_put_dword( buf, entity->u.ifaceps.nummethods );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_COM_TYPE_LIBRARY_REDIRECTION:
+            cache_put_string( buf, entity->u.typelib.tlbid );
+            cache_put_string( buf, entity->u.typelib.helpdir );
+            cache_put_dword( buf, entity->u.typelib.flags );
+            cache_put_dword( buf, entity->u.typelib.major );
+            cache_put_dword( buf, entity->u.typelib.minor );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_WINDOW_CLASS_REDIRECTION:
+            cache_put_string( buf, entity->u.class.name );
+            cache_put_dword( buf, entity->u.class.versioned );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_CLR_SURROGATES:
+            cache_put_string( buf, entity->u.clrsurrogate.name );
+            cache_put_string( buf, entity->u.clrsurrogate.clsid );
+            cache_put_string( buf, entity->u.clrsurrogate.version );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_APPLICATION_SETTINGS:
+            cache_put_string( buf, entity->u.settings.name );
+            cache_put_string( buf, entity->u.settings.value );
+            cache_put_string( buf, entity->u.settings.ns );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES:
+            cache_put_string( buf, entity->u.activatable_class.name );
+            cache_put_dword( buf, entity->u.activatable_class.threading_model );
+            break;
+        default:
+            buf->error = TRUE;
+            break;
+        }
+    }
+}
+
+static void cache_get_entities( struct manifest_cache_buffer *buf, struct entity_array *entities )
+{
+    unsigned int i, j, count = cache_get_count( buf, sizeof(DWORD) );
+    struct progids *progids;
+    struct entity *entity;
+    DWORD kind;
+
+    for (i = 0; i < count && !buf->error; i++)
+    {
+        kind = cache_get_dword( buf );
+        switch (kind)
+        {
+        case ACTIVATION_CONTEXT_SECTION_COM_SERVER_REDIRECTION:
+        case ACTIVATION_CONTEXT_SECTION_COM_INTERFACE_REDIRECTION:
+        case ACTIVATION_CONTEXT_SECTION_COM_TYPE_LIBRARY_REDIRECTION:
+        case ACTIVATION_CONTEXT_SECTION_WINDOW_CLASS_REDIRECTION:
+        case ACTIVATION_CONTEXT_SECTION_CLR_SURROGATES:
+        case ACTIVATION_CONTEXT_SECTION_APPLICATION_SETTINGS:
+        case ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES:
+            break;
+        default:
+            buf->error = TRUE;
+            return;
+        }
+        if (!(entity = add_entity( entities, kind )))
+        {
+            buf->error = TRUE;
+            return;
+        }
+
+        switch (kind)
+        {
+        case ACTIVATION_CONTEXT_SECTION_COM_SERVER_REDIRECTION:
+            entity->u.comclass.clsid   = cache_get_string( buf );
+            entity->u.comclass.tlbid   = cache_get_string( buf );
+            entity->u.comclass.progid  = cache_get_string( buf );
+            entity->u.comclass.name    = cache_get_string( buf );
+            entity->u.comclass.version = cache_get_string( buf );
+            entity->u.comclass.model               = cache_get_dword( buf );
+            entity->u.comclass.miscstatus          = cache_get_dword( buf );
+            entity->u.comclass.miscstatuscontent   = cache_get_dword( buf );
+            entity->u.comclass.miscstatusthumbnail = cache_get_dword( buf );
+            entity->u.comclass.miscstatusicon      = cache_get_dword( buf );
+            entity->u.comclass.miscstatusdocprint  = cache_get_dword( buf );
+            progids = &entity->u.comclass.progids;
+            if (!(progids->allocated = cache_get_count( buf, sizeof(DWORD) ))) break;
+            if (!(progids->progids = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                      progids->allocated * sizeof(WCHAR *) )))
+            {
+                progids->allocated = 0;
+                buf->error = TRUE;
+                return;
+            }
+            for (j = 0; j < progids->allocated && !buf->error; j++)
+                progids->progids[progids->num++] = cache_get_string( buf );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_COM_INTERFACE_REDIRECTION:
+            entity->u.ifaceps.iid  = cache_get_string( buf );
+            entity->u.ifaceps.base = cache_get_string( buf );
+            entity->u.ifaceps.tlib = cache_get_string( buf );
+            entity->u.ifaceps.name = cache_get_string( buf );
+            entity->u.ifaceps.ps32 = cache_get_string( buf );
+            entity->u.ifaceps.mask       = cache_get_dword( buf );
+            entity->u.ifaceps.nummethods = cache_get_dword( buf );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_COM_TYPE_LIBRARY_REDIRECTION:
+            entity->u.typelib.tlbid   = cache_get_string( buf );
+            entity->u.typelib.helpdir = cache_get_string( buf );
+            entity->u.typelib.flags = cache_get_dword( buf );
+            entity->u.typelib.major = cache_get_dword( buf );
+            entity->u.typelib.minor = cache_get_dword( buf );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_WINDOW_CLASS_REDIRECTION:
+            entity->u.class.name      = cache_get_string( buf );
+            entity->u.class.versioned = cache_get_dword( buf );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_CLR_SURROGATES:
+            entity->u.clrsurrogate.name    = cache_get_string( buf );
+            entity->u.clrsurrogate.clsid   = cache_get_string( buf );
+            entity->u.clrsurrogate.version = cache_get_string( buf );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_APPLICATION_SETTINGS:
+            entity->u.settings.name  = cache_get_string( buf );
+            entity->u.settings.value = cache_get_string( buf );
+            entity->u.settings.ns    = cache_get_string( buf );
+            break;
+        case ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES:
+            entity->u.activatable_class.name            = cache_get_string( buf );
+            entity->u.activatable_class.threading_model = cache_get_dword( buf );
+            break;
+        }
+    }
+}
+
+static void cache_put_assembly( struct manifest_cache_buffer *buf, const struct assembly *assembly )
+{
+    unsigned int i;
+
+    cache_put_identity( buf, &assembly->id );
+    cache_put_dword( buf, assembly->no_inherit );
+    cache_put_entities( buf, &assembly->entities );
+    cache_put_dword( buf, assembly->num_dlls );
+    for (i = 0; i < assembly->num_dlls; i++)
+    {
+        cache_put_string( buf, assembly->dlls[i].name );
+        cache_put_string( buf, assembly->dlls[i].load_from );
+        cache_put_string( buf, assembly->dlls[i].hash );
+        cache_put_entities( buf, &assembly->dlls[i].entities );
+    }
+    cache_put_dword( buf, assembly->num_compat_contexts );
+    cache_put( buf, assembly->compat_contexts, assembly->num_compat_contexts * sizeof(*assembly->compat_contexts) );
+    cache_put_dword( buf, assembly->run_level );
+    cache_put_dword( buf, assembly->ui_access );
+}
+
+static void cache_get_assembly( struct manifest_cache_buffer *buf, struct assembly *assembly )
+{
+    unsigned int i, count;
+
+    cache_get_identity( buf, &assembly->id );
+    assembly->no_inherit = cache_get_dword( buf );
+    cache_get_entities( buf, &assembly->entities );
+
+    if ((count = cache_get_count( buf, 4 * sizeof(DWORD) )))
+    {
+        if (!(assembly->dlls = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(*assembly->dlls) )))
+        {
+            buf->error = TRUE;
+            return;
+        }
+        assembly->num_dlls = assembly->allocated_dlls = count;
+    }
+    for (i = 0; i < assembly->num_dlls && !buf->error; i++)
+    {
+        assembly->dlls[i].name      = cache_get_string( buf );
+        assembly->dlls[i].load_from = cache_get_string( buf );
+        assembly->dlls[i].hash      = cache_get_string( buf );
+        cache_get_entities( buf, &assembly->dlls[i].entities );
+    }
+
+    if ((count = cache_get_count( buf, sizeof(*assembly->compat_contexts) )))
+    {
+        if (!(assembly->compat_contexts = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                           count * sizeof(*assembly->compat_contexts) )))
+        {
+            buf->error = TRUE;
+            return;
+        }
+        assembly->num_compat_contexts = count;
+        cache_get( buf, assembly->compat_contexts, count * sizeof(*assembly->compat_contexts) );
+    }
+    assembly->run_level = cache_get_dword( buf );
+    assembly->ui_access = cache_get_dword( buf );
+}
+
+/* get the NT name of the cache file of a winsxs manifest */
+static BOOL get_manifest_cache_name( LPCWSTR filename, BOOL create_dir, UNICODE_STRING *nt_name )
+{
+    static const WCHAR cache_dirW[] = L"\\winsxs\\ManifestCache";
+    const WCHAR *name = wcsrchr( filename, '\\' );
+    OBJECT_ATTRIBUTES attr;
+    IO_STATUS_BLOCK io;
+    HANDLE handle;
+    WCHAR *path;
+    BOOL ret;
+
+    if (!name) return FALSE;
+    if (!(path = RtlAllocateHeap( GetProcessHeap(), 0, (wcslen(windows_dir) + wcslen(name)) * sizeof(WCHAR) +
+                                  sizeof(cache_dirW) + sizeof(L".cache") )))
+        return FALSE;
+    wcscpy( path, windows_dir );
+    wcscat( path, cache_dirW );
+
+    if (create_dir && RtlDosPathNameToNtPathName_U( path, nt_name, NULL, NULL ))
+    {
+        InitializeObjectAttributes( &attr, nt_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+        if (!NtCreateFile( &handle, FILE_LIST_DIRECTORY | SYNCHRONIZE, &attr, &io, NULL, 0,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_OPEN_IF,
+                           FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT, NULL, 0 ))
+            NtClose( handle );
+        RtlFreeUnicodeString( nt_name );
+    }
+
+    wcscat( path, name );
+    wcscat( path, L".cache" );
+    ret = RtlDosPathNameToNtPathName_U( path, nt_name, NULL, NULL );
+    RtlFreeHeap( GetProcessHeap(), 0, path );
+    return ret;
+}
+
+/* load a parsed winsxs manifest from the cache; returns STATUS_NOT_FOUND if it has to be parsed */
+static NTSTATUS load_manifest_cache( struct actctx_loader *acl, struct assembly_identity *ai,
+                                     LPCWSTR filename, LPCWSTR directory,
+                                     const FILE_NETWORK_OPEN_INFORMATION *info )
+{
+    struct manifest_cache_buffer buf = { NULL };
+    struct manifest_cache_header header;
+    struct assembly_identity *deps = NULL;
+    struct assembly data, *assembly;
+    unsigned int i, num_deps = 0;
+    NTSTATUS status = STATUS_NOT_FOUND;
+    UNICODE_STRING name;
+    IO_STATUS_BLOCK io;
+    HANDLE handle;
+
+    if (!get_manifest_cache_name( filename, FALSE, &name )) return STATUS_NOT_FOUND;
+    status = open_nt_file( &handle, &name );
+    RtlFreeUnicodeString( &name );
+    if (status) return STATUS_NOT_FOUND;
+
+    if (!NtReadFile( handle, 0, NULL, NULL, &io, &header, sizeof(header), NULL, NULL ) &&
+        io.Information == sizeof(header) &&
+        header.magic == MANIFEST_CACHE_MAGIC && header.version == MANIFEST_CACHE_VERSION &&
+        header.mtime == info->LastWriteTime.QuadPart && header.size == info->EndOfFile.QuadPart &&
+        header.data_size <= MANIFEST_CACHE_MAX_SIZE &&
+        (buf.data = RtlAllocateHeap( GetProcessHeap(), 0, header.data_size )))
+    {
+        buf.size = header.data_size;
+        if (NtReadFile( handle, 0, NULL, NULL, &io, buf.data, buf.size, NULL, NULL ) || io.Information != buf.size)
+            buf.error = TRUE;
+    }
+    else buf.error = TRUE;
+    NtClose( handle );
+
+    memset( &data, 0, sizeof(data) );
+    data.type = ASSEMBLY_SHARED_MANIFEST;
+    cache_get_assembly( &buf, &data );
+    if ((num_deps = cache_get_count( &buf, 5 * sizeof(DWORD) )) &&
+        !(deps = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, num_deps * sizeof(*deps) )))
+        buf.error = TRUE;
+    for (i = 0; i < num_deps && !buf.error; i++)
+    {
+        cache_get_identity( &buf, &deps[i] );
+        if (deps[i].arch && !wcscmp( deps[i].arch, L"*" ))
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, deps[i].arch );
+            if (!(deps[i].arch = strdupW( current_archW ))) buf.error = TRUE;
+        }
+    }
+    if (buf.pos != buf.size || (ai && !is_expected_version( &data, ai ))) buf.error = TRUE;
+
+    status = STATUS_NOT_FOUND;
+    if (!buf.error && !(status = add_manifest_assembly( acl, filename, NULL, directory, TRUE, &assembly )))
+    {
+        TRACE( "using cached manifest %s\n", debugstr_w(filename) );
+        data.manifest = assembly->manifest;
+        data.directory = assembly->directory;
+        *assembly = data;
+        acl->actctx->sections |= header.sections;
+        for (i = 0; i < num_deps; i++)
+        {
+            if (add_dependent_assembly_id( acl, &deps[i] )) continue;
+            free_assembly_identity( &deps[i] );
+            status = STATUS_NO_MEMORY;
+        }
+    }
+    else
+    {
+        free_assembly_data( &data );
+        for (i = 0; i < num_deps; i++) free_assembly_identity( &deps[i] );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, deps );
+    RtlFreeHeap( GetProcessHeap(), 0, buf.data );
+    return status;
+}
+
+/* store a parsed winsxs manifest in the cache */
+static void save_manifest_cache( const struct assembly *assembly, LPCWSTR filename,
+                                 const FILE_NETWORK_OPEN_INFORMATION *info, DWORD sections,
+                                 const struct manifest_cache_buffer *deps )
+{
+    struct manifest_cache_buffer buf = { NULL };
+    struct manifest_cache_header header;
+    FILE_RENAME_INFORMATION *rename_info = NULL;
+    FILE_DISPOSITION_INFORMATION disposition;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name, tmp;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER now;
+    HANDLE handle;
+    NTSTATUS status;
+
+    /* don't trust a file modified within the timestamp granularity of some file systems */
+    NtQuerySystemTime( &now );
+    if (now.QuadPart - info->LastWriteTime.QuadPart < 2 * (LONGLONG)10000000) return;
+    if (deps->error) return;
+
+    memset( &header, 0, sizeof(header) );
+    cache_put( &buf, &header, sizeof(header) );
+    cache_put_assembly( &buf, assembly );
+    cache_put_dword( &buf, deps->count );
+    cache_put( &buf, deps->data, deps->pos );
+    if (buf.error || buf.pos - sizeof(header) > MANIFEST_CACHE_MAX_SIZE)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, buf.data );
+        return;
+    }
+    header.magic     = MANIFEST_CACHE_MAGIC;
+    header.version   = MANIFEST_CACHE_VERSION;
+    header.mtime     = info->LastWriteTime.QuadPart;
+    header.size      = info->EndOfFile.QuadPart;
+    header.sections  = sections;
+    header.data_size = buf.pos - sizeof(header);
+    memcpy( buf.data, &header, sizeof(header) );
+
+    if (!get_manifest_cache_name( filename, TRUE, &name ))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, buf.data );
+        return;
+    }
+
+    /* write it under a temporary name, other processes may be doing the same */
+    tmp.MaximumLength = name.Length + 16 * sizeof(WCHAR);
+    if (!(tmp.Buffer = RtlAllocateHeap( GetProcessHeap(), 0, tmp.MaximumLength ))) goto done;
+    tmp.Length = swprintf( tmp.Buffer, tmp.MaximumLength / sizeof(WCHAR), L"%s.%x", name.Buffer,
+                           HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess )) * sizeof(WCHAR);
+    InitializeObjectAttributes( &attr, &tmp, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtCreateFile( &handle, GENERIC_WRITE | DELETE | SYNCHRONIZE, &attr, &io, NULL, 0, 0, FILE_OVERWRITE_IF,
+                      FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT, NULL, 0 ))
+        goto done;
+
+    status = NtWriteFile( handle, 0, NULL, NULL, &io, buf.data, buf.pos, NULL, NULL );
+    if (!status && io.Information != buf.pos) status = STATUS_DISK_FULL;
+    if (!status && !(rename_info = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                    offsetof( FILE_RENAME_INFORMATION, FileName[name.Length / sizeof(WCHAR)] ))))
+        status = STATUS_NO_MEMORY;
+    if (!status)
+    {
+        rename_info->ReplaceIfExists = TRUE;
+        rename_info->RootDirectory = 0;
+        rename_info->FileNameLength = name.Length;
+        memcpy( rename_info->FileName, name.Buffer, name.Length );
+        status = NtSetInformationFile( handle, &io, rename_info,
+                                       offsetof( FILE_RENAME_INFORMATION, FileName[name.Length / sizeof(WCHAR)] ),
+                                       FileRenameInformation );
+    }
+    if (status)
+    {
+        WARN( "failed to write %s, status %#lx\n", debugstr_us(&name), status );
+        disposition.DoDeleteFile = TRUE;
+        NtSetInformationFile( handle, &io, &disposition, sizeof(disposition), FileDispositionInformation );
+    }
+    else TRACE( "created %s\n", debugstr_us(&name) );
+    NtClose( handle );
+
+done:
+    RtlFreeHeap( GetProcessHeap(), 0, rename_info );
+    RtlFreeHeap( GetProcessHeap(), 0, tmp.Buffer );
+    RtlFreeUnicodeString( &name );
+    RtlFreeHeap( GetProcessHeap(), 0, buf.data );
+}
+
 static NTSTATUS get_manifest_in_manifest_file( struct actctx_loader* acl, struct assembly_identity* ai,
                                                LPCWSTR filename, LPCWSTR directory, BOOL shared, HANDLE file )
 {
-    FILE_END_OF_FILE_INFORMATION info;
+    FILE_NETWORK_OPEN_INFORMATION info;
+    struct manifest_cache_buffer deps = { NULL };
     IO_STATUS_BLOCK io;
     HANDLE              mapping;
     OBJECT_ATTRIBUTES   attr;
@@ -3040,10 +3677,18 @@ static NTSTATUS get_manifest_in_manifest_file( struct actctx_loader* acl, struct
     LARGE_INTEGER       offset;
     NTSTATUS            status;
     SIZE_T              count;
+    DWORD               sections;
     void               *base;
 
     TRACE( "loading manifest file %s\n", debugstr_w(filename) );
 
+    status = NtQueryInformationFile( file, &io, &info, sizeof(info), FileNetworkOpenInformation );
+    if (status != STATUS_SUCCESS) return status;
+
+    /* shared assemblies are loaded from the cache of parsed manifests if possible */
+    if (shared && (status = load_manifest_cache( acl, ai, filename, directory, &info )) != STATUS_NOT_FOUND)
+        return status;
+
     attr.Length                   = sizeof(attr);
     attr.RootDirectory            = 0;
     attr.ObjectName               = NULL;
@@ -3064,9 +3709,25 @@ static NTSTATUS get_manifest_in_manifest_file( struct actctx_loader* acl, struct
     NtClose( mapping );
     if (status != STATUS_SUCCESS) return status;
 
-    status = NtQueryInformationFile( file, &io, &info, sizeof(info), FileEndOfFileInformation );
-    if (status == STATUS_SUCCESS)
-        status = parse_manifest(acl, ai, filename, NULL, directory, shared, base, info.EndOfFile.QuadPart);
+    if (shared)
+    {
+        /* collect the sections and dependencies of this manifest alone */
+        sections = acl->actctx->sections;
+        acl->actctx->sections = 0;
+        acl->cache_deps = &deps;
+    }
+
+    status = parse_manifest(acl, ai, filename, NULL, directory, shared, base, info.EndOfFile.QuadPart);
+
+    if (shared)
+    {
+        if (status == STATUS_SUCCESS)
+            save_manifest_cache( &acl->actctx->assemblies[acl->actctx->num_assemblies - 1], filename,
+                                 &info, acl->actctx->sections, &deps );
+        acl->actctx->sections |= sections;
+        acl->cache_deps = NULL;
+        RtlFreeHeap( GetProcessHeap(), 0, deps.data );
+    }
 
     NtUnmapViewOfSection( GetCurrentProcess(), base );
     return status;
@@ -3201,6 +3862,107 @@ static WCHAR *lookup_manifest_file( HANDLE dir, struct assembly_identity *ai )
     return ret;
 }
 
+/* the winsxs_cache_section must be held while calling this function */
+static void flush_winsxs_cache(void)
+{
+    struct winsxs_cache_entry *cache, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( cache, next, &winsxs_cache, struct winsxs_cache_entry, entry )
+    {
+        list_remove( &cache->entry );
+        RtlFreeHeap( GetProcessHeap(), 0, cache->key );
+        RtlFreeHeap( GetProcessHeap(), 0, cache->file );
+        RtlFreeHeap( GetProcessHeap(), 0, cache );
+    }
+    winsxs_cache_count = 0;
+}
+
+/* look up the manifest file of an assembly in the winsxs manifests directory,
+ * remembering the result until the directory gets modified */
+static WCHAR *lookup_manifest_file_cached( OBJECT_ATTRIBUTES *attr, struct assembly_identity *ai )
+{
+    FILE_NETWORK_OPEN_INFORMATION info;
+    struct winsxs_cache_entry *cache;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER now;
+    WCHAR *key = NULL, *file = NULL;
+    HANDLE handle;
+    BOOL listed = FALSE;
+    ULONG len;
+
+    if (!NtQueryFullAttributesFile( attr, &info ))
+    {
+        len = wcslen(ai->arch) + wcslen(ai->name) + wcslen(ai->public_key) +
+              (ai->language ? wcslen(ai->language) : 0) + 40;
+        if ((key = RtlAllocateHeap( GetProcessHeap(), 0, len * sizeof(WCHAR) )))
+            swprintf( key, len, L"%s_%s_%s_%u.%u.%u.%u_%s", ai->arch, ai->name, ai->public_key,
+                      ai->version.major, ai->version.minor, ai->version.build, ai->version.revision,
+                      ai->language ? ai->language : L"" );
+    }
+
+    if (key)
+    {
+        RtlEnterCriticalSection( &winsxs_cache_section );
+        if (winsxs_cache_mtime != info.LastWriteTime.QuadPart)
+        {
+            flush_winsxs_cache();
+            winsxs_cache_mtime = info.LastWriteTime.QuadPart;
+        }
+        LIST_FOR_EACH_ENTRY( cache, &winsxs_cache, struct winsxs_cache_entry, entry )
+        {
+            if (wcscmp( cache->key, key )) continue;
+            if (cache->file && !(file = strdupW( cache->file ))) break;
+            if (file)
+            {
+                ai->version.build = cache->build;
+                ai->version.revision = cache->revision;
+            }
+            RtlLeaveCriticalSection( &winsxs_cache_section );
+            RtlFreeHeap( GetProcessHeap(), 0, key );
+            return file;
+        }
+        RtlLeaveCriticalSection( &winsxs_cache_section );
+    }
+
+    if (!NtOpenFile( &handle, GENERIC_READ | SYNCHRONIZE, attr, &io, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                     FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
+    {
+        file = lookup_manifest_file( handle, ai );
+        NtClose( handle );
+        listed = TRUE;
+    }
+
+    /* don't trust a directory modified within the timestamp granularity of some file systems */
+    NtQuerySystemTime( &now );
+    if (key && listed && now.QuadPart - info.LastWriteTime.QuadPart >= 2 * (LONGLONG)10000000 &&
+        (cache = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*cache) )))
+    {
+        cache->key = key;
+        cache->file = NULL;
+        cache->build = ai->version.build;
+        cache->revision = ai->version.revision;
+        if (file && !(cache->file = strdupW( file ))) cache->key = NULL;
+
+        RtlEnterCriticalSection( &winsxs_cache_section );
+        if (cache->key && winsxs_cache_mtime == info.LastWriteTime.QuadPart &&
+            winsxs_cache_count < MAX_WINSXS_CACHE_ENTRIES)
+        {
+            list_add_head( &winsxs_cache, &cache->entry );
+            winsxs_cache_count++;
+            key = NULL;
+            cache = NULL;
+        }
+        RtlLeaveCriticalSection( &winsxs_cache_section );
+        if (cache)
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, cache->file );
+            RtlFreeHeap( GetProcessHeap(), 0, cache );
+        }
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, key );
+    return file;
+}
+
 static NTSTATUS lookup_winsxs(struct actctx_loader* acl, struct assembly_identity* ai)
 {
     struct assembly_identity    sxs_ai;
@@ -3233,13 +3995,8 @@ static NTSTATUS lookup_winsxs(struct actctx_loader* acl, struct assembly_identit
     attr.SecurityDescriptor = NULL;
     attr.SecurityQualityOfService = NULL;
 
-    if (!NtOpenFile( &handle, GENERIC_READ | SYNCHRONIZE, &attr, &io, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                     FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
-    {
-        sxs_ai = *ai;
-        file = lookup_manifest_file( handle, &sxs_ai );
-        NtClose( handle );
-    }
+    sxs_ai = *ai;
+    file = lookup_manifest_file_cached( &attr, &sxs_ai );
     if (!file)
     {
         RtlFreeUnicodeString( &path_us );
@@ -3525,16 +4282,83 @@ static NTSTATUS build_dllredirect_section(ACTIVATION_CONTEXT* actctx, struct str
     return STATUS_SUCCESS;
 }
 
-static struct string_index *find_string_index(const struct strsection_header *section, const UNICODE_STRING *name)
+static inline ULONG mix_section_hash( ULONG hash )
+{
+    return hash ^ (hash >> 16);
+}
+
+static inline ULONG get_guid_hash( const GUID *guid )
+{
+    const ULONG *data = (const ULONG *)guid;
+    return data[0] ^ data[1] ^ data[2] ^ data[3];
+}
+
+/* small sections are scanned fast enough */
+#define MIN_HASHED_SECTION_COUNT 8
+
+static struct section_hash *alloc_section_hash( ULONG count )
+{
+    struct section_hash *hash;
+    ULONG size;
+
+    for (size = 16; size < 2 * count; size *= 2) ;
+    if (!(hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, offsetof( struct section_hash, slots[size] ))))
+        return NULL;
+    hash->mask = size - 1;
+    return hash;
+}
+
+static void insert_section_hash( struct section_hash *hash, ULONG key, ULONG pos )
 {
-    struct string_index *iter, *index = NULL;
+    ULONG slot = mix_section_hash( key ) & hash->mask;
+
+    /* entries with the same key stay in index order */
+    while (hash->slots[slot]) slot = (slot + 1) & hash->mask;
+    hash->slots[slot] = pos + 1;
+}
+
+static struct section_hash *install_section_hash( struct section_hash **ptr, struct section_hash *hash )
+{
+    struct section_hash *prev;
+
+    if (!hash) return NULL;
+    if (!(prev = InterlockedCompareExchangePointer( (void **)ptr, hash, NULL ))) return hash;
+    RtlFreeHeap( GetProcessHeap(), 0, hash );
+    return prev;
+}
+
+static struct string_index *find_string_index(const struct strsection_header *section, const UNICODE_STRING *name,
+                                              struct section_hash **section_hash)
+{
+    struct string_index *iter, *index = NULL, *first = (struct string_index *)((BYTE *)section + section->index_offset);
+    struct section_hash *table = *section_hash;
     UNICODE_STRING str;
-    ULONG hash = 0, i;
+    ULONG hash = 0, i, slot, pos;
 
     RtlHashUnicodeString(name, TRUE, HASH_STRING_ALGORITHM_X65599, &hash);
-    iter = (struct string_index*)((BYTE*)section + section->index_offset);
 
-    for (i = 0; i < section->count; i++)
+    if (!table && section->count >= MIN_HASHED_SECTION_COUNT &&
+        (table = alloc_section_hash( section->count )))
+    {
+        for (i = 0; i < section->count; i++) insert_section_hash( table, first[i].hash, i );
+        table = install_section_hash( section_hash, table );
+    }
+
+    if (table)
+    {
+        for (slot = mix_section_hash( hash ) & table->mask; (pos = table->slots[slot]); slot = (slot + 1) & table->mask)
+        {
+            iter = &first[pos - 1];
+            if (iter->hash != hash) continue;
+            str.Buffer = (WCHAR *)((BYTE *)section + iter->name_offset);
+            str.Length = iter->name_len;
+            if (RtlEqualUnicodeString( &str, name, TRUE )) return iter;
+            WARN("hash collision 0x%08lx, %s, %s\n", hash, debugstr_us(name), debugstr_us(&str));
+        }
+        return NULL;
+    }
+
+    for (i = 0, iter = first; i < section->count; i++)
     {
         if (iter->hash == hash)
         {
@@ -3554,14 +4378,32 @@ static struct string_index *find_string_index(const struct strsection_header *se
     return index;
 }
 
-static struct guid_index *find_guid_index(const struct guidsection_header *section, const GUID *guid)
+static struct guid_index *find_guid_index(const struct guidsection_header *section, const GUID *guid,
+                                          struct section_hash **section_hash)
 {
-    struct guid_index *iter, *index = NULL;
-    ULONG i;
+    struct guid_index *iter, *index = NULL, *first = (struct guid_index *)((BYTE *)section + section->index_offset);
+    struct section_hash *table = *section_hash;
+    ULONG i, slot, pos;
+
+    if (!table && section->count >= MIN_HASHED_SECTION_COUNT &&
+        (table = alloc_section_hash( section->count )))
+    {
+        for (i = 0; i < section->count; i++) insert_section_hash( table, get_guid_hash( &first[i].guid ), i );
+        table = install_section_hash( section_hash, table );
+    }
 
-    iter = (struct guid_index*)((BYTE*)section + section->index_offset);
+    if (table)
+    {
+        for (slot = mix_section_hash( get_guid_hash( guid )) & table->mask; (pos = table->slots[slot]);
+             slot = (slot + 1) & table->mask)
+        {
+            iter = &first[pos - 1];
+            if (!memcmp( guid, &iter->guid, sizeof(*guid) )) return iter;
+        }
+        return NULL;
+    }
 
-    for (i = 0; i < section->count; i++)
+    for (i = 0, iter = first; i < section->count; i++)
     {
         if (!memcmp(guid, &iter->guid, sizeof(*guid)))
         {
@@ -3598,7 +4440,7 @@ static NTSTATUS find_dll_redirection(ACTIVATION_CONTEXT* actctx, const UNICODE_S
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    index = find_string_index(actctx->dllredirect_section, name);
+    index = find_string_index(actctx->dllredirect_section, name, &actctx->dllredirect_hash);
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
     if (data)
@@ -3621,11 +4463,6 @@ static NTSTATUS find_dll_redirection(ACTIVATION_CONTEXT* actctx, const UNICODE_S
     return STATUS_SUCCESS;
 }
 
-static inline struct string_index *get_wndclass_first_index(ACTIVATION_CONTEXT *actctx)
-{
-    return (struct string_index*)((BYTE*)actctx->wndclass_section + actctx->wndclass_section->index_offset);
-}
-
 static inline struct wndclass_redirect_data *get_wndclass_data(ACTIVATION_CONTEXT *ctxt, struct string_index *index)
 {
     return (struct wndclass_redirect_data*)((BYTE*)ctxt->wndclass_section + index->data_offset);
@@ -3771,11 +4608,8 @@ static NTSTATUS build_wndclass_section(ACTIVATION_CONTEXT* actctx, struct strsec
 static NTSTATUS find_window_class(ACTIVATION_CONTEXT* actctx, const UNICODE_STRING *name,
                                   PACTCTX_SECTION_KEYED_DATA data)
 {
-    struct string_index *iter, *index = NULL;
+    struct string_index *index;
     struct wndclass_redirect_data *class;
-    UNICODE_STRING str;
-    ULONG hash;
-    int i;
 
     if (!(actctx->sections & WINDOWCLASS_SECTION)) return STATUS_SXS_KEY_NOT_FOUND;
 
@@ -3790,26 +4624,7 @@ static NTSTATUS find_window_class(ACTIVATION_CONTEXT* actctx, const UNICODE_STRI
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    hash = 0;
-    RtlHashUnicodeString(name, TRUE, HASH_STRING_ALGORITHM_X65599, &hash);
-    iter = get_wndclass_first_index(actctx);
-
-    for (i = 0; i < actctx->wndclass_section->count; i++)
-    {
-        if (iter->hash == hash)
-        {
-            str.Buffer = (WCHAR *)((BYTE *)actctx->wndclass_section + iter->name_offset);
-            str.Length = iter->name_len;
-            if (RtlEqualUnicodeString( &str, name, TRUE ))
-            {
-                index = iter;
-                break;
-            }
-            else
-                WARN("hash collision 0x%08lx, %s, %s\n", hash, debugstr_us(name), debugstr_us(&str));
-        }
-        iter++;
-    }
+    index = find_string_index(actctx->wndclass_section, name, &actctx->wndclass_hash);
 
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
@@ -3834,11 +4649,6 @@ static NTSTATUS find_window_class(ACTIVATION_CONTEXT* actctx, const UNICODE_STRI
     return STATUS_SUCCESS;
 }
 
-static inline struct string_index *get_activatable_class_first_index(ACTIVATION_CONTEXT *actctx)
-{
-    return (struct string_index *)((BYTE *)actctx->activatable_class_section + actctx->activatable_class_section->index_offset);
-}
-
 static inline struct activatable_class_data *get_activatable_class_data(ACTIVATION_CONTEXT *ctxt, struct string_index *index)
 {
     return (struct activatable_class_data *)((BYTE *)ctxt->activatable_class_section + index->data_offset);
@@ -3971,11 +4781,8 @@ static NTSTATUS build_activatable_class_section(ACTIVATION_CONTEXT *actctx, stru
 static NTSTATUS find_activatable_class(ACTIVATION_CONTEXT* actctx, const UNICODE_STRING *name,
                                        PACTCTX_SECTION_KEYED_DATA data)
 {
-    struct string_index *iter, *index = NULL;
+    struct string_index *index;
     struct activatable_class_data *class;
-    UNICODE_STRING str;
-    ULONG hash;
-    int i;
 
     if (!(actctx->sections & ACTIVATABLE_CLASS_SECTION)) return STATUS_SXS_KEY_NOT_FOUND;
 
@@ -3990,26 +4797,7 @@ static NTSTATUS find_activatable_class(ACTIVATION_CONTEXT* actctx, const UNICODE
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    hash = 0;
-    RtlHashUnicodeString(name, TRUE, HASH_STRING_ALGORITHM_X65599, &hash);
-    iter = get_activatable_class_first_index(actctx);
-
-    for (i = 0; i < actctx->activatable_class_section->count; i++)
-    {
-        if (iter->hash == hash)
-        {
-            str.Buffer = (WCHAR *)((BYTE *)actctx->activatable_class_section + iter->name_offset);
-            str.Length = iter->name_len;
-            if (RtlEqualUnicodeString( &str, name, TRUE ))
-            {
-                index = iter;
-                break;
-            }
-            else
-                WARN("hash collision 0x%08lx, %s, %s\n", hash, debugstr_us(name), debugstr_us(&str));
-        }
-        iter++;
-    }
+    index = find_string_index(actctx->activatable_class_section, name, &actctx->activatable_class_hash);
 
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
@@ -4181,7 +4969,7 @@ static NTSTATUS find_tlib_redirection(ACTIVATION_CONTEXT* actctx, const GUID *gu
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    index = find_guid_index(actctx->tlib_section, guid);
+    index = find_guid_index(actctx->tlib_section, guid, &actctx->tlib_hash);
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
     tlib = get_tlib_data(actctx, index);
@@ -4514,7 +5302,7 @@ static NTSTATUS find_comserver_redirection(ACTIVATION_CONTEXT* actctx, const GUI
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    index = find_guid_index(actctx->comserver_section, guid);
+    index = find_guid_index(actctx->comserver_section, guid, &actctx->comserver_hash);
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
     comclass = get_comclass_data(actctx, index);
@@ -4704,7 +5492,7 @@ static NTSTATUS find_cominterface_redirection(ACTIVATION_CONTEXT* actctx, const
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    index = find_guid_index(actctx->ifaceps_section, guid);
+    index = find_guid_index(actctx->ifaceps_section, guid, &actctx->ifaceps_hash);
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
     iface = get_ifaceps_data(actctx, index);
@@ -4852,7 +5640,7 @@ static NTSTATUS find_clr_surrogate(ACTIVATION_CONTEXT* actctx, const GUID *guid,
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    index = find_guid_index(actctx->clrsurrogate_section, guid);
+    index = find_guid_index(actctx->clrsurrogate_section, guid, &actctx->clrsurrogate_hash);
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
     surrogate = get_surrogate_data(actctx, index);
@@ -4963,7 +5751,7 @@ static void add_progid_record(ACTIVATION_CONTEXT* actctx, struct strsection_head
             RtlInitUnicodeString(&str, entity->u.comclass.clsid);
             RtlGUIDFromString(&str, &clsid);
 
-            guid_index = find_guid_index(actctx->comserver_section, &clsid);
+            guid_index = find_guid_index(actctx->comserver_section, &clsid, &actctx->comserver_hash);
             comclass = get_comclass_data(actctx, guid_index);
 
             if (entity->u.comclass.progid)
@@ -5066,7 +5854,7 @@ static NTSTATUS find_progid_redirection(ACTIVATION_CONTEXT* actctx, const UNICOD
             RtlFreeHeap(GetProcessHeap(), 0, section);
     }
 
-    index = find_string_index(actctx->progid_section, name);
+    index = find_string_index(actctx->progid_section, name, &actctx->progid_hash);
     if (!index) return STATUS_SXS_KEY_NOT_FOUND;
 
     if (data)
@@ -5294,6 +6082,7 @@ NTSTATUS WINAPI RtlCreateActivationContext( HANDLE *handle, const void *ptr )
     acl.dependencies = NULL;
     acl.num_dependencies = 0;
     acl.allocated_dependencies = 0;
+    acl.cache_deps = NULL;
 
     if (pActCtx->dwFlags & ACTCTX_FLAG_LANGID_VALID) lang = pActCtx->wLangId;
     if (pActCtx->dwFlags & ACTCTX_FLAG_ASSEMBLY_DIRECTORY_VALID) directory = pActCtx->lpAssemblyDirectory;
@@ -94,6 +94,7 @@ C_ASSERT( sizeof(struct block) == 8 );
 #define BLOCK_FLAG_PREV_FREE   0x02
 #define BLOCK_FLAG_FREE_LINK   0x03
 #define BLOCK_FLAG_LARGE       0x04
+#define BLOCK_FLAG_LFH         0x08 /* block is handled by the LFH front end */
 #define BLOCK_FLAG_USER_INFO   0x10 /* user flags up to 0xf0 */
 #define BLOCK_FLAG_USER_MASK   0xf0
 
@@ -182,6 +183,55 @@ typedef struct DECLSPEC_ALIGN(BLOCK_ALIGN) tagSUBHEAP
 C_ASSERT( sizeof(SUBHEAP) == offsetof(SUBHEAP, block) + sizeof(struct block) );
 C_ASSERT( sizeof(SUBHEAP) == 4 * BLOCK_ALIGN );
 
+/* a group of fixed-size blocks, allocated from the heap as a single block */
+struct DECLSPEC_ALIGN(BLOCK_ALIGN) group
+{
+    SLIST_ENTRY entry;
+    /* one bit for each free block and the highest bit for GROUP_FLAG_FREE */
+    LONG free_bits;
+#ifdef _WIN64
+    DWORD __pad;
+#endif
+    /* first block of the group, the others follow it */
+    struct block first_block;
+};
+
+/* block must be last and aligned */
+C_ASSERT( sizeof(struct group) == offsetof(struct group, first_block) + sizeof(struct block) );
+C_ASSERT( sizeof(struct group) % BLOCK_ALIGN == 0 );
+
+#define GROUP_BLOCK_COUNT     (sizeof(((struct group *)0)->free_bits) * 8 - 1)
+/* the group isn't owned by any thread, the last thread freeing one of its blocks takes it */
+#define GROUP_FLAG_FREE       (1u << GROUP_BLOCK_COUNT)
+#define GROUP_FREE_BITS_MASK  (GROUP_FLAG_FREE - 1)
+
+/* max number of fully free groups kept in a bin */
+#define GROUP_CACHE_DEPTH     4
+
+/* LFH block sizes are BLOCK_ALIGN apart up to BIN_SMALL_MAX, and BIN_LARGE_STEP apart up to
+ * HEAP_MAX_BIN_BLOCK_SIZE, so that the unused size of a block always fits in its tail_size */
+#define BIN_SMALL_MAX           0x400
+#define BIN_LARGE_STEP          0x80
+#define HEAP_MAX_BIN_BLOCK_SIZE 0x2000
+#define BIN_COUNT               (BIN_SMALL_MAX / BLOCK_ALIGN + (HEAP_MAX_BIN_BLOCK_SIZE - BIN_SMALL_MAX) / BIN_LARGE_STEP)
+
+C_ASSERT( BIN_LARGE_STEP + 3 * BLOCK_ALIGN <= FIELD_MAX( struct block, tail_size ) );
+C_ASSERT( offsetof(struct group, first_block) + GROUP_BLOCK_COUNT * HEAP_MAX_BIN_BLOCK_SIZE < HEAP_MIN_LARGE_BLOCK_SIZE );
+
+/* number of thread affinity slots, each with its own group for every bin */
+#define AFFINITY_COUNT          32
+
+/* a bin, tracking LFH blocks of a given size */
+struct bin
+{
+    /* counters for the bin activation */
+    LONG count_alloc;
+    LONG count_freed;
+    LONG enabled;
+    /* fully free groups, ready to be used by any thread */
+    SLIST_HEADER groups;
+};
+
 struct heap
 {                                  /* win32/win64 */
     DWORD_PTR        unknown1[2];   /* 0000/0000 */
@@ -202,6 +252,7 @@ struct heap
     DWORD            magic;         /* Magic number */
     DWORD            pending_pos;   /* Position in pending free requests ring */
     struct block   **pending_free;  /* Ring buffer for pending free requests */
+    struct bin      *bins;          /* LFH bins followed by the affinity groups, NULL if LFH isn't enabled */
     RTL_CRITICAL_SECTION cs;
     struct entry     free_lists[HEAP_NB_FREE_LISTS];
     SUBHEAP          subheap;
@@ -227,6 +278,11 @@ C_ASSERT( offsetof(struct heap, subheap) <= REGION_ALIGN - 1 );
 #define HEAP_VALIDATE_PARAMS  0x40000000
 #define HEAP_CHECKING_ENABLED 0x80000000
 
+/* heap compatibility information values */
+#define HEAP_STD              0
+#define HEAP_LAL              1
+#define HEAP_LFH              2
+
 static struct heap *process_heap;  /* main process heap */
 
 /* check if memory range a contains memory range b */
@@ -294,6 +350,30 @@ static inline void block_set_flags( struct block *block, BYTE clear, BYTE set )
     block_set_size( block, block_size );
 }
 
+static inline struct group *block_get_group( const struct block *block )
+{
+    SIZE_T block_size = block_get_size( block );
+    void *first_block = (char *)block - block->base_offset * block_size;
+    return CONTAINING_RECORD( first_block, struct group, first_block );
+}
+
+static inline void block_set_group_index( struct block *block, UINT index )
+{
+    block->base_offset = index;
+}
+
+static inline UINT block_size_get_bin( SIZE_T block_size )
+{
+    if (block_size <= BIN_SMALL_MAX) return (block_size - 1) / BLOCK_ALIGN;
+    return BIN_SMALL_MAX / BLOCK_ALIGN + (block_size - BIN_SMALL_MAX - 1) / BIN_LARGE_STEP;
+}
+
+static inline SIZE_T bin_get_block_size( UINT bin )
+{
+    if (bin < BIN_SMALL_MAX / BLOCK_ALIGN) return (bin + 1) * BLOCK_ALIGN;
+    return BIN_SMALL_MAX + (bin - BIN_SMALL_MAX / BLOCK_ALIGN + 1) * BIN_LARGE_STEP;
+}
+
 static inline void *subheap_base( const SUBHEAP *subheap )
 {
     return ROUND_ADDR( subheap, REGION_ALIGN - 1 );
@@ -1191,6 +1271,24 @@ static inline struct block *unsafe_block_from_ptr( struct heap *heap, ULONG flag
 
     if ((ULONG_PTR)ptr % BLOCK_ALIGN)
         err = "invalid ptr alignment";
+    else if (block_get_flags( block ) & BLOCK_FLAG_LFH)
+    {
+        /* LFH blocks base offset is their index in the group, check the group block instead */
+        const struct block *group_block = (struct block *)block_get_group( block ) - 1;
+
+        if (block_get_type( block ) == BLOCK_TYPE_FREE)
+            err = "already freed block";
+        else if (block_get_type( block ) != BLOCK_TYPE_USED)
+            err = "invalid block type";
+        else if (block->base_offset >= GROUP_BLOCK_COUNT)
+            err = "invalid group index";
+        else if (block_get_type( group_block ) != BLOCK_TYPE_USED || !(block_get_flags( group_block ) & BLOCK_FLAG_LFH))
+            err = "invalid group block";
+        else if ((subheap = block_get_subheap( heap, group_block )) >= (SUBHEAP *)group_block)
+            err = "invalid group base offset";
+        else if (subheap->user_value != heap)
+            err = "mismatching heap";
+    }
     else if ((subheap = block_get_subheap( heap, block )) >= (SUBHEAP *)block)
         err = "invalid base offset";
     else if (block_get_type( block ) == BLOCK_TYPE_USED)
@@ -1470,6 +1568,11 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE handle )
         addr = ROUND_ADDR( subheap, REGION_ALIGN - 1 );
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if ((addr = heap->bins))
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     valgrind_notify_free_all( &heap->subheap );
     size = 0;
     addr = heap;
@@ -1528,12 +1631,191 @@ static NTSTATUS heap_allocate_block( struct heap *heap, ULONG flags, SIZE_T bloc
     return STATUS_SUCCESS;
 }
 
+/* LFH bins are only used after enough allocations of their size went through the back end */
+static void bin_count_alloc( struct bin *bin )
+{
+    LONG count_alloc = InterlockedIncrement( &bin->count_alloc );
+    if (count_alloc - ReadNoFence( &bin->count_freed ) > 0x10 || count_alloc > 0x800) bin->enabled = TRUE;
+}
+
+static inline struct bin *heap_get_bin( const struct heap *heap, SIZE_T block_size )
+{
+    struct bin *bins = heap->bins;
+    if (!bins || block_size > HEAP_MAX_BIN_BLOCK_SIZE) return NULL;
+    return bins + block_size_get_bin( block_size );
+}
+
+static LONG next_thread_affinity;
+
+/* get the group slot reserved for the current thread affinity in a bin */
+static struct group **heap_get_affinity_group( const struct heap *heap, const struct bin *bin )
+{
+    struct group **affinity_groups = (struct group **)(heap->bins + BIN_COUNT);
+    ULONG affinity;
+
+    if (!(affinity = NtCurrentTeb()->HeapVirtualAffinity))
+    {
+        affinity = 1 + (ULONG)InterlockedIncrement( &next_thread_affinity ) % AFFINITY_COUNT;
+        NtCurrentTeb()->HeapVirtualAffinity = affinity;
+    }
+
+    /* slots of the same affinity are kept together, away from the other threads ones */
+    return affinity_groups + (affinity - 1) * BIN_COUNT + (bin - heap->bins);
+}
+
+/* allocate a new group of free blocks from the back end */
+static struct group *group_allocate( struct heap *heap, ULONG flags, SIZE_T block_size )
+{
+    SIZE_T i, group_size, group_block_size;
+    struct group *group;
+    struct block *block;
+    NTSTATUS status;
+
+    flags &= ~(HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY | HEAP_USER_FLAGS_MASK);
+    group_size = offsetof( struct group, first_block ) + GROUP_BLOCK_COUNT * block_size;
+    group_block_size = heap_get_block_size( heap, flags, group_size );
+
+    heap_lock( heap, flags );
+    status = heap_allocate_block( heap, flags, group_block_size, group_size, (void **)&group );
+    heap_unlock( heap, flags );
+    if (status) return NULL;
+
+    /* mark the group block so that heap walks go through its blocks */
+    block_set_flags( (struct block *)group - 1, 0, BLOCK_FLAG_LFH );
+
+    for (i = 0, block = &group->first_block; i < GROUP_BLOCK_COUNT; i++)
+    {
+        block_set_type( block, BLOCK_TYPE_FREE );
+        block_set_flags( block, ~0, BLOCK_FLAG_FREE | BLOCK_FLAG_LFH );
+        block_set_size( block, block_size );
+        block_set_group_index( block, i );
+        mark_block_free( block + 1, block_size - sizeof(*block), flags );
+        block = (struct block *)((char *)block + block_size);
+    }
+
+    group->free_bits = GROUP_FREE_BITS_MASK;
+    return group;
+}
+
+/* give a fully free group, owned by the current thread, back to its bin or to the back end */
+static void group_release( struct heap *heap, ULONG flags, struct bin *bin, struct group *group )
+{
+    flags &= ~HEAP_NO_SERIALIZE;
+    group->free_bits = GROUP_FREE_BITS_MASK;
+
+    if (RtlQueryDepthSList( &bin->groups ) < GROUP_CACHE_DEPTH)
+        RtlInterlockedPushEntrySList( &bin->groups, &group->entry );
+    else
+    {
+        heap_lock( heap, flags );
+        heap_free_block( heap, flags, (struct block *)group - 1 );
+        heap_unlock( heap, flags );
+    }
+}
+
+/* stop owning a group, the last thread freeing one of its blocks will release it */
+static void group_disown( struct heap *heap, ULONG flags, struct bin *bin, struct group *group )
+{
+    if ((ULONG)InterlockedOr( &group->free_bits, GROUP_FLAG_FREE ) == GROUP_FREE_BITS_MASK)
+        group_release( heap, flags, bin, group );
+}
+
+/* take a free block from the current thread group, or from another group of the bin */
+static struct block *find_free_bin_block( struct heap *heap, ULONG flags, SIZE_T block_size, struct bin *bin )
+{
+    struct group **affinity_group = heap_get_affinity_group( heap, bin ), *group;
+    SLIST_ENTRY *entry;
+    DWORD bits, i;
+
+    /* the thread owns the group it took, only it can clear free bits, other threads may still set them */
+    group = InterlockedExchangePointer( (void **)affinity_group, NULL );
+
+    for (;;)
+    {
+        if (group && (bits = ReadNoFence( &group->free_bits )))
+        {
+            BitScanForward( &i, bits );
+            if ((DWORD)InterlockedCompareExchange( &group->free_bits, bits & ~(1u << i), bits ) == bits) break;
+            continue;
+        }
+
+        if (group) group_disown( heap, flags, bin, group );
+        if ((entry = RtlInterlockedPopEntrySList( &bin->groups ))) group = CONTAINING_RECORD( entry, struct group, entry );
+        else if (!(group = group_allocate( heap, flags, block_size ))) return NULL;
+    }
+
+    /* keep the group for the next allocations, unless another thread of the same affinity did it first */
+    if (InterlockedCompareExchangePointer( (void **)affinity_group, group, NULL ))
+        group_disown( heap, flags, bin, group );
+
+    return (struct block *)((char *)&group->first_block + i * block_size);
+}
+
+static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T block_size, SIZE_T size, void **ret )
+{
+    static const ULONG debug_flags = HEAP_VALIDATE | HEAP_VALIDATE_ALL | HEAP_VALIDATE_PARAMS | HEAP_CHECKING_ENABLED |
+                                     HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED;
+    struct block *block;
+    struct bin *bin;
+
+    if (flags & debug_flags) return STATUS_UNSUCCESSFUL;
+    if (!(bin = heap_get_bin( heap, block_size )) || !ReadNoFence( &bin->enabled )) return STATUS_UNSUCCESSFUL;
+
+    block_size = bin_get_block_size( bin - heap->bins );
+    if (!(block = find_free_bin_block( heap, flags, block_size, bin ))) return STATUS_NO_MEMORY;
+
+    block_set_type( block, BLOCK_TYPE_USED );
+    block_set_flags( block, ~BLOCK_FLAG_LFH, BLOCK_USER_FLAGS( flags ) );
+    block->tail_size = block_size - sizeof(*block) - size;
+    initialize_block( block, 0, size, flags );
+    mark_block_tail( block, flags );
+
+    *ret = block + 1;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block )
+{
+    struct bin *bin = heap_get_bin( heap, block_get_size( block ) );
+    struct group *group = block_get_group( block );
+    UINT i = block->base_offset;
+
+    block_set_type( block, BLOCK_TYPE_FREE );
+    block_set_flags( block, 0, BLOCK_FLAG_FREE );
+    mark_block_free( block + 1, block_get_size( block ) - sizeof(*block), flags );
+
+    /* if the group was disowned and this was its last used block, the thread now owns it */
+    if ((ULONG)InterlockedOr( &group->free_bits, 1u << i ) == ~(1u << i)) group_release( heap, flags, bin, group );
+    return STATUS_SUCCESS;
+}
+
+/* enable the LFH front end, which can't be disabled afterwards */
+static NTSTATUS heap_enable_lfh( struct heap *heap )
+{
+    SIZE_T size = BIN_COUNT * sizeof(struct bin) + AFFINITY_COUNT * BIN_COUNT * sizeof(struct group *);
+    struct bin *bins = NULL;
+    NTSTATUS status;
+
+    if (heap->bins) return STATUS_SUCCESS;
+    if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&bins, 0, &size,
+                                           MEM_COMMIT, PAGE_READWRITE )))
+        return status;
+
+    if (InterlockedCompareExchangePointer( (void **)&heap->bins, bins, NULL ))
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), (void **)&bins, &size, MEM_RELEASE );
+    }
+    return STATUS_SUCCESS;
+}
+
 /***********************************************************************
  *           RtlAllocateHeap   (NTDLL.@)
  */
 void *WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE handle, ULONG flags, SIZE_T size )
 {
     struct heap *heap;
+    struct bin *bin;
     SIZE_T block_size;
     void *ptr = NULL;
     ULONG heap_flags;
@@ -1545,11 +1827,15 @@ void *WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE handle, ULONG flags, SIZE
         status = STATUS_NO_MEMORY;
     else if (block_size >= HEAP_MIN_LARGE_BLOCK_SIZE)
         status = heap_allocate_large( heap, heap_flags, block_size, size, &ptr );
+    else if (!heap_allocate_block_lfh( heap, heap_flags, block_size, size, &ptr ))
+        status = STATUS_SUCCESS;
     else
     {
         heap_lock( heap, heap_flags );
         status = heap_allocate_block( heap, heap_flags, block_size, size, &ptr );
         heap_unlock( heap, heap_flags );
+
+        if (!status && (bin = heap_get_bin( heap, block_size ))) bin_count_alloc( bin );
     }
 
     if (!status) valgrind_notify_alloc( ptr, size, flags & HEAP_ZERO_MEMORY );
@@ -1567,6 +1853,7 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE handle, ULONG flags, void *
 {
     struct block *block;
     struct heap *heap;
+    struct bin *bin;
     ULONG heap_flags;
     NTSTATUS status;
 
@@ -1580,13 +1867,19 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE handle, ULONG flags, void *
         status = STATUS_INVALID_PARAMETER;
     else if (block_get_flags( block ) & BLOCK_FLAG_LARGE)
         status = heap_free_large( heap, heap_flags, block );
+    else if (block_get_flags( block ) & BLOCK_FLAG_LFH)
+        status = heap_free_block_lfh( heap, heap_flags, block );
     else if (!(block = heap_delay_free( heap, heap_flags, block )))
         status = STATUS_SUCCESS;
     else
     {
+        SIZE_T block_size = block_get_size( block );
+
         heap_lock( heap, heap_flags );
         status = heap_free_block( heap, heap_flags, block );
         heap_unlock( heap, heap_flags );
+
+        if (!status && (bin = heap_get_bin( heap, block_size ))) InterlockedIncrement( &bin->count_freed );
     }
 
     TRACE( "handle %p, flags %#lx, ptr %p, return %u, status %#lx.\n", handle, flags, ptr, !status, status );
@@ -1626,6 +1919,22 @@ static NTSTATUS heap_resize_block( struct heap *heap, ULONG flags, struct block
     old_block_size = block_get_size( block );
     *old_size = old_block_size - block_get_overhead( block );
 
+    if (block_get_flags( block ) & BLOCK_FLAG_LFH)
+    {
+        /* LFH blocks can only be resized within their bin block size */
+        if (block_size > old_block_size) return STATUS_NO_MEMORY;
+        if (old_block_size - sizeof(*block) - size > FIELD_MAX( struct block, tail_size )) return STATUS_NO_MEMORY;
+
+        valgrind_notify_resize( block + 1, *old_size, size );
+        block_set_flags( block, BLOCK_FLAG_USER_MASK & ~BLOCK_FLAG_USER_INFO, BLOCK_USER_FLAGS( flags ) );
+        block->tail_size = old_block_size - sizeof(*block) - size;
+        initialize_block( block, *old_size, size, flags );
+        mark_block_tail( block, flags );
+
+        *ret = block + 1;
+        return STATUS_SUCCESS;
+    }
+
     if (block_size >= HEAP_MIN_LARGE_BLOCK_SIZE) return STATUS_NO_MEMORY;  /* growing small block to large block */
 
     heap_lock( heap, flags );
@@ -1840,6 +2149,14 @@ BOOLEAN WINAPI RtlValidateHeap( HANDLE handle, ULONG flags, const void *ptr )
 }
 
 
+/* LFH groups are walked through as the blocks they contain */
+static inline const struct block *heap_walk_group( const struct block *block )
+{
+    const struct group *group = (const struct group *)(block + 1);
+    if (!(block_get_flags( block ) & BLOCK_FLAG_LFH)) return block;
+    return &group->first_block;
+}
+
 static NTSTATUS heap_walk_blocks( const struct heap *heap, const SUBHEAP *subheap,
                                   const struct block *block, struct rtl_heap_entry *entry )
 {
@@ -1847,15 +2164,23 @@ static NTSTATUS heap_walk_blocks( const struct heap *heap, const SUBHEAP *subhea
     const struct block *blocks = first_block( subheap );
 
     if (entry->lpData == commit_end) return STATUS_NO_MORE_ENTRIES;
-    if (entry->lpData == base) block = blocks;
-    else if (!(block = next_block( subheap, block )))
+    if (entry->lpData == base) block = heap_walk_group( blocks );
+    else if ((block_get_flags( block ) & BLOCK_FLAG_LFH) && block->base_offset < GROUP_BLOCK_COUNT - 1)
+        block = (struct block *)((char *)block + block_get_size( block ));
+    else
     {
-        entry->lpData = (void *)commit_end;
-        entry->cbData = end - commit_end;
-        entry->cbOverhead = 0;
-        entry->iRegionIndex = 0;
-        entry->wFlags = RTL_HEAP_ENTRY_UNCOMMITTED;
-        return STATUS_SUCCESS;
+        /* the last block of a group is followed by the block after the group */
+        if (block_get_flags( block ) & BLOCK_FLAG_LFH) block = (struct block *)block_get_group( block ) - 1;
+        if (!(block = next_block( subheap, block )))
+        {
+            entry->lpData = (void *)commit_end;
+            entry->cbData = end - commit_end;
+            entry->cbOverhead = 0;
+            entry->iRegionIndex = 0;
+            entry->wFlags = RTL_HEAP_ENTRY_UNCOMMITTED;
+            return STATUS_SUCCESS;
+        }
+        block = heap_walk_group( block );
     }
 
     if (block_get_flags( block ) & BLOCK_FLAG_FREE)
@@ -1878,6 +2203,8 @@ static NTSTATUS heap_walk_blocks( const struct heap *heap, const SUBHEAP *subhea
         entry->wFlags = RTL_HEAP_ENTRY_COMMITTED|RTL_HEAP_ENTRY_BLOCK|RTL_HEAP_ENTRY_BUSY;
     }
 
+    if (block_get_flags( block ) & BLOCK_FLAG_LFH) entry->wFlags = (entry->wFlags & RTL_HEAP_ENTRY_BUSY) | RTL_HEAP_ENTRY_LFH;
+
     return STATUS_SUCCESS;
 }
 
@@ -2006,15 +2333,21 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS info_class,
                                          void *info, SIZE_T size_in, PSIZE_T size_out )
 {
+    struct heap *heap;
+    ULONG flags;
+
+    TRACE( "handle %p, info_class %u, info %p, size_in %Iu, size_out %p.\n", handle, info_class, info, size_in, size_out );
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
+        if (!(heap = unsafe_heap_from_handle( handle, 0, &flags ))) return STATUS_ACCESS_VIOLATION;
         if (size_out) *size_out = sizeof(ULONG);
 
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        *(ULONG *)info = heap->bins ? HEAP_LFH : HEAP_STD;
         return STATUS_SUCCESS;
 
     default:
@@ -2028,8 +2361,36 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS i
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS info_class, void *info, SIZE_T size )
 {
-    FIXME( "handle %p, info_class %d, info %p, size %Id stub!\n", handle, info_class, info, size );
-    return STATUS_SUCCESS;
+    struct heap *heap;
+    ULONG flags;
+
+    TRACE( "handle %p, info_class %u, info %p, size %Iu.\n", handle, info_class, info, size );
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+    {
+        ULONG compat_info;
+
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heap = unsafe_heap_from_handle( handle, 0, &flags ))) return STATUS_INVALID_HANDLE;
+
+        compat_info = *(ULONG *)info;
+        if (compat_info != HEAP_STD && compat_info != HEAP_LFH)
+        {
+            FIXME( "Unsupported heap compatibility information %lu\n", compat_info );
+            return STATUS_UNSUCCESSFUL;
+        }
+        if (heap->bins) return compat_info == HEAP_LFH ? STATUS_SUCCESS : STATUS_UNSUCCESSFUL;
+        if (compat_info == HEAP_STD) return STATUS_SUCCESS;
+        if (heap->flags & HEAP_NO_SERIALIZE) return STATUS_INVALID_PARAMETER;
+        return heap_enable_lfh( heap );
+    }
+
+    default:
+        FIXME( "handle %p, info_class %d, info %p, size %Id stub!\n", handle, info_class, info, size );
+        return STATUS_SUCCESS;
+    }
 }
 
 /***********************************************************************
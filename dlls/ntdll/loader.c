@@ -115,6 +115,24 @@ struct ldr_notification
 
 static struct list ldr_notifications = LIST_INIT( ldr_notifications );
 
+/* listing of a directory of the dll search path, to avoid probing for missing files */
+struct dir_cache_entry
+{
+    struct list entry;
+    WCHAR      *path;       /* NT path of the directory */
+    USHORT      len;        /* length of the path in bytes */
+    LONGLONG    mtime;      /* last write time of the directory when it was listed */
+    BOOL        racy;       /* whether the directory changed right before it was listed */
+    BOOL        valid;      /* whether the listing can be used to exclude names */
+    ULONG       count;      /* number of names */
+    ULONG       hashes[1];  /* sorted hashes of the names */
+};
+
+#define MAX_DIR_CACHE_ENTRIES 32
+#define MAX_DIR_CACHE_NAMES   32768
+static struct list dir_cache = LIST_INIT( dir_cache );
+static unsigned int dir_cache_count;
+
 static const char * const reason_names[] =
 {
     "PROCESS_DETACH",
@@ -128,6 +146,16 @@ struct file_id
     BYTE ObjectId[16];
 };
 
+/* lookup tables for the exports of a module */
+struct export_cache
+{
+    const IMAGE_EXPORT_DIRECTORY *exports;      /* export directory the tables were built for */
+    DWORD                         mask;         /* size of the name hash table minus one */
+    DWORD                        *names;        /* hash table of name indexes plus one, 0 if free */
+    ULONG                         generation;   /* unload_generation when the forwards were resolved */
+    FARPROC                      *forwards;     /* resolved forwarded functions, by ordinal */
+};
+
 /* internal representation of loaded modules */
 typedef struct _wine_modref
 {
@@ -135,6 +163,10 @@ typedef struct _wine_modref
     struct file_id        id;
     ULONG                 CheckSum;
     BOOL                  system;
+    LIST_ENTRY            fullname_links;  /* entry in fullname_hash_table */
+    LIST_ENTRY            fileid_links;    /* entry in fileid_hash_table */
+    LIST_ENTRY            base_links;      /* entry in base_hash_table */
+    struct export_cache  *export_cache;    /* lookup tables for the exports, built on demand */
 } WINE_MODREF;
 
 static UINT tls_module_count;      /* number of modules with TLS directory */
@@ -179,6 +211,15 @@ static PEB_LDR_DATA ldr =
 static RTL_BITMAP tls_bitmap;
 static RTL_BITMAP tls_expansion_bitmap;
 
+/* hash tables of the loaded modules, the base name one goes through ldr.HashLinks */
+#define MODULE_HASH_SIZE 256
+static LIST_ENTRY basename_hash_table[MODULE_HASH_SIZE];
+static LIST_ENTRY fullname_hash_table[MODULE_HASH_SIZE];
+static LIST_ENTRY fileid_hash_table[MODULE_HASH_SIZE];
+static LIST_ENTRY base_hash_table[MODULE_HASH_SIZE];
+
+static ULONG unload_generation;  /* incremented when a module is unloaded */
+
 static WINE_MODREF *cached_modref;
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
@@ -497,6 +538,76 @@ static void call_ldr_notifications( ULONG reason, LDR_DATA_TABLE_ENTRY *module )
     }
 }
 
+/* case-insensitive hash of a file name; names get hashed before the case mapping
+ * tables are loaded, so only ASCII characters are folded and others skipped */
+static ULONG hash_file_name( const WCHAR *name, ULONG len )
+{
+    ULONG i, hash = len;
+
+    for (i = 0; i < len; i++)
+    {
+        WCHAR ch = name[i];
+        if (ch >= 0x80) continue;
+        if (ch >= 'a' && ch <= 'z') ch -= 'a' - 'A';
+        hash = hash * 65599 + ch;
+    }
+    return hash;
+}
+
+static ULONG hash_module_name( const UNICODE_STRING *name )
+{
+    return hash_file_name( name->Buffer, name->Length / sizeof(WCHAR) ) % MODULE_HASH_SIZE;
+}
+
+static ULONG hash_module_fileid( const struct file_id *id )
+{
+    ULONG i, hash = 0;
+
+    for (i = 0; i < sizeof(id->ObjectId); i++) hash = hash * 65599 + id->ObjectId[i];
+    return hash % MODULE_HASH_SIZE;
+}
+
+static ULONG hash_module_base( HMODULE module )
+{
+    return ((ULONG_PTR)module >> 16) % MODULE_HASH_SIZE;  /* modules are 64k aligned */
+}
+
+static void init_module_hash_tables(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < MODULE_HASH_SIZE; i++)
+    {
+        InitializeListHead( &basename_hash_table[i] );
+        InitializeListHead( &fullname_hash_table[i] );
+        InitializeListHead( &fileid_hash_table[i] );
+        InitializeListHead( &base_hash_table[i] );
+    }
+}
+
+/* the loader_section must be locked while calling these functions */
+static void insert_module_hash( WINE_MODREF *wm )
+{
+    InsertTailList( &basename_hash_table[hash_module_name( &wm->ldr.BaseDllName )], &wm->ldr.HashLinks );
+    InsertTailList( &fullname_hash_table[hash_module_name( &wm->ldr.FullDllName )], &wm->fullname_links );
+    InsertTailList( &base_hash_table[hash_module_base( wm->ldr.DllBase )], &wm->base_links );
+}
+
+static void remove_module_hash( WINE_MODREF *wm )
+{
+    RemoveEntryList( &wm->ldr.HashLinks );
+    RemoveEntryList( &wm->fullname_links );
+    RemoveEntryList( &wm->fileid_links );
+    RemoveEntryList( &wm->base_links );
+}
+
+static void set_module_fileid( WINE_MODREF *wm, const struct file_id *id )
+{
+    wm->id = *id;
+    InsertTailList( &fileid_hash_table[hash_module_fileid( id )], &wm->fileid_links );
+}
+
+
 /*************************************************************************
  *		get_modref
  *
@@ -506,16 +617,15 @@ static void call_ldr_notifications( ULONG reason, LDR_DATA_TABLE_ENTRY *module )
 static WINE_MODREF *get_modref( HMODULE hmod )
 {
     PLIST_ENTRY mark, entry;
-    PLDR_DATA_TABLE_ENTRY mod;
+    WINE_MODREF *wm;
 
     if (cached_modref && cached_modref->ldr.DllBase == hmod) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
+    mark = &base_hash_table[hash_module_base( hmod )];
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
-        if (mod->DllBase == hmod)
-            return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+        wm = CONTAINING_RECORD(entry, WINE_MODREF, base_links);
+        if (wm->ldr.DllBase == hmod) return cached_modref = wm;
     }
     return NULL;
 }
@@ -537,10 +647,10 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
     if (cached_modref && RtlEqualUnicodeString( &name_str, &cached_modref->ldr.BaseDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = &basename_hash_table[hash_module_name( &name_str )];
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        WINE_MODREF *mod = CONTAINING_RECORD(entry, WINE_MODREF, ldr.InLoadOrderLinks);
+        WINE_MODREF *mod = CONTAINING_RECORD(entry, WINE_MODREF, ldr.HashLinks);
         if (RtlEqualUnicodeString( &name_str, &mod->ldr.BaseDllName, TRUE ) && !mod->system)
         {
             cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
@@ -569,13 +679,13 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = &fullname_hash_table[hash_module_name( &name )];
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
+        WINE_MODREF *wm = CONTAINING_RECORD(entry, WINE_MODREF, fullname_links);
+        if (RtlEqualUnicodeString( &name, &wm->ldr.FullDllName, TRUE ))
         {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+            cached_modref = wm;
             return cached_modref;
         }
     }
@@ -595,11 +705,10 @@ static WINE_MODREF *find_fileid_module( const struct file_id *id )
 
     if (cached_modref && !memcmp( &cached_modref->id, id, sizeof(*id) )) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = &fileid_hash_table[hash_module_fileid( id )];
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
-        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, fileid_links );
 
         if (!memcmp( &wm->id, id, sizeof(*id) ))
         {
@@ -849,6 +958,66 @@ static NTSTATUS walk_node_dependencies( LDR_DDAG_NODE *node, void *context,
     return status;
 }
 
+static DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 0;
+
+    while (*name) hash = hash * 65599 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		get_export_cache
+ *
+ * Get the export lookup tables of a module, building the name hash table on first use.
+ * The loader_section must be locked while calling this function.
+ */
+static struct export_cache *get_export_cache( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    struct export_cache *cache;
+    WINE_MODREF *wm;
+    DWORD i, pos, size;
+
+    if (!(wm = get_modref( module ))) return NULL;
+    if ((cache = wm->export_cache)) return cache->exports == exports ? cache : NULL;
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) return NULL;
+    cache->exports = exports;
+    cache->generation = unload_generation;
+
+    /* small tables are searched fast enough already */
+    if (exports->NumberOfNames >= 16)
+    {
+        for (size = 32; size < 2 * exports->NumberOfNames; size *= 2) ;
+        if ((cache->names = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*cache->names) )))
+        {
+            cache->mask = size - 1;
+            for (i = 0; i < exports->NumberOfNames; i++)
+            {
+                pos = hash_export_name( get_rva( module, names[i] )) & cache->mask;
+                while (cache->names[pos]) pos = (pos + 1) & cache->mask;
+                cache->names[pos] = i + 1;
+            }
+        }
+    }
+    return wm->export_cache = cache;
+}
+
+
+/*************************************************************************
+ *		free_export_cache
+ */
+static void free_export_cache( struct export_cache *cache )
+{
+    if (!cache) return;
+    RtlFreeHeap( GetProcessHeap(), 0, cache->names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->forwards );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+
 /*************************************************************************
  *		find_forwarded_export
  *
@@ -940,7 +1109,30 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
     /* if the address falls into the export dir, it's a forward */
     if (((const char *)proc >= (const char *)exports) && 
         ((const char *)proc < (const char *)exports + exp_size))
-        return find_forwarded_export( module, (const char *)proc, load_path );
+    {
+        struct export_cache *cache;
+        FARPROC *forward = NULL;
+
+        /* relay and snoop thunks depend on the caller, so don't cache them */
+        if (!TRACE_ON(relay) && !TRACE_ON(snoop) && (cache = get_export_cache( module, exports )))
+        {
+            if (cache->generation != unload_generation && cache->forwards)
+                memset( cache->forwards, 0, exports->NumberOfFunctions * sizeof(*cache->forwards) );
+            cache->generation = unload_generation;
+            if (!cache->forwards)
+                cache->forwards = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                   exports->NumberOfFunctions * sizeof(*cache->forwards) );
+            if (cache->forwards)
+            {
+                forward = &cache->forwards[ordinal];
+                if (*forward) return *forward;
+            }
+        }
+        proc = find_forwarded_export( module, (const char *)proc, load_path );
+        /* the target could have been unloaded again if it failed to initialize */
+        if (forward && cache->generation == unload_generation) *forward = proc;
+        return proc;
+    }
 
     if (TRACE_ON(snoop))
     {
@@ -979,6 +1171,27 @@ static int find_name_in_exports( HMODULE module, const IMAGE_EXPORT_DIRECTORY *e
 }
 
 
+/*************************************************************************
+ *		find_name_in_export_cache
+ *
+ * Helper for find_named_export. Returns -2 if the module has no name hash table.
+ * The loader_section must be locked while calling this function.
+ */
+static int find_name_in_export_cache( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports, const char *name )
+{
+    const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    struct export_cache *cache;
+    DWORD pos, index;
+
+    if (!(cache = get_export_cache( module, exports )) || !cache->names) return -2;
+
+    for (pos = hash_export_name( name ) & cache->mask; (index = cache->names[pos]); pos = (pos + 1) & cache->mask)
+        if (!strcmp( get_rva( module, names[index - 1] ), name )) return ordinals[index - 1];
+    return -1;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -1000,10 +1213,11 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
-    if ((ordinal = find_name_in_exports( module, exports, name )) == -1) return NULL;
+    /* then use the hash table, or do a binary search */
+    ordinal = find_name_in_export_cache( module, exports, name );
+    if (ordinal == -2) ordinal = find_name_in_exports( module, exports, name );
+    if (ordinal == -1) return NULL;
     return find_ordinal_export( module, exports, exp_size, ordinal, load_path );
-
 }
 
 
@@ -1471,6 +1685,8 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderLinks);
     /* wait until init is called for inserting into InInitializationOrderModuleList */
+    InitializeListHead(&wm->fileid_links);
+    insert_module_hash( wm );
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
     {
@@ -2126,7 +2342,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
 
     if (!(wm = alloc_module( *module, nt_name, is_builtin ))) return STATUS_NO_MEMORY;
 
-    if (id) wm->id = *id;
+    if (id) set_module_fileid( wm, id );
     if (image_info->LoaderFlags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info->u.s.ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
     wm->system = system;
@@ -2148,6 +2364,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderLinks);
             RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+            remove_module_hash( wm );
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -2479,6 +2696,158 @@ static NTSTATUS get_dll_load_path_search_flags( LPCWSTR module, DWORD flags, WCH
 }
 
 
+static int __cdecl compare_dir_cache_hash( const void *a, const void *b )
+{
+    ULONG hash_a = *(const ULONG *)a, hash_b = *(const ULONG *)b;
+
+    if (hash_a < hash_b) return -1;
+    return hash_a > hash_b;
+}
+
+
+/***********************************************************************
+ *	list_dir_cache_entry
+ *
+ * Build the listing of a search path directory.
+ * The loader_section must be locked while calling this function.
+ */
+static struct dir_cache_entry *list_dir_cache_entry( OBJECT_ATTRIBUTES *attr, LONGLONG mtime )
+{
+    struct dir_cache_entry *dir;
+    FILE_NAMES_INFORMATION *info;
+    LARGE_INTEGER now;
+    IO_STATUS_BLOCK io;
+    ULONG size = 64, pos;
+    BOOL restart = TRUE;
+    HANDLE handle;
+    char buffer[8192];
+
+    if (NtOpenFile( &handle, FILE_LIST_DIRECTORY | SYNCHRONIZE, attr, &io,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
+        return NULL;
+
+    if (!(dir = RtlAllocateHeap( GetProcessHeap(), 0, offsetof( struct dir_cache_entry, hashes[size] ))))
+        goto done;
+    dir->mtime = mtime;
+    dir->count = 0;
+    /* don't trust a directory modified within the timestamp granularity of some file systems */
+    NtQuerySystemTime( &now );
+    dir->racy = now.QuadPart - mtime < 2 * (LONGLONG)10000000;
+    dir->valid = !dir->racy;
+
+    while (dir->valid && !NtQueryDirectoryFile( handle, 0, NULL, NULL, &io, buffer, sizeof(buffer),
+                                                FileNamesInformation, FALSE, NULL, restart ))
+    {
+        restart = FALSE;
+        for (pos = 0; pos < io.Information; pos += info->NextEntryOffset)
+        {
+            ULONG i, len;
+
+            info = (FILE_NAMES_INFORMATION *)(buffer + pos);
+            len = info->FileNameLength / sizeof(WCHAR);
+            for (i = 0; i < len; i++) if (info->FileName[i] >= 0x80) dir->valid = FALSE;
+            if (dir->count == size)
+            {
+                struct dir_cache_entry *new_dir;
+
+                if (size >= MAX_DIR_CACHE_NAMES) dir->valid = FALSE;
+                else if (!(new_dir = RtlReAllocateHeap( GetProcessHeap(), 0, dir,
+                                                        offsetof( struct dir_cache_entry, hashes[size * 2] ))))
+                    dir->valid = FALSE;
+                else
+                {
+                    dir = new_dir;
+                    size *= 2;
+                }
+            }
+            if (!dir->valid) break;
+            dir->hashes[dir->count++] = hash_file_name( info->FileName, len );
+            if (!info->NextEntryOffset) break;
+        }
+    }
+    if (!dir->valid) dir->count = 0;
+    qsort( dir->hashes, dir->count, sizeof(dir->hashes[0]), compare_dir_cache_hash );
+
+    dir->len = attr->ObjectName->Length;
+    if (!(dir->path = RtlAllocateHeap( GetProcessHeap(), 0, dir->len )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, dir );
+        dir = NULL;
+        goto done;
+    }
+    memcpy( dir->path, attr->ObjectName->Buffer, dir->len );
+
+done:
+    NtClose( handle );
+    return dir;
+}
+
+
+/***********************************************************************
+ *	free_dir_cache_entry
+ */
+static void free_dir_cache_entry( struct dir_cache_entry *dir )
+{
+    list_remove( &dir->entry );
+    dir_cache_count--;
+    RtlFreeHeap( GetProcessHeap(), 0, dir->path );
+    RtlFreeHeap( GetProcessHeap(), 0, dir );
+}
+
+
+/***********************************************************************
+ *	dll_file_may_exist
+ *
+ * Check in the directory cache whether a file may exist; only returns FALSE
+ * if the file is known to be missing. Helper for open_dll_file.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL dll_file_may_exist( const UNICODE_STRING *nt_name )
+{
+    const WCHAR *name = nt_name->Buffer;
+    ULONG i, hash, len = nt_name->Length / sizeof(WCHAR), dir_len;
+    FILE_NETWORK_OPEN_INFORMATION info;
+    struct dir_cache_entry *dir;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING str;
+    NTSTATUS status;
+
+    for (dir_len = len; dir_len; dir_len--) if (name[dir_len - 1] == '\\') break;
+    if (dir_len < 2 || dir_len == len) return TRUE;
+    /* non-ASCII names don't hash consistently, and short names aren't listed */
+    for (i = dir_len; i < len; i++) if (name[i] >= 0x80 || name[i] == '~') return TRUE;
+
+    str.Buffer = (WCHAR *)name;
+    str.Length = str.MaximumLength = (dir_len - 1) * sizeof(WCHAR);
+    if (name[dir_len - 2] == ':') str.Length += sizeof(WCHAR);  /* root directory */
+    InitializeObjectAttributes( &attr, &str, OBJ_CASE_INSENSITIVE, 0, NULL );
+
+    status = NtQueryFullAttributesFile( &attr, &info );
+    if (status == STATUS_OBJECT_NAME_NOT_FOUND || status == STATUS_OBJECT_PATH_NOT_FOUND) return FALSE;
+    if (status || !(info.FileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return TRUE;
+
+    LIST_FOR_EACH_ENTRY( dir, &dir_cache, struct dir_cache_entry, entry )
+    {
+        if (dir->len != str.Length || wcsnicmp( dir->path, str.Buffer, str.Length / sizeof(WCHAR) )) continue;
+        if (!dir->racy && dir->mtime == info.LastWriteTime.QuadPart) goto found;
+        free_dir_cache_entry( dir );
+        break;
+    }
+
+    if (!(dir = list_dir_cache_entry( &attr, info.LastWriteTime.QuadPart ))) return TRUE;
+    if (dir_cache_count == MAX_DIR_CACHE_ENTRIES)
+        free_dir_cache_entry( LIST_ENTRY( list_tail( &dir_cache ), struct dir_cache_entry, entry ));
+    dir_cache_count++;
+    list_add_head( &dir_cache, &dir->entry );
+
+found:
+    if (!dir->valid) return TRUE;
+    hash = hash_file_name( name + dir_len, len - dir_len );
+    return bsearch( &hash, dir->hashes, dir->count, sizeof(dir->hashes[0]), compare_dir_cache_hash ) != NULL;
+}
+
+
 /***********************************************************************
  *	open_dll_file
  *
@@ -2496,6 +2865,7 @@ static NTSTATUS open_dll_file( UNICODE_STRING *nt_name, WINE_MODREF **pwm, HANDL
     HANDLE handle;
 
     if ((*pwm = find_fullname_module( nt_name ))) return STATUS_SUCCESS;
+    if (!dll_file_may_exist( nt_name )) return STATUS_DLL_NOT_FOUND;
 
     attr.Length = sizeof(attr);
     attr.RootDirectory = 0;
@@ -3745,6 +4115,7 @@ static void free_modref( WINE_MODREF *wm )
 
     RemoveEntryList(&wm->ldr.InLoadOrderLinks);
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+    remove_module_hash( wm );
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
 
@@ -3776,6 +4147,8 @@ static void free_modref( WINE_MODREF *wm )
     RtlReleaseActivationContext( wm->ldr.ActivationContext );
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
+    unload_generation++;
+    free_export_cache( wm->export_cache );
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
@@ -4129,6 +4502,7 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, ULONG_PTR unknown2, ULONG_PTR
                              sizeof(peb->TlsExpansionBitmapBits) * 8 );
         RtlSetBits( peb->TlsBitmap, 0, 1 ); /* TLS index 0 is reserved and should be initialized to NULL. */
 
+        init_module_hash_tables();
         init_user_process_params();
         load_global_options();
         version_init();
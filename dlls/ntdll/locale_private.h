@@ -188,6 +188,30 @@ static inline unsigned int decode_utf8_char( unsigned char ch, const char **str,
 }
 
 
+/* number of 7-bit ASCII chars at the start of a string, checked 8 bytes at a time */
+static inline unsigned int ascii_mbs_len( const char *str, unsigned int len )
+{
+    typedef ULONGLONG DECLSPEC_ALIGN(1) unaligned_ui64;
+    unsigned int pos = 0;
+
+    while (pos + 8 <= len && !(*(const unaligned_ui64 *)(str + pos) & 0x8080808080808080ull)) pos += 8;
+    while (pos < len && !(str[pos] & 0x80)) pos++;
+    return pos;
+}
+
+
+/* number of 7-bit ASCII chars at the start of a string, checked 4 WCHARs at a time */
+static inline unsigned int ascii_wcs_len( const WCHAR *str, unsigned int len )
+{
+    typedef ULONGLONG DECLSPEC_ALIGN(1) unaligned_ui64;
+    unsigned int pos = 0;
+
+    while (pos + 4 <= len && !(*(const unaligned_ui64 *)(str + pos) & 0xff80ff80ff80ff80ull)) pos += 4;
+    while (pos < len && str[pos] < 0x80) pos++;
+    return pos;
+}
+
+
 static inline void init_codepage_table( USHORT *ptr, CPTABLEINFO *info )
 {
     USHORT hdr_size = ptr[0];
@@ -316,7 +340,13 @@ static inline NTSTATUS utf8_wcstombs_size( const WCHAR *src, unsigned int srclen
 
     for (len = 0; srclen; srclen--, src++)
     {
-        if (*src < 0x80) len++;  /* 0x00-0x7f: 1 byte */
+        if (*src < 0x80)  /* 0x00-0x7f: 1 byte */
+        {
+            unsigned int count = ascii_wcs_len( src + 1, srclen - 1 );
+            len += count + 1;
+            src += count;
+            srclen -= count;
+        }
         else if (*src < 0x800) len += 2;  /* 0x80-0x7ff: 2 bytes */
         else
         {
@@ -348,7 +378,13 @@ static inline NTSTATUS utf8_mbstowcs_size( const char *src, unsigned int srclen,
     for (len = 0; src < srcend; len++)
     {
         unsigned char ch = *src++;
-        if (ch < 0x80) continue;
+        if (ch < 0x80)
+        {
+            unsigned int count = ascii_mbs_len( src, srcend - src );
+            src += count;
+            len += count;
+            continue;
+        }
         if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
             status = STATUS_SOME_NOT_MAPPED;
         else
@@ -430,9 +466,13 @@ static inline NTSTATUS utf8_mbstowcs( WCHAR *dst, unsigned int dstlen, unsigned
     while ((dst < dstend) && (src < srcend))
     {
         unsigned char ch = *src++;
-        if (ch < 0x80)  /* special fast case for 7-bit ASCII */
+        if (ch < 0x80)  /* special fast case for runs of 7-bit ASCII */
         {
+            unsigned int i, count = ascii_mbs_len( src, min( srcend - src, dstend - dst - 1 ) );
             *dst++ = ch;
+            for (i = 0; i < count; i++) dst[i] = (unsigned char)src[i];
+            src += count;
+            dst += count;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -471,8 +511,15 @@ static inline NTSTATUS utf8_wcstombs( char *dst, unsigned int dstlen, unsigned i
 
         if (ch < 0x80)  /* 0x00-0x7f: 1 byte */
         {
+            unsigned int i, count;
+
             if (dst > end - 1) break;
             *dst++ = ch;
+            count = ascii_wcs_len( src + 1, min( srclen - 1, end - dst ) );
+            for (i = 0; i < count; i++) dst[i] = src[i + 1];
+            dst += count;
+            src += count;
+            srclen -= count;
             continue;
         }
         if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
@@ -96,49 +96,122 @@ int __cdecl memcmp( const void *ptr1, const void *ptr2, size_t n )
 
 
 /*********************************************************************
- *                  memcpy   (NTDLL.@)
+ *                  memmove   (NTDLL.@)
  *
  * NOTES
- *  Behaves like memmove.
- */
-void * __cdecl memcpy( void *dst, const void *src, size_t n )
+ *  The destination is accessed through volatile pointers to prevent gcc
+ *  from turning the copy loops back into calls to memmove.
+ */
+#ifdef WORDS_BIGENDIAN
+# define MERGE(w1, sh1, w2, sh2) ((w1 << sh1) | (w2 >> sh2))
+#else
+# define MERGE(w1, sh1, w2, sh2) ((w1 >> sh1) | (w2 << sh2))
+#endif
+void * __cdecl memmove( void *dst, const void *src, size_t n )
 {
-    volatile unsigned char *d = dst;  /* avoid gcc optimizations */
+    volatile unsigned char *d = dst;
     const unsigned char *s = src;
+    int sh1;
+
+    if (!n) return dst;
 
     if ((size_t)dst - (size_t)src >= n)
     {
+        for (; (size_t)d % sizeof(size_t) && n; n--) *d++ = *s++;
+
+        sh1 = 8 * ((size_t)s % sizeof(size_t));
+        if (!sh1)
+        {
+            while (n >= sizeof(size_t))
+            {
+                *(volatile size_t *)d = *(const size_t *)s;
+                s += sizeof(size_t);
+                d += sizeof(size_t);
+                n -= sizeof(size_t);
+            }
+        }
+        else if (n >= 2 * sizeof(size_t))
+        {
+            int sh2 = 8 * sizeof(size_t) - sh1;
+            size_t x, y;
+
+            s -= sh1 / 8;
+            x = *(const size_t *)s;
+            do
+            {
+                s += sizeof(size_t);
+                y = *(const size_t *)s;
+                *(volatile size_t *)d = MERGE(x, sh1, y, sh2);
+                d += sizeof(size_t);
+
+                s += sizeof(size_t);
+                x = *(const size_t *)s;
+                *(volatile size_t *)d = MERGE(y, sh1, x, sh2);
+                d += sizeof(size_t);
+
+                n -= 2 * sizeof(size_t);
+            } while (n >= 2 * sizeof(size_t));
+            s += sh1 / 8;
+        }
         while (n--) *d++ = *s++;
     }
     else
     {
-        d += n - 1;
-        s += n - 1;
-        while (n--) *d-- = *s--;
+        d += n;
+        s += n;
+
+        for (; (size_t)d % sizeof(size_t) && n; n--) *--d = *--s;
+
+        sh1 = 8 * ((size_t)s % sizeof(size_t));
+        if (!sh1)
+        {
+            while (n >= sizeof(size_t))
+            {
+                s -= sizeof(size_t);
+                d -= sizeof(size_t);
+                *(volatile size_t *)d = *(const size_t *)s;
+                n -= sizeof(size_t);
+            }
+        }
+        else if (n >= 2 * sizeof(size_t))
+        {
+            int sh2 = 8 * sizeof(size_t) - sh1;
+            size_t x, y;
+
+            s -= sh1 / 8;
+            x = *(const size_t *)s;
+            do
+            {
+                s -= sizeof(size_t);
+                y = *(const size_t *)s;
+                d -= sizeof(size_t);
+                *(volatile size_t *)d = MERGE(y, sh1, x, sh2);
+
+                s -= sizeof(size_t);
+                x = *(const size_t *)s;
+                d -= sizeof(size_t);
+                *(volatile size_t *)d = MERGE(x, sh1, y, sh2);
+
+                n -= 2 * sizeof(size_t);
+            } while (n >= 2 * sizeof(size_t));
+            s += sh1 / 8;
+        }
+        while (n--) *--d = *--s;
     }
     return dst;
 }
+#undef MERGE
 
 
 /*********************************************************************
- *                  memmove   (NTDLL.@)
+ *                  memcpy   (NTDLL.@)
+ *
+ * NOTES
+ *  Behaves like memmove.
  */
-void * __cdecl memmove( void *dst, const void *src, size_t n )
+void * __cdecl memcpy( void *dst, const void *src, size_t n )
 {
-    volatile unsigned char *d = dst;  /* avoid gcc optimizations */
-    const unsigned char *s = src;
-
-    if ((size_t)dst - (size_t)src >= n)
-    {
-        while (n--) *d++ = *s++;
-    }
-    else
-    {
-        d += n - 1;
-        s += n - 1;
-        while (n--) *d-- = *s--;
-    }
-    return dst;
+    return memmove( dst, src, n );
 }
 
 
@@ -39,6 +39,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(sync);
 WINE_DECLARE_DEBUG_CHANNEL(relay);
+WINE_DECLARE_DEBUG_CHANNEL(lockstat);
 
 static const char *debugstr_timeout( const LARGE_INTEGER *timeout )
 {
@@ -143,6 +144,97 @@ DWORD WINAPI RtlRunOnceComplete( RTL_RUN_ONCE *once, ULONG flags, void *context
 }
 
 
+/***********************************************************************
+ * Lock spinning
+ ***********************************************************************/
+
+/* Contended critical sections and SRW locks spin for a while before going
+ * to sleep. The spin limit adapts to how long the recent waits took, and
+ * the numbers are kept per hash bucket of lock addresses. With +lockstat
+ * the buckets also count the contention they see. */
+
+struct lock_stats
+{
+    const void *addr;       /* first lock seen in this bucket */
+    LONG        spin;       /* average number of spins that were needed */
+    LONG        contended;  /* number of contended acquisitions */
+    LONG        spun;       /* number of waits that ended while spinning */
+    LONG        sleeps;     /* number of waits that had to sleep */
+};
+
+#define MAX_LOCK_SPIN 500
+
+static struct lock_stats lock_stats[256];
+
+static struct lock_stats *get_lock_stats( const void *lock )
+{
+    ULONG_PTR val = (ULONG_PTR)lock;
+
+    return &lock_stats[(val >> 4) % ARRAY_SIZE(lock_stats)];
+}
+
+static inline ULONG get_max_spin( const struct lock_stats *stats )
+{
+    if (NtCurrentTeb()->Peb->NumberOfProcessors <= 1) return 0;
+    return min( MAX_LOCK_SPIN, 2 * stats->spin + 10 );
+}
+
+static void update_lock_stats( struct lock_stats *stats, const void *lock, ULONG count, BOOL slept )
+{
+    LONG total;
+
+    /* the average doesn't need to be exact, so races are harmless */
+    stats->spin += ((LONG)count - stats->spin) / 8;
+
+    if (!TRACE_ON(lockstat)) return;
+
+    if (!stats->addr) InterlockedCompareExchangePointer( (void **)&stats->addr, (void *)lock, NULL );
+    InterlockedIncrement( slept ? &stats->sleeps : &stats->spun );
+    total = InterlockedIncrement( &stats->contended );
+    /* report each bucket when its count reaches a power of two */
+    if (!(total & (total - 1)))
+        TRACE_(lockstat)( "lock %p: %ld contended, %ld spun, %ld slept, average spin %ld\n",
+                          stats->addr, total, stats->spun, stats->sleeps, stats->spin );
+}
+
+static BOOL compare_addr( const void *addr, const void *cmp, SIZE_T size )
+{
+    switch (size)
+    {
+        case 1:
+            return (*(const UCHAR *)addr == *(const UCHAR *)cmp);
+        case 2:
+            return (*(const USHORT *)addr == *(const USHORT *)cmp);
+        case 4:
+            return (*(const ULONG *)addr == *(const ULONG *)cmp);
+        case 8:
+            return (*(const ULONG64 *)addr == *(const ULONG64 *)cmp);
+    }
+
+    return FALSE;
+}
+
+/* spin until the lock word changes; return FALSE if the caller needs to sleep on it */
+static BOOL spin_wait_on_address( const void *lock, const void *addr, const void *cmp, SIZE_T size )
+{
+    struct lock_stats *stats = get_lock_stats( lock );
+    ULONG count, max = get_max_spin( stats );
+
+    if (!max) return FALSE;
+    for (count = 0; count < max; count++)
+    {
+        YieldProcessor();
+        if (!compare_addr( addr, cmp, size ))
+        {
+            update_lock_stats( stats, lock, count, FALSE );
+            return TRUE;
+        }
+    }
+    update_lock_stats( stats, lock, max, TRUE );
+    return FALSE;
+}
+
+
 /***********************************************************************
  * Critical sections
  ***********************************************************************/
@@ -379,6 +471,28 @@ NTSTATUS WINAPI RtlpUnWaitCriticalSection( RTL_CRITICAL_SECTION *crit )
 }
 
 
+/* spin on a critical section without a spin count, as long as nobody sleeps on it */
+static BOOL spin_enter_critical_section( RTL_CRITICAL_SECTION *crit )
+{
+    struct lock_stats *stats = get_lock_stats( crit );
+    ULONG count, max = get_max_spin( stats );
+
+    if (!max) return FALSE;
+    for (count = 0; count < max; count++)
+    {
+        if (crit->LockCount > 0) return FALSE;  /* there are waiters already, don't bother spinning */
+        if (crit->LockCount == -1 && InterlockedCompareExchange( &crit->LockCount, 0, -1 ) == -1)
+        {
+            update_lock_stats( stats, crit, count, FALSE );
+            return TRUE;
+        }
+        YieldProcessor();
+    }
+    update_lock_stats( stats, crit, max, TRUE );
+    return FALSE;
+}
+
+
 /******************************************************************************
  *      RtlEnterCriticalSection   (NTDLL.@)
  */
@@ -399,6 +513,10 @@ NTSTATUS WINAPI RtlEnterCriticalSection( RTL_CRITICAL_SECTION *crit )
             YieldProcessor();
         }
     }
+    else if (crit->LockCount != -1 && crit->OwningThread != ULongToHandle(GetCurrentThreadId()))
+    {
+        if (spin_enter_critical_section( crit )) goto done;
+    }
 
     if (InterlockedIncrement( &crit->LockCount ))
     {
@@ -572,6 +690,7 @@ void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
         } while (InterlockedCompareExchange( u.l, new.l, old.l ) != old.l);
 
         if (!wait) return;
+        if (spin_wait_on_address( lock, &u.s->owners, &new.s.owners, sizeof(short) )) continue;
         RtlWaitOnAddress( &u.s->owners, &new.s.owners, sizeof(short), NULL );
     }
 }
@@ -611,6 +730,7 @@ void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
         } while (InterlockedCompareExchange( u.l, new.l, old.l ) != old.l);
 
         if (!wait) return;
+        if (spin_wait_on_address( lock, u.s, &new.s, sizeof(struct srw_lock) )) continue;
         RtlWaitOnAddress( u.s, &new.s, sizeof(struct srw_lock), NULL );
     }
 }
@@ -883,23 +1003,6 @@ static void spin_unlock( LONG *lock )
     InterlockedExchange( lock, 0 );
 }
 
-static BOOL compare_addr( const void *addr, const void *cmp, SIZE_T size )
-{
-    switch (size)
-    {
-        case 1:
-            return (*(const UCHAR *)addr == *(const UCHAR *)cmp);
-        case 2:
-            return (*(const USHORT *)addr == *(const USHORT *)cmp);
-        case 4:
-            return (*(const ULONG *)addr == *(const ULONG *)cmp);
-        case 8:
-            return (*(const ULONG64 *)addr == *(const ULONG64 *)cmp);
-    }
-
-    return FALSE;
-}
-
 /***********************************************************************
  *           RtlWaitOnAddress   (NTDLL.@)
  */
@@ -842,6 +842,108 @@ done:
     pRtlFreeUnicodeString(&ntdirname);
 }
 
+static int count_dir_entries( const WCHAR *testdir, const WCHAR *maskW )
+{
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING ntdirname, mask;
+    IO_STATUS_BLOCK io;
+    BYTE data[8192];
+    FILE_BOTH_DIRECTORY_INFORMATION *info;
+    NTSTATUS status;
+    HANDLE handle;
+    UINT data_pos;
+    int count = 0;
+
+    if (!pRtlDosPathNameToNtPathName_U( testdir, &ntdirname, NULL, NULL )) return -1;
+    InitializeObjectAttributes( &attr, &ntdirname, OBJ_CASE_INSENSITIVE, 0, NULL );
+    status = pNtOpenFile( &handle, SYNCHRONIZE | FILE_LIST_DIRECTORY, &attr, &io, FILE_SHARE_READ,
+                          FILE_SYNCHRONOUS_IO_NONALERT | FILE_OPEN_FOR_BACKUP_INTENT | FILE_DIRECTORY_FILE );
+    pRtlFreeUnicodeString( &ntdirname );
+    if (status) return -1;
+
+    pRtlInitUnicodeString( &mask, maskW );
+    status = pNtQueryDirectoryFile( handle, NULL, NULL, NULL, &io, data, sizeof(data),
+                                    FileBothDirectoryInformation, FALSE, &mask, TRUE );
+    while (!status)
+    {
+        for (data_pos = 0; data_pos < io.Information; data_pos += info->NextEntryOffset)
+        {
+            info = (FILE_BOTH_DIRECTORY_INFORMATION *)(data + data_pos);
+            count++;
+            if (!info->NextEntryOffset) break;
+        }
+        status = pNtQueryDirectoryFile( handle, NULL, NULL, NULL, &io, data, sizeof(data),
+                                        FileBothDirectoryInformation, FALSE, &mask, FALSE );
+    }
+    ok( status == STATUS_NO_MORE_FILES || status == STATUS_NO_SUCH_FILE,
+        "failed to query directory; status %lx\n", status );
+    pNtClose( handle );
+    return count;
+}
+
+static void create_dir_entry( const WCHAR *testdir, const WCHAR *name )
+{
+    WCHAR path[MAX_PATH];
+    HANDLE h;
+
+    swprintf( path, ARRAY_SIZE(path), L"%s\\%s", testdir, name );
+    h = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0 );
+    ok( h != INVALID_HANDLE_VALUE, "failed to create %s, error %lu\n", wine_dbgstr_w(path), GetLastError() );
+    CloseHandle( h );
+}
+
+static void delete_dir_entry( const WCHAR *testdir, const WCHAR *name )
+{
+    WCHAR path[MAX_PATH];
+
+    swprintf( path, ARRAY_SIZE(path), L"%s\\%s", testdir, name );
+    DeleteFileW( path );
+}
+
+/* repeated enumerations of a directory must see the changes made in between */
+static void test_repeated_enumeration(void)
+{
+    WCHAR testdir[MAX_PATH];
+    int count;
+
+    GetTempPathW( MAX_PATH, testdir );
+    lstrcatW( testdir, L"enum.tmp" );
+    if (!CreateDirectoryW( testdir, NULL ))
+    {
+        skip( "couldn't create dir %s, error %lu\n", wine_dbgstr_w(testdir), GetLastError() );
+        return;
+    }
+    create_dir_entry( testdir, L"a.txt" );
+    create_dir_entry( testdir, L"b.dat" );
+    /* make sure that the directory is old enough to be remembered */
+    Sleep( 1100 );
+
+    count = count_dir_entries( testdir, L"*" );
+    ok( count == 4, "got %d entries\n", count );
+    count = count_dir_entries( testdir, L"*" );
+    ok( count == 4, "got %d entries\n", count );
+    count = count_dir_entries( testdir, L"*.txt" );
+    ok( count == 1, "got %d entries\n", count );
+    count = count_dir_entries( testdir, L"B.*" );
+    ok( count == 1, "got %d entries\n", count );
+    count = count_dir_entries( testdir, L"a.txt" );
+    ok( count == 1, "got %d entries\n", count );
+
+    create_dir_entry( testdir, L"c.txt" );
+    count = count_dir_entries( testdir, L"*.txt" );
+    ok( count == 2, "got %d entries\n", count );
+    count = count_dir_entries( testdir, L"*" );
+    ok( count == 5, "got %d entries\n", count );
+
+    delete_dir_entry( testdir, L"a.txt" );
+    count = count_dir_entries( testdir, L"*.txt" );
+    ok( count == 1, "got %d entries\n", count );
+
+    delete_dir_entry( testdir, L"b.dat" );
+    delete_dir_entry( testdir, L"c.txt" );
+    RemoveDirectoryW( testdir );
+}
+
 static NTSTATUS get_file_id( FILE_INTERNAL_INFORMATION *info, const WCHAR *root, const WCHAR *name )
 {
     OBJECT_ATTRIBUTES attr;
@@ -1035,5 +1137,6 @@ START_TEST(directory)
     test_directory_sort( sysdir );
     test_NtQueryDirectoryFile();
     test_NtQueryDirectoryFile_case();
+    test_repeated_enumeration();
     test_redirection();
 }
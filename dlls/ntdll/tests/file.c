@@ -5096,6 +5096,149 @@ static void test_read_write(void)
     CloseHandle(hfile);
 }
 
+/* check the result of an overlapped NtReadFile or NtWriteFile, waiting for it if it's pending */
+static void check_overlapped_result( int i, BOOL ring, NTSTATUS status, HANDLE event,
+                                     IO_STATUS_BLOCK *iob, NTSTATUS expect, ULONG_PTR size )
+{
+    DWORD ret;
+
+    if (ring) ok( status == STATUS_PENDING, "%d: got %#lx\n", i, status );
+    else ok( status == STATUS_PENDING || status == expect, "%d: got %#lx\n", i, status );
+    if (status == STATUS_PENDING)
+    {
+        ret = WaitForSingleObject( event, 5000 );
+        ok( !ret, "%d: wait failed %lu\n", i, ret );
+    }
+    ok( U(*iob).Status == expect, "%d: got status %#lx\n", i, U(*iob).Status );
+    ok( iob->Information == size, "%d: got %Iu\n", i, iob->Information );
+}
+
+static void test_overlapped_queue( BOOL ring )
+{
+    static const int count = 16, block = 4096;
+    HANDLE hfile, events[16];
+    IO_STATUS_BLOCK iob[16];
+    NTSTATUS status[16];
+    LARGE_INTEGER offset;
+    char *buf;
+    int i, j;
+
+    hfile = create_temp_file( FILE_FLAG_OVERLAPPED );
+    if (!hfile) return;
+    buf = malloc( count * block );
+    for (i = 0; i < count; i++) events[i] = CreateEventA( NULL, TRUE, FALSE, NULL );
+
+    /* the ring is only used when the kernel supports it */
+    memset( buf, 'a', block );
+    offset.QuadPart = 0;
+    status[0] = pNtWriteFile( hfile, events[0], NULL, NULL, &iob[0], buf, block, &offset, NULL );
+    if (ring && status[0] != STATUS_PENDING)
+    {
+        win_skip( "io_uring is not available\n" );
+        ring = FALSE;
+    }
+    check_overlapped_result( 0, ring, status[0], events[0], &iob[0], STATUS_SUCCESS, block );
+
+    /* many outstanding writes and reads on the same file */
+    for (i = 0; i < count; i++)
+    {
+        ResetEvent( events[i] );
+        memset( buf + i * block, 'a' + i, block );
+        offset.QuadPart = (LONGLONG)i * block;
+        status[i] = pNtWriteFile( hfile, events[i], NULL, NULL, &iob[i], buf + i * block, block, &offset, NULL );
+    }
+    for (i = 0; i < count; i++)
+        check_overlapped_result( i, ring, status[i], events[i], &iob[i], STATUS_SUCCESS, block );
+
+    memset( buf, 0, count * block );
+    for (i = count - 1; i >= 0; i--)
+    {
+        ResetEvent( events[i] );
+        offset.QuadPart = (LONGLONG)i * block;
+        status[i] = pNtReadFile( hfile, events[i], NULL, NULL, &iob[i], buf + i * block, block, &offset, NULL );
+    }
+    for (i = 0; i < count; i++)
+    {
+        check_overlapped_result( i, ring, status[i], events[i], &iob[i], STATUS_SUCCESS, block );
+        for (j = 0; j < block; j++) if (buf[i * block + j] != 'a' + i) break;
+        ok( j == block, "%d: wrong data at %d\n", i, j );
+    }
+
+    /* reading across and past the end of file */
+    ResetEvent( events[0] );
+    offset.QuadPart = (LONGLONG)count * block - 16;
+    status[0] = pNtReadFile( hfile, events[0], NULL, NULL, &iob[0], buf, block, &offset, NULL );
+    check_overlapped_result( 0, ring, status[0], events[0], &iob[0], STATUS_SUCCESS, 16 );
+
+    ResetEvent( events[0] );
+    offset.QuadPart = (LONGLONG)count * block;
+    status[0] = pNtReadFile( hfile, events[0], NULL, NULL, &iob[0], buf, block, &offset, NULL );
+    check_overlapped_result( 0, ring, status[0], events[0], &iob[0], STATUS_END_OF_FILE, 0 );
+
+    for (i = 0; i < count; i++) CloseHandle( events[i] );
+    free( buf );
+    CloseHandle( hfile );
+}
+
+/* run the overlapped tests again in a process that submits them through io_uring */
+static void test_overlapped_queue_ring(void)
+{
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    char cmdline[MAX_PATH * 2], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "\"%s\" %s io_ring", argv[0], argv[1] );
+    SetEnvironmentVariableA( "WINEIOURING", "1" );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    SetEnvironmentVariableA( "WINEIOURING", NULL );
+    ok( ret, "CreateProcess failed %lu\n", GetLastError() );
+    if (!ret) return;
+    wait_child_process( pi.hProcess );
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+}
+
+static DWORD WINAPI fd_cache_thread( void *arg )
+{
+    char data[64], buf[64];
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER offset;
+    NTSTATUS status;
+    HANDLE hfile;
+    int i;
+
+    memset( data, 'a' + (INT_PTR)arg, sizeof(data) );
+    for (i = 0; i < 100; i++)
+    {
+        if (!(hfile = create_temp_file( 0 ))) break;
+        offset.QuadPart = 0;
+        status = pNtWriteFile( hfile, NULL, NULL, NULL, &io, data, sizeof(data), &offset, NULL );
+        ok( !status, "got %#lx\n", status );
+        memset( buf, 0, sizeof(buf) );
+        status = pNtReadFile( hfile, NULL, NULL, NULL, &io, buf, sizeof(buf), &offset, NULL );
+        ok( !status, "got %#lx\n", status );
+        ok( !memcmp( buf, data, sizeof(data) ), "%d: got data from another file\n", i );
+        CloseHandle( hfile );
+    }
+    return 0;
+}
+
+static void test_fd_cache_threads(void)
+{
+    HANDLE threads[8];
+    DWORD ret;
+    int i;
+
+    /* handle values are reused across threads, a stale cached fd would read another file */
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread( NULL, 0, fd_cache_thread, (void *)(INT_PTR)i, 0, NULL );
+    ret = WaitForMultipleObjects( ARRAY_SIZE(threads), threads, TRUE, 30000 );
+    ok( ret < WAIT_OBJECT_0 + ARRAY_SIZE(threads), "wait failed %lu\n", ret );
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle( threads[i] );
+}
+
 static void test_ioctl(void)
 {
     HANDLE event = CreateEventA(NULL, TRUE, FALSE, NULL);
@@ -5434,10 +5577,89 @@ static void test_reparse_points(void)
     CloseHandle( handle );
 }
 
+static HANDLE open_case_test_file( const WCHAR *dir, const WCHAR *name, DWORD disposition )
+{
+    WCHAR path[MAX_PATH];
+
+    lstrcpyW( path, dir );
+    lstrcatW( path, name );
+    return CreateFileW( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, disposition, 0, 0 );
+}
+
+static void test_case_insensitive_open(void)
+{
+    WCHAR dir[MAX_PATH], src[MAX_PATH], dst[MAX_PATH];
+    HANDLE file;
+    BOOL ret;
+
+    GetTempPathW( MAX_PATH, dir );
+    lstrcatW( dir, L"winetest_case\\" );
+    ret = CreateDirectoryW( dir, NULL );
+    ok( ret, "CreateDirectory failed %lu\n", GetLastError() );
+
+    file = open_case_test_file( dir, L"MixedCase.txt", CREATE_NEW );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %lu\n", GetLastError() );
+    CloseHandle( file );
+
+    /* directories modified in the current second are not cached */
+    Sleep( 1100 );
+
+    /* the first lookup fills the cache, the second one hits it */
+    file = open_case_test_file( dir, L"mixedcase.TXT", OPEN_EXISTING );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %lu\n", GetLastError() );
+    CloseHandle( file );
+    file = open_case_test_file( dir, L"MIXEDCASE.txt", OPEN_EXISTING );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %lu\n", GetLastError() );
+    CloseHandle( file );
+
+    /* missing names are answered from the cache too */
+    SetLastError( 0xdeadbeef );
+    file = open_case_test_file( dir, L"renamed.txt", OPEN_EXISTING );
+    ok( file == INVALID_HANDLE_VALUE, "CreateFile succeeded\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "got error %lu\n", GetLastError() );
+
+    /* renaming a file changes the directory time and must invalidate the cache */
+    lstrcpyW( src, dir );
+    lstrcatW( src, L"MixedCase.txt" );
+    lstrcpyW( dst, dir );
+    lstrcatW( dst, L"Renamed.txt" );
+    ret = MoveFileW( src, dst );
+    ok( ret, "MoveFile failed %lu\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    file = open_case_test_file( dir, L"MIXEDCASE.txt", OPEN_EXISTING );
+    ok( file == INVALID_HANDLE_VALUE, "CreateFile succeeded\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "got error %lu\n", GetLastError() );
+
+    file = open_case_test_file( dir, L"rEnAmEd.TXT", OPEN_EXISTING );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %lu\n", GetLastError() );
+    CloseHandle( file );
+
+    /* once the directory is old enough again, the new contents get cached */
+    Sleep( 1100 );
+
+    SetLastError( 0xdeadbeef );
+    file = open_case_test_file( dir, L"mixedcase.txt", OPEN_EXISTING );
+    ok( file == INVALID_HANDLE_VALUE, "CreateFile succeeded\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "got error %lu\n", GetLastError() );
+
+    file = open_case_test_file( dir, L"RENAMED.txt", OPEN_EXISTING );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %lu\n", GetLastError() );
+    CloseHandle( file );
+
+    ret = DeleteFileW( dst );
+    ok( ret, "DeleteFile failed %lu\n", GetLastError() );
+    ret = RemoveDirectoryW( dir );
+    ok( ret, "RemoveDirectory failed %lu\n", GetLastError() );
+}
+
 START_TEST(file)
 {
     HMODULE hkernel32 = GetModuleHandleA("kernel32.dll");
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
+    char **argv;
+    int argc;
+
     if (!hntdll)
     {
         skip("not running on NT, skipping test\n");
@@ -5476,7 +5698,17 @@ START_TEST(file)
     pNtFlushBuffersFile = (void *)GetProcAddress(hntdll, "NtFlushBuffersFile");
     pNtQueryEaFile          = (void *)GetProcAddress(hntdll, "NtQueryEaFile");
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc > 2 && !strcmp( argv[2], "io_ring" ))
+    {
+        test_overlapped_queue( TRUE );
+        return;
+    }
+
     test_read_write();
+    test_overlapped_queue( FALSE );
+    test_overlapped_queue_ring();
+    test_fd_cache_threads();
     test_NtCreateFile();
     create_file_test();
     open_file_test();
@@ -5508,4 +5740,5 @@ START_TEST(file)
     test_flush_buffers_file();
     test_mailslot_name();
     test_reparse_points();
+    test_case_insensitive_open();
 }
@@ -1916,6 +1916,27 @@ static void test_query_object(void)
     test_object_type( handle, L"File" );
     test_file_info( handle );
     pNtClose( handle );
+
+    handle = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ok( handle != NULL, "CreateEvent failed (%lu)\n", GetLastError() );
+    SetHandleInformation( handle, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT );
+    status = pNtQueryObject( handle, ObjectDataInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %lx\n", status );
+    ok( ((OBJECT_DATA_INFORMATION *)buffer)->InheritHandle, "handle not inheritable\n" );
+    ok( !((OBJECT_DATA_INFORMATION *)buffer)->ProtectFromClose, "handle protected from close\n" );
+    SetHandleInformation( handle, HANDLE_FLAG_INHERIT, 0 );
+    status = pNtQueryObject( handle, ObjectDataInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %lx\n", status );
+    ok( !((OBJECT_DATA_INFORMATION *)buffer)->InheritHandle, "handle inheritable\n" );
+    test_object_type( handle, L"Event" );
+    pNtClose( handle );
+
+    status = pNtQueryObject( handle, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_INVALID_HANDLE, "NtQueryObject returned %lx\n", status );
+    status = pNtQueryObject( handle, ObjectDataInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_INVALID_HANDLE, "NtQueryObject returned %lx\n", status );
+    status = pNtQueryObject( handle, ObjectBasicInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_INVALID_HANDLE, "NtQueryObject returned %lx\n", status );
 }
 
 static void test_type_mismatch(void)
@@ -769,7 +769,9 @@ static void test_NtQueryValueKey(void)
     KEY_VALUE_BASIC_INFORMATION *basic_info;
     KEY_VALUE_PARTIAL_INFORMATION *partial_info, pi;
     KEY_VALUE_FULL_INFORMATION *full_info;
-    DWORD len, expected;
+    DWORD len, expected, data, i;
+    BYTE partial_buffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[sizeof(DWORD)])];
+    HANDLE key2;
 
     pRtlCreateUnicodeStringFromAsciiz(&ValName, "deletetest");
 
@@ -881,6 +883,33 @@ static void test_NtQueryValueKey(void)
     ok(pi.DataLength == 0, "DataLength=%lu\n", pi.DataLength);
     pRtlFreeUnicodeString(&ValName);
 
+    /* values modified through another handle are seen by subsequent queries */
+    status = pNtOpenKey(&key2, KEY_READ|KEY_SET_VALUE, &attr);
+    ok(status == STATUS_SUCCESS, "NtOpenKey Failed: 0x%08lx\n", status);
+    pRtlCreateUnicodeStringFromAsciiz(&ValName, "cachetest");
+    partial_info = (KEY_VALUE_PARTIAL_INFORMATION *)partial_buffer;
+    for (i = 0; i < 3; i++)
+    {
+        data = 0xdead0000 + i;
+        status = pNtSetValueKey(key2, &ValName, 0, REG_DWORD, &data, sizeof(data));
+        ok(status == STATUS_SUCCESS, "NtSetValueKey Failed: 0x%08lx\n", status);
+        status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_buffer, sizeof(partial_buffer), &len);
+        ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08lx\n", status);
+        ok(*(DWORD *)partial_info->Data == data, "%lu: incorrect Data returned: 0x%lx\n", i, *(DWORD *)partial_info->Data);
+    }
+    status = pNtDeleteValueKey(key2, &ValName);
+    ok(status == STATUS_SUCCESS, "NtDeleteValueKey Failed: 0x%08lx\n", status);
+    status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_buffer, sizeof(partial_buffer), &len);
+    ok(status == STATUS_OBJECT_NAME_NOT_FOUND, "NtQueryValueKey wrong status 0x%08lx\n", status);
+    status = pNtSetValueKey(key2, &ValName, 0, REG_DWORD, &data, sizeof(data));
+    ok(status == STATUS_SUCCESS, "NtSetValueKey Failed: 0x%08lx\n", status);
+    status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_buffer, sizeof(partial_buffer), &len);
+    ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08lx\n", status);
+    status = pNtDeleteValueKey(key2, &ValName);
+    ok(status == STATUS_SUCCESS, "NtDeleteValueKey Failed: 0x%08lx\n", status);
+    pRtlFreeUnicodeString(&ValName);
+    pNtClose(key2);
+
     pNtClose(key);
 }
 
@@ -2128,6 +2157,82 @@ static void test_long_value_name(void)
     pNtClose(key);
 }
 
+static void test_many_values(void)
+{
+    HANDLE key;
+    NTSTATUS status;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING ValName;
+    KEY_VALUE_BASIC_INFORMATION *basic_info;
+    KEY_VALUE_PARTIAL_INFORMATION *partial_info;
+    BYTE buffer[256];
+    char name[16];
+    DWORD i, len, count;
+
+    InitializeObjectAttributes(&attr, &winetestpath, 0, 0, 0);
+    status = pNtOpenKey(&key, KEY_WRITE|KEY_READ, &attr);
+    ok(status == STATUS_SUCCESS, "NtOpenKey Failed: 0x%08lx\n", status);
+
+    /* enough values to use a hash index, inserted out of order */
+    for (i = 0; i < 500; i++)
+    {
+        sprintf(name, "Many%03lu", (i * 7) % 500);
+        pRtlCreateUnicodeStringFromAsciiz(&ValName, name);
+        status = pNtSetValueKey(key, &ValName, 0, REG_DWORD, &i, sizeof(i));
+        ok(status == STATUS_SUCCESS, "NtSetValueKey Failed: 0x%08lx\n", status);
+        pRtlFreeUnicodeString(&ValName);
+    }
+    for (i = 0; i < 500; i += 2)
+    {
+        sprintf(name, "many%03lu", i);
+        pRtlCreateUnicodeStringFromAsciiz(&ValName, name);
+        status = pNtDeleteValueKey(key, &ValName);
+        ok(status == STATUS_SUCCESS, "NtDeleteValueKey Failed: 0x%08lx\n", status);
+        pRtlFreeUnicodeString(&ValName);
+    }
+
+    partial_info = (KEY_VALUE_PARTIAL_INFORMATION *)buffer;
+    for (i = 0; i < 500; i++)
+    {
+        sprintf(name, "MANY%03lu", i);
+        pRtlCreateUnicodeStringFromAsciiz(&ValName, name);
+        status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, buffer, sizeof(buffer), &len);
+        if (i % 2)
+        {
+            ok(status == STATUS_SUCCESS, "%lu: NtQueryValueKey returned 0x%08lx\n", i, status);
+            ok((*(DWORD *)partial_info->Data * 7) % 500 == i, "%lu: incorrect Data returned: %lu\n",
+               i, *(DWORD *)partial_info->Data);
+        }
+        else ok(status == STATUS_OBJECT_NAME_NOT_FOUND, "%lu: NtQueryValueKey returned 0x%08lx\n", i, status);
+        pRtlFreeUnicodeString(&ValName);
+    }
+
+    /* enumeration is still sorted */
+    basic_info = (KEY_VALUE_BASIC_INFORMATION *)buffer;
+    for (i = count = 0; ; i++)
+    {
+        status = pNtEnumerateValueKey(key, i, KeyValueBasicInformation, buffer, sizeof(buffer), &len);
+        if (status) break;
+        if (basic_info->NameLength != 7 * sizeof(WCHAR) || memcmp(basic_info->Name, L"Many", 4 * sizeof(WCHAR)))
+            continue;
+        len = (basic_info->Name[4] - '0') * 100 + (basic_info->Name[5] - '0') * 10 + basic_info->Name[6] - '0';
+        ok(len == 2 * count + 1, "%lu: got value %lu\n", i, len);
+        count++;
+    }
+    ok(status == STATUS_NO_MORE_ENTRIES, "NtEnumerateValueKey returned 0x%08lx\n", status);
+    ok(count == 250, "got %lu values\n", count);
+
+    for (i = 1; i < 500; i += 2)
+    {
+        sprintf(name, "Many%03lu", i);
+        pRtlCreateUnicodeStringFromAsciiz(&ValName, name);
+        status = pNtDeleteValueKey(key, &ValName);
+        ok(status == STATUS_SUCCESS, "NtDeleteValueKey Failed: 0x%08lx\n", status);
+        pRtlFreeUnicodeString(&ValName);
+    }
+    pNtClose(key);
+}
+
 static void test_NtQueryKey(void)
 {
     HANDLE key, subkey, subkey2;
@@ -2638,6 +2743,7 @@ START_TEST(reg)
     test_NtQueryLicenseKey();
     test_NtQueryValueKey();
     test_long_value_name();
+    test_many_values();
     test_notify();
     test_RtlCreateRegistryKey();
     test_NtDeleteKey();
@@ -2630,6 +2630,147 @@ static void test_RtlUTF8ToUnicodeN(void)
     }
 }
 
+static unsigned int encode_utf8( char *dst, const WCHAR *src, unsigned int len )
+{
+    unsigned int i, ret = 0, val;
+
+    for (i = 0; i < len; i++)
+    {
+        val = src[i];
+        if (val >= 0xd800 && val < 0xdc00 && i + 1 < len)
+            val = 0x10000 + ((val - 0xd800) << 10) + (src[++i] - 0xdc00);
+        if (val < 0x80) dst[ret++] = val;
+        else if (val < 0x800)
+        {
+            dst[ret++] = 0xc0 | (val >> 6);
+            dst[ret++] = 0x80 | (val & 0x3f);
+        }
+        else if (val < 0x10000)
+        {
+            dst[ret++] = 0xe0 | (val >> 12);
+            dst[ret++] = 0x80 | ((val >> 6) & 0x3f);
+            dst[ret++] = 0x80 | (val & 0x3f);
+        }
+        else
+        {
+            dst[ret++] = 0xf0 | (val >> 18);
+            dst[ret++] = 0x80 | ((val >> 12) & 0x3f);
+            dst[ret++] = 0x80 | ((val >> 6) & 0x3f);
+            dst[ret++] = 0x80 | (val & 0x3f);
+        }
+    }
+    return ret;
+}
+
+static void test_utf8_runs(void)
+{
+    static const char invalid[] = "abcdefghij\xffklmnopqrstuvwx\xc3" "0123456789\xe4\xb8" "ABCDEFGHIJ\xed\xa0\x80xyz";
+    static const WCHAR invalid_expect[] = L"abcdefghij\xfffdklmnopqrstuvwx\xfffd" "0123456789\xfffd"
+                                          L"ABCDEFGHIJ\xfffd\xfffdxyz";
+    static const WCHAR mixed[] = L"0123456789abcdef\x00e9t\x00e9 ABCDEFGHIJKL\x4e2d\x6587 tail\xd83d\xde00!";
+    static const char *names[] = { "ascii", "latin", "cjk" };
+    const unsigned int count = 0x10000;
+    WCHAR *src, *dst, buffer[128];
+    char *utf8, *out, bytes[256];
+    unsigned int i, j, len, pass;
+    ULONG bytes_out, expect;
+    NTSTATUS status;
+    DWORD start;
+
+    if (!pRtlUTF8ToUnicodeN || !pRtlUnicodeToUTF8N)
+    {
+        win_skip("RtlUTF8ToUnicodeN or RtlUnicodeToUTF8N not available\n");
+        return;
+    }
+
+    /* invalid sequences between runs of ASCII */
+    status = pRtlUTF8ToUnicodeN( buffer, sizeof(buffer), &bytes_out, invalid, strlen(invalid) );
+    ok( status == STATUS_SOME_NOT_MAPPED, "status = 0x%lx\n", status );
+    ok( bytes_out == wcslen(invalid_expect) * sizeof(WCHAR), "bytes_out = %lu\n", bytes_out );
+    ok( !memcmp( buffer, invalid_expect, bytes_out ), "got %s\n", wine_dbgstr_wn( buffer, bytes_out / sizeof(WCHAR) ));
+    status = pRtlUTF8ToUnicodeN( NULL, 0, &bytes_out, invalid, strlen(invalid) );
+    ok( status == STATUS_SOME_NOT_MAPPED, "status = 0x%lx\n", status );
+    ok( bytes_out == wcslen(invalid_expect) * sizeof(WCHAR), "bytes_out = %lu\n", bytes_out );
+
+    /* output truncated at every position */
+    len = encode_utf8( bytes, mixed, wcslen(mixed) );
+    for (i = 0; i <= len; i++)
+    {
+        char res[256];
+
+        for (j = expect = 0; j < wcslen(mixed); j++)
+        {
+            unsigned int size;
+
+            if (mixed[j] >= 0xd800 && mixed[j] < 0xdc00) continue;  /* no partial surrogate pairs */
+            if ((size = encode_utf8( res, mixed, j + 1 )) > i) break;
+            expect = size;
+        }
+        memset( res, 0x55, sizeof(res) );
+        status = pRtlUnicodeToUTF8N( res, i, &bytes_out, mixed, wcslen(mixed) * sizeof(WCHAR) );
+        ok( status == (i < len ? STATUS_BUFFER_TOO_SMALL : STATUS_SUCCESS), "%u: status = 0x%lx\n", i, status );
+        ok( bytes_out == expect, "%u: bytes_out = %lu, expected %lu\n", i, bytes_out, expect );
+        ok( !memcmp( res, bytes, bytes_out ), "%u: wrong data\n", i );
+        ok( (unsigned char)res[bytes_out] == 0x55, "%u: wrote past the end\n", i );
+    }
+    for (i = 0; i <= wcslen(mixed) - 1; i++)
+    {
+        memset( buffer, 0x55, sizeof(buffer) );
+        status = pRtlUTF8ToUnicodeN( buffer, i * sizeof(WCHAR), &bytes_out, bytes, len );
+        ok( status == STATUS_BUFFER_TOO_SMALL, "%u: status = 0x%lx\n", i, status );
+        ok( bytes_out == i * sizeof(WCHAR), "%u: bytes_out = %lu\n", i, bytes_out );
+        ok( !memcmp( buffer, mixed, bytes_out ), "%u: wrong data\n", i );
+        ok( buffer[i] == 0x5555, "%u: wrote past the end\n", i );
+    }
+
+    /* large corpora, with various alignments */
+    src = malloc( count * sizeof(WCHAR) );
+    dst = malloc( (count + 4) * sizeof(WCHAR) );
+    utf8 = malloc( count * 3 + 8 );
+    out = malloc( count * 3 + 8 );
+    for (pass = 0; pass < ARRAY_SIZE(names); pass++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            switch (pass)
+            {
+            case 0: src[i] = ' ' + i % 95; break;
+            case 1: src[i] = i % 7 ? 'a' + i % 26 : 0xe0 + i % 32; break;
+            case 2: src[i] = i % 11 ? 0x4e00 + i % 0x5000 : ' '; break;
+            }
+        }
+
+        for (i = 0; i < 8; i++)
+        {
+            len = encode_utf8( utf8 + i, src, count );
+            status = pRtlUTF8ToUnicodeN( dst + i % 4, count * sizeof(WCHAR), &bytes_out, utf8 + i, len );
+            ok( !status, "%s %u: status = 0x%lx\n", names[pass], i, status );
+            ok( bytes_out == count * sizeof(WCHAR), "%s %u: bytes_out = %lu\n", names[pass], i, bytes_out );
+            ok( !memcmp( dst + i % 4, src, count * sizeof(WCHAR) ), "%s %u: wrong data\n", names[pass], i );
+
+            status = pRtlUnicodeToUTF8N( NULL, 0, &bytes_out, dst + i % 4, count * sizeof(WCHAR) );
+            ok( !status, "%s %u: status = 0x%lx\n", names[pass], i, status );
+            ok( bytes_out == len, "%s %u: bytes_out = %lu\n", names[pass], i, bytes_out );
+            status = pRtlUnicodeToUTF8N( out + 7 - i, len, &bytes_out, dst + i % 4, count * sizeof(WCHAR) );
+            ok( !status, "%s %u: status = 0x%lx\n", names[pass], i, status );
+            ok( bytes_out == len, "%s %u: bytes_out = %lu\n", names[pass], i, bytes_out );
+            ok( !memcmp( out + 7 - i, utf8 + i, len ), "%s %u: wrong data\n", names[pass], i );
+        }
+
+        start = GetTickCount();
+        for (i = 0; i < 200; i++)
+        {
+            pRtlUTF8ToUnicodeN( dst, count * sizeof(WCHAR), &bytes_out, utf8, len );
+            pRtlUnicodeToUTF8N( out, len, &bytes_out, dst, count * sizeof(WCHAR) );
+        }
+        trace( "%s: 200 round trips of %u chars in %lu ms\n", names[pass], count, GetTickCount() - start );
+    }
+    free( out );
+    free( utf8 );
+    free( dst );
+    free( src );
+}
+
 static NTSTATUS WINAPIV fmt( const WCHAR *src, ULONG width, BOOLEAN ignore_inserts, BOOLEAN ansi,
                              WCHAR *buffer, ULONG size, ULONG *retsize, ... )
 {
@@ -2963,5 +3104,6 @@ START_TEST(rtlstr)
     test_RtlHashUnicodeString();
     test_RtlUnicodeToUTF8N();
     test_RtlUTF8ToUnicodeN();
+    test_utf8_runs();
     test_RtlFormatMessage();
 }
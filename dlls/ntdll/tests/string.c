@@ -64,8 +64,12 @@ static int      (__cdecl *p_wcsicmp)(LPCWSTR,LPCWSTR);
 static int      (__cdecl *p_wcsnicmp)(LPCWSTR,LPCWSTR,int);
 
 static LPWSTR   (__cdecl *pwcschr)(LPCWSTR, WCHAR);
+static int      (__cdecl *pwcscmp)(LPCWSTR, LPCWSTR);
+static size_t   (__cdecl *pwcslen)(LPCWSTR);
 static LPWSTR   (__cdecl *pwcsrchr)(LPCWSTR, WCHAR);
 static void*    (__cdecl *pmemchr)(const void*, int, size_t);
+static void*    (__cdecl *pmemcpy)(void *, const void*, size_t);
+static void*    (__cdecl *pmemmove)(void *, const void*, size_t);
 
 static void     (__cdecl *pqsort)(void *,size_t,size_t, int(__cdecl *compar)(const void *, const void *) );
 static void*    (__cdecl *pbsearch)(void *,void*,size_t,size_t, int(__cdecl *compar)(const void *, const void *) );
@@ -134,8 +138,12 @@ static void InitFunctionPtrs(void)
     X(_wcsicmp);
     X(_wcsnicmp);
     X(wcschr);
+    X(wcscmp);
+    X(wcslen);
     X(wcsrchr);
     X(memchr);
+    X(memcpy);
+    X(memmove);
     X(qsort);
     X(bsearch);
     X(_snprintf);
@@ -2056,6 +2064,162 @@ static void test_memchr(void)
     ok(r == s, "memchr returned %p, expected %p\n", r, s);
 }
 
+static void test_memmove(void)
+{
+    unsigned char src[128], dst[128], expect[128], *page;
+    unsigned int i, j, len, count;
+    DWORD start;
+    void *ret;
+    SYSTEM_INFO si;
+    DWORD old_prot;
+
+    for (i = 0; i < sizeof(src); i++) src[i] = i + 1;
+
+    for (i = 0; i < 16; i++)
+    {
+        for (j = 0; j < 16; j++)
+        {
+            for (len = 0; len < 80; len++)
+            {
+                memset( dst, 0xcc, sizeof(dst) );
+                memset( expect, 0xcc, sizeof(expect) );
+                memcpy( expect + j, src + i, len );
+                ret = pmemcpy( dst + j, src + i, len );
+                ok( ret == dst + j, "%u,%u,%u: wrong ret %p / %p\n", i, j, len, ret, dst + j );
+                ok( !memcmp( dst, expect, sizeof(dst) ), "%u,%u,%u: wrong data\n", i, j, len );
+
+                /* overlapping copies in both directions */
+                memcpy( dst, src, sizeof(dst) );
+                memcpy( expect, src, sizeof(expect) );
+                memcpy( expect + j + 16, src + i, len );
+                ret = pmemmove( dst + j + 16, dst + i, len );
+                ok( ret == dst + j + 16, "%u,%u,%u: wrong ret %p / %p\n", i, j, len, ret, dst + j + 16 );
+                ok( !memcmp( dst, expect, sizeof(dst) ), "%u,%u,%u: wrong forward data\n", i, j, len );
+
+                memcpy( dst, src, sizeof(dst) );
+                memcpy( expect, src, sizeof(expect) );
+                memcpy( expect + i, src + j + 16, len );
+                ret = pmemmove( dst + i, dst + j + 16, len );
+                ok( ret == dst + i, "%u,%u,%u: wrong ret %p / %p\n", i, j, len, ret, dst + i );
+                ok( !memcmp( dst, expect, sizeof(dst) ), "%u,%u,%u: wrong backward data\n", i, j, len );
+            }
+        }
+    }
+
+    /* the source ends right before an inaccessible page */
+    GetSystemInfo( &si );
+    page = VirtualAlloc( NULL, 2 * si.dwPageSize, MEM_COMMIT, PAGE_READWRITE );
+    ok( page != NULL, "VirtualAlloc failed %lu\n", GetLastError() );
+    VirtualProtect( page + si.dwPageSize, si.dwPageSize, PAGE_NOACCESS, &old_prot );
+    for (i = 0; i < 64; i++) page[si.dwPageSize - 64 + i] = i + 1;
+    for (len = 0; len < 64; len++)
+    {
+        for (i = 0; i < 16; i++)
+        {
+            memset( dst, 0xcc, sizeof(dst) );
+            pmemmove( dst + i, page + si.dwPageSize - len, len );
+            ok( !memcmp( dst + i, page + si.dwPageSize - len, len ), "%u,%u: wrong data\n", i, len );
+            pmemmove( page + si.dwPageSize - len, page + si.dwPageSize - len, len );
+        }
+    }
+    VirtualFree( page, 0, MEM_RELEASE );
+
+    page = malloc( 0x100000 + 16 );
+    memset( page, 0x55, 0x100000 + 16 );
+    start = GetTickCount();
+    for (count = 0; count < 200; count++) pmemcpy( page + (count & 7), page + 0x80000 + 8, 0x80000 );
+    trace( "memcpy: 200 unaligned copies of 512K in %lu ms\n", GetTickCount() - start );
+    start = GetTickCount();
+    for (count = 0; count < 200; count++) pmemmove( page + 0x40000 + (count & 7), page, 0x80000 );
+    trace( "memmove: 200 overlapping copies of 512K in %lu ms\n", GetTickCount() - start );
+    free( page );
+}
+
+static void test_wcs_page_boundary(void)
+{
+    static const WCHAR upper[] = L"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    WCHAR *page, *str, *lower, *big;
+    unsigned char *end;
+    unsigned int i, len, misalign, count;
+    size_t ret;
+    WCHAR *p;
+    SYSTEM_INFO si;
+    DWORD old_prot, start;
+    int res;
+
+    GetSystemInfo( &si );
+    page = VirtualAlloc( NULL, 2 * si.dwPageSize, MEM_COMMIT, PAGE_READWRITE );
+    ok( page != NULL, "VirtualAlloc failed %lu\n", GetLastError() );
+    lower = VirtualAlloc( NULL, si.dwPageSize, MEM_COMMIT, PAGE_READWRITE );
+    VirtualProtect( (char *)page + si.dwPageSize, si.dwPageSize, PAGE_NOACCESS, &old_prot );
+    end = (unsigned char *)page + si.dwPageSize;
+
+    for (misalign = 0; misalign < 2; misalign++)
+    {
+        for (len = 0; len < ARRAY_SIZE(upper); len++)
+        {
+            /* the terminating null is the last accessible WCHAR */
+            str = (WCHAR *)(end - misalign - (len + 1) * sizeof(WCHAR));
+            memcpy( str, upper, len * sizeof(WCHAR) );
+            str[len] = 0;
+            for (i = 0; i < len; i++) lower[i] = upper[i] >= 'A' && upper[i] <= 'Z' ? upper[i] + 32 : upper[i];
+            lower[len] = 0;
+
+            ret = pwcslen( str );
+            ok( ret == len, "%u,%u: wcslen returned %Iu\n", misalign, len, ret );
+
+            p = pwcschr( str, 0 );
+            ok( p == str + len, "%u,%u: wcschr returned %p / %p\n", misalign, len, p, str + len );
+            p = pwcschr( str, 'z' );
+            ok( !p, "%u,%u: wcschr returned %p\n", misalign, len, p );
+            if (len)
+            {
+                p = pwcschr( str, upper[len - 1] );
+                ok( p == str + len - 1, "%u,%u: wcschr returned %p / %p\n", misalign, len, p, str + len - 1 );
+            }
+
+            res = pwcscmp( str, upper );
+            if (len < ARRAY_SIZE(upper) - 1) ok( res < 0, "%u,%u: wcscmp returned %d\n", misalign, len, res );
+            res = pwcscmp( str, str );
+            ok( !res, "%u,%u: wcscmp returned %d\n", misalign, len, res );
+            res = p_wcsicmp( str, lower );
+            ok( !res, "%u,%u: _wcsicmp returned %d\n", misalign, len, res );
+            res = p_wcsicmp( lower, str );
+            ok( !res, "%u,%u: _wcsicmp returned %d\n", misalign, len, res );
+
+            /* a difference at every position */
+            for (i = 0; i < len; i++)
+            {
+                lower[i] = '~';
+                res = pwcscmp( str, lower );
+                ok( res < 0, "%u,%u,%u: wcscmp returned %d\n", misalign, len, i, res );
+                res = pwcscmp( lower, str );
+                ok( res > 0, "%u,%u,%u: wcscmp returned %d\n", misalign, len, i, res );
+                res = p_wcsicmp( str, lower );
+                ok( res < 0, "%u,%u,%u: _wcsicmp returned %d\n", misalign, len, i, res );
+                res = p_wcsicmp( lower, str );
+                ok( res > 0, "%u,%u,%u: _wcsicmp returned %d\n", misalign, len, i, res );
+                lower[i] = upper[i] >= 'A' && upper[i] <= 'Z' ? upper[i] + 32 : upper[i];
+            }
+        }
+    }
+    VirtualFree( lower, 0, MEM_RELEASE );
+    VirtualFree( page, 0, MEM_RELEASE );
+
+    big = malloc( 0x10001 * sizeof(WCHAR) * 2 );
+    for (i = 0; i < 0x10000; i++) big[i] = big[0x10001 + i] = 'a' + i % 26;
+    big[0x10000] = big[0x20001] = 0;
+    start = GetTickCount();
+    for (count = 0, ret = 0; count < 500; count++) ret += pwcslen( big ) + (pwcschr( big, '!' ) != NULL);
+    trace( "wcslen/wcschr: 500 scans of 64K chars in %lu ms\n", GetTickCount() - start );
+    ok( ret == 500 * 0x10000, "wrong total %Iu\n", ret );
+    start = GetTickCount();
+    for (count = 0; count < 500; count++) res = pwcscmp( big, big + 0x10001 ) + p_wcsicmp( big, big + 0x10001 );
+    trace( "wcscmp/_wcsicmp: 500 compares of 64K chars in %lu ms\n", GetTickCount() - start );
+    ok( !res, "wrong result %d\n", res );
+    free( big );
+}
+
 START_TEST(string)
 {
     InitFunctionPtrs();
@@ -2088,4 +2252,6 @@ START_TEST(string)
     test_wctype();
     test_ctype();
     test_memchr();
+    test_memmove();
+    test_wcs_page_boundary();
 }
@@ -27,11 +27,15 @@
 #include "wine/test.h"
 
 static NTSTATUS (WINAPI *pNtAlertThreadByThreadId)( HANDLE );
+static NTSTATUS (WINAPI *pNtAssociateWaitCompletionPacket)( HANDLE, HANDLE, HANDLE, void *, void *, NTSTATUS, ULONG_PTR, BOOLEAN * );
+static NTSTATUS (WINAPI *pNtCancelWaitCompletionPacket)( HANDLE, BOOLEAN );
 static NTSTATUS (WINAPI *pNtClose)( HANDLE );
+static NTSTATUS (WINAPI *pNtCreateIoCompletion)( HANDLE *, ACCESS_MASK, OBJECT_ATTRIBUTES *, ULONG );
 static NTSTATUS (WINAPI *pNtCreateEvent) ( PHANDLE, ACCESS_MASK, const OBJECT_ATTRIBUTES *, EVENT_TYPE, BOOLEAN);
 static NTSTATUS (WINAPI *pNtCreateKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, ULONG );
 static NTSTATUS (WINAPI *pNtCreateMutant)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, BOOLEAN );
 static NTSTATUS (WINAPI *pNtCreateSemaphore)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, LONG, LONG );
+static NTSTATUS (WINAPI *pNtCreateWaitCompletionPacket)( HANDLE *, ACCESS_MASK, OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtOpenEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtOpenKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtPulseEvent)( HANDLE, LONG * );
@@ -42,6 +46,7 @@ static NTSTATUS (WINAPI *pNtQuerySystemTime)( LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtReleaseKeyedEvent)( HANDLE, const void *, BOOLEAN, const LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtReleaseMutant)( HANDLE, LONG * );
 static NTSTATUS (WINAPI *pNtReleaseSemaphore)( HANDLE, ULONG, ULONG * );
+static NTSTATUS (WINAPI *pNtRemoveIoCompletion)( HANDLE, ULONG_PTR *, ULONG_PTR *, IO_STATUS_BLOCK *, LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtResetEvent)( HANDLE, LONG * );
 static NTSTATUS (WINAPI *pNtSetEvent)( HANDLE, LONG * );
 static NTSTATUS (WINAPI *pNtWaitForAlertByThreadId)( void *, const LARGE_INTEGER * );
@@ -529,6 +534,85 @@ static void test_semaphore(void)
     NtClose( semaphore );
 }
 
+static void test_wait_all(void)
+{
+    SEMAPHORE_BASIC_INFORMATION sem_info;
+    MUTANT_BASIC_INFORMATION mutant_info;
+    EVENT_BASIC_INFORMATION event_info;
+    HANDLE handles[3];
+    NTSTATUS status;
+    DWORD ret;
+
+    status = pNtCreateSemaphore( &handles[0], SEMAPHORE_ALL_ACCESS, NULL, 1, 1 );
+    ok( !status, "NtCreateSemaphore failed %08lx\n", status );
+    status = pNtCreateMutant( &handles[1], MUTANT_ALL_ACCESS, NULL, FALSE );
+    ok( !status, "NtCreateMutant failed %08lx\n", status );
+    status = pNtCreateEvent( &handles[2], EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+
+    /* objects that are signaled must not be acquired if the wait isn't satisfied */
+    ret = WaitForMultipleObjects( 3, handles, TRUE, 0 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+
+    status = pNtQuerySemaphore( handles[0], SemaphoreBasicInformation, &sem_info, sizeof(sem_info), NULL );
+    ok( !status, "NtQuerySemaphore failed %08lx\n", status );
+    ok( sem_info.CurrentCount == 1, "got count %ld\n", sem_info.CurrentCount );
+    status = pNtQueryMutant( handles[1], MutantBasicInformation, &mutant_info, sizeof(mutant_info), NULL );
+    ok( !status, "NtQueryMutant failed %08lx\n", status );
+    ok( mutant_info.CurrentCount == 1, "got count %ld\n", mutant_info.CurrentCount );
+    ok( !mutant_info.OwnedByCaller, "mutant is owned\n" );
+
+    status = pNtSetEvent( handles[2], NULL );
+    ok( !status, "NtSetEvent failed %08lx\n", status );
+    ret = WaitForMultipleObjects( 3, handles, TRUE, 0 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+    status = pNtQuerySemaphore( handles[0], SemaphoreBasicInformation, &sem_info, sizeof(sem_info), NULL );
+    ok( !status, "NtQuerySemaphore failed %08lx\n", status );
+    ok( !sem_info.CurrentCount, "got count %ld\n", sem_info.CurrentCount );
+    status = pNtQueryMutant( handles[1], MutantBasicInformation, &mutant_info, sizeof(mutant_info), NULL );
+    ok( !status, "NtQueryMutant failed %08lx\n", status );
+    ok( !mutant_info.CurrentCount, "got count %ld\n", mutant_info.CurrentCount );
+    ok( mutant_info.OwnedByCaller, "mutant isn't owned\n" );
+    status = pNtQueryEvent( handles[2], EventBasicInformation, &event_info, sizeof(event_info), NULL );
+    ok( !status, "NtQueryEvent failed %08lx\n", status );
+    ok( !event_info.EventState, "event is signaled\n" );
+
+    status = pNtReleaseMutant( handles[1], NULL );
+    ok( !status, "NtReleaseMutant failed %08lx\n", status );
+    pNtClose( handles[0] );
+    pNtClose( handles[1] );
+    pNtClose( handles[2] );
+}
+
+static DWORD WINAPI pulse_event_thread( void *arg )
+{
+    return WaitForSingleObject( arg, 5000 );
+}
+
+static void test_pulse_event_waiter(void)
+{
+    HANDLE event, thread;
+    NTSTATUS status;
+    DWORD ret;
+
+    status = pNtCreateEvent( &event, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+
+    /* the waiter has to be released even though it never sees the event signaled */
+    thread = CreateThread( NULL, 0, pulse_event_thread, event, 0, NULL );
+    do
+    {
+        status = pNtPulseEvent( event, NULL );
+        ok( !status, "NtPulseEvent failed %08lx\n", status );
+    } while (WaitForSingleObject( thread, 10 ) == WAIT_TIMEOUT);
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+    CloseHandle( thread );
+    pNtClose( event );
+}
+
 static void test_wait_on_address(void)
 {
     SIZE_T size;
@@ -633,6 +717,95 @@ static DWORD WINAPI resource_exclusive_thread(void *arg)
     return 0;
 }
 
+static void test_wait_completion_packet(void)
+{
+    HANDLE port, packet, event;
+    LARGE_INTEGER timeout;
+    IO_STATUS_BLOCK iosb;
+    ULONG_PTR key, value;
+    BOOLEAN signaled;
+    NTSTATUS status;
+
+    if (!pNtCreateWaitCompletionPacket)
+    {
+        win_skip( "NtCreateWaitCompletionPacket is not available\n" );
+        return;
+    }
+
+    status = pNtCreateIoCompletion( &port, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( !status, "NtCreateIoCompletion failed %08lx\n", status );
+    status = pNtCreateWaitCompletionPacket( &packet, GENERIC_ALL, NULL );
+    ok( !status, "NtCreateWaitCompletionPacket failed %08lx\n", status );
+    status = pNtCreateEvent( &event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+
+    status = pNtCancelWaitCompletionPacket( packet, FALSE );
+    ok( status == STATUS_CANCELLED, "NtCancelWaitCompletionPacket returned %08lx\n", status );
+
+    /* the packet is queued once the object gets signaled */
+    signaled = 0xcc;
+    status = pNtAssociateWaitCompletionPacket( packet, port, event, (void *)0x1234, (void *)0x5678,
+                                               STATUS_SUCCESS, 0xdead, &signaled );
+    ok( !status, "NtAssociateWaitCompletionPacket failed %08lx\n", status );
+    ok( !signaled, "got signaled %u\n", signaled );
+
+    timeout.QuadPart = 0;
+    status = pNtRemoveIoCompletion( port, &key, &value, &iosb, &timeout );
+    ok( status == STATUS_TIMEOUT, "NtRemoveIoCompletion returned %08lx\n", status );
+
+    pNtSetEvent( event, NULL );
+    key = value = 0;
+    memset( &iosb, 0xcc, sizeof(iosb) );
+    timeout.QuadPart = -1000 * 10000;
+    status = pNtRemoveIoCompletion( port, &key, &value, &iosb, &timeout );
+    ok( !status, "NtRemoveIoCompletion returned %08lx\n", status );
+    ok( key == 0x1234, "got key %#Ix\n", key );
+    ok( value == 0x5678, "got value %#Ix\n", value );
+    ok( iosb.Status == STATUS_SUCCESS, "got status %08lx\n", iosb.Status );
+    ok( iosb.Information == 0xdead, "got information %#Ix\n", iosb.Information );
+
+    /* the wait acquired the event */
+    timeout.QuadPart = 0;
+    status = NtWaitForSingleObject( event, FALSE, &timeout );
+    ok( status == STATUS_TIMEOUT, "NtWaitForSingleObject returned %08lx\n", status );
+
+    status = pNtCancelWaitCompletionPacket( packet, FALSE );
+    ok( status == STATUS_CANCELLED, "NtCancelWaitCompletionPacket returned %08lx\n", status );
+
+    /* an already signaled object queues the packet right away */
+    pNtSetEvent( event, NULL );
+    signaled = 0xcc;
+    status = pNtAssociateWaitCompletionPacket( packet, port, event, (void *)0x1234, (void *)0x5678,
+                                               STATUS_SUCCESS, 0, &signaled );
+    ok( !status, "NtAssociateWaitCompletionPacket failed %08lx\n", status );
+    ok( signaled == TRUE, "got signaled %u\n", signaled );
+
+    status = pNtCancelWaitCompletionPacket( packet, FALSE );
+    ok( status == STATUS_PENDING, "NtCancelWaitCompletionPacket returned %08lx\n", status );
+    status = pNtCancelWaitCompletionPacket( packet, TRUE );
+    ok( !status, "NtCancelWaitCompletionPacket returned %08lx\n", status );
+
+    timeout.QuadPart = 0;
+    status = pNtRemoveIoCompletion( port, &key, &value, &iosb, &timeout );
+    ok( status == STATUS_TIMEOUT, "NtRemoveIoCompletion returned %08lx\n", status );
+
+    /* cancelling a pending wait leaves the object alone */
+    status = pNtAssociateWaitCompletionPacket( packet, port, event, NULL, NULL, STATUS_SUCCESS, 0, NULL );
+    ok( !status, "NtAssociateWaitCompletionPacket failed %08lx\n", status );
+    status = pNtCancelWaitCompletionPacket( packet, FALSE );
+    ok( !status, "NtCancelWaitCompletionPacket returned %08lx\n", status );
+
+    pNtSetEvent( event, NULL );
+    status = pNtRemoveIoCompletion( port, &key, &value, &iosb, &timeout );
+    ok( status == STATUS_TIMEOUT, "NtRemoveIoCompletion returned %08lx\n", status );
+    status = NtWaitForSingleObject( event, FALSE, &timeout );
+    ok( !status, "NtWaitForSingleObject returned %08lx\n", status );
+
+    pNtClose( event );
+    pNtClose( packet );
+    pNtClose( port );
+}
+
 static void test_resource(void)
 {
     HANDLE thread, thread2;
@@ -848,11 +1021,15 @@ START_TEST(sync)
     if (argc > 2) return;
 
     pNtAlertThreadByThreadId        = (void *)GetProcAddress(module, "NtAlertThreadByThreadId");
+    pNtAssociateWaitCompletionPacket = (void *)GetProcAddress(module, "NtAssociateWaitCompletionPacket");
+    pNtCancelWaitCompletionPacket   = (void *)GetProcAddress(module, "NtCancelWaitCompletionPacket");
     pNtClose                        = (void *)GetProcAddress(module, "NtClose");
     pNtCreateEvent                  = (void *)GetProcAddress(module, "NtCreateEvent");
+    pNtCreateIoCompletion           = (void *)GetProcAddress(module, "NtCreateIoCompletion");
     pNtCreateKeyedEvent             = (void *)GetProcAddress(module, "NtCreateKeyedEvent");
     pNtCreateMutant                 = (void *)GetProcAddress(module, "NtCreateMutant");
     pNtCreateSemaphore              = (void *)GetProcAddress(module, "NtCreateSemaphore");
+    pNtCreateWaitCompletionPacket   = (void *)GetProcAddress(module, "NtCreateWaitCompletionPacket");
     pNtOpenEvent                    = (void *)GetProcAddress(module, "NtOpenEvent");
     pNtOpenKeyedEvent               = (void *)GetProcAddress(module, "NtOpenKeyedEvent");
     pNtPulseEvent                   = (void *)GetProcAddress(module, "NtPulseEvent");
@@ -863,6 +1040,7 @@ START_TEST(sync)
     pNtReleaseKeyedEvent            = (void *)GetProcAddress(module, "NtReleaseKeyedEvent");
     pNtReleaseMutant                = (void *)GetProcAddress(module, "NtReleaseMutant");
     pNtReleaseSemaphore             = (void *)GetProcAddress(module, "NtReleaseSemaphore");
+    pNtRemoveIoCompletion           = (void *)GetProcAddress(module, "NtRemoveIoCompletion");
     pNtResetEvent                   = (void *)GetProcAddress(module, "NtResetEvent");
     pNtSetEvent                     = (void *)GetProcAddress(module, "NtSetEvent");
     pNtWaitForAlertByThreadId       = (void *)GetProcAddress(module, "NtWaitForAlertByThreadId");
@@ -881,7 +1059,10 @@ START_TEST(sync)
     test_event();
     test_mutant();
     test_semaphore();
+    test_wait_all();
+    test_pulse_event_waiter();
     test_keyed_events();
+    test_wait_completion_packet();
     test_resource();
     test_tid_alert( argv );
 }
@@ -811,6 +811,153 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+#define STRESS_THREADS 4
+#define STRESS_ITEMS   25000
+
+struct stress_info
+{
+    TP_WORK *work;
+    TP_CALLBACK_ENVIRON *environment;
+    LONG simple_count;
+    HANDLE done;
+};
+
+static void CALLBACK stress_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void CALLBACK stress_simple_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
+{
+    struct stress_info *info = userdata;
+    if (InterlockedIncrement(&info->simple_count) == STRESS_THREADS * STRESS_ITEMS)
+        SetEvent(info->done);
+}
+
+static DWORD CALLBACK stress_post_work_thread(void *arg)
+{
+    struct stress_info *info = arg;
+    int i;
+
+    for (i = 0; i < STRESS_ITEMS; i++)
+        pTpPostWork(info->work);
+    return 0;
+}
+
+static DWORD CALLBACK stress_post_simple_thread(void *arg)
+{
+    struct stress_info *info = arg;
+    NTSTATUS status;
+    int i;
+
+    for (i = 0; i < STRESS_ITEMS; i++)
+    {
+        status = pTpSimpleTryPost(stress_simple_cb, info, info->environment);
+        if (status) break;
+    }
+    ok(!status, "TpSimpleTryPost failed with status %lx\n", status);
+    return 0;
+}
+
+static void start_stress_threads(HANDLE *threads, LPTHREAD_START_ROUTINE proc, struct stress_info *info)
+{
+    int i;
+
+    for (i = 0; i < STRESS_THREADS; i++)
+    {
+        threads[i] = CreateThread(NULL, 0, proc, info, 0, NULL);
+        ok(threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+}
+
+static void wait_stress_threads(HANDLE *threads)
+{
+    DWORD result;
+    int i;
+
+    result = WaitForMultipleObjects(STRESS_THREADS, threads, TRUE, 60000);
+    ok(result == WAIT_OBJECT_0, "WaitForMultipleObjects returned %lu\n", result);
+    for (i = 0; i < STRESS_THREADS; i++)
+        CloseHandle(threads[i]);
+}
+
+static void run_stress_threads(LPTHREAD_START_ROUTINE proc, struct stress_info *info)
+{
+    HANDLE threads[STRESS_THREADS];
+
+    start_stress_threads(threads, proc, info);
+    wait_stress_threads(threads);
+}
+
+static void test_tp_work_stress(void)
+{
+    HANDLE threads[STRESS_THREADS];
+    TP_CALLBACK_ENVIRON environment;
+    struct stress_info info;
+    DWORD start, result;
+    NTSTATUS status;
+    TP_POOL *pool;
+    LONG userdata;
+    int i;
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %lx\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+    pTpSetPoolMaxThreads(pool, 8);
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+    info.work = NULL;
+    info.environment = &environment;
+    info.simple_count = 0;
+    info.done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    status = pTpAllocWork(&info.work, stress_work_cb, &userdata, &environment);
+    ok(!status, "TpAllocWork failed with status %lx\n", status);
+    ok(info.work != NULL, "expected work != NULL\n");
+
+    /* many small work items posted concurrently all get executed */
+    userdata = 0;
+    start = GetTickCount();
+    run_stress_threads(stress_post_work_thread, &info);
+    pTpWaitForWork(info.work, FALSE);
+    ok(userdata == STRESS_THREADS * STRESS_ITEMS, "expected userdata = %u, got %lu\n",
+       STRESS_THREADS * STRESS_ITEMS, userdata);
+    trace("%u work items took %lu ms\n", STRESS_THREADS * STRESS_ITEMS, GetTickCount() - start);
+
+    /* cancelling while other threads are posting leaves the pool usable */
+    userdata = 0;
+    start_stress_threads(threads, stress_post_work_thread, &info);
+    for (i = 0; i < 100; i++)
+    {
+        pTpWaitForWork(info.work, TRUE);
+        Sleep(0);
+    }
+    wait_stress_threads(threads);
+    pTpWaitForWork(info.work, TRUE);
+    ok(userdata <= STRESS_THREADS * STRESS_ITEMS, "expected userdata <= %u, got %lu\n",
+       STRESS_THREADS * STRESS_ITEMS, userdata);
+    userdata = 0;
+    pTpPostWork(info.work);
+    pTpWaitForWork(info.work, FALSE);
+    ok(userdata == 1, "expected userdata = 1, got %lu\n", userdata);
+
+    /* simple callbacks */
+    start = GetTickCount();
+    run_stress_threads(stress_post_simple_thread, &info);
+    result = WaitForSingleObject(info.done, 60000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
+    ok(info.simple_count == STRESS_THREADS * STRESS_ITEMS, "expected simple_count = %u, got %lu\n",
+       STRESS_THREADS * STRESS_ITEMS, info.simple_count);
+    trace("%u simple callbacks took %lu ms\n", STRESS_THREADS * STRESS_ITEMS, GetTickCount() - start);
+
+    /* cleanup */
+    pTpReleaseWork(info.work);
+    pTpReleasePool(pool);
+    CloseHandle(info.done);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -1975,6 +2122,121 @@ static void test_tp_multi_wait(void)
     CloseHandle(semaphore);
 }
 
+#define WAIT_STRESS_COUNT 2000
+
+static struct
+{
+    HANDLE done;
+    LONG signaled;
+    LONG timeouts;
+} wait_stress_info;
+
+static void CALLBACK wait_stress_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WAIT *wait, TP_WAIT_RESULT result)
+{
+    LONG count;
+
+    if (result == WAIT_OBJECT_0)
+        count = InterlockedIncrement(&wait_stress_info.signaled);
+    else if (result == WAIT_TIMEOUT)
+        count = InterlockedIncrement(&wait_stress_info.timeouts);
+    else
+    {
+        ok(0, "unexpected result %lu\n", result);
+        return;
+    }
+    if (count == WAIT_STRESS_COUNT) SetEvent(wait_stress_info.done);
+}
+
+static void test_tp_wait_stress(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    LARGE_INTEGER when;
+    HANDLE *events;
+    TP_WAIT **waits;
+    DWORD start, result;
+    NTSTATUS status;
+    TP_POOL *pool;
+    int i;
+
+    events = HeapAlloc(GetProcessHeap(), 0, WAIT_STRESS_COUNT * sizeof(*events));
+    waits = HeapAlloc(GetProcessHeap(), 0, WAIT_STRESS_COUNT * sizeof(*waits));
+    wait_stress_info.done = CreateEventW(NULL, FALSE, FALSE, NULL);
+    wait_stress_info.signaled = 0;
+    wait_stress_info.timeouts = 0;
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %lx\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+
+    /* far more waits than fit in a single WaitForMultipleObjects call */
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+    {
+        events[i] = CreateEventW(NULL, FALSE, FALSE, NULL);
+        ok(events[i] != NULL, "failed to create event %d\n", i);
+        waits[i] = NULL;
+        status = pTpAllocWait(&waits[i], wait_stress_cb, NULL, &environment);
+        ok(!status, "TpAllocWait failed with status %lx\n", status);
+        pTpSetWait(waits[i], events[i], NULL);
+    }
+
+    /* signal them all at once */
+    start = GetTickCount();
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+        SetEvent(events[i]);
+    result = WaitForSingleObject(wait_stress_info.done, 30000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
+    ok(wait_stress_info.signaled == WAIT_STRESS_COUNT, "expected %u signaled waits, got %ld\n",
+       WAIT_STRESS_COUNT, wait_stress_info.signaled);
+    trace("%u signaled waits took %lu ms\n", WAIT_STRESS_COUNT, GetTickCount() - start);
+
+    /* waits fire only once per TpSetWait call */
+    SetEvent(events[0]);
+    Sleep(50);
+    ok(wait_stress_info.signaled == WAIT_STRESS_COUNT, "expected %u signaled waits, got %ld\n",
+       WAIT_STRESS_COUNT, wait_stress_info.signaled);
+    ResetEvent(events[0]);
+
+    /* time them all out */
+    start = GetTickCount();
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+    {
+        when.QuadPart = (ULONGLONG)(50 + i % 50) * -10000;
+        pTpSetWait(waits[i], events[i], &when);
+    }
+    result = WaitForSingleObject(wait_stress_info.done, 30000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
+    ok(wait_stress_info.timeouts == WAIT_STRESS_COUNT, "expected %u timed out waits, got %ld\n",
+       WAIT_STRESS_COUNT, wait_stress_info.timeouts);
+    trace("%u timed out waits took %lu ms\n", WAIT_STRESS_COUNT, GetTickCount() - start);
+
+    /* cancel them all while they are pending */
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+        pTpSetWait(waits[i], events[i], NULL);
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+        pTpSetWait(waits[i], NULL, NULL);
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+        SetEvent(events[i]);
+    Sleep(50);
+    ok(wait_stress_info.signaled == WAIT_STRESS_COUNT, "expected %u signaled waits, got %ld\n",
+       WAIT_STRESS_COUNT, wait_stress_info.signaled);
+
+    for (i = 0; i < WAIT_STRESS_COUNT; i++)
+    {
+        pTpWaitForWait(waits[i], FALSE);
+        pTpReleaseWait(waits[i]);
+        CloseHandle(events[i]);
+    }
+    pTpReleasePool(pool);
+    CloseHandle(wait_stress_info.done);
+    HeapFree(GetProcessHeap(), 0, waits);
+    HeapFree(GetProcessHeap(), 0, events);
+}
+
 struct io_cb_ctx
 {
     unsigned int count;
@@ -2365,6 +2627,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_stress();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -2373,6 +2636,7 @@ START_TEST(threadpool)
     test_tp_window_length();
     test_tp_wait();
     test_tp_multi_wait();
+    test_tp_wait_stress();
     test_tp_io();
     test_kernel32_tp_io();
 }
@@ -1875,6 +1875,73 @@ static void test_query_region_information(void)
     NtClose(mapping);
 }
 
+static LONG query_thread_done;
+
+static DWORD WINAPI alloc_free_thread( void *arg )
+{
+    NTSTATUS status;
+    SIZE_T size;
+    ULONG old;
+    void *ptr;
+
+    while (!query_thread_done)
+    {
+        ptr = NULL;
+        size = 0x10000;
+        status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 0, &size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+        if (status) break;
+        size = 0x1000;
+        NtProtectVirtualMemory( NtCurrentProcess(), &ptr, &size, PAGE_READONLY, &old );
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &ptr, &size, MEM_RELEASE );
+    }
+    return 0;
+}
+
+static void test_query_concurrent(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    HANDLE threads[2];
+    NTSTATUS status;
+    SIZE_T size;
+    ULONG old;
+    char *ptr = NULL;
+    int i, bad = 0;
+
+    size = 0x20000;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&ptr, 0, &size, MEM_RESERVE, PAGE_READWRITE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    size = 0x2000;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&ptr, 0, &size, MEM_COMMIT, PAGE_READWRITE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    status = VirtualProtect( ptr + 0x1000, 0x1000, PAGE_READONLY, &old ) ? STATUS_SUCCESS : STATUS_UNSUCCESSFUL;
+    ok( status == STATUS_SUCCESS, "VirtualProtect failed %lu.\n", GetLastError() );
+
+    /* queries of a stable range must stay consistent while other views change */
+    query_thread_done = 0;
+    for (i = 0; i < ARRAY_SIZE(threads); i++) threads[i] = CreateThread( NULL, 0, alloc_free_thread, NULL, 0, NULL );
+    for (i = 0; i < 20000; i++)
+    {
+        status = NtQueryVirtualMemory( NtCurrentProcess(), ptr + (i % 3) * 0x1000, MemoryBasicInformation,
+                                       &info, sizeof(info), NULL );
+        if (status || info.AllocationBase != ptr) bad++;
+        else switch (i % 3)
+        {
+        case 0: if (info.RegionSize != 0x1000 || info.Protect != PAGE_READWRITE || info.State != MEM_COMMIT) bad++; break;
+        case 1: if (info.RegionSize != 0x1000 || info.Protect != PAGE_READONLY || info.State != MEM_COMMIT) bad++; break;
+        case 2: if (info.RegionSize != 0x1e000 || info.State != MEM_RESERVE) bad++; break;
+        }
+    }
+    query_thread_done = 1;
+    WaitForMultipleObjects( ARRAY_SIZE(threads), threads, TRUE, INFINITE );
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle( threads[i] );
+    ok( !bad, "got %d inconsistent results\n", bad );
+
+    size = 0;
+    status = NtFreeVirtualMemory( NtCurrentProcess(), (void **)&ptr, &size, MEM_RELEASE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+}
+
 START_TEST(virtual)
 {
     HMODULE mod;
@@ -1922,4 +1989,5 @@ START_TEST(virtual)
     test_user_shared_data();
     test_syscalls();
     test_query_region_information();
+    test_query_concurrent();
 }
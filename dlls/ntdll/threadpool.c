@@ -30,6 +30,7 @@
 
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #include "ntdll_misc.h"
 
@@ -98,7 +99,7 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
-#define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
+#define THREADPOOL_WORKER_SPIN 4000
 
 /* internal threadpool representation */
 struct threadpool
@@ -109,7 +110,13 @@ struct threadpool
     CRITICAL_SECTION        cs;
     /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
     struct list             pools[3];
-    RTL_CONDITION_VARIABLE  update_event;
+    /* Objects submitted without taking .cs, moved to the pools by the workers. */
+    SLIST_HEADER            submitted;
+    /* Incremented whenever new work is available, idle workers wait on it. */
+    LONG                    work_seq;
+    LONG                    num_parked_workers;
+    /* Idle workers which haven't been claimed by a lock-free submission yet. */
+    LONG                    num_idle_workers;
     /* information about worker threads, locked via .cs */
     int                     max_workers;
     int                     min_workers;
@@ -155,6 +162,8 @@ struct threadpool_object
     BOOL                    is_group_member;
     /* information about the pool, locked via .pool->cs */
     struct list             pool_entry;
+    SLIST_ENTRY             submit_entry;
+    LONG                    num_submitted_callbacks;
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
     HANDLE                  completed_event;
@@ -191,9 +200,12 @@ struct threadpool_object
             /* information about the wait object, locked via waitqueue.cs */
             struct waitqueue_bucket *bucket;
             BOOL            wait_pending;
-            struct list     wait_entry;
+            struct rb_entry wait_entry;
             ULONGLONG       timeout;
+            ULONGLONG       interval;
             HANDLE          handle;
+            HANDLE          packet;
+            ULONG_PTR       cookie;
             DWORD           flags;
             RTL_WAITORTIMERCALLBACKFUNC rtl_callback;
         } wait;
@@ -286,14 +298,23 @@ static RTL_CRITICAL_SECTION_DEBUG waitqueue_debug =
       0, 0, { (DWORD_PTR)(__FILE__ ": waitqueue.cs") }
 };
 
+/* Each wait object owns a wait completion packet, which is queued to the
+ * port of its bucket once the object is signaled. A single thread per
+ * bucket associates and dispatches the packets and handles the timeouts,
+ * regardless of the number of wait objects. Buckets running the callbacks
+ * in their own thread are limited to MAXIMUM_WAITQUEUE_OBJECTS, so that a
+ * slow callback only delays a few waits, as on Windows. */
+#define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
+
 struct waitqueue_bucket
 {
     struct list             bucket_entry;
     LONG                    objcount;
-    struct list             reserved;
-    struct list             waiting;
-    HANDLE                  update_event;
+    struct rb_tree          waiting;        /* pending waits, sorted by timeout */
+    HANDLE                  port;
+    DWORD                   thread_id;
     BOOL                    alertable;
+    BOOL                    wait_thread;    /* callbacks are executed by the bucket thread */
 };
 
 /* global I/O completion queue object */
@@ -1237,18 +1258,133 @@ static void tp_timerqueue_unlock( struct threadpool_object *timer )
     RtlLeaveCriticalSection( &timerqueue.cs );
 }
 
+static int compare_wait_timeout( const void *key, const struct rb_entry *entry )
+{
+    const struct threadpool_object *wait = key;
+    const struct threadpool_object *other = RB_ENTRY_VALUE( entry, struct threadpool_object, u.wait.wait_entry );
+
+    if (wait->u.wait.timeout != other->u.wait.timeout)
+        return wait->u.wait.timeout < other->u.wait.timeout ? -1 : 1;
+    if (wait != other)
+        return wait < other ? -1 : 1;
+    return 0;
+}
+
+/***********************************************************************
+ *           tp_waitqueue_associate    (internal)
+ *
+ * Associates the packet of an armed wait object with the port of its
+ * bucket, called from the wait queue thread with waitqueue.cs held. The
+ * queued packet takes over the caller's reference to the wait object.
+ */
+static void tp_waitqueue_associate( struct threadpool_object *wait )
+{
+    NTSTATUS status;
+
+    status = NtAssociateWaitCompletionPacket( wait->u.wait.packet, wait->u.wait.bucket->port,
+                                              wait->u.wait.handle, wait, (void *)wait->u.wait.cookie,
+                                              STATUS_SUCCESS, 0, NULL );
+    if (status)
+    {
+        /* Only the timeout can fire. */
+        WARN( "failed to wait for handle %p, status %#lx\n", wait->u.wait.handle, status );
+        tp_object_release( wait );
+    }
+}
+
+/***********************************************************************
+ *           tp_waitqueue_arm    (internal)
+ *
+ * Starts waiting for the handle of a wait object, waitqueue.cs has to be
+ * held. The waiting thread acquires the object (e.g. owns a mutex), so
+ * other threads ask the wait queue thread to associate the packet.
+ */
+static void tp_waitqueue_arm( struct threadpool_object *wait, const LARGE_INTEGER *now )
+{
+    struct waitqueue_bucket *bucket = wait->u.wait.bucket;
+    NTSTATUS status;
+
+    if (wait->u.wait.interval)
+        wait->u.wait.timeout = now->QuadPart + wait->u.wait.interval;
+    wait->u.wait.wait_pending = TRUE;
+    wait->u.wait.cookie++;
+    rb_put( &bucket->waiting, wait, &wait->u.wait.wait_entry );
+
+    InterlockedIncrement( &wait->refcount );
+    if (GetCurrentThreadId() == bucket->thread_id)
+        tp_waitqueue_associate( wait );
+    else if ((status = NtSetIoCompletion( bucket->port, (ULONG_PTR)wait, wait->u.wait.cookie,
+                                          STATUS_PENDING, 0 )))
+    {
+        /* Only the timeout can fire. */
+        WARN( "failed to arm wait object %p, status %#lx\n", wait, status );
+        tp_object_release( wait );
+    }
+}
+
+/***********************************************************************
+ *           tp_waitqueue_disarm    (internal)
+ *
+ * Stops waiting for the handle of a wait object, waitqueue.cs has to be
+ * held. Returns FALSE if the object got signaled and remove_signaled is
+ * FALSE, the packet is then still dispatched by the wait queue thread.
+ */
+static BOOL tp_waitqueue_disarm( struct threadpool_object *wait, BOOL remove_signaled )
+{
+    NTSTATUS status = NtCancelWaitCompletionPacket( wait->u.wait.packet, remove_signaled );
+
+    if (status == STATUS_PENDING)
+        return FALSE;
+
+    rb_remove( &wait->u.wait.bucket->waiting, &wait->u.wait.wait_entry );
+    wait->u.wait.wait_pending = FALSE;
+    /* A packet already removed from the port is discarded by the wait queue thread. */
+    wait->u.wait.cookie++;
+    if (status == STATUS_SUCCESS)
+        tp_object_release( wait );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           tp_waitqueue_trigger    (internal)
+ *
+ * Runs or queues the callback of a signaled or timed out wait object.
+ */
+static void tp_waitqueue_trigger( struct threadpool_object *wait, BOOL signaled, const LARGE_INTEGER *now )
+{
+    /* Repeating waits restart their relative timeout, an absolute one only expires once. */
+    if (!(wait->u.wait.flags & WT_EXECUTEONLYONCE))
+    {
+        if (!signaled && !wait->u.wait.interval)
+            wait->u.wait.timeout = MAXLONGLONG;
+        tp_waitqueue_arm( wait, now );
+    }
+
+    if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
+    {
+        InterlockedIncrement( &wait->refcount );
+        if (signaled) wait->u.wait.signaled++;
+        wait->num_pending_callbacks++;
+        RtlEnterCriticalSection( &wait->pool->cs );
+        tp_object_execute( wait, TRUE );
+        RtlLeaveCriticalSection( &wait->pool->cs );
+        tp_object_release( wait );
+    }
+    else tp_object_submit( wait, signaled );
+}
+
 /***********************************************************************
  *           waitqueue_thread_proc    (internal)
  */
 static void CALLBACK waitqueue_thread_proc( void *param )
 {
-    struct threadpool_object *objects[MAXIMUM_WAITQUEUE_OBJECTS];
-    HANDLE handles[MAXIMUM_WAITQUEUE_OBJECTS + 1];
     struct waitqueue_bucket *bucket = param;
-    struct threadpool_object *wait, *next;
+    FILE_IO_COMPLETION_INFORMATION info;
+    struct threadpool_object *wait;
     LARGE_INTEGER now, timeout;
-    DWORD num_handles;
+    struct rb_entry *ptr;
     NTSTATUS status;
+    ULONG count;
 
     TRACE( "starting wait queue thread\n" );
     set_thread_name(L"wine_threadpool_waitqueue");
@@ -1259,139 +1395,70 @@ static void CALLBACK waitqueue_thread_proc( void *param )
     {
         NtQuerySystemTime( &now );
         timeout.QuadPart = MAXLONGLONG;
-        num_handles = 0;
 
-        LIST_FOR_EACH_ENTRY_SAFE( wait, next, &bucket->waiting, struct threadpool_object,
-                                  u.wait.wait_entry )
+        while ((ptr = rb_head( bucket->waiting.root )))
         {
+            wait = RB_ENTRY_VALUE( ptr, struct threadpool_object, u.wait.wait_entry );
             assert( wait->type == TP_OBJECT_TYPE_WAIT );
-            if (wait->u.wait.timeout <= now.QuadPart)
+            if (wait->u.wait.timeout > now.QuadPart)
             {
-                /* Wait object timed out. */
-                if ((wait->u.wait.flags & WT_EXECUTEONLYONCE))
-                {
-                    list_remove( &wait->u.wait.wait_entry );
-                    list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
-                }
-                if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
-                {
-                    InterlockedIncrement( &wait->refcount );
-                    wait->num_pending_callbacks++;
-                    RtlEnterCriticalSection( &wait->pool->cs );
-                    tp_object_execute( wait, TRUE );
-                    RtlLeaveCriticalSection( &wait->pool->cs );
-                    tp_object_release( wait );
-                }
-                else tp_object_submit( wait, FALSE );
+                timeout.QuadPart = wait->u.wait.timeout;
+                break;
             }
-            else
+
+            /* Signaled meanwhile, the packet is already in the port. */
+            if (!tp_waitqueue_disarm( wait, FALSE ))
             {
-                if (wait->u.wait.timeout < timeout.QuadPart)
-                    timeout.QuadPart = wait->u.wait.timeout;
-
-                assert( num_handles < MAXIMUM_WAITQUEUE_OBJECTS );
-                InterlockedIncrement( &wait->refcount );
-                objects[num_handles] = wait;
-                handles[num_handles] = wait->u.wait.handle;
-                num_handles++;
+                timeout.QuadPart = now.QuadPart;
+                break;
             }
+
+            /* Wait object timed out. */
+            tp_waitqueue_trigger( wait, FALSE, &now );
+            NtQuerySystemTime( &now );
         }
 
         if (!bucket->objcount)
         {
             /* All wait objects have been destroyed, if no new wait objects are created
              * within some amount of time, then we can shutdown this thread. */
-            assert( num_handles == 0 );
-            RtlLeaveCriticalSection( &waitqueue.cs );
+            assert( !rb_head( bucket->waiting.root ) );
             timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-            status = NtWaitForMultipleObjects( 1, &bucket->update_event, TRUE, bucket->alertable, &timeout );
-            RtlEnterCriticalSection( &waitqueue.cs );
-
-            if (status == STATUS_TIMEOUT && !bucket->objcount)
-                break;
         }
-        else
-        {
-            handles[num_handles] = bucket->update_event;
-            RtlLeaveCriticalSection( &waitqueue.cs );
-            status = NtWaitForMultipleObjects( num_handles + 1, handles, TRUE, bucket->alertable, &timeout );
-            RtlEnterCriticalSection( &waitqueue.cs );
 
-            if (status >= STATUS_WAIT_0 && status < STATUS_WAIT_0 + num_handles)
-            {
-                wait = objects[status - STATUS_WAIT_0];
-                assert( wait->type == TP_OBJECT_TYPE_WAIT );
-                if (wait->u.wait.bucket)
-                {
-                    /* Wait object signaled. */
-                    assert( wait->u.wait.bucket == bucket );
-                    if ((wait->u.wait.flags & WT_EXECUTEONLYONCE))
-                    {
-                        list_remove( &wait->u.wait.wait_entry );
-                        list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
-                    }
-                    if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
-                    {
-                        wait->u.wait.signaled++;
-                        wait->num_pending_callbacks++;
-                        RtlEnterCriticalSection( &wait->pool->cs );
-                        tp_object_execute( wait, TRUE );
-                        RtlLeaveCriticalSection( &wait->pool->cs );
-                    }
-                    else tp_object_submit( wait, TRUE );
-                }
-                else
-                    WARN("wait object %p triggered while object was destroyed\n", wait);
-            }
+        RtlLeaveCriticalSection( &waitqueue.cs );
+        status = NtRemoveIoCompletionEx( bucket->port, &info, 1, &count, &timeout, bucket->alertable );
+        RtlEnterCriticalSection( &waitqueue.cs );
 
-            /* Release temporary references to wait objects. */
-            while (num_handles)
-            {
-                wait = objects[--num_handles];
-                assert( wait->type == TP_OBJECT_TYPE_WAIT );
-                tp_object_release( wait );
-            }
-        }
+        if (status == STATUS_TIMEOUT && !bucket->objcount)
+            break;
+        if (status != STATUS_SUCCESS || !info.CompletionKey)
+            continue;
 
-        /* Try to merge bucket with other threads. */
-        if (waitqueue.num_buckets > 1 && bucket->objcount &&
-            bucket->objcount <= MAXIMUM_WAITQUEUE_OBJECTS * 1 / 3)
+        wait = (struct threadpool_object *)info.CompletionKey;
+        assert( wait->type == TP_OBJECT_TYPE_WAIT );
+        if (wait->u.wait.bucket == bucket && wait->u.wait.wait_pending &&
+            (ULONG_PTR)info.CompletionValue == wait->u.wait.cookie &&
+            info.IoStatusBlock.u.Status == STATUS_PENDING)
         {
-            struct waitqueue_bucket *other_bucket;
-            LIST_FOR_EACH_ENTRY( other_bucket, &waitqueue.buckets, struct waitqueue_bucket, bucket_entry )
-            {
-                if (other_bucket != bucket && other_bucket->objcount && other_bucket->alertable == bucket->alertable &&
-                    other_bucket->objcount + bucket->objcount <= MAXIMUM_WAITQUEUE_OBJECTS * 2 / 3)
-                {
-                    other_bucket->objcount += bucket->objcount;
-                    bucket->objcount = 0;
-
-                    /* Update reserved list. */
-                    LIST_FOR_EACH_ENTRY( wait, &bucket->reserved, struct threadpool_object, u.wait.wait_entry )
-                    {
-                        assert( wait->type == TP_OBJECT_TYPE_WAIT );
-                        wait->u.wait.bucket = other_bucket;
-                    }
-                    list_move_tail( &other_bucket->reserved, &bucket->reserved );
-
-                    /* Update waiting list. */
-                    LIST_FOR_EACH_ENTRY( wait, &bucket->waiting, struct threadpool_object, u.wait.wait_entry )
-                    {
-                        assert( wait->type == TP_OBJECT_TYPE_WAIT );
-                        wait->u.wait.bucket = other_bucket;
-                    }
-                    list_move_tail( &other_bucket->waiting, &bucket->waiting );
-
-                    /* Move bucket to the end, to keep the probability of
-                     * newly added wait objects as small as possible. */
-                    list_remove( &bucket->bucket_entry );
-                    list_add_tail( &waitqueue.buckets, &bucket->bucket_entry );
-
-                    NtSetEvent( other_bucket->update_event, NULL );
-                    break;
-                }
-            }
+            /* Wait object armed by another thread. */
+            tp_waitqueue_associate( wait );
+            continue;
         }
+        if (wait->u.wait.bucket == bucket && wait->u.wait.wait_pending &&
+            (ULONG_PTR)info.CompletionValue == wait->u.wait.cookie)
+        {
+            /* Wait object signaled. */
+            rb_remove( &bucket->waiting, &wait->u.wait.wait_entry );
+            wait->u.wait.wait_pending = FALSE;
+            NtQuerySystemTime( &now );
+            tp_waitqueue_trigger( wait, TRUE, &now );
+        }
+        else
+            TRACE( "discarding stale packet for wait object %p\n", wait );
+
+        /* Release the reference held by the packet or the arm request. */
+        tp_object_release( wait );
     }
 
     /* Remove this bucket from the list. */
@@ -1404,9 +1471,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
     TRACE( "terminating wait queue thread\n" );
 
     assert( bucket->objcount == 0 );
-    assert( list_empty( &bucket->reserved ) );
-    assert( list_empty( &bucket->waiting ) );
-    NtClose( bucket->update_event );
+    NtClose( bucket->port );
 
     RtlFreeHeap( GetProcessHeap(), 0, bucket );
     RtlExitUserThread( 0 );
@@ -1419,24 +1484,31 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
 {
     struct waitqueue_bucket *bucket;
     NTSTATUS status;
+    CLIENT_ID client_id;
     HANDLE thread;
     BOOL alertable = (wait->u.wait.flags & WT_EXECUTEINIOTHREAD) != 0;
+    BOOL wait_thread = (wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)) != 0;
     assert( wait->type == TP_OBJECT_TYPE_WAIT );
 
     wait->u.wait.signaled       = 0;
     wait->u.wait.bucket         = NULL;
     wait->u.wait.wait_pending   = FALSE;
     wait->u.wait.timeout        = 0;
+    wait->u.wait.interval       = 0;
     wait->u.wait.handle         = INVALID_HANDLE_VALUE;
+    wait->u.wait.cookie         = 0;
+
+    if ((status = NtCreateWaitCompletionPacket( &wait->u.wait.packet, GENERIC_ALL, NULL )))
+        return status;
 
     RtlEnterCriticalSection( &waitqueue.cs );
 
     /* Try to assign to existing bucket if possible. */
     LIST_FOR_EACH_ENTRY( bucket, &waitqueue.buckets, struct waitqueue_bucket, bucket_entry )
     {
-        if (bucket->objcount < MAXIMUM_WAITQUEUE_OBJECTS && bucket->alertable == alertable)
+        if (bucket->alertable == alertable && bucket->wait_thread == wait_thread &&
+            (!wait_thread || bucket->objcount < MAXIMUM_WAITQUEUE_OBJECTS))
         {
-            list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
             wait->u.wait.bucket = bucket;
             bucket->objcount++;
 
@@ -1455,11 +1527,10 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
 
     bucket->objcount = 0;
     bucket->alertable = alertable;
-    list_init( &bucket->reserved );
-    list_init( &bucket->waiting );
+    bucket->wait_thread = wait_thread;
+    rb_init( &bucket->waiting, compare_wait_timeout );
 
-    status = NtCreateEvent( &bucket->update_event, EVENT_ALL_ACCESS,
-                            NULL, SynchronizationEvent, FALSE );
+    status = NtCreateIoCompletion( &bucket->port, IO_COMPLETION_ALL_ACCESS, NULL, 1 );
     if (status)
     {
         RtlFreeHeap( GetProcessHeap(), 0, bucket );
@@ -1467,13 +1538,13 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
     }
 
     status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
-                                  waitqueue_thread_proc, bucket, &thread, NULL );
+                                  waitqueue_thread_proc, bucket, &thread, &client_id );
     if (status == STATUS_SUCCESS)
     {
+        bucket->thread_id = HandleToULong( client_id.UniqueThread );
         list_add_tail( &waitqueue.buckets, &bucket->bucket_entry );
         waitqueue.num_buckets++;
 
-        list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
         wait->u.wait.bucket = bucket;
         bucket->objcount++;
 
@@ -1481,12 +1552,13 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
     }
     else
     {
-        NtClose( bucket->update_event );
+        NtClose( bucket->port );
         RtlFreeHeap( GetProcessHeap(), 0, bucket );
     }
 
 out:
     RtlLeaveCriticalSection( &waitqueue.cs );
+    if (status) NtClose( wait->u.wait.packet );
     return status;
 }
 
@@ -1503,11 +1575,14 @@ static void tp_waitqueue_unlock( struct threadpool_object *wait )
         struct waitqueue_bucket *bucket = wait->u.wait.bucket;
         assert( bucket->objcount > 0 );
 
-        list_remove( &wait->u.wait.wait_entry );
+        if (wait->u.wait.wait_pending)
+            tp_waitqueue_disarm( wait, TRUE );
+        NtClose( wait->u.wait.packet );
         wait->u.wait.bucket = NULL;
-        bucket->objcount--;
 
-        NtSetEvent( bucket->update_event, NULL );
+        /* Let the thread start its shutdown timeout. */
+        if (!--bucket->objcount)
+            NtSetIoCompletion( bucket->port, 0, 0, STATUS_SUCCESS, 0 );
     }
     RtlLeaveCriticalSection( &waitqueue.cs );
 }
@@ -1656,6 +1731,42 @@ static NTSTATUS tp_ioqueue_lock( struct threadpool_object *io, HANDLE file )
     return status;
 }
 
+/***********************************************************************
+ *           tp_threadpool_wake    (internal)
+ *
+ * Notifies idle worker threads that new work is available.
+ */
+static void tp_threadpool_wake( struct threadpool *pool, BOOL all )
+{
+    InterlockedIncrement( &pool->work_seq );
+    if (!ReadNoFence( &pool->num_parked_workers ))
+        return;
+
+    if (all)
+        RtlWakeAddressAll( &pool->work_seq );
+    else
+        RtlWakeAddressSingle( &pool->work_seq );
+}
+
+/***********************************************************************
+ *           tp_threadpool_claim_idle_worker    (internal)
+ *
+ * Reserves one of the idle worker threads. Returns FALSE if all of them
+ * are already busy or claimed.
+ */
+static BOOL tp_threadpool_claim_idle_worker( struct threadpool *pool )
+{
+    LONG count = ReadNoFence( &pool->num_idle_workers ), prev;
+
+    while (count > 0)
+    {
+        if ((prev = InterlockedCompareExchange( &pool->num_idle_workers, count - 1, count )) == count)
+            return TRUE;
+        count = prev;
+    }
+    return FALSE;
+}
+
 /***********************************************************************
  *           tp_threadpool_alloc    (internal)
  *
@@ -1680,7 +1791,10 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
 
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         list_init( &pool->pools[i] );
-    RtlInitializeConditionVariable( &pool->update_event );
+    RtlInitializeSListHead( &pool->submitted );
+    pool->work_seq                = 0;
+    pool->num_parked_workers      = 0;
+    pool->num_idle_workers        = 0;
 
     pool->max_workers             = 500;
     pool->min_workers             = 0;
@@ -1707,7 +1821,7 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
     assert( pool != default_threadpool );
 
     pool->shutdown = TRUE;
-    RtlWakeAllConditionVariable( &pool->update_event );
+    tp_threadpool_wake( pool, TRUE );
 }
 
 /***********************************************************************
@@ -1728,6 +1842,7 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
     assert( !pool->objcount );
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         assert( list_empty( &pool->pools[i] ) );
+    assert( !RtlFirstEntrySList( &pool->submitted ) );
 
     pool->cs.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &pool->cs );
@@ -1908,6 +2023,8 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     object->is_group_member         = FALSE;
 
     memset( &object->pool_entry, 0, sizeof(object->pool_entry) );
+    memset( &object->submit_entry, 0, sizeof(object->submit_entry) );
+    object->num_submitted_callbacks = 0;
     RtlInitializeConditionVariable( &object->finished_event );
     RtlInitializeConditionVariable( &object->group_finished_event );
     object->completed_event         = NULL;
@@ -1973,6 +2090,45 @@ static void tp_object_prio_queue( struct threadpool_object *object )
     list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
 }
 
+/***********************************************************************
+ *           tp_threadpool_flush_submitted    (internal)
+ *
+ * Moves the objects submitted without holding the pool lock to the
+ * pools, pool->cs has to be held.
+ */
+static void tp_threadpool_flush_submitted( struct threadpool *pool )
+{
+    SLIST_ENTRY *entry, *next, *prev = NULL;
+
+    if (!RtlFirstEntrySList( &pool->submitted ))
+        return;
+
+    /* Restore submission order. */
+    entry = RtlInterlockedFlushSList( &pool->submitted );
+    while (entry)
+    {
+        next = entry->Next;
+        entry->Next = prev;
+        prev = entry;
+        entry = next;
+    }
+
+    for (entry = prev; entry; entry = next)
+    {
+        struct threadpool_object *object = CONTAINING_RECORD( entry, struct threadpool_object, submit_entry );
+        LONG count;
+
+        /* The object may be pushed again as soon as its counter is reset. */
+        next = entry->Next;
+        count = InterlockedExchange( &object->num_submitted_callbacks, 0 );
+        assert( count > 0 );
+
+        if (!object->num_pending_callbacks)
+            tp_object_prio_queue( object );
+        object->num_pending_callbacks += count;
+    }
+}
+
 /***********************************************************************
  *           tp_object_submit    (internal)
  *
@@ -1983,10 +2139,27 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
     NTSTATUS status = STATUS_UNSUCCESSFUL;
+    BOOL submitted = FALSE;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
+    /* Work items and simple callbacks don't need the pool lock as long as
+     * an idle worker thread is around to pick them up. */
+    if (object->type == TP_OBJECT_TYPE_WORK || object->type == TP_OBJECT_TYPE_SIMPLE)
+    {
+        InterlockedIncrement( &object->refcount );
+        if (InterlockedIncrement( &object->num_submitted_callbacks ) == 1)
+            RtlInterlockedPushEntrySList( &pool->submitted, &object->submit_entry );
+
+        if (tp_threadpool_claim_idle_worker( pool ))
+        {
+            tp_threadpool_wake( pool, FALSE );
+            return;
+        }
+        submitted = TRUE;
+    }
+
     RtlEnterCriticalSection( &pool->cs );
 
     /* Start new worker threads if required. */
@@ -1995,9 +2168,14 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
         status = tp_new_worker_thread( pool );
 
     /* Queue work item and increment refcount. */
-    InterlockedIncrement( &object->refcount );
-    if (!object->num_pending_callbacks++)
-        tp_object_prio_queue( object );
+    if (submitted)
+        tp_threadpool_flush_submitted( pool );
+    else
+    {
+        InterlockedIncrement( &object->refcount );
+        if (!object->num_pending_callbacks++)
+            tp_object_prio_queue( object );
+    }
 
     /* Count how often the object was signaled. */
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
@@ -2007,7 +2185,7 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     if (status != STATUS_SUCCESS)
     {
         assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        tp_threadpool_wake( pool, FALSE );
     }
 
     RtlLeaveCriticalSection( &pool->cs );
@@ -2024,6 +2202,7 @@ static void tp_object_cancel( struct threadpool_object *object )
     LONG pending_callbacks = 0;
 
     RtlEnterCriticalSection( &pool->cs );
+    tp_threadpool_flush_submitted( pool );
     if (object->num_pending_callbacks)
     {
         pending_callbacks = object->num_pending_callbacks;
@@ -2046,7 +2225,7 @@ static void tp_object_cancel( struct threadpool_object *object )
 
 static BOOL object_is_finished( struct threadpool_object *object, BOOL group )
 {
-    if (object->num_pending_callbacks)
+    if (object->num_pending_callbacks || ReadNoFence( &object->num_submitted_callbacks ))
         return FALSE;
     if (object->type == TP_OBJECT_TYPE_IO && object->u.io.pending_count)
         return FALSE;
@@ -2068,6 +2247,7 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
     struct threadpool *pool = object->pool;
 
     RtlEnterCriticalSection( &pool->cs );
+    tp_threadpool_flush_submitted( pool );
     while (!object_is_finished( object, group_wait ))
     {
         if (group_wait)
@@ -2121,6 +2301,7 @@ static BOOL tp_object_release( struct threadpool_object *object )
 
     assert( object->shutdown );
     assert( !object->num_pending_callbacks );
+    assert( !object->num_submitted_callbacks );
     assert( !object->num_running_callbacks );
     assert( !object->num_associated_callbacks );
 
@@ -2152,11 +2333,13 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
-static struct list *threadpool_get_next_item( const struct threadpool *pool )
+static struct list *threadpool_get_next_item( struct threadpool *pool )
 {
     struct list *ptr;
     unsigned int i;
 
+    tp_threadpool_flush_submitted( pool );
+
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
     {
         if ((ptr = list_head( &pool->pools[i] )))
@@ -2333,6 +2516,9 @@ static void CALLBACK threadpool_worker_proc( void *param )
     struct threadpool *pool = param;
     LARGE_INTEGER timeout;
     struct list *ptr;
+    NTSTATUS status;
+    LONG seq;
+    int spin;
 
     TRACE( "starting worker thread for pool %p\n", pool );
     set_thread_name(L"wine_threadpool_worker");
@@ -2340,6 +2526,9 @@ static void CALLBACK threadpool_worker_proc( void *param )
     RtlEnterCriticalSection( &pool->cs );
     for (;;)
     {
+        /* Read the sequence before looking for work, so that no wakeup is missed. */
+        seq = ReadNoFence( &pool->work_seq );
+
         while ((ptr = threadpool_get_next_item( pool )))
         {
             struct threadpool_object *object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
@@ -2368,8 +2557,29 @@ static void CALLBACK threadpool_worker_proc( void *param )
          * decreased without violating the min_workers limit. An exception is when
          * min_workers == 0, then objcount is used to detect if the last thread
          * can be terminated. */
-        timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
+        InterlockedIncrement( &pool->num_idle_workers );
+        RtlLeaveCriticalSection( &pool->cs );
+
+        /* Spin for a while first, streams of small work items would otherwise
+         * put the worker to sleep between each of them. */
+        spin = NtCurrentTeb()->Peb->NumberOfProcessors > 1 ? THREADPOOL_WORKER_SPIN : 0;
+        while (spin-- && ReadNoFence( &pool->work_seq ) == seq)
+            YieldProcessor();
+
+        status = STATUS_SUCCESS;
+        if (ReadNoFence( &pool->work_seq ) == seq)
+        {
+            timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+            InterlockedIncrement( &pool->num_parked_workers );
+            status = RtlWaitOnAddress( &pool->work_seq, &seq, sizeof(seq), &timeout );
+            InterlockedDecrement( &pool->num_parked_workers );
+        }
+
+        /* Take back our idle slot, unless a submitter claimed it already. */
+        tp_threadpool_claim_idle_worker( pool );
+        RtlEnterCriticalSection( &pool->cs );
+
+        if (status == STATUS_TIMEOUT &&
             !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
             (!pool->min_workers && !pool->objcount)))
         {
@@ -3047,7 +3257,7 @@ VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LO
 VOID WINAPI TpSetWait( TP_WAIT *wait, HANDLE handle, LARGE_INTEGER *timeout )
 {
     struct threadpool_object *this = impl_from_TP_WAIT( wait );
-    ULONGLONG timestamp = MAXLONGLONG;
+    LARGE_INTEGER now;
 
     TRACE( "%p %p %p\n", wait, handle, timeout );
 
@@ -3056,38 +3266,27 @@ VOID WINAPI TpSetWait( TP_WAIT *wait, HANDLE handle, LARGE_INTEGER *timeout )
     assert( this->u.wait.bucket );
     this->u.wait.handle = handle;
 
-    if (handle || this->u.wait.wait_pending)
+    if (this->u.wait.wait_pending)
+        tp_waitqueue_disarm( this, TRUE );
+
+    if (handle)
     {
-        struct waitqueue_bucket *bucket = this->u.wait.bucket;
-        list_remove( &this->u.wait.wait_entry );
+        NtQuerySystemTime( &now );
 
         /* Convert relative timeout to absolute timestamp. */
-        if (handle && timeout)
+        this->u.wait.timeout = MAXLONGLONG;
+        this->u.wait.interval = 0;
+        if (timeout)
         {
-            timestamp = timeout->QuadPart;
-            if ((LONGLONG)timestamp < 0)
+            this->u.wait.timeout = timeout->QuadPart;
+            if ((LONGLONG)this->u.wait.timeout < 0)
             {
-                LARGE_INTEGER now;
-                NtQuerySystemTime( &now );
-                timestamp = now.QuadPart - timestamp;
+                this->u.wait.interval = -timeout->QuadPart;
+                this->u.wait.timeout = now.QuadPart + this->u.wait.interval;
             }
         }
-
-        /* Add wait object back into one of the queues. */
-        if (handle)
-        {
-            list_add_tail( &bucket->waiting, &this->u.wait.wait_entry );
-            this->u.wait.wait_pending = TRUE;
-            this->u.wait.timeout = timestamp;
-        }
-        else
-        {
-            list_add_tail( &bucket->reserved, &this->u.wait.wait_entry );
-            this->u.wait.wait_pending = FALSE;
-        }
-
-        /* Wake up the wait queue thread. */
-        NtSetEvent( bucket->update_event, NULL );
+        /* This also wakes up the wait queue thread, which updates its timeout. */
+        tp_waitqueue_arm( this, &now );
     }
 
     RtlLeaveCriticalSection( &waitqueue.cs );
@@ -52,6 +52,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #ifdef HAVE_SYS_ATTR_H
 #include <sys/attr.h>
 #endif
@@ -238,6 +239,20 @@ static const unsigned int dir_data_names_initial_size  = 64;
 static struct dir_data **dir_data_cache;
 static unsigned int dir_data_cache_size;
 
+/* sorted snapshots of the full contents of unchanged directories, shared by all handles */
+struct dir_snapshot
+{
+    struct file_identity id;         /* directory file identity */
+    time_t               mtime;      /* directory modification time */
+    long                 mtime_nsec;
+    struct dir_data     *data;       /* sorted directory contents */
+};
+
+#define DIR_SNAPSHOT_CACHE_SIZE 8
+
+static struct dir_snapshot dir_snapshots[DIR_SNAPSHOT_CACHE_SIZE];
+static unsigned int dir_snapshot_pos;
+
 static BOOL show_dot_files;
 static mode_t start_umask;
 
@@ -292,6 +307,17 @@ static inline BOOL is_ignored_file( const struct stat *st )
     return FALSE;
 }
 
+static long get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
 static inline unsigned int dir_info_align( unsigned int len )
 {
     return (len + 7) & ~7;
@@ -2504,6 +2530,88 @@ static int name_compare( const void *a, const void *b )
 }
 
 
+/* sort filenames, but not "." and ".." */
+static void sort_dir_data( struct dir_data *data )
+{
+    unsigned int i = 0;
+
+    if (i < data->count && !strcmp( data->names[i].unix_name, "." )) i++;
+    if (i < data->count && !strcmp( data->names[i].unix_name, ".." )) i++;
+    if (i < data->count) qsort( data->names + i, data->count - i, sizeof(*data->names), name_compare );
+}
+
+
+/***********************************************************************
+ *           get_dir_snapshot
+ *
+ * Retrieve the sorted full contents of a directory, reusing the snapshot taken by
+ * a previous enumeration if the directory hasn't changed since. Directories
+ * modified within the current second are not kept, since a change in the same
+ * tick wouldn't be noticed; the returned data must be freed by the caller in that
+ * case, which is indicated by *cached being FALSE.
+ */
+static struct dir_data *get_dir_snapshot( int fd, const struct stat *st, BOOL *cached )
+{
+    struct dir_snapshot *snapshot;
+    struct dir_data *data;
+    unsigned int i;
+
+    for (i = 0; i < DIR_SNAPSHOT_CACHE_SIZE; i++)
+    {
+        snapshot = &dir_snapshots[i];
+        if (!snapshot->data || !is_same_file( &snapshot->id, st )) continue;
+        if (snapshot->mtime == st->st_mtime && snapshot->mtime_nsec == get_mtime_nsec( st ))
+        {
+            *cached = TRUE;
+            return snapshot->data;
+        }
+        free_dir_data( snapshot->data );
+        snapshot->data = NULL;
+    }
+
+    if (!(data = calloc( 1, sizeof(*data) ))) return NULL;
+    if (read_directory_data( data, fd, NULL ))
+    {
+        free_dir_data( data );
+        return NULL;
+    }
+    sort_dir_data( data );
+
+    *cached = st->st_mtime < time( NULL );
+    if (*cached)
+    {
+        snapshot = &dir_snapshots[dir_snapshot_pos++ % DIR_SNAPSHOT_CACHE_SIZE];
+        free_dir_data( snapshot->data );
+        snapshot->id.dev     = st->st_dev;
+        snapshot->id.ino     = st->st_ino;
+        snapshot->mtime      = st->st_mtime;
+        snapshot->mtime_nsec = get_mtime_nsec( st );
+        snapshot->data       = data;
+    }
+    return data;
+}
+
+
+/* copy the entries of a sorted snapshot that match the mask, keeping their order */
+static NTSTATUS filter_dir_data( struct dir_data *data, const struct dir_data *snapshot,
+                                 const UNICODE_STRING *mask )
+{
+    const struct dir_data_names *names;
+    unsigned int i;
+
+    for (i = 0; i < snapshot->count; i++)
+    {
+        names = &snapshot->names[i];
+        if (mask && !match_filename( names->long_name, wcslen( names->long_name ), mask ) &&
+            (!names->short_name[0] || !match_filename( names->short_name, wcslen( names->short_name ), mask )))
+            continue;
+        if (!add_dir_data_names( data, names->long_name, names->short_name, names->unix_name ))
+            return STATUS_NO_MEMORY;
+    }
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           init_cached_dir_data
  *
@@ -2511,28 +2619,32 @@ static int name_compare( const void *a, const void *b )
  */
 static NTSTATUS init_cached_dir_data( struct dir_data **data_ret, int fd, const UNICODE_STRING *mask )
 {
-    struct dir_data *data;
+    struct dir_data *data, *snapshot = NULL;
     struct stat st;
     NTSTATUS status;
     unsigned int i;
+    BOOL cached;
 
     if (!(data = calloc( 1, sizeof(*data) ))) return STATUS_NO_MEMORY;
 
-    if ((status = read_directory_data( data, fd, mask )))
+    /* wildcard searches need the whole directory, share it between enumerations */
+    if (!fstat( fd, &st ) && has_wildcard( mask )) snapshot = get_dir_snapshot( fd, &st, &cached );
+
+    if (snapshot)
+    {
+        status = filter_dir_data( data, snapshot, mask );
+        if (!cached) free_dir_data( snapshot );
+    }
+    else if (!(status = read_directory_data( data, fd, mask ))) sort_dir_data( data );
+
+    if (status)
     {
         free_dir_data( data );
         return status;
     }
 
-    /* sort filenames, but not "." and ".." */
-    i = 0;
-    if (i < data->count && !strcmp( data->names[i].unix_name, "." )) i++;
-    if (i < data->count && !strcmp( data->names[i].unix_name, ".." )) i++;
-    if (i < data->count) qsort( data->names + i, data->count - i, sizeof(*data->names), name_compare );
-
     if (data->count)
     {
-        fstat( fd, &st );
         data->id.dev = st.st_dev;
         data->id.ino = st.st_ino;
     }
@@ -2695,6 +2807,206 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/***********************************************************************
+ *           Case-insensitive directory lookup cache
+ *
+ * Directories that had to be searched the hard way are remembered, with
+ * their names hashed case-insensitively, as long as their modification
+ * time doesn't change.
+ */
+struct case_name
+{
+    int                  next;        /* index of the next name in the hash chain, -1 if none */
+    unsigned int         hash;        /* hash of the upper-case name */
+    unsigned int         len;         /* length of the name in WCHARs */
+    unsigned int         name;        /* offset of the upper-case name in nt_names */
+    unsigned int         unix_name;   /* offset of the Unix name in unix_names */
+};
+
+struct case_dir
+{
+    struct file_identity id;          /* directory file identity */
+    time_t               mtime;       /* directory modification time */
+    long                 mtime_nsec;
+    unsigned int         count;       /* count of names */
+    unsigned int         hash_mask;   /* size of the hash table - 1 */
+    int                 *buckets;     /* hash table of names indices */
+    struct case_name    *names;       /* directory names */
+    WCHAR               *nt_names;    /* upper-case names pool */
+    char                *unix_names;  /* Unix names pool */
+};
+
+#define CASE_DIR_CACHE_SIZE 32
+
+static struct case_dir *case_dir_cache[CASE_DIR_CACHE_SIZE];
+static unsigned int case_dir_cache_pos;
+static pthread_mutex_t case_dir_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int hash_case_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len; i++) hash = hash * 31 + towupper( name[i] );
+    return hash;
+}
+
+static void free_case_dir( struct case_dir *dir )
+{
+    if (!dir) return;
+    free( dir->buckets );
+    free( dir->names );
+    free( dir->nt_names );
+    free( dir->unix_names );
+    free( dir );
+}
+
+static BOOL grow_case_buffer( void **buffer, unsigned int *size, unsigned int needed, unsigned int elem_size )
+{
+    unsigned int new_size;
+    void *new_buffer;
+
+    if (needed <= *size) return TRUE;
+    new_size = max( needed, *size * 2 );
+    if (!(new_buffer = realloc( *buffer, new_size * elem_size ))) return FALSE;
+    *buffer = new_buffer;
+    *size = new_size;
+    return TRUE;
+}
+
+/* read a directory into a new cache entry */
+static struct case_dir *read_case_dir( const char *unix_name, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    unsigned int names_size = 64, nt_size = 1024, unix_size = 1024, nt_pos = 0, unix_pos = 0, i, hash_size;
+    struct case_dir *dir;
+    struct dirent *de;
+    DIR *unix_dir;
+    int len, unix_len;
+
+    /* a change in the same second as the scan could leave the modification time unchanged */
+    if (st->st_mtime >= time( NULL )) return NULL;
+
+    if (!(dir = calloc( 1, sizeof(*dir) ))) return NULL;
+    dir->id.dev     = st->st_dev;
+    dir->id.ino     = st->st_ino;
+    dir->mtime      = st->st_mtime;
+    dir->mtime_nsec = get_mtime_nsec( st );
+    if (!(dir->names = malloc( names_size * sizeof(*dir->names) )) ||
+        !(dir->nt_names = malloc( nt_size * sizeof(WCHAR) )) ||
+        !(dir->unix_names = malloc( unix_size )) ||
+        !(unix_dir = opendir( unix_name )))
+    {
+        free_case_dir( dir );
+        return NULL;
+    }
+
+    while ((de = readdir( unix_dir )))
+    {
+        if (!strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." )) continue;
+        unix_len = strlen( de->d_name );
+        if ((len = ntdll_umbstowcs( de->d_name, unix_len, buffer, MAX_DIR_ENTRY_LEN )) <= 0) continue;
+
+        if (!grow_case_buffer( (void **)&dir->names, &names_size, dir->count + 1, sizeof(*dir->names) ) ||
+            !grow_case_buffer( (void **)&dir->nt_names, &nt_size, nt_pos + len, sizeof(WCHAR) ) ||
+            !grow_case_buffer( (void **)&dir->unix_names, &unix_size, unix_pos + unix_len + 1, 1 ))
+        {
+            closedir( unix_dir );
+            free_case_dir( dir );
+            return NULL;
+        }
+        for (i = 0; i < len; i++) dir->nt_names[nt_pos + i] = towupper( buffer[i] );
+        memcpy( dir->unix_names + unix_pos, de->d_name, unix_len + 1 );
+        dir->names[dir->count].hash      = hash_case_name( buffer, len );
+        dir->names[dir->count].len       = len;
+        dir->names[dir->count].name      = nt_pos;
+        dir->names[dir->count].unix_name = unix_pos;
+        dir->count++;
+        nt_pos += len;
+        unix_pos += unix_len + 1;
+    }
+    closedir( unix_dir );
+
+    for (hash_size = 16; hash_size < dir->count * 2; hash_size *= 2) ;
+    if (!(dir->buckets = malloc( hash_size * sizeof(*dir->buckets) )))
+    {
+        free_case_dir( dir );
+        return NULL;
+    }
+    dir->hash_mask = hash_size - 1;
+    for (i = 0; i < hash_size; i++) dir->buckets[i] = -1;
+    for (i = 0; i < dir->count; i++)
+    {
+        int *bucket = &dir->buckets[dir->names[i].hash & dir->hash_mask];
+        dir->names[i].next = *bucket;
+        *bucket = i;
+    }
+    return dir;
+}
+
+/***********************************************************************
+ *           find_file_in_case_cache
+ *
+ * Find a file by case-insensitive long name, using the directory cache.
+ * unix_name contains the directory name, and the file found is appended at pos.
+ * Returns STATUS_NOT_SUPPORTED if the directory can't be cached.
+ */
+static NTSTATUS find_file_in_case_cache( char *unix_name, int pos, const WCHAR *name, int length )
+{
+    NTSTATUS status = STATUS_OBJECT_NAME_NOT_FOUND;
+    struct case_dir *dir = NULL;
+    unsigned int i, hash;
+    struct stat st;
+    int index;
+
+    if (stat( unix_name, &st ) == -1) return STATUS_NOT_SUPPORTED;
+
+    mutex_lock( &case_dir_mutex );
+
+    for (i = 0; i < CASE_DIR_CACHE_SIZE; i++)
+    {
+        struct case_dir *entry = case_dir_cache[i];
+
+        if (!entry || entry->id.dev != st.st_dev || entry->id.ino != st.st_ino) continue;
+        if (entry->mtime == st.st_mtime && entry->mtime_nsec == get_mtime_nsec( &st ))
+        {
+            dir = entry;
+            break;
+        }
+        /* the directory changed, drop it */
+        free_case_dir( entry );
+        case_dir_cache[i] = NULL;
+    }
+
+    if (!dir)
+    {
+        if (!(dir = read_case_dir( unix_name, &st )))
+        {
+            mutex_unlock( &case_dir_mutex );
+            return STATUS_NOT_SUPPORTED;
+        }
+        i = case_dir_cache_pos++ % CASE_DIR_CACHE_SIZE;
+        free_case_dir( case_dir_cache[i] );
+        case_dir_cache[i] = dir;
+    }
+
+    hash = hash_case_name( name, length );
+    for (index = dir->buckets[hash & dir->hash_mask]; index != -1; index = dir->names[index].next)
+    {
+        const struct case_name *entry = &dir->names[index];
+
+        if (entry->hash != hash || entry->len != length) continue;
+        if (wcsnicmp( dir->nt_names + entry->name, name, length )) continue;
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, dir->unix_names + entry->unix_name );
+        status = STATUS_SUCCESS;
+        break;
+    }
+
+    mutex_unlock( &case_dir_mutex );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2785,6 +3097,16 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (find_file_in_case_cache( unix_name, pos, name, length ))
+    {
+    case STATUS_SUCCESS:
+        return STATUS_SUCCESS;
+    case STATUS_OBJECT_NAME_NOT_FOUND:
+        /* short names aren't cached, they still need a full scan */
+        if (!is_name_8_dot_3) goto not_found;
+        break;
+    }
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
@@ -5312,6 +5634,346 @@ void add_completion( HANDLE handle, ULONG_PTR value, NTSTATUS status, ULONG info
     SERVER_END_REQ;
 }
 
+/* asynchronous regular file I/O through an io_uring submission queue */
+
+struct async_fileio_ring
+{
+    struct async_fileio io;
+    void               *buffer;
+    ULONG               length;
+    ULONGLONG           offset;
+    BOOL                write;
+    client_ptr_t        iosb;
+    HANDLE              wait;     /* async wait handle returned by register_async */
+};
+
+/* report the result of an operation to the server, which then signals its completion */
+static void complete_ring_io( struct async_fileio_ring *fileio, int result )
+{
+    unsigned int status;
+    ULONG_PTR info = 0;
+    int fd, needs_close;
+
+    /* the buffer may be write-watched, retry with the view lock held */
+    if (result == -EFAULT && !fileio->write &&
+        !server_get_unix_fd( fileio->io.handle, FILE_READ_DATA, &fd, &needs_close, NULL, NULL ))
+    {
+        while ((result = virtual_locked_pread( fd, fileio->buffer, fileio->length,
+                                               fileio->offset )) == -1 && errno == EINTR);
+        if (result == -1) result = -errno;
+        if (needs_close) close( fd );
+    }
+
+    if (result < 0)
+        status = fileio->write && result == -EFAULT ? STATUS_INVALID_USER_BUFFER : errno_to_status( -result );
+    else
+    {
+        status = (result || !fileio->length || fileio->write) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+        info = result;
+    }
+
+    set_async_iosb( fileio->iosb, status, info );
+    set_async_direct_result( &fileio->wait, status, info, TRUE );
+    release_fileio( &fileio->io );
+}
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+#define IO_RING_OP_NOP          0
+#define IO_RING_OP_READ         22
+#define IO_RING_OP_WRITE        23
+#define IO_RING_ENTER_GETEVENTS 1
+#define IO_RING_FEAT_RW_CUR_POS (1 << 3)  /* implies IORING_OP_READ and IORING_OP_WRITE */
+#define IO_RING_OFF_SQ_RING     0ULL
+#define IO_RING_OFF_CQ_RING     0x8000000ULL
+#define IO_RING_OFF_SQES        0x10000000ULL
+#define IO_RING_ENTRIES         256
+
+struct io_ring_sqe
+{
+    BYTE      opcode;
+    BYTE      flags;
+    USHORT    ioprio;
+    int       fd;
+    ULONGLONG off;
+    ULONGLONG addr;
+    UINT      len;
+    UINT      rw_flags;
+    ULONGLONG user_data;
+    ULONGLONG pad[3];
+};
+
+struct io_ring_cqe
+{
+    ULONGLONG user_data;
+    int       res;
+    UINT      flags;
+};
+
+struct io_ring_sq_offsets
+{
+    UINT head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+    ULONGLONG resv2;
+};
+
+struct io_ring_cq_offsets
+{
+    UINT head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+    ULONGLONG resv2;
+};
+
+struct io_ring_params
+{
+    UINT sq_entries, cq_entries, flags, sq_thread_cpu, sq_thread_idle, features, wq_fd, resv[3];
+    struct io_ring_sq_offsets sq_off;
+    struct io_ring_cq_offsets cq_off;
+};
+
+static pthread_mutex_t io_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int io_ring_fd = -1;
+static BOOL io_ring_init_done;
+static unsigned int *sq_head, *sq_tail, *sq_array, sq_mask, sq_entries;
+static unsigned int *cq_head, *cq_tail, cq_mask;
+static struct io_ring_sqe *sqes;
+static struct io_ring_cqe *cqes;
+static unsigned int io_ring_inflight;  /* submitted operations that haven't been reaped */
+static unsigned int io_ring_max_inflight;
+
+static int io_ring_enter( unsigned int to_submit, unsigned int min_complete, unsigned int flags )
+{
+    return syscall( __NR_io_uring_enter, io_ring_fd, to_submit, min_complete, flags, NULL, 0 );
+}
+
+/* take the next completed operation off the ring; called with io_ring_mutex held */
+static struct async_fileio_ring *io_ring_reap( int *result )
+{
+    unsigned int head = *cq_head, tail = __atomic_load_n( cq_tail, __ATOMIC_ACQUIRE );
+    struct async_fileio_ring *fileio = NULL;
+
+    for ( ; head != tail && !fileio; head++)
+    {
+        const struct io_ring_cqe *cqe = &cqes[head & cq_mask];
+
+        if (!(fileio = (struct async_fileio_ring *)(ULONG_PTR)cqe->user_data)) continue;
+        *result = cqe->res;
+        io_ring_inflight--;
+    }
+    __atomic_store_n( cq_head, head, __ATOMIC_RELEASE );
+    return fileio;
+}
+
+/* thread completing the operations, so that the threads that started them never wait for them */
+static void CALLBACK io_ring_reaper( void *arg )
+{
+    struct async_fileio_ring *fileio;
+    int result;
+
+    for (;;)
+    {
+        mutex_lock( &io_ring_mutex );
+        while (!(fileio = io_ring_reap( &result )))
+        {
+            mutex_unlock( &io_ring_mutex );
+            io_ring_enter( 0, 1, IO_RING_ENTER_GETEVENTS );
+            mutex_lock( &io_ring_mutex );
+        }
+        mutex_unlock( &io_ring_mutex );
+        complete_ring_io( fileio, result );
+    }
+}
+
+/* create the ring and its reaper thread when WINEIOURING is set; called with io_ring_mutex held */
+static BOOL init_io_ring(void)
+{
+    const char *env = getenv( "WINEIOURING" );
+    struct io_ring_params params;
+    char *sq_ring, *cq_ring;
+    size_t sq_size, cq_size;
+    HANDLE thread;
+    int fd;
+
+    if (io_ring_init_done) return io_ring_fd != -1;
+    io_ring_init_done = TRUE;
+    if (!env || !atoi( env )) return FALSE;
+
+    memset( &params, 0, sizeof(params) );
+    if ((fd = syscall( __NR_io_uring_setup, IO_RING_ENTRIES, &params )) == -1)
+    {
+        WARN( "io_uring not supported, errno %d\n", errno );
+        return FALSE;
+    }
+    if (!(params.features & IO_RING_FEAT_RW_CUR_POS))
+    {
+        WARN( "io_uring is too old, not using it\n" );
+        close( fd );
+        return FALSE;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_ring_cqe);
+    sq_ring = mmap( NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IO_RING_OFF_SQ_RING );
+    cq_ring = mmap( NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IO_RING_OFF_CQ_RING );
+    sqes = mmap( NULL, params.sq_entries * sizeof(*sqes), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IO_RING_OFF_SQES );
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) goto failed;
+
+    sq_head  = (unsigned int *)(sq_ring + params.sq_off.head);
+    sq_tail  = (unsigned int *)(sq_ring + params.sq_off.tail);
+    sq_array = (unsigned int *)(sq_ring + params.sq_off.array);
+    sq_mask  = *(unsigned int *)(sq_ring + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    cq_head  = (unsigned int *)(cq_ring + params.cq_off.head);
+    cq_tail  = (unsigned int *)(cq_ring + params.cq_off.tail);
+    cq_mask  = *(unsigned int *)(cq_ring + params.cq_off.ring_mask);
+    cqes     = (struct io_ring_cqe *)(cq_ring + params.cq_off.cqes);
+    /* leave room in the completion queue for the nop entries */
+    io_ring_max_inflight = params.cq_entries / 2;
+    io_ring_fd = fd;
+
+    if (NtCreateThreadEx( &thread, THREAD_ALL_ACCESS, NULL, NtCurrentProcess(), io_ring_reaper, NULL,
+                          THREAD_CREATE_FLAGS_HIDE_FROM_DEBUGGER, 0, 0, 0, NULL ))
+    {
+        WARN( "failed to create the reaper thread\n" );
+        io_ring_fd = -1;
+        goto failed;
+    }
+    NtClose( thread );
+    TRACE( "using io_uring with %u entries\n", params.sq_entries );
+    return TRUE;
+
+failed:
+    if (sq_ring != MAP_FAILED) munmap( sq_ring, sq_size );
+    if (cq_ring != MAP_FAILED) munmap( cq_ring, cq_size );
+    if (sqes != MAP_FAILED) munmap( sqes, params.sq_entries * sizeof(*sqes) );
+    close( fd );
+    return FALSE;
+}
+
+/* queue a submission entry and pass it to the kernel; called with io_ring_mutex held */
+static BOOL io_ring_submit_sqe( unsigned int opcode, int fd, void *addr, unsigned int len,
+                                ULONGLONG off, ULONG_PTR user_data )
+{
+    unsigned int tail = *sq_tail, index = tail & sq_mask, pending;
+    struct io_ring_sqe *sqe = &sqes[index];
+    int ret;
+
+    /* entries left over by a failed submission are still pending, pass them along with this one */
+    pending = tail - __atomic_load_n( sq_head, __ATOMIC_ACQUIRE );
+    if (pending >= sq_entries) return FALSE;
+    pending++;
+
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode    = opcode;
+    sqe->fd        = fd;
+    sqe->addr      = (ULONG_PTR)addr;
+    sqe->len       = len;
+    sqe->off       = off;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+    __atomic_store_n( sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+    while ((ret = io_ring_enter( pending, 0, 0 )) == -1 && errno == EINTR);
+    if (ret == (int)pending) return TRUE;
+
+    /* the entry is still queued, make sure it won't do anything when the next
+     * submission consumes it */
+    WARN( "failed to submit, errno %d\n", ret == -1 ? errno : 0 );
+    sqe->opcode    = IO_RING_OP_NOP;
+    sqe->user_data = 0;
+    return FALSE;
+}
+
+/* start an asynchronous read or write, return FALSE if it has to be done the usual way */
+static BOOL io_ring_submit( struct async_fileio_ring *fileio, int fd )
+{
+    BOOL ret = FALSE;
+
+    mutex_lock( &io_ring_mutex );
+    if (io_ring_inflight < io_ring_max_inflight &&
+        io_ring_submit_sqe( fileio->write ? IO_RING_OP_WRITE : IO_RING_OP_READ, fd,
+                            fileio->buffer, fileio->length, fileio->offset, (ULONG_PTR)fileio ))
+    {
+        io_ring_inflight++;
+        ret = TRUE;
+    }
+    mutex_unlock( &io_ring_mutex );
+    return ret;
+}
+
+static BOOL io_ring_enabled(void)
+{
+    BOOL ret;
+
+    mutex_lock( &io_ring_mutex );
+    ret = init_io_ring();
+    mutex_unlock( &io_ring_mutex );
+    return ret;
+}
+
+#else  /* __NR_io_uring_setup */
+
+static BOOL io_ring_enabled(void)
+{
+    return FALSE;
+}
+
+static BOOL io_ring_submit( struct async_fileio_ring *fileio, int fd )
+{
+    return FALSE;
+}
+
+#endif  /* __NR_io_uring_setup */
+
+/* register an async I/O on a regular file and start it through the ring; helper for NtReadFile and NtWriteFile */
+static unsigned int register_async_ring_io( HANDLE handle, int unix_handle, HANDLE event,
+                                            PIO_APC_ROUTINE apc, void *apc_user, client_ptr_t iosb,
+                                            void *buffer, ULONG length, ULONGLONG offset, BOOL write )
+{
+    struct async_fileio_ring *fileio;
+    unsigned int status;
+    ssize_t ret;
+
+    if (!io_ring_enabled()) return STATUS_NOT_SUPPORTED;
+
+    /* the result is always reported with set_async_direct_result, so no callback is needed */
+    if (!(fileio = (struct async_fileio_ring *)alloc_fileio( sizeof(*fileio), NULL, handle )))
+        return STATUS_NO_MEMORY;
+
+    fileio->buffer = buffer;
+    fileio->length = length;
+    fileio->offset = offset;
+    fileio->write  = write;
+    fileio->iosb   = iosb;
+
+    SERVER_START_REQ( register_async )
+    {
+        req->type   = write ? ASYNC_TYPE_WRITE : ASYNC_TYPE_READ;
+        req->count  = length;
+        req->direct = 1;
+        req->async  = server_async( handle, &fileio->io, event, apc, apc_user, iosb );
+        status = wine_server_call( req );
+        fileio->wait = wine_server_ptr_handle( reply->wait );
+    }
+    SERVER_END_REQ;
+
+    if (status != STATUS_ALERTED)
+    {
+        release_fileio( &fileio->io );
+        return status;
+    }
+
+    if (!io_ring_submit( fileio, unix_handle ))
+    {
+        /* the ring is full, do it now and report the result right away */
+        if (write)
+            while ((ret = pwrite( unix_handle, buffer, length, offset )) == -1 && errno == EINTR);
+        else
+            while ((ret = virtual_locked_pread( unix_handle, buffer, length, offset )) == -1 && errno == EINTR);
+        complete_ring_io( fileio, ret < 0 ? -errno : ret );
+    }
+    return STATUS_PENDING;
+}
+
 static unsigned int set_pending_write( HANDLE device )
 {
     unsigned int status;
@@ -5369,6 +6031,13 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
+            if (async_read && length)
+            {
+                status = register_async_ring_io( handle, unix_handle, event, apc, apc_user, iosb_ptr,
+                                                 buffer, length, offset->QuadPart, FALSE );
+                if (status != STATUS_NOT_SUPPORTED) goto err;
+            }
+
             /* async I/O doesn't make sense on regular files */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
@@ -5686,6 +6355,13 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
                 goto done;
             }
 
+            if (async_write && length)
+            {
+                status = register_async_ring_io( handle, unix_handle, event, apc, apc_user, iosb_ptr,
+                                                 (void *)buffer, length, off, TRUE );
+                if (status != STATUS_NOT_SUPPORTED) goto err;
+            }
+
             /* async I/O doesn't make sense on regular files */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
@@ -6959,12 +7635,49 @@ static void *put_object_type_info( OBJECT_TYPE_INFORMATION *p, struct object_typ
     return (char *)(p + 1) + ((p->TypeName.MaximumLength + align) & ~align);
 }
 
+static struct object_type_info *type_info_cache[SHARED_TYPE_COUNT];
+static pthread_mutex_t type_info_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* get the static information of an object type, cached from the server on first use */
+static const struct object_type_info *get_cached_type_info( unsigned int index )
+{
+    UINT size = SHARED_TYPE_COUNT * (sizeof(struct object_type_info) + 16 * sizeof(WCHAR));
+    struct object_type_info *buffer;
+    UINT i, count = 0, pos;
+    unsigned int status;
+
+    if (index >= SHARED_TYPE_COUNT) return NULL;
+    if (type_info_cache[index]) return type_info_cache[index];
+
+    mutex_lock( &type_info_mutex );
+    if (!type_info_cache[0] && (buffer = malloc( size )))
+    {
+        SERVER_START_REQ( get_object_types )
+        {
+            wine_server_set_reply( req, buffer, size );
+            status = wine_server_call( req );
+            count = reply->count;
+        }
+        SERVER_END_REQ;
+        for (i = pos = 0; !status && i < count; i++)
+        {
+            struct object_type_info *info = (struct object_type_info *)((char *)buffer + pos);
+            pos += sizeof(*info) + ((info->name_len + 3) & ~3);
+            if (info->index < SHARED_TYPE_COUNT) type_info_cache[info->index] = info;
+        }
+        if (status || !count) free( buffer );
+    }
+    mutex_unlock( &type_info_mutex );
+    return type_info_cache[index];
+}
+
 /**************************************************************************
  *           NtQueryObject   (NTDLL.@)
  */
 NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_class,
                                void *ptr, ULONG len, ULONG *used_len )
 {
+    struct shared_handle shared;
     unsigned int status;
 
     TRACE("(%p,0x%08x,%p,0x%08x,%p)\n", handle, info_class, ptr, (int)len, used_len);
@@ -6978,6 +7691,7 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
         OBJECT_BASIC_INFORMATION *p = ptr;
 
         if (len < sizeof(*p)) return STATUS_INFO_LENGTH_MISMATCH;
+        if (get_shared_handle( handle, &shared ) && !shared.type) return STATUS_INVALID_HANDLE;
 
         SERVER_START_REQ( get_object_info )
         {
@@ -7066,6 +7780,24 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
         OBJECT_TYPE_INFORMATION *p = ptr;
         char buffer[sizeof(struct object_type_info) + 64];
         struct object_type_info *info = (struct object_type_info *)buffer;
+        const struct object_type_info *cached;
+        struct shared_type_counts counts;
+
+        if (get_shared_handle( handle, &shared ))
+        {
+            if (!shared.type) return STATUS_INVALID_HANDLE;
+            if ((cached = get_cached_type_info( shared.type - 1 )) &&
+                sizeof(*info) + cached->name_len <= sizeof(buffer) &&
+                get_shared_type_counts( shared.type - 1, &counts ))
+            {
+                memcpy( info, cached, sizeof(*info) + cached->name_len );
+                info->obj_count    = counts.obj_count;
+                info->handle_count = counts.handle_count;
+                info->obj_max      = counts.obj_max;
+                info->handle_max   = counts.handle_max;
+                goto done_type;
+            }
+        }
 
         SERVER_START_REQ( get_object_type )
         {
@@ -7075,6 +7807,7 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
         }
         SERVER_END_REQ;
         if (status) break;
+    done_type:
         if (sizeof(*p) + info->name_len + sizeof(WCHAR) <= len)
         {
             put_object_type_info( p, info );
@@ -7132,6 +7865,15 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
 
         if (len < sizeof(*p)) return STATUS_INVALID_BUFFER_SIZE;
 
+        if (get_shared_handle( handle, &shared ))
+        {
+            if (!shared.type) return STATUS_INVALID_HANDLE;
+            p->InheritHandle = (shared.flags & HANDLE_FLAG_INHERIT) != 0;
+            p->ProtectFromClose = (shared.flags & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
+            if (used_len) *used_len = sizeof(*p);
+            return STATUS_SUCCESS;
+        }
+
         SERVER_START_REQ( set_handle_info )
         {
             req->handle = wine_server_obj_handle( handle );
@@ -136,11 +136,13 @@ static void * const syscalls[] =
     NtAllocateVirtualMemoryEx,
     NtAreMappedFilesTheSame,
     NtAssignProcessToJobObject,
+    NtAssociateWaitCompletionPacket,
     NtCallbackReturn,
     NtCancelIoFile,
     NtCancelIoFileEx,
     NtCancelSynchronousIoFile,
     NtCancelTimer,
+    NtCancelWaitCompletionPacket,
     NtClearEvent,
     NtClose,
     NtCompareObjects,
@@ -169,6 +171,7 @@ static void * const syscalls[] =
     NtCreateThreadEx,
     NtCreateTimer,
     NtCreateUserProcess,
+    NtCreateWaitCompletionPacket,
     NtDebugActiveProcess,
     NtDebugContinue,
     NtDelayExecution,
@@ -1092,8 +1095,8 @@ static void load_ntdll_wow64_functions( HMODULE module )
 }
 
 /* reimplementation of LdrProcessRelocationBlock */
-static const IMAGE_BASE_RELOCATION *process_relocation_block( void *module, const IMAGE_BASE_RELOCATION *rel,
-                                                              INT_PTR delta )
+const IMAGE_BASE_RELOCATION *process_relocation_block( void *module, const IMAGE_BASE_RELOCATION *rel,
+                                                       INT_PTR delta )
 {
     char *page = get_rva( module, rel->VirtualAddress );
     UINT count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
@@ -2083,6 +2086,9 @@ static void start_main_thread(void)
     dbg_init();
     startup_info_size = server_init_process();
     virtual_map_user_shared_data();
+    init_registry_cache();
+    init_shared_handles();
+    init_fast_sync();
     init_cpu_info();
     init_files();
     load_libwine();
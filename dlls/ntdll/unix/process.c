@@ -425,10 +425,12 @@ static NTSTATUS spawn_process( const RTL_USER_PROCESS_PARAMETERS *params, int so
                                int unixdir, char *winedebug, const pe_image_info_t *pe_info )
 {
     NTSTATUS status = STATUS_SUCCESS;
+    HANDLE std_handles[2] = { params->hStdInput, params->hStdOutput };
     int stdin_fd = -1, stdout_fd = -1;
     pid_t pid;
     char **argv;
 
+    server_prefetch_unix_fds( std_handles, ARRAY_SIZE(std_handles) );
     if (wine_server_handle_to_fd( params->hStdInput, FILE_READ_DATA, &stdin_fd, NULL ) &&
         isatty(0) && is_unix_console_handle( params->hStdInput ))
         stdin_fd = 0;
@@ -546,6 +548,7 @@ NTSTATUS WINAPI __wine_unix_spawnvp( char * const argv[], int wait )
 static NTSTATUS fork_and_exec( OBJECT_ATTRIBUTES *attr, int unixdir,
                                const RTL_USER_PROCESS_PARAMETERS *params )
 {
+    HANDLE std_handles[2] = { params->hStdInput, params->hStdOutput };
     pid_t pid;
     int fd[2], stdin_fd = -1, stdout_fd = -1;
     char **argv, **envp;
@@ -568,6 +571,7 @@ static NTSTATUS fork_and_exec( OBJECT_ATTRIBUTES *attr, int unixdir,
         fcntl( fd[1], F_SETFD, FD_CLOEXEC );
     }
 
+    server_prefetch_unix_fds( std_handles, ARRAY_SIZE(std_handles) );
     if (wine_server_handle_to_fd( params->hStdInput, FILE_READ_DATA, &stdin_fd, NULL ) &&
         isatty(0) && is_unix_console_handle( params->hStdInput ))
         stdin_fd = 0;
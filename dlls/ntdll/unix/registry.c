@@ -27,6 +27,8 @@
 
 #include <stdarg.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -39,6 +41,162 @@ WINE_DEFAULT_DEBUG_CHANNEL(reg);
 /* maximum length of a value name in bytes (without terminating null) */
 #define MAX_VALUE_LENGTH (16383 * sizeof(WCHAR))
 
+/* client-side cache of value queries, validated against the server key modification stamps */
+
+#define VALUE_CACHE_SETS      128  /* sets are indexed by key handle */
+#define VALUE_CACHE_WAYS      8    /* entries per set */
+#define VALUE_CACHE_MAX_NAME  64   /* max. value name length in WCHARs */
+#define VALUE_CACHE_MAX_DATA  256  /* max. value data size in bytes */
+
+struct value_cache_entry
+{
+    HANDLE       key;          /* key handle the value was queried on */
+    unsigned int stamp_index;  /* index in the shared stamps array */
+    unsigned int stamp;        /* key stamp at the time of the query */
+    unsigned int status;       /* STATUS_SUCCESS or STATUS_OBJECT_NAME_NOT_FOUND */
+    int          type;         /* value type */
+    unsigned int total;        /* value data length */
+    USHORT       name_len;     /* value name length in bytes */
+    WCHAR        name[VALUE_CACHE_MAX_NAME];
+    BYTE         data[VALUE_CACHE_MAX_DATA];
+};
+
+struct value_cache_set
+{
+    struct value_cache_entry *entries[VALUE_CACHE_WAYS];
+    unsigned int              next;  /* next entry to replace */
+};
+
+static const volatile unsigned int *registry_stamps;
+static struct value_cache_set value_cache[VALUE_CACHE_SETS];
+static LONG value_cache_count;  /* number of cached entries */
+static pthread_mutex_t value_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline struct value_cache_set *get_value_cache_set( HANDLE key )
+{
+    return &value_cache[((ULONG_PTR)key >> 2) % VALUE_CACHE_SETS];
+}
+
+static inline BOOL is_cached_value( const struct value_cache_entry *entry, HANDLE key,
+                                    const UNICODE_STRING *name )
+{
+    return entry && entry->key == key && entry->name_len == name->Length &&
+           !memcmp( entry->name, name->Buffer, name->Length );
+}
+
+/***********************************************************************
+ *           init_registry_cache
+ *
+ * Map the key modification stamps published by the server.
+ */
+void init_registry_cache(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','r','e','g','i','s','t','r','y','_','s','t','a','m','p','s',0};
+    UNICODE_STRING name_str = { sizeof(nameW) - sizeof(WCHAR), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr = { sizeof(attr), 0, &name_str };
+    size_t size = REGISTRY_STAMP_COUNT * sizeof(*registry_stamps);
+    unsigned int status;
+    HANDLE section;
+    void *ptr;
+    int fd, needs_close;
+
+    if ((status = NtOpenSection( &section, SECTION_MAP_READ, &attr )))
+    {
+        WARN( "failed to open the registry stamps section: %08x\n", status );
+        return;
+    }
+    if (!server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+    {
+        if ((ptr = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 )) != MAP_FAILED) registry_stamps = ptr;
+        if (needs_close) close( fd );
+    }
+    NtClose( section );
+}
+
+/***********************************************************************
+ *           invalidate_registry_cache
+ *
+ * Remove the cached values of a key handle that is about to be closed.
+ * The server bumps the key stamp when another process closes the handle,
+ * so entries of handles closed elsewhere never match.
+ */
+void invalidate_registry_cache( HANDLE key )
+{
+    struct value_cache_set *set = get_value_cache_set( key );
+    unsigned int i;
+
+    if (!value_cache_count) return;
+
+    mutex_lock( &value_cache_mutex );
+    for (i = 0; i < VALUE_CACHE_WAYS; i++)
+    {
+        if (!set->entries[i] || set->entries[i]->key != key) continue;
+        free( set->entries[i] );
+        set->entries[i] = NULL;
+        InterlockedDecrement( &value_cache_count );
+    }
+    mutex_unlock( &value_cache_mutex );
+}
+
+/* look up a value in the cache; the data is copied to the entry buffer */
+static BOOL get_cached_value( HANDLE key, const UNICODE_STRING *name, struct value_cache_entry *ret )
+{
+    struct value_cache_set *set = get_value_cache_set( key );
+    struct value_cache_entry *entry;
+    BOOL found = FALSE;
+    unsigned int i;
+
+    mutex_lock( &value_cache_mutex );
+    for (i = 0; i < VALUE_CACHE_WAYS; i++)
+    {
+        if (!is_cached_value( (entry = set->entries[i]), key, name )) continue;
+        if (registry_stamps[entry->stamp_index] == entry->stamp)
+        {
+            memcpy( ret, entry, offsetof( struct value_cache_entry, data[entry->total] ));
+            found = TRUE;
+        }
+        else  /* the key has been modified, or the handle closed, since */
+        {
+            free( entry );
+            set->entries[i] = NULL;
+            InterlockedDecrement( &value_cache_count );
+        }
+        break;
+    }
+    mutex_unlock( &value_cache_mutex );
+    return found;
+}
+
+/* add a value to the cache; the stamp is the one the server returned with the value */
+static void add_cached_value( HANDLE key, const UNICODE_STRING *name,
+                              unsigned int status, int type, unsigned int total, const void *data,
+                              unsigned int stamp_index, unsigned int stamp )
+{
+    struct value_cache_set *set = get_value_cache_set( key );
+    struct value_cache_entry *entry;
+    unsigned int i;
+
+    if (!(entry = malloc( offsetof( struct value_cache_entry, data[total] )))) return;
+    entry->key         = key;
+    entry->stamp_index = stamp_index % REGISTRY_STAMP_COUNT;
+    entry->stamp       = stamp;
+    entry->status      = status;
+    entry->type        = type;
+    entry->total       = total;
+    entry->name_len    = name->Length;
+    memcpy( entry->name, name->Buffer, name->Length );
+    if (total) memcpy( entry->data, data, total );
+
+    mutex_lock( &value_cache_mutex );
+    for (i = 0; i < VALUE_CACHE_WAYS; i++) if (is_cached_value( set->entries[i], key, name )) break;
+    if (i == VALUE_CACHE_WAYS) i = set->next++ % VALUE_CACHE_WAYS;
+    if (set->entries[i]) free( set->entries[i] );
+    else InterlockedIncrement( &value_cache_count );
+    set->entries[i] = entry;
+    mutex_unlock( &value_cache_mutex );
+}
+
 
 NTSTATUS open_hkcu_key( const char *path, HANDLE *key )
 {
@@ -481,9 +639,11 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
                                  KEY_VALUE_INFORMATION_CLASS info_class,
                                  void *info, DWORD length, DWORD *result_len )
 {
+    struct value_cache_entry cached;
     unsigned int ret;
     UCHAR *data_ptr;
     unsigned int fixed_size, min_size;
+    BOOL cache = FALSE;
 
     TRACE( "(%p,%s,%d,%p,%d)\n", handle, debugstr_us(name), info_class, info, (int)length );
 
@@ -524,6 +684,22 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
         return STATUS_INVALID_PARAMETER;
     }
 
+    if (registry_stamps && name->Length <= sizeof(cached.name))
+    {
+        if (get_cached_value( handle, name, &cached ))
+        {
+            if (cached.status) return cached.status;
+            if (length > fixed_size && data_ptr)
+                memcpy( data_ptr, cached.data, min( length - fixed_size, cached.total ));
+            copy_key_value_info( info_class, info, length, cached.type, name->Length, cached.total );
+            *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : cached.total);
+            if (length < min_size) return STATUS_BUFFER_TOO_SMALL;
+            if (length < *result_len) return STATUS_BUFFER_OVERFLOW;
+            return STATUS_SUCCESS;
+        }
+        cache = TRUE;
+    }
+
     SERVER_START_REQ( get_key_value )
     {
         req->hkey = wine_server_obj_handle( handle );
@@ -531,12 +707,17 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
         if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
         if (!(ret = wine_server_call( req )))
         {
+            if (cache && reply->total <= sizeof(cached.data) && wine_server_reply_size( reply ) == reply->total)
+                add_cached_value( handle, name, ret, reply->type, reply->total, data_ptr,
+                                  reply->stamp_index, reply->stamp );
             copy_key_value_info( info_class, info, length, reply->type,
                                  name->Length, reply->total );
             *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : reply->total);
             if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
             else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
         }
+        else if (cache && ret == STATUS_OBJECT_NAME_NOT_FOUND)
+            add_cached_value( handle, name, ret, 0, 0, NULL, reply->stamp_index, reply->stamp );
     }
     SERVER_END_REQ;
     return ret;
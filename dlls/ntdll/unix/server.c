@@ -106,7 +106,7 @@ sigset_t server_block_set;  /* signals to block during server calls */
 static int fd_socket = -1;  /* socket to exchange file descriptors with the server */
 static int initial_cwd = -1;
 static pid_t server_pid;
-static pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t fd_socket_mutex = PTHREAD_MUTEX_INITIALIZER;  /* serializes fd transfers from the server */
 
 /* atomically exchange a 64-bit value */
 static inline LONG64 interlocked_xchg64( LONG64 *dest, LONG64 val )
@@ -906,15 +906,30 @@ union fd_cache_entry
         unsigned int        access : 3;
         unsigned int        options : 24;
     } s;
+    struct
+    {
+        int          fd;        /* always 0 */
+        unsigned int ticket;    /* FD_CACHE_CLOSING, or identifies the thread fetching the fd */
+    } pending;
 };
 
 C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
 
 #define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(union fd_cache_entry))
 #define FD_CACHE_ENTRIES     128
+#define FD_CACHE_CLOSING     ~0u
+
+/* The cache is lock-free. An empty entry is reserved with a unique ticket by a thread before it
+ * asks the server for the fd, and it's only filled if the entry still holds that ticket. Closing
+ * a handle marks its entry as closing until the server has closed it, which both evicts a pending
+ * ticket and prevents new ones, so that the fd of a closed handle can never end up in the cache. */
 
 static union fd_cache_entry *fd_cache[FD_CACHE_ENTRIES];
 static union fd_cache_entry fd_cache_initial_block[FD_CACHE_BLOCK_SIZE];
+static LONG fd_cache_ticket;
+
+static const volatile struct shared_handle *shared_handles;  /* mirror of the process handle table */
+static const volatile struct shared_type_counts *shared_type_counts;  /* object type counters */
 
 static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
 {
@@ -925,42 +940,92 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
 
 
 /***********************************************************************
- *           add_fd_to_cache
- *
- * Caller must hold fd_cache_mutex.
+ *           get_fd_cache_entry
  */
-static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
-                            unsigned int access, unsigned int options )
+static union fd_cache_entry *get_fd_cache_entry( HANDLE handle, BOOL alloc )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
-    union fd_cache_entry cache;
+    union fd_cache_entry *block;
 
-    if (entry >= FD_CACHE_ENTRIES)
-    {
-        FIXME( "too many allocated handles, not caching %p\n", handle );
-        return FALSE;
-    }
+    if (entry >= FD_CACHE_ENTRIES) return NULL;  /* too many allocated handles, or a pseudo-handle */
 
-    if (!fd_cache[entry])  /* do we need to allocate a new block of entries? */
+    if (!(block = fd_cache[entry]))  /* do we need to allocate a new block of entries? */
     {
-        if (!entry) fd_cache[0] = fd_cache_initial_block;
+        if (!alloc) return NULL;
+        if (!entry) block = fd_cache_initial_block;
         else
         {
-            void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union fd_cache_entry),
-                                         PROT_READ | PROT_WRITE );
-            if (ptr == MAP_FAILED) return FALSE;
-            fd_cache[entry] = ptr;
+            block = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union fd_cache_entry), PROT_READ | PROT_WRITE );
+            if (block == MAP_FAILED) return NULL;
+        }
+        if (InterlockedCompareExchangePointer( (void **)&fd_cache[entry], block, NULL ))
+        {
+            /* another thread allocated it first */
+            if (entry) munmap( block, FD_CACHE_BLOCK_SIZE * sizeof(union fd_cache_entry) );
+            block = fd_cache[entry];
         }
     }
+    return &block[idx];
+}
+
+
+/***********************************************************************
+ *           reserve_fd_cache_entry
+ *
+ * Reserve the cache entry of a handle before fetching its fd; returns 0 if it can't be cached.
+ */
+static unsigned int reserve_fd_cache_entry( HANDLE handle )
+{
+    union fd_cache_entry *entry, pending;
+
+    if (!(entry = get_fd_cache_entry( handle, TRUE ))) return 0;
+
+    pending.pending.fd = 0;
+    do pending.pending.ticket = InterlockedIncrement( &fd_cache_ticket );
+    while (!pending.pending.ticket || pending.pending.ticket == FD_CACHE_CLOSING);
+
+    /* fails if the entry is filled, closing, or reserved by another thread */
+    if (InterlockedCompareExchange64( &entry->data, pending.data, 0 )) return 0;
+    return pending.pending.ticket;
+}
+
+
+/***********************************************************************
+ *           release_fd_cache_entry
+ *
+ * Release the reservation of a cache entry if it hasn't been filled.
+ */
+static void release_fd_cache_entry( HANDLE handle, unsigned int ticket )
+{
+    union fd_cache_entry *entry, pending;
 
+    if (!ticket || !(entry = get_fd_cache_entry( handle, FALSE ))) return;
+    pending.pending.fd = 0;
+    pending.pending.ticket = ticket;
+    InterlockedCompareExchange64( &entry->data, 0, pending.data );
+}
+
+
+/***********************************************************************
+ *           add_fd_to_cache
+ *
+ * Fill a cache entry reserved with reserve_fd_cache_entry.
+ */
+static BOOL add_fd_to_cache( HANDLE handle, unsigned int ticket, int fd, enum server_fd_type type,
+                             unsigned int access, unsigned int options )
+{
+    union fd_cache_entry *entry, cache, pending;
+
+    if (!ticket || !(entry = get_fd_cache_entry( handle, FALSE ))) return FALSE;
+
+    pending.pending.fd = 0;
+    pending.pending.ticket = ticket;
     /* store fd+1 so that 0 can be used as the unset value */
     cache.s.fd = fd + 1;
     cache.s.type = type;
     cache.s.access = access;
     cache.s.options = options;
-    cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, cache.data );
-    assert( !cache.s.fd );
-    return TRUE;
+    return InterlockedCompareExchange64( &entry->data, cache.data, pending.data ) == pending.data;
 }
 
 
@@ -976,7 +1041,7 @@ static inline NTSTATUS get_cached_fd( HANDLE handle, int *fd, enum server_fd_typ
     if (entry >= FD_CACHE_ENTRIES || !fd_cache[entry]) return STATUS_INVALID_HANDLE;
 
     cache.data = InterlockedCompareExchange64( &fd_cache[entry][idx].data, 0, 0 );
-    if (!cache.data) return STATUS_INVALID_HANDLE;
+    if (!cache.s.fd) return STATUS_INVALID_HANDLE;  /* unset or pending */
 
     /* if fd type is invalid, fd stores an error value */
     if (cache.s.type == FD_TYPE_INVALID) return cache.s.fd - 1;
@@ -991,23 +1056,42 @@ static inline NTSTATUS get_cached_fd( HANDLE handle, int *fd, enum server_fd_typ
 
 /***********************************************************************
  *           remove_fd_from_cache
+ *
+ * Remove the fd of a handle that is being closed; the entry stays marked as closing
+ * until end_fd_cache_removal is called once the server has closed the handle.
  */
 static int remove_fd_from_cache( HANDLE handle )
 {
-    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry *entry, cache;
     int fd = -1;
 
-    if (entry < FD_CACHE_ENTRIES && fd_cache[entry])
+    if ((entry = get_fd_cache_entry( handle, FALSE )))
     {
-        union fd_cache_entry cache;
-        cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, 0 );
-        if (cache.s.type != FD_TYPE_INVALID) fd = cache.s.fd - 1;
+        cache.pending.fd = 0;
+        cache.pending.ticket = FD_CACHE_CLOSING;
+        cache.data = interlocked_xchg64( &entry->data, cache.data );
+        if (cache.s.fd && cache.s.type != FD_TYPE_INVALID) fd = cache.s.fd - 1;
+        if (fd != -1 && cache.s.type == FD_TYPE_SOCKET) reset_socket_wait( fd );
     }
 
     return fd;
 }
 
 
+/***********************************************************************
+ *           end_fd_cache_removal
+ */
+static void end_fd_cache_removal( HANDLE handle )
+{
+    union fd_cache_entry *entry, closing;
+
+    if (!(entry = get_fd_cache_entry( handle, FALSE ))) return;
+    closing.pending.fd = 0;
+    closing.pending.ticket = FD_CACHE_CLOSING;
+    InterlockedCompareExchange64( &entry->data, 0, closing.data );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1019,7 +1103,7 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     sigset_t sigset;
     obj_handle_t fd_handle;
     int ret, fd = -1;
-    unsigned int access = 0;
+    unsigned int ticket, access = 0;
 
     *unix_fd = -1;
     *needs_close = 0;
@@ -1028,35 +1112,35 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     ret = get_cached_fd( handle, &fd, type, &access, options );
     if (ret != STATUS_INVALID_HANDLE) goto done;
 
-    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
-    ret = get_cached_fd( handle, &fd, type, &access, options );
-    if (ret == STATUS_INVALID_HANDLE)
+    ticket = reserve_fd_cache_entry( handle );
+
+    server_enter_uninterrupted_section( &fd_socket_mutex, &sigset );
+    SERVER_START_REQ( get_handle_fd )
     {
-        SERVER_START_REQ( get_handle_fd )
+        req->handle = wine_server_obj_handle( handle );
+        if (!(ret = wine_server_call( req )))
         {
-            req->handle = wine_server_obj_handle( handle );
-            if (!(ret = wine_server_call( req )))
+            if (type) *type = reply->type;
+            if (options) *options = reply->options;
+            access = reply->access;
+            if ((fd = receive_fd( &fd_handle )) != -1)
             {
-                if (type) *type = reply->type;
-                if (options) *options = reply->options;
-                access = reply->access;
-                if ((fd = receive_fd( &fd_handle )) != -1)
-                {
-                    assert( wine_server_ptr_handle(fd_handle) == handle );
-                    *needs_close = (!reply->cacheable ||
-                                    !add_fd_to_cache( handle, fd, reply->type,
-                                                      reply->access, reply->options ));
-                }
-                else ret = STATUS_TOO_MANY_OPENED_FILES;
-            }
-            else if (reply->cacheable)
-            {
-                add_fd_to_cache( handle, ret, FD_TYPE_INVALID, 0, 0 );
+                assert( wine_server_ptr_handle(fd_handle) == handle );
+                *needs_close = (!reply->cacheable ||
+                                !add_fd_to_cache( handle, ticket, fd, reply->type,
+                                                  reply->access, reply->options ));
             }
+            else ret = STATUS_TOO_MANY_OPENED_FILES;
+        }
+        else if (reply->cacheable)
+        {
+            add_fd_to_cache( handle, ticket, ret, FD_TYPE_INVALID, 0, 0 );
         }
-        SERVER_END_REQ;
     }
-    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_socket_mutex, &sigset );
+
+    release_fd_cache_entry( handle, ticket );
 
 done:
     if (!ret && ((access & wanted_access) != wanted_access))
@@ -1069,6 +1153,59 @@ done:
 }
 
 
+/***********************************************************************
+ *           server_prefetch_unix_fds
+ *
+ * Fetch the fds of several handles that aren't cached yet with a single server request.
+ */
+void server_prefetch_unix_fds( const HANDLE *handles, unsigned int count )
+{
+    obj_handle_t wanted[16], fd_handle;
+    unsigned int tickets[16];
+    struct handle_fd_info info[16];
+    unsigned int i, n = 0;
+    sigset_t sigset;
+    HANDLE handle;
+    int fd;
+
+    for (i = 0; i < count && n < ARRAY_SIZE(wanted); i++)
+    {
+        if (!handles[i] || get_cached_fd( handles[i], &fd, NULL, NULL, NULL ) != STATUS_INVALID_HANDLE) continue;
+        if (!(tickets[n] = reserve_fd_cache_entry( handles[i] ))) continue;
+        wanted[n++] = wine_server_obj_handle( handles[i] );
+    }
+    if (!n) return;
+
+    server_enter_uninterrupted_section( &fd_socket_mutex, &sigset );
+    SERVER_START_REQ( get_handle_fds )
+    {
+        wine_server_add_data( req, wanted, n * sizeof(wanted[0]) );
+        wine_server_set_reply( req, info, n * sizeof(info[0]) );
+        if (!wine_server_call( req ))
+        {
+            for (i = 0; i < wine_server_reply_size( reply ) / sizeof(info[0]); i++)
+            {
+                handle = wine_server_ptr_handle( info[i].handle );
+                if (!info[i].status)
+                {
+                    if ((fd = receive_fd( &fd_handle )) == -1) continue;
+                    assert( fd_handle == info[i].handle );
+                    if (!info[i].cacheable || !add_fd_to_cache( handle, tickets[i], fd, info[i].type,
+                                                                info[i].access, info[i].options ))
+                        close( fd );
+                }
+                else if (info[i].cacheable)
+                    add_fd_to_cache( handle, tickets[i], info[i].status, FD_TYPE_INVALID, 0, 0 );
+            }
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_socket_mutex, &sigset );
+
+    for (i = 0; i < n; i++) release_fd_cache_entry( wine_server_ptr_handle( wanted[i] ), tickets[i] );
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle
  */
@@ -1136,6 +1273,95 @@ int server_pipe( int fd[2] )
 }
 
 
+/***********************************************************************
+ *           init_shared_handles
+ *
+ * Map the handle table mirror and the object type counters published by the server.
+ */
+void init_shared_handles(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s','\\',
+                                  '_','_','w','i','n','e','_','o','b','j','e','c','t','_','t','y','p','e','_','c','o','u','n','t','s',0};
+    UNICODE_STRING name_str = { sizeof(nameW) - sizeof(WCHAR), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr = { sizeof(attr), 0, &name_str };
+    HANDLE section = 0;
+    unsigned int status;
+    void *ptr;
+    int fd, needs_close;
+
+    SERVER_START_REQ( get_handle_table_mapping )
+    {
+        if (!(status = wine_server_call( req ))) section = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (!status && !server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+    {
+        ptr = mmap( NULL, SHARED_HANDLE_COUNT * sizeof(*shared_handles), PROT_READ, MAP_SHARED, fd, 0 );
+        if (ptr != MAP_FAILED) shared_handles = ptr;
+        if (needs_close) close( fd );
+    }
+    if (section) NtClose( section );
+    if (!shared_handles) WARN( "failed to map the handle table mirror: %08x\n", status );
+
+    if ((status = NtOpenSection( &section, SECTION_MAP_READ, &attr )))
+    {
+        WARN( "failed to open the object type counters section: %08x\n", status );
+        return;
+    }
+    if (!server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+    {
+        ptr = mmap( NULL, SHARED_TYPE_COUNT * sizeof(*shared_type_counts), PROT_READ, MAP_SHARED, fd, 0 );
+        if (ptr != MAP_FAILED) shared_type_counts = ptr;
+        if (needs_close) close( fd );
+    }
+    NtClose( section );
+}
+
+
+/***********************************************************************
+ *           get_shared_handle
+ *
+ * Read the mirrored entry of a handle. Returns FALSE if the server has to be asked;
+ * an entry with a zero type means that the handle is not valid.
+ */
+BOOL get_shared_handle( HANDLE handle, struct shared_handle *ret )
+{
+    unsigned int index = (wine_server_obj_handle( handle ) >> 2) - 1;
+
+    if (!shared_handles || index >= SHARED_HANDLE_COUNT) return FALSE;
+    *ret = shared_handles[index];
+    return ret->type != SHARED_HANDLE_UNKNOWN_TYPE;
+}
+
+
+/***********************************************************************
+ *           get_shared_type_counts
+ *
+ * Read a consistent snapshot of the object and handle counts of a type.
+ */
+BOOL get_shared_type_counts( unsigned int index, struct shared_type_counts *ret )
+{
+    const volatile struct shared_type_counts *counts;
+    unsigned int seq;
+
+    if (!shared_type_counts || index >= SHARED_TYPE_COUNT) return FALSE;
+    counts = &shared_type_counts[index];
+    do
+    {
+        while ((seq = counts->seq) & 1) YieldProcessor();
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        ret->obj_count    = counts->obj_count;
+        ret->handle_count = counts->handle_count;
+        ret->obj_max      = counts->obj_max;
+        ret->handle_max   = counts->handle_max;
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    } while (counts->seq != seq);
+    ret->seq = seq;
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           init_server_dir
  */
@@ -1650,7 +1876,6 @@ void server_init_thread( void *entry_point, BOOL *suspend )
 NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE dest_process, HANDLE *dest,
                                    ACCESS_MASK access, ULONG attributes, ULONG options )
 {
-    sigset_t sigset;
     unsigned int ret;
     int fd = -1;
 
@@ -1677,7 +1902,7 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
         return result.dup_handle.status;
     }
 
-    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (options & DUPLICATE_CLOSE_SOURCE) invalidate_registry_cache( source );
 
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
@@ -1699,7 +1924,7 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     }
     SERVER_END_REQ;
 
-    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (options & DUPLICATE_CLOSE_SOURCE) end_fd_cache_removal( source );
 
     if (fd != -1) close( fd );
     return ret;
@@ -1730,7 +1955,6 @@ NTSTATUS WINAPI NtCompareObjects( HANDLE first, HANDLE second )
  */
 NTSTATUS WINAPI NtClose( HANDLE handle )
 {
-    sigset_t sigset;
     HANDLE port;
     unsigned int ret;
     int fd;
@@ -1738,7 +1962,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     if (HandleToLong( handle ) >= ~5 && HandleToLong( handle ) <= ~0)
         return STATUS_SUCCESS;
 
-    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    invalidate_registry_cache( handle );
 
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
@@ -1751,7 +1975,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     }
     SERVER_END_REQ;
 
-    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    end_fd_cache_removal( handle );
 
     if (fd != -1) close( fd );
 
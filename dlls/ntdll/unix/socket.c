@@ -28,6 +28,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <unistd.h>
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
@@ -832,6 +833,55 @@ static BOOL async_recv_proc( void *user, ULONG_PTR *info, unsigned int *status )
     return TRUE;
 }
 
+/* state of the local wait on a socket, indexed by unix fd; the low byte is the number of
+ * blocking calls that go straight to the server, the next one the number of local waits
+ * in a row that timed out */
+#define LOCAL_WAIT_MAX_FD     4096
+#define LOCAL_WAIT_BACKOFF    4
+#define LOCAL_WAIT_MAX_MISSES 6
+
+static LONG local_waits[LOCAL_WAIT_MAX_FD];
+
+/* forget the local wait state of a socket fd that is being closed */
+void reset_socket_wait( int fd )
+{
+    if (fd >= 0 && fd < LOCAL_WAIT_MAX_FD) InterlockedExchange( &local_waits[fd], 0 );
+}
+
+/* give a blocking call a chance to complete without handing the wait to the server,
+ * which costs several round trips; the wait is short, and it is attempted less and less
+ * often on a socket where it keeps timing out */
+static BOOL wait_socket_ready( int fd, short events )
+{
+    LONG state, new_state;
+    unsigned int misses;
+    struct pollfd pfd;
+
+    if (fd < 0 || fd >= LOCAL_WAIT_MAX_FD) return FALSE;
+
+    do
+    {
+        state = local_waits[fd];
+        if (!(state & 0xff)) break;
+    } while (InterlockedCompareExchange( &local_waits[fd], state - 1, state ) != state);
+    if (state & 0xff) return FALSE;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    if (poll( &pfd, 1, 1 ) > 0)
+    {
+        InterlockedCompareExchange( &local_waits[fd], 0, state );
+        return TRUE;
+    }
+
+    /* if another thread updated the state in the meantime, its result wins */
+    misses = min( (state >> 8) + 1, LOCAL_WAIT_MAX_MISSES );
+    new_state = (misses << 8) | min( LOCAL_WAIT_BACKOFF << misses, 255 );
+    InterlockedCompareExchange( &local_waits[fd], new_state, state );
+    return FALSE;
+}
+
 static BOOL is_icmp_over_dgram( int fd )
 {
 #ifdef linux
@@ -886,6 +936,8 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         ULONG_PTR information;
 
         status = try_recv( fd, async, &information );
+        if (status == STATUS_DEVICE_NOT_READY && !force_async && !nonblocking && wait_socket_ready( fd, POLLIN ))
+            status = try_recv( fd, async, &information );
         if (status == STATUS_DEVICE_NOT_READY && (force_async || !nonblocking))
             status = STATUS_PENDING;
         if (!NT_ERROR(status) && status != STATUS_PENDING)
@@ -1125,6 +1177,8 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         ULONG_PTR information;
 
         status = try_send( fd, async );
+        if (status == STATUS_DEVICE_NOT_READY && !force_async && !nonblocking && wait_socket_ready( fd, POLLOUT ))
+            status = try_send( fd, async );
         if (status == STATUS_DEVICE_NOT_READY && (force_async || !nonblocking))
             status = STATUS_PENDING;
 
@@ -149,6 +149,419 @@ static inline int use_futexes(void)
 
 #endif
 
+#ifdef __linux__
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+#define FUTEX_32 2
+
+struct futex_waitv_entry
+{
+    ULONG64 val;
+    ULONG64 uaddr;
+    UINT    flags;
+    UINT    reserved;
+};
+
+struct futex_timespec
+{
+    LONGLONG tv_sec;
+    LONGLONG tv_nsec;
+};
+
+static struct fast_sync_slot *fast_sync_slots;
+
+/***********************************************************************
+ *           init_fast_sync
+ *
+ * Map the event, semaphore and mutex state shared by the server when WINEFUTEXSYNC is set.
+ */
+void init_fast_sync(void)
+{
+    const char *env = getenv( "WINEFUTEXSYNC" );
+    HANDLE section = 0;
+    unsigned int status;
+    int fd, needs_close;
+    void *ptr;
+
+    if (!env || !atoi( env )) return;
+
+    if (syscall( __NR_futex_waitv, NULL, 0, 0, NULL, 0 ) == -1 && errno == ENOSYS)
+    {
+        WARN( "futex_waitv not supported, not using fast sync\n" );
+        return;
+    }
+
+    SERVER_START_REQ( get_fast_sync_mapping )
+    {
+        if (!(status = wine_server_call( req ))) section = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (status)
+    {
+        WARN( "fast sync not enabled in the server: %08x\n", status );
+        return;
+    }
+    if (!server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+    {
+        ptr = mmap( NULL, FAST_SYNC_SLOT_COUNT * sizeof(*fast_sync_slots), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0 );
+        if (ptr != MAP_FAILED) fast_sync_slots = ptr;
+        if (needs_close) close( fd );
+    }
+    NtClose( section );
+    TRACE( "fast sync slots at %p\n", fast_sync_slots );
+}
+
+/* return the shared state of an object if the handle has the requested access to it */
+static struct fast_sync_slot *get_fast_sync( HANDLE handle, ACCESS_MASK access, unsigned int type )
+{
+    struct shared_handle shared;
+    struct fast_sync_slot *sync;
+
+    if (!fast_sync_slots || !get_shared_handle( handle, &shared )) return NULL;
+    if (!shared.type || !shared.fast_sync || shared.fast_sync >= FAST_SYNC_SLOT_COUNT) return NULL;
+    if ((shared.access & access) != access) return NULL;
+    sync = &fast_sync_slots[shared.fast_sync];
+    if (!sync->type || (type && sync->type != type)) return NULL;
+    return sync;
+}
+
+static inline BOOL is_fast_sync_event( struct fast_sync_slot *sync )
+{
+    return sync && (sync->type == FAST_SYNC_MANUAL_EVENT || sync->type == FAST_SYNC_AUTO_EVENT);
+}
+
+/* get the state of an object once the server is done checking a wait on it */
+static unsigned int fast_sync_get_state( struct fast_sync_slot *sync )
+{
+    unsigned int state, spins = 0;
+
+    while ((state = __atomic_load_n( &sync->state, __ATOMIC_SEQ_CST )) & FAST_SYNC_LOCKED)
+    {
+        /* the server only keeps it locked for a moment, unless it gets preempted */
+        if (++spins < 100) YieldProcessor();
+        else sched_yield();
+    }
+    return state;
+}
+
+/* replace the state of an object; on failure fetch the state again */
+static BOOL fast_sync_set_state( struct fast_sync_slot *sync, unsigned int *state, unsigned int new_state )
+{
+    if (__atomic_compare_exchange_n( &sync->state, state, new_state, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+        return TRUE;
+    if (*state & FAST_SYNC_LOCKED) *state = fast_sync_get_state( sync );
+    return FALSE;
+}
+
+/* wake the threads waiting on an object after it has been signaled */
+static void fast_sync_wake( HANDLE handle, struct fast_sync_slot *sync )
+{
+    __atomic_add_fetch( &sync->futex, 1, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &sync->waiters, __ATOMIC_SEQ_CST ))
+        syscall( __NR_futex, &sync->futex, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+    if (__atomic_load_n( &sync->server_waiters, __ATOMIC_SEQ_CST ))
+    {
+        SERVER_START_REQ( fast_sync_wake )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            wine_server_call( req );
+        }
+        SERVER_END_REQ;
+    }
+}
+
+/* try to acquire an object; return 0 if not signaled, -1 if the server has to acquire it */
+static int fast_sync_acquire( struct fast_sync_slot *sync, thread_id_t tid )
+{
+    unsigned int state = fast_sync_get_state( sync );
+
+    switch (sync->type)
+    {
+    case FAST_SYNC_MANUAL_EVENT:
+        return state != 0;
+    case FAST_SYNC_AUTO_EVENT:
+        while (state) if (fast_sync_set_state( sync, &state, 0 )) return 1;
+        return 0;
+    case FAST_SYNC_SEMAPHORE:
+        while (state) if (fast_sync_set_state( sync, &state, state - 1 )) return 1;
+        return 0;
+    case FAST_SYNC_MUTEX:
+        if (state == tid)
+        {
+            sync->count++;  /* FIXME: avoid wrap-around */
+            return 1;
+        }
+        /* the server keeps track of the owners, to abandon the mutexes of dying threads */
+        return state ? 0 : -1;
+    }
+    return 0;
+}
+
+/* check if an event got pulsed since a wait started, taking the pulse of an auto-reset event */
+static BOOL fast_sync_pulsed( struct fast_sync_slot *sync, unsigned int start )
+{
+    unsigned int pulse = __atomic_load_n( &sync->pulse, __ATOMIC_SEQ_CST );
+
+    if ((pulse & ~1) == (start & ~1)) return FALSE;
+    if (sync->type == FAST_SYNC_MANUAL_EVENT) return TRUE;
+    while (pulse & 1)
+        if (__atomic_compare_exchange_n( &sync->pulse, &pulse, pulse & ~1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )) return TRUE;
+    return FALSE;
+}
+
+/* acquire a free mutex through the server, without waiting */
+static NTSTATUS fast_sync_grab_mutex( HANDLE handle )
+{
+    static const LARGE_INTEGER zero;
+    select_op_t select_op;
+
+    select_op.wait.op = SELECT_WAIT;
+    select_op.wait.handles[0] = wine_server_obj_handle( handle );
+    return server_wait( &select_op, offsetof( select_op_t, wait.handles[1] ), SELECT_INTERRUPTIBLE, &zero );
+}
+
+static NTSTATUS fast_sync_try_wait( DWORD count, const HANDLE *handles, struct fast_sync_slot **syncs,
+                                    const unsigned int *pulses, thread_id_t tid )
+{
+    NTSTATUS ret;
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+    {
+        switch (fast_sync_acquire( syncs[i], tid ))
+        {
+        case 1:
+            return STATUS_WAIT_0 + i;
+        case 0:
+            if (fast_sync_pulsed( syncs[i], pulses[i] )) return STATUS_WAIT_0 + i;
+            break;
+        case -1:
+            ret = fast_sync_grab_mutex( handles[i] );
+            if (ret == STATUS_WAIT_0 || ret == STATUS_ABANDONED_WAIT_0) return ret + i;
+            if (ret != STATUS_TIMEOUT) return ret;
+            break;
+        }
+    }
+    return STATUS_TIMEOUT;
+}
+
+/* wait on objects through their shared state; fails with STATUS_NOT_IMPLEMENTED if the server is needed */
+static NTSTATUS fast_sync_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any, BOOLEAN alertable,
+                                const LARGE_INTEGER *timeout )
+{
+    struct fast_sync_slot *syncs[MAXIMUM_WAIT_OBJECTS];
+    struct futex_waitv_entry futexes[MAXIMUM_WAIT_OBJECTS];
+    unsigned int pulses[MAXIMUM_WAIT_OBJECTS];
+    struct futex_timespec end;
+    thread_id_t tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    int clock = CLOCK_MONOTONIC;
+    BOOL waiting = FALSE;
+    LONGLONG ticks;
+    NTSTATUS ret;
+    DWORD i;
+
+    /* user APCs can only be delivered by the server */
+    if (!fast_sync_slots || alertable) return STATUS_NOT_IMPLEMENTED;
+    /* only the server can check and acquire several objects atomically */
+    if (!wait_any && count > 1) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(syncs[i] = get_fast_sync( handles[i], SYNCHRONIZE, 0 ))) return STATUS_NOT_IMPLEMENTED;
+        pulses[i] = __atomic_load_n( &syncs[i]->pulse, __ATOMIC_SEQ_CST );
+        futexes[i].uaddr    = (ULONG_PTR)&syncs[i]->futex;
+        futexes[i].flags    = FUTEX_32;
+        futexes[i].reserved = 0;
+    }
+
+    if (timeout && timeout->QuadPart < 0)
+    {
+        struct timespec now;
+
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        ticks = now.tv_sec * (LONGLONG)TICKSPERSEC + now.tv_nsec / 100 - timeout->QuadPart;
+        end.tv_sec  = ticks / TICKSPERSEC;
+        end.tv_nsec = (ticks % TICKSPERSEC) * 100;
+    }
+    else if (timeout)
+    {
+        clock = CLOCK_REALTIME;
+        ticks = timeout->QuadPart - (LONGLONG)(SECS_1601_TO_1970 * TICKSPERSEC);
+        if (ticks < 0) ticks = 0;
+        end.tv_sec  = ticks / TICKSPERSEC;
+        end.tv_nsec = (ticks % TICKSPERSEC) * 100;
+    }
+
+    for (;;)
+    {
+        for (i = 0; i < count; i++) futexes[i].val = __atomic_load_n( &syncs[i]->futex, __ATOMIC_SEQ_CST );
+        if ((ret = fast_sync_try_wait( count, handles, syncs, pulses, tid )) != STATUS_TIMEOUT) break;
+        if (timeout && !timeout->QuadPart) break;
+        if (!waiting)
+        {
+            /* signalers only wake the futex when they see a waiter, so check again once registered */
+            for (i = 0; i < count; i++) __atomic_add_fetch( &syncs[i]->waiters, 1, __ATOMIC_SEQ_CST );
+            waiting = TRUE;
+            continue;
+        }
+        if (syscall( __NR_futex_waitv, futexes, count, 0, timeout ? &end : NULL, clock ) == -1 &&
+            errno == ETIMEDOUT) break;
+    }
+
+    if (waiting)
+        for (i = 0; i < count; i++) __atomic_sub_fetch( &syncs[i]->waiters, 1, __ATOMIC_SEQ_CST );
+    return ret;
+}
+
+static NTSTATUS fast_set_event( HANDLE handle, LONG *prev_state )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, EVENT_MODIFY_STATE, 0 );
+    unsigned int state;
+
+    if (!is_fast_sync_event( sync )) return STATUS_NOT_IMPLEMENTED;
+    state = fast_sync_get_state( sync );
+    while (!state && !fast_sync_set_state( sync, &state, 1 ));
+    /* waiters only need to be woken when the state changes */
+    if (!state) fast_sync_wake( handle, sync );
+    if (prev_state) *prev_state = state;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_reset_event( HANDLE handle, LONG *prev_state )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, EVENT_MODIFY_STATE, 0 );
+    unsigned int state;
+
+    if (!is_fast_sync_event( sync )) return STATUS_NOT_IMPLEMENTED;
+    state = fast_sync_get_state( sync );
+    while (state && !fast_sync_set_state( sync, &state, 0 ));
+    if (prev_state) *prev_state = state;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_query_event( HANDLE handle, EVENT_BASIC_INFORMATION *info )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, EVENT_QUERY_STATE, 0 );
+
+    if (!is_fast_sync_event( sync )) return STATUS_NOT_IMPLEMENTED;
+    info->EventType  = sync->type == FAST_SYNC_MANUAL_EVENT ? NotificationEvent : SynchronizationEvent;
+    info->EventState = fast_sync_get_state( sync );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, SEMAPHORE_MODIFY_STATE, FAST_SYNC_SEMAPHORE );
+    unsigned int state;
+
+    if (!sync) return STATUS_NOT_IMPLEMENTED;
+    state = fast_sync_get_state( sync );
+    do
+    {
+        if (count > sync->max - state) return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+    } while (!fast_sync_set_state( sync, &state, state + count ));
+    fast_sync_wake( handle, sync );
+    if (previous) *previous = state;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_query_semaphore( HANDLE handle, SEMAPHORE_BASIC_INFORMATION *info )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, SEMAPHORE_QUERY_STATE, FAST_SYNC_SEMAPHORE );
+
+    if (!sync) return STATUS_NOT_IMPLEMENTED;
+    info->CurrentCount = fast_sync_get_state( sync );
+    info->MaximumCount = sync->max;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, 0, FAST_SYNC_MUTEX );
+    thread_id_t tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    unsigned int state = tid, prev;
+
+    if (!sync) return STATUS_NOT_IMPLEMENTED;
+    if (fast_sync_get_state( sync ) != tid || !sync->count) return STATUS_MUTANT_NOT_OWNED;
+    prev = sync->count;
+    if (!--sync->count)
+    {
+        /* only the owner can change the state, the server may still lock it */
+        while (!fast_sync_set_state( sync, &state, 0 ));
+        fast_sync_wake( handle, sync );
+    }
+    if (prev_count) *prev_count = 1 - prev;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_query_mutex( HANDLE handle, MUTANT_BASIC_INFORMATION *info )
+{
+    struct fast_sync_slot *sync = get_fast_sync( handle, MUTANT_QUERY_STATE, FAST_SYNC_MUTEX );
+    thread_id_t tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    unsigned int owner;
+
+    if (!sync) return STATUS_NOT_IMPLEMENTED;
+    owner = fast_sync_get_state( sync );
+    info->CurrentCount   = owner ? 1 - sync->count : 1;
+    info->OwnedByCaller  = owner == tid;
+    info->AbandonedState = __atomic_load_n( &sync->abandoned, __ATOMIC_SEQ_CST );
+    return STATUS_SUCCESS;
+}
+
+#else  /* __linux__ */
+
+void init_fast_sync(void)
+{
+}
+
+static NTSTATUS fast_sync_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any, BOOLEAN alertable,
+                                const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_set_event( HANDLE handle, LONG *prev_state )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_reset_event( HANDLE handle, LONG *prev_state )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_query_event( HANDLE handle, EVENT_BASIC_INFORMATION *info )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_query_semaphore( HANDLE handle, SEMAPHORE_BASIC_INFORMATION *info )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_query_mutex( HANDLE handle, MUTANT_BASIC_INFORMATION *info )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
 
 /* create a struct security_descriptor and contained information in one contiguous piece of memory */
 unsigned int alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
@@ -333,6 +746,12 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 
     if (len != sizeof(SEMAPHORE_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((ret = fast_query_semaphore( handle, out )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!ret && ret_len) *ret_len = sizeof(SEMAPHORE_BASIC_INFORMATION);
+        return ret;
+    }
+
     SERVER_START_REQ( query_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -355,6 +774,8 @@ NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, ULONG *previous
 {
     unsigned int ret;
 
+    if ((ret = fast_release_semaphore( handle, count, previous )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -431,6 +852,8 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if ((ret = fast_set_event( handle, prev_state )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -450,6 +873,8 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if ((ret = fast_reset_event( handle, prev_state )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -510,6 +935,12 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 
     if (len != sizeof(EVENT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((ret = fast_query_event( handle, out )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!ret && ret_len) *ret_len = sizeof(EVENT_BASIC_INFORMATION);
+        return ret;
+    }
+
     SERVER_START_REQ( query_event )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -585,6 +1016,8 @@ NTSTATUS WINAPI NtReleaseMutant( HANDLE handle, LONG *prev_count )
 {
     unsigned int ret;
 
+    if ((ret = fast_release_mutex( handle, prev_count )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( release_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -615,6 +1048,12 @@ NTSTATUS WINAPI NtQueryMutant( HANDLE handle, MUTANT_INFORMATION_CLASS class,
 
     if (len != sizeof(MUTANT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((ret = fast_query_mutex( handle, out )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!ret && ret_len) *ret_len = sizeof(MUTANT_BASIC_INFORMATION);
+        return ret;
+    }
+
     SERVER_START_REQ( query_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1418,9 +1857,13 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    unsigned int ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if ((ret = fast_sync_wait( count, handles, wait_any, alertable, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1938,6 +2381,81 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE handle, IO_COMPLETION_INFORMATION_CL
 }
 
 
+/***********************************************************************
+ *             NtCreateWaitCompletionPacket (NTDLL.@)
+ */
+NTSTATUS WINAPI NtCreateWaitCompletionPacket( HANDLE *handle, ACCESS_MASK access, OBJECT_ATTRIBUTES *attr )
+{
+    unsigned int status;
+    data_size_t len;
+    struct object_attributes *objattr;
+
+    TRACE( "(%p, %x, %p)\n", handle, (int)access, attr );
+
+    *handle = 0;
+    if ((status = alloc_object_attributes( attr, &objattr, &len ))) return status;
+
+    SERVER_START_REQ( create_wait_completion_packet )
+    {
+        req->access = access;
+        wine_server_add_data( req, objattr, len );
+        if (!(status = wine_server_call( req ))) *handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    free( objattr );
+    return status;
+}
+
+
+/***********************************************************************
+ *             NtAssociateWaitCompletionPacket (NTDLL.@)
+ */
+NTSTATUS WINAPI NtAssociateWaitCompletionPacket( HANDLE packet, HANDLE completion, HANDLE target,
+                                                 void *key, void *value, NTSTATUS io_status,
+                                                 ULONG_PTR info, BOOLEAN *signaled )
+{
+    unsigned int status;
+
+    TRACE( "(%p, %p, %p, %p, %p, %x, %lx, %p)\n", packet, completion, target, key, value,
+           (int)io_status, info, signaled );
+
+    SERVER_START_REQ( associate_wait_completion_packet )
+    {
+        req->handle      = wine_server_obj_handle( packet );
+        req->chandle     = wine_server_obj_handle( completion );
+        req->target      = wine_server_obj_handle( target );
+        req->ckey        = wine_server_client_ptr( key );
+        req->cvalue      = wine_server_client_ptr( value );
+        req->information = info;
+        req->status      = io_status;
+        if (!(status = wine_server_call( req )) && signaled) *signaled = reply->signaled;
+    }
+    SERVER_END_REQ;
+    return status;
+}
+
+
+/***********************************************************************
+ *             NtCancelWaitCompletionPacket (NTDLL.@)
+ */
+NTSTATUS WINAPI NtCancelWaitCompletionPacket( HANDLE packet, BOOLEAN remove_signaled )
+{
+    unsigned int status;
+
+    TRACE( "(%p, %d)\n", packet, remove_signaled );
+
+    SERVER_START_REQ( cancel_wait_completion_packet )
+    {
+        req->handle          = wine_server_obj_handle( packet );
+        req->remove_signaled = remove_signaled;
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    return status;
+}
+
+
 /***********************************************************************
  *             NtCreateSection (NTDLL.@)
  */
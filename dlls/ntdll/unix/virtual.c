@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
@@ -36,6 +37,10 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #ifdef HAVE_SYS_SYSINFO_H
 # include <sys/sysinfo.h>
 #endif
@@ -122,6 +127,7 @@ struct file_view
 #define VPROT_WRITEWATCH 0x40
 /* per-mapping protection flags */
 #define VPROT_SYSTEM     0x0200  /* system view (underlying mmap not under our control) */
+#define VPROT_KERNELWATCH 0x0400 /* write watches tracked by the kernel instead of page faults */
 
 /* Conversion from VPROT_* to Win32 flags */
 static const BYTE VIRTUAL_Win32Flags[16] =
@@ -146,6 +152,8 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 
 static struct wine_rb_tree views_tree;
 static pthread_mutex_t virtual_mutex;
+static unsigned int virtual_seq;         /* odd while virtual_mutex is held */
+static unsigned int virtual_lock_depth;  /* recursion count of virtual_mutex */
 
 static const UINT page_shift = 12;
 static const UINT_PTR page_mask = 0xfff;
@@ -216,6 +224,40 @@ static struct range_entry *free_ranges;
 static struct range_entry *free_ranges_end;
 
 
+/* take virtual_mutex, blocking signals unless called from a signal handler; the sequence
+ * number tells the lock-free readers that the views may be changing */
+static void virtual_lock( sigset_t *sigset )
+{
+    if (sigset) server_enter_uninterrupted_section( &virtual_mutex, sigset );
+    else mutex_lock( &virtual_mutex );
+    if (!virtual_lock_depth++)
+    {
+        __atomic_store_n( &virtual_seq, virtual_seq + 1, __ATOMIC_RELAXED );
+        __atomic_thread_fence( __ATOMIC_RELEASE );
+    }
+}
+
+static void virtual_unlock( sigset_t *sigset )
+{
+    if (!--virtual_lock_depth) __atomic_store_n( &virtual_seq, virtual_seq + 1, __ATOMIC_RELEASE );
+    if (sigset) server_leave_uninterrupted_section( &virtual_mutex, sigset );
+    else mutex_unlock( &virtual_mutex );
+}
+
+/* start a lock-free read of the views, return FALSE if they are being changed */
+static inline BOOL virtual_read_begin( unsigned int *seq )
+{
+    *seq = __atomic_load_n( &virtual_seq, __ATOMIC_ACQUIRE );
+    return !(*seq & 1);
+}
+
+/* check that the views didn't change during a lock-free read */
+static inline BOOL virtual_read_end( unsigned int seq )
+{
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return __atomic_load_n( &virtual_seq, __ATOMIC_RELAXED ) == seq;
+}
+
 static inline BOOL is_beyond_limit( const void *addr, size_t size, const void *limit )
 {
     return (addr >= limit || (const char *)addr + size > (const char *)limit);
@@ -622,7 +664,7 @@ void *get_builtin_so_handle( void *module )
     void *ret = NULL;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -630,7 +672,7 @@ void *get_builtin_so_handle( void *module )
         if (ret) builtin->refcount++;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -655,7 +697,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, const void **fun
         return STATUS_SUCCESS;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -678,7 +720,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, const void **fun
         }
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -692,7 +734,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
     NTSTATUS status = STATUS_SUCCESS;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -700,7 +742,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
         else status = STATUS_IMAGE_ALREADY_LOADED;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -1117,12 +1159,12 @@ static void VIRTUAL_Dump(void)
     struct file_view *view;
 
     TRACE( "Dump of all virtual memory views:\n" );
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
     {
         dump_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 }
 #endif
 
@@ -1788,6 +1830,224 @@ static void reset_write_watches( void *base, SIZE_T size )
 }
 
 
+#ifndef HAVE_LIBPROCSTAT
+
+static int pagemap_fd = -2;
+
+/***********************************************************************
+ *           get_pagemap_fd
+ *
+ * Open /proc/self/pagemap on first use.
+ * virtual_mutex must be held by caller.
+ */
+static int get_pagemap_fd(void)
+{
+    if (pagemap_fd == -2)
+    {
+#ifdef O_CLOEXEC
+        if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC, 0 )) == -1 && errno == EINVAL)
+#endif
+            pagemap_fd = open( "/proc/self/pagemap", O_RDONLY, 0 );
+
+        if (pagemap_fd == -1) WARN( "unable to open /proc/self/pagemap\n" );
+        else fcntl(pagemap_fd, F_SETFD, FD_CLOEXEC);  /* in case O_CLOEXEC isn't supported */
+    }
+    return pagemap_fd;
+}
+
+#endif
+
+
+#if defined(__linux__) && defined(__NR_userfaultfd)
+
+/* Write watches can be tracked with asynchronous userfaultfd write protection: writes
+ * to protected pages are resolved by the kernel without a signal, and PAGEMAP_SCAN
+ * reports and protects again the written pages. */
+
+#define UFFD_API_VERSION             0xaa
+#define UFFD_USER_MODE_ONLY_FLAG     1
+#define UFFD_FEATURE_WP_UNPOPULATED_ (1 << 13)
+#define UFFD_FEATURE_WP_ASYNC_       (1 << 15)
+#define UFFD_REGISTER_MODE_WP        (1 << 1)
+#define UFFD_WRITEPROTECT_MODE_WP    (1 << 0)
+#define PM_SCAN_WP_MATCHING_         (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC_       (1 << 1)
+#define PM_PAGE_IS_WRITTEN           (1 << 1)
+
+struct uffd_range { ULONG64 start, len; };
+struct uffd_api_arg { ULONG64 api, features, ioctls; };
+struct uffd_register_arg { struct uffd_range range; ULONG64 mode, ioctls; };
+struct uffd_writeprotect_arg { struct uffd_range range; ULONG64 mode; };
+
+struct pm_scan_region { ULONG64 start, end, categories; };
+struct pm_scan_args
+{
+    ULONG64 size, flags, start, end, walk_end, vec, vec_len, max_pages;
+    ULONG64 category_inverted, category_mask, category_anyof_mask, return_mask;
+};
+
+#define UFFD_IOC_API          _IOWR( 0xaa, 0x3f, struct uffd_api_arg )
+#define UFFD_IOC_REGISTER     _IOWR( 0xaa, 0x00, struct uffd_register_arg )
+#define UFFD_IOC_UNREGISTER   _IOR( 0xaa, 0x01, struct uffd_range )
+#define UFFD_IOC_WRITEPROTECT _IOWR( 0xaa, 0x06, struct uffd_writeprotect_arg )
+#define PM_IOC_SCAN           _IOWR( 'f', 16, struct pm_scan_args )
+
+static int uffd_fd = -1;
+
+static void init_kernel_write_watches(void)
+{
+    struct uffd_api_arg api = { UFFD_API_VERSION, UFFD_FEATURE_WP_ASYNC_ | UFFD_FEATURE_WP_UNPOPULATED_ };
+    struct pm_scan_args args;
+    int fd;
+
+    if ((fd = syscall( __NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY_FLAG )) == -1) return;
+    if (ioctl( fd, UFFD_IOC_API, &api )) goto failed;
+    if (get_pagemap_fd() == -1) goto failed;
+
+    /* an empty scan checks for PAGEMAP_SCAN support */
+    memset( &args, 0, sizeof(args) );
+    args.size = sizeof(args);
+    if (ioctl( pagemap_fd, PM_IOC_SCAN, &args ) == -1) goto failed;
+    TRACE( "using kernel write watches\n" );
+    uffd_fd = fd;
+    return;
+
+failed:
+    close( fd );
+}
+
+/* register a new mapping for kernel write watches; all its pages start out unwritten */
+static BOOL add_kernel_write_watches( void *base, size_t size )
+{
+    struct uffd_register_arg reg = { { (UINT_PTR)base, size }, UFFD_REGISTER_MODE_WP };
+    struct uffd_writeprotect_arg wp = { { (UINT_PTR)base, size }, UFFD_WRITEPROTECT_MODE_WP };
+
+    if (uffd_fd == -1) return FALSE;
+    if (ioctl( uffd_fd, UFFD_IOC_REGISTER, &reg ) || ioctl( uffd_fd, UFFD_IOC_WRITEPROTECT, &wp ))
+    {
+        WARN( "failed to register %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* stop tracking the writes to a mapping in the kernel */
+static void remove_kernel_write_watches( void *base, size_t size )
+{
+    struct uffd_range range = { (UINT_PTR)base, size };
+
+    if (ioctl( uffd_fd, UFFD_IOC_UNREGISTER, &range ))
+        WARN( "failed to unregister %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+}
+
+/* retrieve the written pages, optionally protecting them again; returns the number of addresses */
+static ULONG_PTR get_kernel_write_watches( void *base, size_t size, PVOID *addresses, ULONG_PTR count,
+                                           BOOL reset )
+{
+    struct pm_scan_region regions[64];
+    struct pm_scan_args args;
+    ULONG_PTR pos = 0;
+    ULONG64 addr;
+    int i, ret;
+
+    memset( &args, 0, sizeof(args) );
+    args.size          = sizeof(args);
+    args.flags         = reset ? PM_SCAN_WP_MATCHING_ | PM_SCAN_CHECK_WPASYNC_ : 0;
+    args.start         = (UINT_PTR)base;
+    args.end           = (UINT_PTR)base + size;
+    args.category_mask = PM_PAGE_IS_WRITTEN;
+    args.return_mask   = PM_PAGE_IS_WRITTEN;
+    if (addresses)
+    {
+        args.vec     = (UINT_PTR)regions;
+        args.vec_len = ARRAY_SIZE(regions);
+    }
+
+    while (args.start < args.end && (!addresses || pos < count))
+    {
+        if (addresses) args.max_pages = count - pos;
+        if ((ret = ioctl( pagemap_fd, PM_IOC_SCAN, &args )) == -1)
+        {
+            ERR( "scan failed for %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+            break;
+        }
+        for (i = 0; i < ret; i++)
+            for (addr = regions[i].start; addr < regions[i].end; addr += page_size)
+                addresses[pos++] = (void *)(UINT_PTR)addr;
+        args.start = args.walk_end;
+    }
+    return pos;
+}
+
+#else
+
+static void init_kernel_write_watches(void)
+{
+}
+
+static BOOL add_kernel_write_watches( void *base, size_t size )
+{
+    return FALSE;
+}
+
+static void remove_kernel_write_watches( void *base, size_t size )
+{
+}
+
+static ULONG_PTR get_kernel_write_watches( void *base, size_t size, PVOID *addresses, ULONG_PTR count,
+                                           BOOL reset )
+{
+    return 0;
+}
+
+#endif
+
+
+/***********************************************************************
+ *           enable_kernel_write_watches
+ *
+ * Switch a new write watch view to kernel tracking if possible.
+ * virtual_mutex must be held by caller.
+ */
+static void enable_kernel_write_watches( struct file_view *view )
+{
+    if (!add_kernel_write_watches( view->base, view->size )) return;
+    view->protect |= VPROT_KERNELWATCH;
+    /* the pages no longer need to fault on write */
+    set_page_vprot_bits( view->base, view->size, 0, VPROT_WRITEWATCH );
+    mprotect_range( view->base, view->size, 0, 0 );
+}
+
+
+/***********************************************************************
+ *           disable_kernel_write_watches
+ *
+ * Switch a view back to fault-based write watches, before its pages get discarded.
+ * Discarding the pages would lose the written state kept by the kernel.
+ * virtual_mutex must be held by caller.
+ */
+static void disable_kernel_write_watches( struct file_view *view )
+{
+    PVOID addresses[256];
+    char *addr = view->base, *end = addr + view->size;
+    ULONG_PTR i, count;
+
+    if (!(view->protect & VPROT_KERNELWATCH)) return;
+
+    /* copy the written state into the page protections */
+    set_page_vprot_bits( view->base, view->size, VPROT_WRITEWATCH, 0 );
+    while (addr < end &&
+           (count = get_kernel_write_watches( addr, end - addr, addresses, ARRAY_SIZE(addresses), FALSE )))
+    {
+        for (i = 0; i < count; i++) set_page_vprot_bits( addresses[i], page_size, 0, VPROT_WRITEWATCH );
+        addr = (char *)addresses[count - 1] + page_size;
+    }
+    remove_kernel_write_watches( view->base, view->size );
+    view->protect &= ~VPROT_KERNELWATCH;
+    mprotect_range( view->base, view->size, 0, 0 );
+}
+
+
 /***********************************************************************
  *           unmap_extra_space
  *
@@ -2099,6 +2359,7 @@ static SIZE_T get_committed_size( struct file_view *view, void *base, BYTE *vpro
 static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t size )
 {
     if (!size) size = view->size;
+    disable_kernel_write_watches( view );
     if (anon_mmap_fixed( (char *)view->base + start, size, PROT_NONE, 0 ) != MAP_FAILED)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
@@ -2196,22 +2457,499 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
 }
 
 
+/***********************************************************************
+ *           get_section_file_range
+ *
+ * Get the range of the file data of a section, and the size of its mapping.
+ */
+static void get_section_file_range( const IMAGE_SECTION_HEADER *sec, SIZE_T *file_start,
+                                    SIZE_T *file_size, SIZE_T *map_size )
+{
+    static const SIZE_T sector_align = 0x1ff;
+
+    if (!sec->Misc.VirtualSize)
+        *map_size = ROUND_SIZE( 0, sec->SizeOfRawData );
+    else
+        *map_size = ROUND_SIZE( 0, sec->Misc.VirtualSize );
+
+    /* file positions are rounded to sector boundaries regardless of OptionalHeader.FileAlignment */
+    *file_start = sec->PointerToRawData & ~sector_align;
+    *file_size = (sec->SizeOfRawData + (sec->PointerToRawData & sector_align) + sector_align) & ~sector_align;
+    if (*file_size > *map_size) *file_size = *map_size;
+}
+
+
+/***********************************************************************
+ *           is_unaligned_section
+ *
+ * Check if the file data of a section can't be mapped directly because it isn't page-aligned.
+ */
+static BOOL is_unaligned_section( const IMAGE_SECTION_HEADER *sec )
+{
+    SIZE_T file_start, file_size, map_size;
+
+    if ((sec->Characteristics & IMAGE_SCN_MEM_SHARED) && (sec->Characteristics & IMAGE_SCN_MEM_WRITE))
+        return FALSE;
+    get_section_file_range( sec, &file_start, &file_size, &map_size );
+    return sec->PointerToRawData && file_size && (file_start & page_mask);
+}
+
+
+/***********************************************************************
+ *           create_aligned_image
+ *
+ * Copy the file data of the unaligned sections to their virtual address in a new file.
+ */
+static BOOL create_aligned_image( int fd, int dst, const IMAGE_SECTION_HEADER *sections,
+                                  unsigned int count, SIZE_T total_size )
+{
+    SIZE_T file_start, file_size, map_size, pos;
+    char *buffer;
+    ssize_t ret;
+    unsigned int i;
+    BOOL success = FALSE;
+
+    if (ftruncate( dst, total_size ) == -1) return FALSE;
+    if (!(buffer = malloc( 0x10000 ))) return FALSE;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!is_unaligned_section( &sections[i] )) continue;
+        get_section_file_range( &sections[i], &file_start, &file_size, &map_size );
+        if (sections[i].VirtualAddress > total_size || file_size > total_size - sections[i].VirtualAddress)
+            continue;  /* rejected by map_image_into_view */
+
+        for (pos = 0; pos < file_size; pos += ret)
+        {
+            if ((ret = pread( fd, buffer, min( file_size - pos, 0x10000 ), file_start + pos )) == -1) goto done;
+            if (!ret) break;  /* the rest of the section is past the end of file */
+            if (pwrite( dst, buffer, ret, sections[i].VirtualAddress + pos ) != ret) goto done;
+        }
+    }
+    success = TRUE;
+done:
+    free( buffer );
+    return success;
+}
+
+
+/* stored at the end of cached image files, after the data mapped into the view */
+struct image_cache_header
+{
+    char      magic[8];
+    ULONGLONG dev;
+    ULONGLONG ino;
+    ULONGLONG size;
+    ULONGLONG mtime;
+    ULONGLONG mtime_nsec;
+    ULONGLONG total_size;
+    ULONGLONG base;        /* address of relocated copies, 0 for aligned copies */
+};
+
+static const char image_cache_magic[8] = "WineImg1";
+
+static long get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static void init_image_cache_header( struct image_cache_header *header, const struct stat *st,
+                                     const void *base, SIZE_T total_size )
+{
+    memset( header, 0, sizeof(*header) );
+    memcpy( header->magic, image_cache_magic, sizeof(header->magic) );
+    header->dev        = st->st_dev;
+    header->ino        = st->st_ino;
+    header->size       = st->st_size;
+    header->mtime      = st->st_mtime;
+    header->mtime_nsec = get_mtime_nsec( st );
+    header->total_size = total_size;
+    header->base       = (ULONG_PTR)base;
+}
+
+
+/***********************************************************************
+ *           write_image_cache_header
+ */
+static BOOL write_image_cache_header( int fd, const struct stat *st, const void *base, SIZE_T total_size )
+{
+    struct image_cache_header header;
+
+    init_image_cache_header( &header, st, base, total_size );
+    return pwrite( fd, &header, sizeof(header), total_size ) == sizeof(header);
+}
+
+
+/***********************************************************************
+ *           open_image_cache_file
+ *
+ * Open a cached copy of an image file, and check that it is complete and made for that file.
+ */
+static int open_image_cache_file( const char *path, const struct stat *st, const void *base, SIZE_T total_size )
+{
+    struct image_cache_header header, expect;
+    struct stat cache_st;
+    int fd;
+
+    if ((fd = open( path, O_RDONLY | O_CLOEXEC )) == -1) return -1;
+    init_image_cache_header( &expect, st, base, total_size );
+    if (!fstat( fd, &cache_st ) && cache_st.st_size == total_size + sizeof(header) &&
+        pread( fd, &header, sizeof(header), total_size ) == sizeof(header) &&
+        !memcmp( &header, &expect, sizeof(header) ))
+        return fd;
+
+    WARN_(module)( "ignoring invalid %s\n", debugstr_a(path) );
+    close( fd );
+    return -1;
+}
+
+
+/***********************************************************************
+ *           get_image_cache_path
+ *
+ * Get the path of the cached copy of an image file, keyed by the identity and modification
+ * time of the file, and by the address for relocated copies. Returns NULL if the cache is disabled.
+ */
+static char *get_image_cache_path( const struct stat *st, const void *base )
+{
+    static int enabled = -1;
+    char *path, *end;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEIMAGECACHE" );
+        enabled = env && atoi( env );
+    }
+    if (!enabled) return NULL;
+
+    if (!(path = malloc( strlen( config_dir ) + sizeof("/image-cache/") + 6 * 16 + 32 ))) return NULL;
+    end = path + sprintf( path, "%s/image-cache", config_dir );
+    mkdir( path, 0777 );
+    end += sprintf( end, "/%llx-%llx-%llx-%llx-%lx", (unsigned long long)st->st_dev,
+                    (unsigned long long)st->st_ino, (unsigned long long)st->st_size,
+                    (unsigned long long)st->st_mtime, get_mtime_nsec( st ));
+    if (base) sprintf( end, "@%lx", (unsigned long)(ULONG_PTR)base );
+    return path;
+}
+
+
+/***********************************************************************
+ *           create_image_cache_file
+ *
+ * Create a cache file under a temporary name, other processes may be doing the same.
+ */
+static int create_image_cache_file( const char *path, char **tmp )
+{
+    int fd;
+
+    if (!(*tmp = malloc( strlen( path ) + 10 ))) return -1;
+    sprintf( *tmp, "%s.%x", path, getpid() );
+    unlink( *tmp );  /* left over by a crashed process */
+    if ((fd = open( *tmp, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666 )) == -1)
+    {
+        free( *tmp );
+        *tmp = NULL;
+    }
+    return fd;
+}
+
+
+/***********************************************************************
+ *           finish_image_cache_file
+ *
+ * Move a complete cache file into place, or get rid of it. The data is flushed before
+ * the rename and the directory after it, so that a crash can't leave a partial file.
+ */
+static int finish_image_cache_file( const char *path, char *tmp, int fd, BOOL success )
+{
+    char *dir;
+    int dir_fd;
+
+    if (success && !fsync( fd ) && !rename( tmp, path ))
+    {
+        TRACE_(module)( "created %s\n", debugstr_a(path) );
+        if ((dir = strdup( path )))
+        {
+            *strrchr( dir, '/' ) = 0;
+            if ((dir_fd = open( dir, O_RDONLY | O_CLOEXEC )) != -1)
+            {
+                fsync( dir_fd );
+                close( dir_fd );
+            }
+            free( dir );
+        }
+    }
+    else
+    {
+        WARN_(module)( "failed to create %s\n", debugstr_a(path) );
+        unlink( tmp );
+        close( fd );
+        fd = -1;
+    }
+    free( tmp );
+    return fd;
+}
+
+
+/***********************************************************************
+ *           open_aligned_image
+ *
+ * Open a copy of an image file where the unaligned sections are stored at their
+ * virtual address, so that they can be mapped instead of read into private memory.
+ */
+static int open_aligned_image( int fd, const struct stat *st, const IMAGE_SECTION_HEADER *sections,
+                               unsigned int count, SIZE_T total_size )
+{
+    char *path, *tmp;
+    int ret;
+
+    if (!(path = get_image_cache_path( st, NULL ))) return -1;
+    if ((ret = open_image_cache_file( path, st, NULL, total_size )) != -1)
+        TRACE_(module)( "using %s\n", debugstr_a(path) );
+    else if ((ret = create_image_cache_file( path, &tmp )) != -1)
+        ret = finish_image_cache_file( path, tmp, ret,
+                                       create_aligned_image( fd, ret, sections, count, total_size ) &&
+                                       write_image_cache_header( ret, st, NULL, total_size ));
+    free( path );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           get_relocation_dir
+ *
+ * Get the relocations of a dll that the loader will need to apply when mapped at base.
+ */
+static IMAGE_DATA_DIRECTORY *get_relocation_dir( IMAGE_NT_HEADERS *nt, void *base, ULONG_PTR *image_base )
+{
+    IMAGE_NT_HEADERS32 *nt32 = (IMAGE_NT_HEADERS32 *)nt;
+    IMAGE_NT_HEADERS64 *nt64 = (IMAGE_NT_HEADERS64 *)nt;
+    IMAGE_DATA_DIRECTORY *dir;
+
+    /* same conditions as in perform_relocations() */
+    if (!(nt->FileHeader.Characteristics & IMAGE_FILE_DLL)) return NULL;
+    if (nt->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED) return NULL;
+    if (nt->OptionalHeader.SectionAlignment < page_size) return NULL;
+
+    switch (nt->OptionalHeader.Magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        if (nt32->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return NULL;
+        *image_base = nt32->OptionalHeader.ImageBase;
+        dir = &nt32->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        if (nt64->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return NULL;
+        *image_base = nt64->OptionalHeader.ImageBase;
+        dir = &nt64->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        break;
+    default:
+        return NULL;
+    }
+    if (*image_base == (ULONG_PTR)base || !dir->Size || !dir->VirtualAddress) return NULL;
+    return dir;
+}
+
+
+/***********************************************************************
+ *           relocate_image
+ *
+ * Apply the relocations of a dll at map time, and update its base address in the header
+ * so that the loader doesn't apply them again.
+ */
+static BOOL relocate_image( char *ptr, SIZE_T total_size, IMAGE_NT_HEADERS *nt,
+                            const IMAGE_DATA_DIRECTORY *dir, ULONG_PTR image_base )
+{
+    const IMAGE_BASE_RELOCATION *rel, *end;
+    const USHORT *relocs;
+    UINT i, count, offset, size;
+
+    if (dir->VirtualAddress > total_size || dir->Size > total_size - dir->VirtualAddress) return FALSE;
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress);
+    end = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress + dir->Size);
+
+    /* check everything first, if anything is unexpected the loader deals with it as usual */
+    while (rel < end - 1 && rel->SizeOfBlock)
+    {
+        if (rel->SizeOfBlock < sizeof(*rel) || rel->SizeOfBlock > (char *)end - (char *)rel) return FALSE;
+        if (rel->VirtualAddress >= total_size) return FALSE;
+        count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+        relocs = (const USHORT *)(rel + 1);
+        for (i = 0; i < count; i++)
+        {
+            switch (relocs[i] >> 12)
+            {
+            case IMAGE_REL_BASED_ABSOLUTE:    size = 0; break;
+            case IMAGE_REL_BASED_HIGH:
+            case IMAGE_REL_BASED_LOW:         size = sizeof(short); break;
+            case IMAGE_REL_BASED_HIGHLOW:     size = sizeof(int); break;
+            case IMAGE_REL_BASED_DIR64:
+            case IMAGE_REL_BASED_THUMB_MOV32: size = sizeof(INT64); break;
+            default: return FALSE;
+            }
+            offset = relocs[i] & 0xfff;
+            if (offset + size > total_size - rel->VirtualAddress) return FALSE;
+        }
+        rel = (const IMAGE_BASE_RELOCATION *)(relocs + count);
+    }
+
+    TRACE_(module)( "relocating %p-%p from %p\n", ptr, ptr + total_size, (void *)image_base );
+
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress);
+    while (rel < end - 1 && rel->SizeOfBlock)
+        rel = process_relocation_block( ptr, rel, ptr - (char *)image_base );
+
+    if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+        ((IMAGE_NT_HEADERS64 *)nt)->OptionalHeader.ImageBase = (ULONG_PTR)ptr;
+    else
+        ((IMAGE_NT_HEADERS32 *)nt)->OptionalHeader.ImageBase = PtrToUlong( ptr );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           is_relocated_image
+ *
+ * Check that the headers of a cached relocated image are based at the address it is mapped at.
+ */
+static BOOL is_relocated_image( const char *ptr, SIZE_T header_size )
+{
+    const IMAGE_DOS_HEADER *dos = (const IMAGE_DOS_HEADER *)ptr;
+    const IMAGE_NT_HEADERS32 *nt32;
+    const IMAGE_NT_HEADERS64 *nt64;
+
+    if (dos->e_magic != IMAGE_DOS_SIGNATURE) return FALSE;
+    if (dos->e_lfanew + sizeof(*nt32) > header_size) return FALSE;
+    nt32 = (const IMAGE_NT_HEADERS32 *)(ptr + dos->e_lfanew);
+    nt64 = (const IMAGE_NT_HEADERS64 *)(ptr + dos->e_lfanew);
+    if (nt32->Signature != IMAGE_NT_SIGNATURE) return FALSE;
+
+    switch (nt32->OptionalHeader.Magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        return nt32->OptionalHeader.ImageBase == PtrToUlong( ptr );
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        if (dos->e_lfanew + sizeof(*nt64) > header_size) return FALSE;
+        return nt64->OptionalHeader.ImageBase == (ULONG_PTR)ptr;
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           evict_relocated_images
+ *
+ * Remove the cached copies of older versions of an image file, and the relocated
+ * copies of the current one when there are too many of them.
+ */
+static void evict_relocated_images( const char *path )
+{
+    static const unsigned int max_copies = 4;
+    const char *name = strrchr( path, '/' ) + 1, *key_end = strchr( name, '@' ), *p;
+    unsigned int copies = 0;
+    size_t prefix_len, key_len = key_end - name;
+    struct dirent *de;
+    char *dir, *file;
+    DIR *unix_dir;
+    BOOL stale;
+    int pass;
+
+    /* the name starts with the device and inode numbers, followed by the size and time */
+    if (!(p = strchr( name, '-' )) || !(p = strchr( p + 1, '-' ))) return;
+    prefix_len = p + 1 - name;
+
+    if (!(dir = malloc( strlen( path ) + 256 ))) return;
+    memcpy( dir, path, name - path );
+    file = dir + (name - path);
+    file[-1] = 0;
+    if (!(unix_dir = opendir( dir )))
+    {
+        free( dir );
+        return;
+    }
+    file[-1] = '/';
+
+    for (pass = 0; pass < 2; pass++)
+    {
+        while ((de = readdir( unix_dir )))
+        {
+            if (strncmp( de->d_name, name, prefix_len ) || strchr( de->d_name, '.' )) continue;
+            if (strlen( de->d_name ) >= 256 || !strcmp( de->d_name, name )) continue;
+            stale = strncmp( de->d_name, name, key_len ) || (de->d_name[key_len] && de->d_name[key_len] != '@');
+            if (!stale && de->d_name[key_len] != '@') continue;  /* the aligned copy */
+            if (!pass)
+            {
+                if (!stale) copies++;
+                continue;
+            }
+            if (!stale && copies < max_copies) continue;
+            strcpy( file, de->d_name );
+            TRACE_(module)( "removing %s\n", debugstr_a(dir) );
+            unlink( dir );
+        }
+        rewinddir( unix_dir );
+    }
+    closedir( unix_dir );
+    free( dir );
+}
+
+
+/***********************************************************************
+ *           save_relocated_image
+ *
+ * Store a relocated image in the cache. Called without holding virtual_mutex, the
+ * view is the one returned to the caller which can't have unmapped it yet.
+ */
+static void save_relocated_image( const char *path, int image_fd, const char *ptr, SIZE_T total_size )
+{
+    struct stat st;
+    SIZE_T pos;
+    ssize_t ret;
+    BOOL success = TRUE;
+    char *tmp;
+    int fd;
+
+    if (fstat( image_fd, &st )) return;
+    evict_relocated_images( path );
+    if ((fd = create_image_cache_file( path, &tmp )) == -1) return;
+    /* pages that can't be read make the write fail instead of faulting */
+    for (pos = 0; success && pos < total_size; pos += ret)
+    {
+        while ((ret = pwrite( fd, ptr + pos, total_size - pos, pos )) == -1 && errno == EINTR);
+        success = ret > 0;
+    }
+    success = success && write_image_cache_header( fd, &st, ptr, total_size );
+    if ((fd = finish_image_cache_file( path, tmp, fd, success )) != -1) close( fd );
+}
+
+
 /***********************************************************************
  *           map_image_into_view
  *
  * Map an executable (PE format) image into an existing view.
  * virtual_mutex must be held by caller.
+ * If the image got relocated, save_path is set to the cache file to store it in
+ * once the mutex has been released.
  */
 static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filename, int fd, void *orig_base,
-                                     SIZE_T header_size, ULONG image_flags, int shared_fd, BOOL removable )
+                                     SIZE_T header_size, ULONG image_flags, int shared_fd, BOOL removable,
+                                     char **save_path )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
     IMAGE_SECTION_HEADER sections[96];
     IMAGE_SECTION_HEADER *sec;
-    IMAGE_DATA_DIRECTORY *imports;
+    IMAGE_DATA_DIRECTORY *imports, *relocs = NULL;
     NTSTATUS status = STATUS_CONFLICTING_ADDRESSES;
-    int i;
+    int i, aligned_fd = -1, relocated_fd = -1;
+    ULONG_PTR image_base = 0;
+    char *relocated_path = NULL;
     off_t pos;
     struct stat st;
     char *header_end, *header_start;
@@ -2270,22 +3008,51 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
     }
 
 
+    /* dlls loaded away from their preferred base are mapped from a relocated copy if possible */
+
+    if (!removable && (relocs = get_relocation_dir( nt, ptr, &image_base )))
+    {
+        for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
+            if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) && (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE))
+                break;
+        if (i == nt->FileHeader.NumberOfSections && (relocated_path = get_image_cache_path( &st, ptr )) &&
+            (relocated_fd = open_image_cache_file( relocated_path, &st, ptr, total_size )) != -1)
+        {
+            if (!map_file_into_view( view, relocated_fd, 0, total_size, 0,
+                                     VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) &&
+                is_relocated_image( ptr, header_size ))
+            {
+                TRACE_(module)( "using %s\n", debugstr_a(relocated_path) );
+                goto set_protections;
+            }
+            /* the header may have been mapped over */
+            if ((status = map_pe_header( view->base, header_size, fd, &removable ))) goto done;
+            memset( ptr + header_size, 0, header_end - (ptr + header_size) );
+            status = STATUS_INVALID_IMAGE_FORMAT;
+        }
+    }
+
+    /* sections that aren't page-aligned in the file are mapped from an aligned copy if possible */
+
+    if (!removable)
+    {
+        for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
+            if (is_unaligned_section( &sections[i] )) break;
+        if (i < nt->FileHeader.NumberOfSections)
+            aligned_fd = open_aligned_image( fd, &st, sections, nt->FileHeader.NumberOfSections, total_size );
+    }
+
     /* map all the sections */
 
     for (i = pos = 0; i < nt->FileHeader.NumberOfSections; i++, sec++)
     {
         static const SIZE_T sector_align = 0x1ff;
         SIZE_T map_size, file_start, file_size, end;
+        int map_fd = fd;
+        off_t map_offset;
 
-        if (!sec->Misc.VirtualSize)
-            map_size = ROUND_SIZE( 0, sec->SizeOfRawData );
-        else
-            map_size = ROUND_SIZE( 0, sec->Misc.VirtualSize );
-
-        /* file positions are rounded to sector boundaries regardless of OptionalHeader.FileAlignment */
-        file_start = sec->PointerToRawData & ~sector_align;
-        file_size = (sec->SizeOfRawData + (sec->PointerToRawData & sector_align) + sector_align) & ~sector_align;
-        if (file_size > map_size) file_size = map_size;
+        get_section_file_range( sec, &file_start, &file_size, &map_size );
+        map_offset = file_start;
 
         /* a few sanity checks */
         end = sec->VirtualAddress + ROUND_SIZE( sec->VirtualAddress, map_size );
@@ -2293,7 +3060,7 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         {
             WARN_(module)( "%s section %.8s too large (%x+%lx/%lx)\n",
                            debugstr_w(filename), sec->Name, (int)sec->VirtualAddress, map_size, total_size );
-            return status;
+            goto done;
         }
 
         if ((sec->Characteristics & IMAGE_SCN_MEM_SHARED) &&
@@ -2307,7 +3074,7 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
                                     VPROT_COMMITTED | VPROT_READ | VPROT_WRITE, FALSE ) != STATUS_SUCCESS)
             {
                 ERR_(module)( "Could not map %s shared section %.8s\n", debugstr_w(filename), sec->Name );
-                return status;
+                goto done;
             }
 
             /* check if the import directory falls inside this section */
@@ -2333,6 +3100,12 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
 
         if (!sec->PointerToRawData || !file_size) continue;
 
+        if (aligned_fd != -1 && (file_start & page_mask))
+        {
+            map_fd = aligned_fd;
+            map_offset = sec->VirtualAddress;
+        }
+
         /* Note: if the section is not aligned properly map_file_into_view will magically
          *       fall back to read(), so we don't need to check anything here.
          */
@@ -2340,13 +3113,13 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         if (sec->PointerToRawData >= st.st_size ||
             end > ((st.st_size + sector_align) & ~sector_align) ||
             end < file_start ||
-            map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
+            map_file_into_view( view, map_fd, sec->VirtualAddress, file_size, map_offset,
                                 VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
                                 removable ) != STATUS_SUCCESS)
         {
             ERR_(module)( "Could not map %s section %.8s, file probably truncated\n",
                           debugstr_w(filename), sec->Name );
-            return status;
+            goto done;
         }
 
         if (file_size & page_mask)
@@ -2360,6 +3133,13 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         }
     }
 
+    if (relocated_path && relocate_image( ptr, total_size, nt, relocs, image_base ))
+    {
+        *save_path = relocated_path;
+        relocated_path = NULL;
+    }
+
+set_protections:
     /* set the image protections */
 
     set_vprot( view, ptr, ROUND_SIZE( 0, header_size ), VPROT_COMMITTED | VPROT_READ );
@@ -2387,7 +3167,13 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
 #ifdef VALGRIND_LOAD_PDB_DEBUGINFO
     VALGRIND_LOAD_PDB_DEBUGINFO(fd, ptr, total_size, ptr - (char *)orig_base);
 #endif
-    return STATUS_SUCCESS;
+    status = STATUS_SUCCESS;
+
+done:
+    if (aligned_fd != -1) close( aligned_fd );
+    if (relocated_fd != -1) close( relocated_fd );
+    free( relocated_path );
+    return status;
 }
 
 
@@ -2453,6 +3239,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     int shared_fd = -1, shared_needs_close = 0;
     SIZE_T size = image_info->map_size;
     struct file_view *view;
+    char *save_path = NULL;
     unsigned int status;
     sigset_t sigset;
     void *base;
@@ -2468,7 +3255,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     }
 
     status = STATUS_INVALID_PARAMETER;
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     base = wine_server_get_ptr( image_info->base );
     if ((ULONG_PTR)base != image_info->base) base = NULL;
@@ -2480,7 +3267,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     if (status) goto done;
 
     status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
-                                  image_info->image_flags, shared_fd, needs_close );
+                                  image_info->image_flags, shared_fd, needs_close, &save_path );
     if (status == STATUS_SUCCESS)
     {
         SERVER_START_REQ( map_view )
@@ -2503,7 +3290,12 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
+    if (save_path)
+    {
+        if (NT_SUCCESS(status)) save_relocated_image( save_path, unix_fd, *addr_ptr, size );
+        free( save_path );
+    }
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
     return status;
@@ -2597,7 +3389,7 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
 
     if ((res = server_get_unix_fd( handle, 0, &unix_handle, &needs_close, NULL, NULL ))) return res;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     res = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, get_zero_bits_mask( zero_bits ), 0 );
     if (res) goto done;
@@ -2628,7 +3420,7 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     if (needs_close) close( unix_handle );
     return res;
 }
@@ -2727,6 +3519,8 @@ void virtual_init(void)
     size = (char *)address_space_start - (char *)0x10000;
     if (size && mmap_is_in_reserved_area( (void*)0x10000, size ) == 1)
         anon_mmap_fixed( (void *)0x10000, size, PROT_READ | PROT_WRITE, 0 );
+
+    init_kernel_write_watches();
 }
 
 
@@ -2843,7 +3637,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
     void *base = wine_server_get_ptr( info->base );
     int i;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     status = create_view( &view, base, size, SEC_IMAGE | SEC_FILE | VPROT_SYSTEM |
                           VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY | VPROT_EXEC );
     if (!status)
@@ -2882,7 +3676,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
         }
         else delete_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     return status;
 }
@@ -2993,7 +3787,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
     SIZE_T block_size = signal_stack_mask + 1;
     BOOL is_wow = !!NtCurrentTeb()->WowTebOffset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (next_free_teb)
     {
         ptr = next_free_teb;
@@ -3009,7 +3803,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
             if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, is_win64 && is_wow ? 0x7fffffff : 0,
                                                    &total, MEM_RESERVE, PAGE_READWRITE )))
             {
-                server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                virtual_unlock( &sigset );
                 return status;
             }
             teb_block = ptr;
@@ -3020,14 +3814,14 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
                                  MEM_COMMIT, PAGE_READWRITE );
     }
     *ret_teb = teb = init_teb( ptr, is_wow );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     if ((status = signal_alloc_thread( teb )))
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         *(void **)ptr = next_free_teb;
         next_free_teb = ptr;
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
     }
     return status;
 }
@@ -3061,13 +3855,13 @@ void virtual_free_teb( TEB *teb )
         NtFreeVirtualMemory( GetCurrentProcess(), &ptr, &size, MEM_RELEASE );
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     list_remove( &thread_data->entry );
     ptr = teb;
     if (!is_win64) ptr = (char *)ptr - teb_offset;
     *(void **)ptr = next_free_teb;
     next_free_teb = ptr;
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 }
 
 
@@ -3081,7 +3875,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 
     if (index < TLS_MINIMUM_AVAILABLE)
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( thread_data, TEB, GdiTebBatch );
@@ -3092,14 +3886,14 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             teb->TlsSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
     }
     else
     {
         index -= TLS_MINIMUM_AVAILABLE;
         if (index >= 8 * sizeof(peb->TlsExpansionBitmapBits)) return STATUS_INVALID_PARAMETER;
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( thread_data, TEB, GdiTebBatch );
@@ -3114,7 +3908,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             if (teb->TlsExpansionSlots) teb->TlsExpansionSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
     }
     return STATUS_SUCCESS;
 }
@@ -3138,7 +3932,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     if (size < 1024 * 1024) size = 1024 * 1024;  /* Xlib needs a large stack */
     size = (size + 0xffff) & ~0xffff;  /* round to 64K boundary */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if ((status = map_view( &view, NULL, size + extra_size, FALSE,
                             VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, get_zero_bits_mask( zero_bits ), 0 ))
@@ -3180,7 +3974,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     stack->StackBase = (char *)view->base + view->size;
     stack->StackLimit = (char *)view->base + 2 * page_size;
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -3286,9 +4080,20 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
 {
     NTSTATUS ret = STATUS_ACCESS_VIOLATION;
     char *page = ROUND_ADDR( addr, page_mask );
+    unsigned int seq;
     BYTE vprot;
 
-    mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+    /* faults on pages without guard or write watch flags are never handled here */
+    if (virtual_read_begin( &seq ))
+    {
+        vprot = get_page_vprot( page );
+        if (!(vprot & (VPROT_GUARD | VPROT_WRITEWATCH)) &&
+            (!(err & EXCEPTION_WRITE_FAULT) || !(get_unix_prot( vprot ) & PROT_WRITE)) &&
+            virtual_read_end( seq ))
+            return STATUS_ACCESS_VIOLATION;
+    }
+
+    virtual_lock( NULL );  /* no need for signal masking inside signal handler */
     vprot = get_page_vprot( page );
     if (!is_inside_signal_stack( stack ) && (vprot & VPROT_GUARD))
     {
@@ -3315,7 +4120,7 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
                 ret = STATUS_SUCCESS;
         }
     }
-    mutex_unlock( &virtual_mutex );
+    virtual_unlock( NULL );
     return ret;
 }
 
@@ -3353,14 +4158,14 @@ void *virtual_setup_exception( void *stack_ptr, size_t size, EXCEPTION_RECORD *r
     }
     else if (stack < stack_info.limit)
     {
-        mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+        virtual_lock( NULL );  /* no need for signal masking inside signal handler */
         if ((get_page_vprot( stack ) & VPROT_GUARD) &&
             grow_thread_stack( ROUND_ADDR( stack, page_mask ), &stack_info ))
         {
             rec->ExceptionCode = STATUS_STACK_OVERFLOW;
             rec->NumberParameters = 0;
         }
-        mutex_unlock( &virtual_mutex );
+        virtual_unlock( NULL );
     }
 #if defined(VALGRIND_MAKE_MEM_UNDEFINED)
     VALGRIND_MAKE_MEM_UNDEFINED( stack, size );
@@ -3409,14 +4214,14 @@ unsigned int virtual_locked_server_call( void *req_ptr )
 
     if (!size) return wine_server_call( req_ptr );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         ret = server_call_unlocked( req );
         if (has_write_watch) update_write_watches( addr, size, wine_server_reply_size( req ));
     }
     else memset( &req->u.reply, 0, sizeof(req->u.reply) );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -3433,14 +4238,14 @@ ssize_t virtual_locked_read( int fd, void *addr, size_t size )
     ssize_t ret = read( fd, addr, size );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = read( fd, addr, size );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     errno = err;
     return ret;
 }
@@ -3458,14 +4263,14 @@ ssize_t virtual_locked_pread( int fd, void *addr, size_t size, off_t offset )
     ssize_t ret = pread( fd, addr, size, offset );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = pread( fd, addr, size, offset );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     errno = err;
     return ret;
 }
@@ -3484,7 +4289,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     ssize_t ret = recvmsg( fd, hdr, flags );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     for (i = 0; i < hdr->msg_iovlen; i++)
         if (check_write_access( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, &has_write_watch ))
             break;
@@ -3496,7 +4301,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     if (has_write_watch)
         while (i--) update_write_watches( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, 0 );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     errno = err;
     return ret;
 }
@@ -3511,10 +4316,10 @@ BOOL virtual_is_valid_code_address( const void *addr, SIZE_T size )
     BOOL ret = FALSE;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if ((view = find_view( addr, size )))
         ret = !(view->protect & VPROT_SYSTEM);  /* system views are not visible to the app */
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -3601,7 +4406,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
 
     if (!size) return 0;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if ((view = find_view( addr, size )))
     {
         if (!(view->protect & VPROT_SYSTEM))
@@ -3617,7 +4422,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
             }
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return bytes_read;
 }
 
@@ -3637,13 +4442,13 @@ NTSTATUS virtual_uninterrupted_write_memory( void *addr, const void *buffer, SIZ
 
     if (!size) return STATUS_SUCCESS;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         memcpy( addr, buffer, size );
         if (has_write_watch) update_write_watches( addr, size, size );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -3658,7 +4463,7 @@ void virtual_set_force_exec( BOOL enable )
     struct file_view *view;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!force_exec_prot != !enable)  /* change all existing views */
     {
         force_exec_prot = enable;
@@ -3671,7 +4476,7 @@ void virtual_set_force_exec( BOOL enable )
             mprotect_range( view->base, view->size, commit, 0 );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 }
 
 struct free_range
@@ -3797,7 +4602,7 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 
     /* Reserve the memory */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if ((type & MEM_RESERVE) || !base)
     {
@@ -3812,13 +4617,21 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
             else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, limit,
                                     align ? align - 1 : granularity_mask );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (vprot & VPROT_WRITEWATCH) enable_kernel_write_watches( view );
+            }
         }
     }
     else if (type & MEM_RESET)
     {
         if (!(view = find_view( base, size ))) status = STATUS_NOT_MAPPED_VIEW;
-        else madvise( base, size, MADV_DONTNEED );
+        else
+        {
+            disable_kernel_write_watches( view );
+            madvise( base, size, MADV_DONTNEED );
+        }
     }
     else  /* commit the pages */
     {
@@ -3839,7 +4652,7 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4040,7 +4853,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
     if (size) size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     /* avoid freeing the DOS area when a broken app passes a NULL pointer */
     if (!base)
@@ -4082,7 +4895,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
         status = STATUS_INVALID_PARAMETER;
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -4136,7 +4949,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
     size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if ((view = find_view( base, size )))
     {
@@ -4152,7 +4965,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4208,6 +5021,52 @@ static int get_free_mem_state_callback( void *start, SIZE_T size, void *arg )
     return 1;
 }
 
+/* fill the information for an address inside a view without taking virtual_mutex; return FALSE
+ * if that isn't possible, either because the views changed or because the lock is needed */
+static BOOL fill_view_memory_info_lockless( char *base, MEMORY_BASIC_INFORMATION *info )
+{
+    struct wine_rb_entry *ptr;
+    struct file_view *view;
+    unsigned int seq, depth = 0, protect;
+    char *view_base;
+    SIZE_T view_size, size;
+    BYTE vprot;
+
+    if (!virtual_read_begin( &seq )) return FALSE;
+
+    ptr = views_tree.root;
+    for (;;)
+    {
+        /* the tree may be changing under us, don't trust it to be well-formed */
+        if (!ptr || ++depth > 128) return FALSE;
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+        view_base = view->base;
+        view_size = view->size;
+        if (view_base > base) ptr = ptr->left;
+        else if (view_base + view_size <= base) ptr = ptr->right;
+        else break;
+    }
+    protect = view->protect;
+    /* the committed state of SEC_RESERVE views is kept by the server */
+    if (protect & SEC_RESERVE) return FALSE;
+    /* the page protections of the view are only valid if the view was */
+    if (!virtual_read_end( seq )) return FALSE;
+
+    size = get_vprot_range_size( base, view_base + view_size - base, ~VPROT_WRITEWATCH, &vprot );
+    if (!virtual_read_end( seq )) return FALSE;
+
+    info->AllocationBase    = view_base;
+    info->BaseAddress       = base;
+    info->RegionSize        = size;
+    info->State             = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
+    info->Protect           = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, protect ) : 0;
+    info->AllocationProtect = get_win32_prot( protect, protect );
+    if (protect & SEC_IMAGE) info->Type = MEM_IMAGE;
+    else if (protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
+    else info->Type = MEM_PRIVATE;
+    return TRUE;
+}
+
 static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFORMATION *info )
 {
     char *base, *alloc_base = 0, *alloc_end = working_set_limit;
@@ -4219,9 +5078,11 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
 
     if (is_beyond_limit( base, 1, working_set_limit )) return STATUS_INVALID_PARAMETER;
 
+    if (fill_view_memory_info_lockless( base, info )) return STATUS_SUCCESS;
+
     /* Find the view containing the address */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     ptr = views_tree.root;
     while (ptr)
     {
@@ -4286,7 +5147,7 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
         else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
         else info->Type = MEM_PRIVATE;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     return STATUS_SUCCESS;
 }
@@ -4368,9 +5229,6 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                                     MEMORY_WORKING_SET_EX_INFORMATION *info,
                                     SIZE_T len, SIZE_T *res_len )
 {
-#if !defined(HAVE_LIBPROCSTAT)
-    static int pagemap_fd = -2;
-#endif
     MEMORY_WORKING_SET_EX_INFORMATION *p;
     sigset_t sigset;
 
@@ -4396,7 +5254,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
         if (vmentries == NULL)
             WARN( "couldn't get process vmmap, errno %d\n", errno );
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         for (p = info; (UINT_PTR)(p + 1) <= (UINT_PTR)info + len; p++)
         {
              int i;
@@ -4423,7 +5281,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                      p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
              }
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
 
         if (vmentries)
             procstat_freevmmap( pstat, vmentries );
@@ -4433,17 +5291,8 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
             procstat_close( pstat );
     }
 #else
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
-    if (pagemap_fd == -2)
-    {
-#ifdef O_CLOEXEC
-        if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC, 0 )) == -1 && errno == EINVAL)
-#endif
-            pagemap_fd = open( "/proc/self/pagemap", O_RDONLY, 0 );
-
-        if (pagemap_fd == -1) WARN( "unable to open /proc/self/pagemap\n" );
-        else fcntl(pagemap_fd, F_SETFD, FD_CLOEXEC);  /* in case O_CLOEXEC isn't supported */
-    }
+    virtual_lock( &sigset );
+    get_pagemap_fd();
 
     for (p = info; (UINT_PTR)(p + 1) <= (UINT_PTR)info + len; p++)
     {
@@ -4472,7 +5321,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 #endif
 
     if (res_len)
@@ -4746,7 +5595,7 @@ NTSTATUS WINAPI NtUnmapViewOfSection( HANDLE process, PVOID addr )
         return status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if ((view = find_view( addr, 0 )) && !is_view_valloc( view ))
     {
         if (view->protect & VPROT_SYSTEM)
@@ -4760,7 +5609,7 @@ NTSTATUS WINAPI NtUnmapViewOfSection( HANDLE process, PVOID addr )
                 {
                     TRACE( "not freeing in-use builtin %p\n", view->base );
                     builtin->refcount--;
-                    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                    virtual_unlock( &sigset );
                     return STATUS_SUCCESS;
                 }
             }
@@ -4779,7 +5628,7 @@ NTSTATUS WINAPI NtUnmapViewOfSection( HANDLE process, PVOID addr )
         }
         else FIXME( "failed to unmap %p %x\n", view->base, status );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -4914,7 +5763,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         return result.virtual_flush.status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!(view = find_view( addr, *size_ptr ))) status = STATUS_INVALID_PARAMETER;
     else
     {
@@ -4924,7 +5773,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         if (msync( addr, *size_ptr, MS_ASYNC )) status = STATUS_NOT_MAPPED_DATA;
 #endif
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -4936,6 +5785,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
 NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T size, PVOID *addresses,
                                  ULONG_PTR *count, ULONG *granularity )
 {
+    struct file_view *view;
     NTSTATUS status = STATUS_SUCCESS;
     sigset_t sigset;
 
@@ -4951,26 +5801,31 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     TRACE( "%p %x %p-%p %p %lu\n", process, (int)flags, base, (char *)base + size,
            addresses, *count );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
-    if (is_write_watch_range( base, size ))
+    if ((view = find_view( base, size )) && (view->protect & VPROT_WRITEWATCH))
     {
         ULONG_PTR pos = 0;
         char *addr = base;
         char *end = addr + size;
 
-        while (pos < *count && addr < end)
+        if (view->protect & VPROT_KERNELWATCH)
+            pos = get_kernel_write_watches( base, size, addresses, *count, flags & WRITE_WATCH_FLAG_RESET );
+        else
         {
-            if (!(get_page_vprot( addr ) & VPROT_WRITEWATCH)) addresses[pos++] = addr;
-            addr += page_size;
+            while (pos < *count && addr < end)
+            {
+                if (!(get_page_vprot( addr ) & VPROT_WRITEWATCH)) addresses[pos++] = addr;
+                addr += page_size;
+            }
+            if (flags & WRITE_WATCH_FLAG_RESET) reset_write_watches( base, addr - (char *)base );
         }
-        if (flags & WRITE_WATCH_FLAG_RESET) reset_write_watches( base, addr - (char *)base );
         *count = pos;
         *granularity = page_size;
     }
     else status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -4981,6 +5836,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
  */
 NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 {
+    struct file_view *view;
     NTSTATUS status = STATUS_SUCCESS;
     sigset_t sigset;
 
@@ -4991,14 +5847,17 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 
     if (!size) return STATUS_INVALID_PARAMETER;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
-    if (is_write_watch_range( base, size ))
-        reset_write_watches( base, size );
+    if ((view = find_view( base, size )) && (view->protect & VPROT_WRITEWATCH))
+    {
+        if (view->protect & VPROT_KERNELWATCH) get_kernel_write_watches( base, size, NULL, 0, TRUE );
+        else reset_write_watches( base, size );
+    }
     else
         status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -5075,7 +5934,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
 
     TRACE("%p %p\n", addr1, addr2);
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     view1 = find_view( addr1, 0 );
     view2 = find_view( addr2, 0 );
@@ -5099,7 +5958,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
         SERVER_END_REQ;
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
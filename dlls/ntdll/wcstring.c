@@ -87,15 +87,44 @@ static const unsigned short wctypes[256] =
 };
 
 
+/* the string functions below scan aligned machine words, which never cross
+ * a page boundary, and fall back to single chars for unaligned strings */
+#define WCHAR_ONES  (~(size_t)0 / 0xffff)   /* 0x0001 in every WCHAR of a word */
+#define WCHAR_HIGHS (WCHAR_ONES << 15)      /* 0x8000 in every WCHAR of a word */
+
+static inline BOOL word_has_null( size_t word )
+{
+    return ((word - WCHAR_ONES) & ~word & WCHAR_HIGHS) != 0;
+}
+
+static inline BOOL words_aligned( const WCHAR *str1, const WCHAR *str2 )
+{
+    return !(((ULONG_PTR)str1 | (ULONG_PTR)str2) % sizeof(size_t));
+}
+
+/* skip the identical words of two aligned strings */
+static inline void skip_equal_words( const WCHAR **str1, const WCHAR **str2 )
+{
+    const size_t *w1 = (const size_t *)*str1, *w2 = (const size_t *)*str2;
+
+    while (*w1 == *w2 && !word_has_null( *w1 )) { w1++; w2++; }
+    *str1 = (const WCHAR *)w1;
+    *str2 = (const WCHAR *)w2;
+}
+
+
 /*********************************************************************
  *           _wcsicmp    (NTDLL.@)
  */
 int __cdecl _wcsicmp( LPCWSTR str1, LPCWSTR str2 )
 {
+    WCHAR ch1, ch2;
+
     for (;;)
     {
-        WCHAR ch1 = (*str1 >= 'A' && *str1 <= 'Z') ? *str1 + 32 : *str1;
-        WCHAR ch2 = (*str2 >= 'A' && *str2 <= 'Z') ? *str2 + 32 : *str2;
+        if (words_aligned( str1, str2 )) skip_equal_words( &str1, &str2 );
+        ch1 = (*str1 >= 'A' && *str1 <= 'Z') ? *str1 + 32 : *str1;
+        ch2 = (*str2 >= 'A' && *str2 <= 'Z') ? *str2 + 32 : *str2;
         if (ch1 != ch2 || !*str1) return ch1 - ch2;
         str1++;
         str2++;
@@ -215,7 +244,11 @@ errno_t __cdecl wcscpy_s( wchar_t *dst, size_t len, const wchar_t *src )
 size_t __cdecl wcslen( LPCWSTR str )
 {
     const WCHAR *s = str;
-    while (*s) s++;
+    const size_t *w;
+
+    for (; (ULONG_PTR)s % sizeof(size_t); s++) if (!*s) return s - str;
+    for (w = (const size_t *)s; !word_has_null( *w ); w++) ;
+    for (s = (const WCHAR *)w; *s; s++) ;
     return s - str;
 }
 
@@ -255,6 +288,16 @@ errno_t __cdecl wcscat_s( wchar_t *dst, size_t len, const wchar_t *src )
  */
 LPWSTR __cdecl wcschr( LPCWSTR str, WCHAR ch )
 {
+    size_t mask = ch * WCHAR_ONES;
+    const size_t *w;
+
+    for (; (ULONG_PTR)str % sizeof(size_t); str++)
+    {
+        if (*str == ch) return (WCHAR *)(ULONG_PTR)str;
+        if (!*str) return NULL;
+    }
+    for (w = (const size_t *)str; !word_has_null( *w ) && !word_has_null( *w ^ mask ); w++) ;
+    str = (const WCHAR *)w;
     do { if (*str == ch) return (WCHAR *)(ULONG_PTR)str; } while (*str++);
     return NULL;
 }
@@ -265,8 +308,13 @@ LPWSTR __cdecl wcschr( LPCWSTR str, WCHAR ch )
  */
 int __cdecl wcscmp( LPCWSTR str1, LPCWSTR str2 )
 {
-    while (*str1 && (*str1 == *str2)) { str1++; str2++; }
-    return *str1 - *str2;
+    for (;;)
+    {
+        if (words_aligned( str1, str2 )) skip_equal_words( &str1, &str2 );
+        if (!*str1 || *str1 != *str2) return *str1 - *str2;
+        str1++;
+        str2++;
+    }
 }
 
 
@@ -4573,6 +4573,70 @@ static void test_SendInput(void)
     DestroyWindow( hwnd );
 }
 
+static void test_hardware_queue(void)
+{
+    INPUT input[1200];
+    UINT res, i, moves = 0, keydown = 0, keyup = 0;
+    HWND hwnd;
+    MSG msg;
+
+    hwnd = CreateWindowW( L"static", L"test", WS_POPUP | WS_VISIBLE, 0, 0, 100, 100, 0, 0, 0, 0 );
+    ok( hwnd != 0, "CreateWindowW failed\n" );
+    SetForegroundWindow( hwnd );
+    SetFocus( hwnd );
+    SetCursorPos( 50, 50 );
+    empty_message_queue();
+
+    /* mouse moves are merged across keyboard input */
+    memset( input, 0, sizeof(input) );
+    for (i = 0; i < 5; i += 2)
+    {
+        input[i].type = INPUT_MOUSE;
+        input[i].mi.dx = 1;
+        input[i].mi.dwFlags = MOUSEEVENTF_MOVE;
+    }
+    input[1].type = INPUT_KEYBOARD;
+    input[1].ki.wVk = VK_F24;
+    input[3].type = INPUT_KEYBOARD;
+    input[3].ki.wVk = VK_F24;
+    input[3].ki.dwFlags = KEYEVENTF_KEYUP;
+    res = SendInput( 5, input, sizeof(*input) );
+    ok( res == 5, "SendInput returned %u\n", res );
+
+    while (PeekMessageW( &msg, hwnd, 0, 0, PM_REMOVE ))
+    {
+        if (msg.message == WM_MOUSEMOVE) moves++;
+        else if (msg.message == WM_KEYDOWN) keydown++;
+        else if (msg.message == WM_KEYUP) keyup++;
+    }
+    ok( moves == 1, "got %u WM_MOUSEMOVE\n", moves );
+    ok( keydown == 1, "got %u WM_KEYDOWN\n", keydown );
+    ok( keyup == 1, "got %u WM_KEYUP\n", keyup );
+
+    /* key transitions are never dropped, even when the queue is full */
+    memset( input, 0, sizeof(input) );
+    for (i = 0; i < ARRAY_SIZE(input); i++)
+    {
+        input[i].type = INPUT_KEYBOARD;
+        input[i].ki.wVk = VK_F24;
+        input[i].ki.dwFlags = (i & 1) ? KEYEVENTF_KEYUP : 0;
+    }
+    res = SendInput( ARRAY_SIZE(input), input, sizeof(*input) );
+    ok( res == ARRAY_SIZE(input), "SendInput returned %u\n", res );
+
+    keydown = keyup = 0;
+    while (PeekMessageW( &msg, hwnd, 0, 0, PM_REMOVE ))
+    {
+        if (msg.message == WM_KEYDOWN) keydown++;
+        else if (msg.message == WM_KEYUP) keyup++;
+    }
+    ok( keydown == ARRAY_SIZE(input) / 2, "got %u WM_KEYDOWN\n", keydown );
+    ok( keyup == ARRAY_SIZE(input) / 2, "got %u WM_KEYUP\n", keyup );
+
+    DestroyWindow( hwnd );
+    empty_message_queue();
+}
+
 #define check_pointer_info( a, b ) check_pointer_info_( __LINE__, a, b )
 static void check_pointer_info_( int line, const POINTER_INFO *actual, const POINTER_INFO *expected )
 {
@@ -4868,6 +4932,7 @@ START_TEST(input)
     }
 
     test_SendInput();
+    test_hardware_queue();
     test_Input_blackbox();
     test_Input_whitebox();
     test_Input_unicode();
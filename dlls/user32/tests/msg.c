@@ -13764,6 +13764,73 @@ static const struct message WmStopQuitSeq[] = {
     { 0 }
 };
 
+static void test_posted_message_order(void)
+{
+    HWND hwnd;
+    DWORD status;
+    BOOL ret;
+    MSG msg;
+    UINT i;
+
+    hwnd = CreateWindowA("TestWindowClass", "PostedOrder", WS_OVERLAPPEDWINDOW,
+                         10, 10, 100, 100, NULL, NULL, NULL, NULL);
+    ok(hwnd != NULL, "expected hwnd != NULL\n");
+    flush_events();
+
+    /* enough messages to overflow any internal queue buffering */
+    for (i = 0; i < 1000; i++)
+    {
+        ret = PostMessageA(hwnd, WM_USER + (i % 3), i, 0);
+        ok(ret, "PostMessage %u failed\n", i);
+        if (i == 500)
+        {
+            ret = PostMessageA(hwnd, WM_APP, i, 0);
+            ok(ret, "PostMessage failed\n");
+        }
+    }
+
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE);
+    ok(ret && msg.message == WM_USER && msg.wParam == 0, "got %04x wp %Ix\n", msg.message, msg.wParam);
+
+    ret = PeekMessageA(&msg, NULL, WM_APP, WM_APP, PM_REMOVE);
+    ok(ret && msg.message == WM_APP && msg.wParam == 500, "got %04x wp %Ix\n", msg.message, msg.wParam);
+
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(HIWORD(status) == QS_POSTMESSAGE, "got %08lx\n", status);
+
+    ret = PeekMessageA(&msg, NULL, WM_USER + 1, WM_USER + 1, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1 && msg.wParam == 1, "got %04x wp %Ix\n", msg.message, msg.wParam);
+
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(HIWORD(status) == QS_POSTMESSAGE, "got %08lx\n", status);
+
+    for (i = 0; i < 1000; i++)
+    {
+        if (i == 1) continue;
+        ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+        ok(ret, "%u: no message\n", i);
+        if (!ret) break;
+        ok(msg.hwnd == hwnd, "%u: got hwnd %p\n", i, msg.hwnd);
+        ok(msg.message == WM_USER + (i % 3), "%u: got message %04x\n", i, msg.message);
+        ok(msg.wParam == i, "%u: got wparam %Ix\n", i, msg.wParam);
+        if (i == 998)
+        {
+            PostMessageA(hwnd, WM_USER, 1000, 0);
+            status = GetQueueStatus(QS_POSTMESSAGE);
+            ok(status == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "got %08lx\n", status);
+        }
+    }
+
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER && msg.wParam == 1000, "got %04x wp %Ix\n", msg.message, msg.wParam);
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == 0, "got %08lx\n", status);
+
+    DestroyWindow(hwnd);
+}
+
 static void test_quit_message(void)
 {
     MSG msg;
@@ -19631,6 +19698,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_posted_message_order();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
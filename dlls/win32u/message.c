@@ -25,6 +25,8 @@
 #endif
 
 #include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
 #include "win32u_private.h"
@@ -1778,6 +1780,115 @@ static BOOL process_hardware_message( MSG *msg, UINT hw_id, const struct hardwar
     return ret;
 }
 
+/***********************************************************************
+ *           get_shared_queue
+ *
+ * Map the memory shared with the server message queue of the current thread.
+ */
+static struct queue_shared_memory *get_shared_queue(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    HANDLE handle = 0;
+    void *ptr = MAP_FAILED;
+    int fd;
+
+    if (thread_info->shared_queue) return thread_info->shared_queue == MAP_FAILED ? NULL : thread_info->shared_queue;
+
+    SERVER_START_REQ( get_msg_queue_mapping )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (handle && !wine_server_handle_to_fd( handle, 0, &fd, NULL ))
+    {
+        ptr = mmap( NULL, sizeof(struct queue_shared_memory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+    }
+    if (handle) NtClose( handle );
+    if (ptr == MAP_FAILED) WARN( "failed to map the shared queue memory\n" );
+    thread_info->shared_queue = ptr;
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+/***********************************************************************
+ *           unmap_shared_queue
+ */
+void unmap_shared_queue(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+
+    if (thread_info->shared_queue && thread_info->shared_queue != MAP_FAILED)
+        munmap( thread_info->shared_queue, sizeof(struct queue_shared_memory) );
+    thread_info->shared_queue = NULL;
+}
+
+/***********************************************************************
+ *           peek_shared_posted_message
+ *
+ * Retrieve the posted message at the head of the shared queue ring without a
+ * server call. Messages that don't match the filters are left to the server.
+ */
+static BOOL peek_shared_posted_message( struct received_message_info *info, HWND hwnd,
+                                        UINT first, UINT last, UINT flags )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct queue_shared_memory *shared;
+    struct shared_posted_message *entry = NULL;
+    UINT filter = flags >> 16, clear_bits = 0, head, start, tail;
+    BOOL ret = FALSE;
+
+    if (filter && !(filter & QS_POSTMESSAGE)) return FALSE;
+    if (!(shared = get_shared_queue())) return FALSE;
+
+    /* hooks have changed, let the server refresh the active hooks */
+    if (__atomic_load_n( &shared->hooks_generation, __ATOMIC_ACQUIRE ) != thread_info->hooks_generation)
+        return FALSE;
+
+    /* sent messages need to be received first */
+    if (__atomic_load_n( &shared->wake_bits, __ATOMIC_ACQUIRE ) & QS_SENDMESSAGE) return FALSE;
+
+    start = head = shared->head;
+    tail = __atomic_load_n( &shared->tail, __ATOMIC_ACQUIRE );
+    for (; head != tail; head++)
+    {
+        entry = &shared->ring[head % QUEUE_RING_SIZE];
+        if (!entry->removed) break;
+    }
+
+    if (head != tail && (!hwnd || wine_server_user_handle( hwnd ) == entry->win) &&
+        (first <= last ? entry->msg >= first && entry->msg <= last
+                       : entry->msg >= first || entry->msg <= last))
+    {
+        info->type        = MSG_POSTED;
+        info->msg.hwnd    = wine_server_ptr_handle( entry->win );
+        info->msg.message = entry->msg;
+        info->msg.wParam  = entry->wparam;
+        info->msg.lParam  = entry->lparam;
+        info->msg.time    = entry->time;
+        info->msg.pt.x    = entry->x;
+        info->msg.pt.y    = entry->y;
+
+        /* clear the changed bits the way the server would have done */
+        if (!filter) filter = QS_ALLINPUT;
+        if (filter & QS_POSTMESSAGE)
+        {
+            clear_bits |= QS_POSTMESSAGE | QS_HOTKEY | QS_TIMER;
+            if (first == 0 && last == ~0U) clear_bits |= QS_ALLPOSTMESSAGE;
+        }
+        if (filter & QS_INPUT) clear_bits |= QS_INPUT;
+        if (filter & QS_PAINT) clear_bits |= QS_PAINT;
+        __atomic_or_fetch( &shared->clear_bits, clear_bits, __ATOMIC_SEQ_CST );
+        shared->get_count++;
+
+        if (flags & PM_REMOVE) head++;
+        ret = TRUE;
+    }
+
+    if (head != start) __atomic_store_n( &shared->head, head, __ATOMIC_RELEASE );
+    return ret;
+}
+
 /***********************************************************************
  *           peek_message
  *
@@ -1809,33 +1920,42 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
 
         thread_info->client_info.msg_source = prev_source;
 
-        SERVER_START_REQ( get_message )
+        if (!hw_id && peek_shared_posted_message( &info, hwnd, first, last, flags ))
+            res = STATUS_SUCCESS;
+        else
         {
-            req->flags     = flags;
-            req->get_win   = wine_server_user_handle( hwnd );
-            req->get_first = first;
-            req->get_last  = last;
-            req->hw_id     = hw_id;
-            req->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
-            req->changed_mask = changed_mask;
-            wine_server_set_reply( req, buffer, buffer_size );
-            if (!(res = wine_server_call( req )))
+            struct queue_shared_memory *shared = get_shared_queue();
+            UINT hooks_generation = shared ? __atomic_load_n( &shared->hooks_generation, __ATOMIC_ACQUIRE ) : 0;
+
+            SERVER_START_REQ( get_message )
             {
-                size = wine_server_reply_size( reply );
-                info.type        = reply->type;
-                info.msg.hwnd    = wine_server_ptr_handle( reply->win );
-                info.msg.message = reply->msg;
-                info.msg.wParam  = reply->wparam;
-                info.msg.lParam  = reply->lparam;
-                info.msg.time    = reply->time;
-                info.msg.pt.x    = reply->x;
-                info.msg.pt.y    = reply->y;
-                hw_id            = 0;
-                thread_info->active_hooks = reply->active_hooks;
+                req->flags     = flags;
+                req->get_win   = wine_server_user_handle( hwnd );
+                req->get_first = first;
+                req->get_last  = last;
+                req->hw_id     = hw_id;
+                req->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+                req->changed_mask = changed_mask;
+                wine_server_set_reply( req, buffer, buffer_size );
+                if (!(res = wine_server_call( req )))
+                {
+                    size = wine_server_reply_size( reply );
+                    info.type        = reply->type;
+                    info.msg.hwnd    = wine_server_ptr_handle( reply->win );
+                    info.msg.message = reply->msg;
+                    info.msg.wParam  = reply->wparam;
+                    info.msg.lParam  = reply->lparam;
+                    info.msg.time    = reply->time;
+                    info.msg.pt.x    = reply->x;
+                    info.msg.pt.y    = reply->y;
+                    hw_id            = 0;
+                    thread_info->active_hooks = reply->active_hooks;
+                    thread_info->hooks_generation = hooks_generation;
+                }
+                else buffer_size = reply->total;
             }
-            else buffer_size = reply->total;
+            SERVER_END_REQ;
         }
-        SERVER_END_REQ;
 
         if (res)
         {
@@ -5435,6 +5435,7 @@ static void thread_detach(void)
 
     destroy_thread_windows();
     cleanup_imm_thread();
+    unmap_shared_queue();
     NtClose( thread_info->server_queue );
 
     exiting_thread_id = 0;
@@ -37,11 +37,13 @@
     SYSCALL_ENTRY( NtAllocateVirtualMemoryEx ) \
     SYSCALL_ENTRY( NtAreMappedFilesTheSame ) \
     SYSCALL_ENTRY( NtAssignProcessToJobObject ) \
+    SYSCALL_ENTRY( NtAssociateWaitCompletionPacket ) \
     SYSCALL_ENTRY( NtCallbackReturn ) \
     SYSCALL_ENTRY( NtCancelIoFile ) \
     SYSCALL_ENTRY( NtCancelIoFileEx ) \
     SYSCALL_ENTRY( NtCancelSynchronousIoFile ) \
     SYSCALL_ENTRY( NtCancelTimer ) \
+    SYSCALL_ENTRY( NtCancelWaitCompletionPacket ) \
     SYSCALL_ENTRY( NtClearEvent ) \
     SYSCALL_ENTRY( NtClose ) \
     SYSCALL_ENTRY( NtCompareObjects ) \
@@ -70,6 +72,7 @@
     SYSCALL_ENTRY( NtCreateThreadEx ) \
     SYSCALL_ENTRY( NtCreateTimer ) \
     SYSCALL_ENTRY( NtCreateUserProcess ) \
+    SYSCALL_ENTRY( NtCreateWaitCompletionPacket ) \
     SYSCALL_ENTRY( NtDebugActiveProcess ) \
     SYSCALL_ENTRY( NtDebugContinue ) \
     SYSCALL_ENTRY( NtDelayExecution ) \
@@ -357,6 +357,33 @@ typedef union
 } message_data_t;
 
 
+struct shared_posted_message
+{
+    user_handle_t  win;
+    unsigned int   msg;
+    lparam_t       wparam;
+    lparam_t       lparam;
+    int            x;
+    int            y;
+    unsigned int   time;
+    unsigned int   removed;
+};
+
+#define QUEUE_RING_SIZE 256
+
+
+struct queue_shared_memory
+{
+    unsigned int  wake_bits;
+    unsigned int  clear_bits;
+    unsigned int  get_count;
+    unsigned int  head;
+    unsigned int  tail;
+    unsigned int  hooks_generation;
+    struct shared_posted_message ring[QUEUE_RING_SIZE];
+};
+
+
 struct filesystem_event
 {
     int         action;
@@ -439,6 +466,54 @@ struct object_type_info
 
 };
 
+
+struct shared_type_counts
+{
+    unsigned int  seq;
+    unsigned int  obj_count;
+    unsigned int  handle_count;
+    unsigned int  obj_max;
+    unsigned int  handle_max;
+};
+
+#define SHARED_TYPE_COUNT 32
+
+
+struct shared_handle
+{
+    unsigned short type;
+    unsigned short flags;
+    unsigned int   access;
+    unsigned int   fast_sync;
+};
+
+#define SHARED_HANDLE_COUNT        0x10000
+#define SHARED_HANDLE_UNKNOWN_TYPE 0xffff
+
+
+struct fast_sync_slot
+{
+    int            futex;
+    int            waiters;
+    int            server_waiters;
+    unsigned int   type;
+    unsigned int   state;
+    unsigned int   count;
+    unsigned int   max;
+    unsigned int   pulse;
+    int            abandoned;
+};
+
+
+#define FAST_SYNC_LOCKED       0x80000000
+
+#define FAST_SYNC_MANUAL_EVENT 1
+#define FAST_SYNC_AUTO_EVENT   2
+#define FAST_SYNC_SEMAPHORE    3
+#define FAST_SYNC_MUTEX        4
+
+#define FAST_SYNC_SLOT_COUNT   0x10000
+
 enum select_op
 {
     SELECT_NONE,
@@ -1669,6 +1744,30 @@ struct get_handle_fd_reply
     unsigned int access;
     unsigned int options;
 };
+
+
+struct get_handle_fds_request
+{
+    struct request_header __header;
+    /* VARARG(handles,uints); */
+    char __pad_12[4];
+};
+struct get_handle_fds_reply
+{
+    struct reply_header __header;
+    /* VARARG(fds,handle_fds); */
+};
+
+struct handle_fd_info
+{
+    obj_handle_t  handle;
+    unsigned int  status;
+    int           type;
+    int           cacheable;
+    unsigned int  access;
+    unsigned int  options;
+};
+
 enum server_fd_type
 {
     FD_TYPE_INVALID,
@@ -2337,10 +2436,15 @@ struct get_key_value_reply
     struct reply_header __header;
     int          type;
     data_size_t  total;
+    unsigned int stamp_index;
+    unsigned int stamp;
     /* VARARG(data,bytes); */
 };
 
 
+#define REGISTRY_STAMP_COUNT 4096
+
+
 
 struct enum_key_value_request
 {
@@ -2650,6 +2754,20 @@ struct get_msg_queue_reply
 
 
 
+struct get_msg_queue_mapping_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_msg_queue_mapping_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
 struct set_queue_fd_request
 {
     struct request_header __header;
@@ -2941,11 +3059,13 @@ struct register_async_request
     int          type;
     async_data_t async;
     int          count;
-    char __pad_60[4];
+    int          direct;
 };
 struct register_async_reply
 {
     struct reply_header __header;
+    obj_handle_t wait;
+    char __pad_12[4];
 };
 #define ASYNC_TYPE_READ  0x01
 #define ASYNC_TYPE_WRITE 0x02
@@ -4836,6 +4956,46 @@ struct get_object_types_reply
 
 
 
+struct get_handle_table_mapping_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_handle_table_mapping_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    char __pad_12[4];
+};
+
+
+
+struct get_fast_sync_mapping_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_fast_sync_mapping_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    char __pad_12[4];
+};
+
+
+
+struct fast_sync_wake_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+};
+struct fast_sync_wake_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct allocate_locally_unique_id_request
 {
     struct request_header __header;
@@ -5124,6 +5284,56 @@ struct query_completion_reply
 
 
 
+struct create_wait_completion_packet_request
+{
+    struct request_header __header;
+    unsigned int  access;
+    /* VARARG(objattr,object_attributes); */
+};
+struct create_wait_completion_packet_reply
+{
+    struct reply_header __header;
+    obj_handle_t  handle;
+    char __pad_12[4];
+};
+
+
+
+struct associate_wait_completion_packet_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+    obj_handle_t  chandle;
+    obj_handle_t  target;
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    char __pad_52[4];
+};
+struct associate_wait_completion_packet_reply
+{
+    struct reply_header __header;
+    int           signaled;
+    char __pad_12[4];
+};
+
+
+
+struct cancel_wait_completion_packet_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+    int           remove_signaled;
+    char __pad_20[4];
+};
+struct cancel_wait_completion_packet_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct set_completion_info_request
 {
     struct request_header __header;
@@ -5554,6 +5764,7 @@ enum request
     REQ_alloc_file_handle,
     REQ_get_handle_unix_name,
     REQ_get_handle_fd,
+    REQ_get_handle_fds,
     REQ_get_directory_cache_entry,
     REQ_flush,
     REQ_get_file_info,
@@ -5613,6 +5824,7 @@ enum request
     REQ_find_atom,
     REQ_get_atom_information,
     REQ_get_msg_queue,
+    REQ_get_msg_queue_mapping,
     REQ_set_queue_fd,
     REQ_set_queue_mask,
     REQ_get_queue_status,
@@ -5741,6 +5953,9 @@ enum request
     REQ_get_object_name,
     REQ_get_object_type,
     REQ_get_object_types,
+    REQ_get_handle_table_mapping,
+    REQ_get_fast_sync_mapping,
+    REQ_fast_sync_wake,
     REQ_allocate_locally_unique_id,
     REQ_create_device_manager,
     REQ_create_device,
@@ -5759,6 +5974,9 @@ enum request
     REQ_add_completion,
     REQ_remove_completion,
     REQ_query_completion,
+    REQ_create_wait_completion_packet,
+    REQ_associate_wait_completion_packet,
+    REQ_cancel_wait_completion_packet,
     REQ_set_completion_info,
     REQ_add_fd_completion,
     REQ_set_fd_completion_mode,
@@ -5839,6 +6057,7 @@ union generic_request
     struct alloc_file_handle_request alloc_file_handle_request;
     struct get_handle_unix_name_request get_handle_unix_name_request;
     struct get_handle_fd_request get_handle_fd_request;
+    struct get_handle_fds_request get_handle_fds_request;
     struct get_directory_cache_entry_request get_directory_cache_entry_request;
     struct flush_request flush_request;
     struct get_file_info_request get_file_info_request;
@@ -5898,6 +6117,7 @@ union generic_request
     struct find_atom_request find_atom_request;
     struct get_atom_information_request get_atom_information_request;
     struct get_msg_queue_request get_msg_queue_request;
+    struct get_msg_queue_mapping_request get_msg_queue_mapping_request;
     struct set_queue_fd_request set_queue_fd_request;
     struct set_queue_mask_request set_queue_mask_request;
     struct get_queue_status_request get_queue_status_request;
@@ -6026,6 +6246,9 @@ union generic_request
     struct get_object_name_request get_object_name_request;
     struct get_object_type_request get_object_type_request;
     struct get_object_types_request get_object_types_request;
+    struct get_handle_table_mapping_request get_handle_table_mapping_request;
+    struct get_fast_sync_mapping_request get_fast_sync_mapping_request;
+    struct fast_sync_wake_request fast_sync_wake_request;
     struct allocate_locally_unique_id_request allocate_locally_unique_id_request;
     struct create_device_manager_request create_device_manager_request;
     struct create_device_request create_device_request;
@@ -6044,6 +6267,9 @@ union generic_request
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
     struct query_completion_request query_completion_request;
+    struct create_wait_completion_packet_request create_wait_completion_packet_request;
+    struct associate_wait_completion_packet_request associate_wait_completion_packet_request;
+    struct cancel_wait_completion_packet_request cancel_wait_completion_packet_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
     struct set_fd_completion_mode_request set_fd_completion_mode_request;
@@ -6122,6 +6348,7 @@ union generic_reply
     struct alloc_file_handle_reply alloc_file_handle_reply;
     struct get_handle_unix_name_reply get_handle_unix_name_reply;
     struct get_handle_fd_reply get_handle_fd_reply;
+    struct get_handle_fds_reply get_handle_fds_reply;
     struct get_directory_cache_entry_reply get_directory_cache_entry_reply;
     struct flush_reply flush_reply;
     struct get_file_info_reply get_file_info_reply;
@@ -6181,6 +6408,7 @@ union generic_reply
     struct find_atom_reply find_atom_reply;
     struct get_atom_information_reply get_atom_information_reply;
     struct get_msg_queue_reply get_msg_queue_reply;
+    struct get_msg_queue_mapping_reply get_msg_queue_mapping_reply;
     struct set_queue_fd_reply set_queue_fd_reply;
     struct set_queue_mask_reply set_queue_mask_reply;
     struct get_queue_status_reply get_queue_status_reply;
@@ -6309,6 +6537,9 @@ union generic_reply
     struct get_object_name_reply get_object_name_reply;
     struct get_object_type_reply get_object_type_reply;
     struct get_object_types_reply get_object_types_reply;
+    struct get_handle_table_mapping_reply get_handle_table_mapping_reply;
+    struct get_fast_sync_mapping_reply get_fast_sync_mapping_reply;
+    struct fast_sync_wake_reply fast_sync_wake_reply;
     struct allocate_locally_unique_id_reply allocate_locally_unique_id_reply;
     struct create_device_manager_reply create_device_manager_reply;
     struct create_device_reply create_device_reply;
@@ -6327,6 +6558,9 @@ union generic_reply
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
     struct query_completion_reply query_completion_reply;
+    struct create_wait_completion_packet_reply create_wait_completion_packet_reply;
+    struct associate_wait_completion_packet_reply associate_wait_completion_packet_reply;
+    struct cancel_wait_completion_packet_reply cancel_wait_completion_packet_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
     struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
@@ -6356,7 +6590,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 758
+#define SERVER_PROTOCOL_VERSION 767
 
 /* ### protocol_version end ### */
 
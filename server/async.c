@@ -413,6 +413,17 @@ obj_handle_t async_handoff( struct async *async, data_size_t *result, int force_
     return async->wait_handle;
 }
 
+/* hand off an async whose I/O is performed by the client, which reports the result
+ * through set_async_direct_result instead of waiting for the async to be woken up */
+obj_handle_t async_handoff_direct( struct async *async )
+{
+    if (!(async->wait_handle = alloc_handle( async->thread->process, async, SYNCHRONIZE, 0 )))
+        return 0;
+    async->direct_result = 1;
+    set_error( STATUS_ALERTED );
+    return async_handoff( async, NULL, 0 );
+}
+
 /* complete a request-based async with a pre-allocated buffer */
 void async_request_complete( struct async *async, unsigned int status, data_size_t result,
                              data_size_t out_size, void *out_data )
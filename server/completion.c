@@ -28,6 +28,7 @@
 
 #include "config.h"
 
+#include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
 
@@ -39,6 +40,7 @@
 #include "object.h"
 #include "file.h"
 #include "handle.h"
+#include "thread.h"
 #include "request.h"
 
 
@@ -56,6 +58,23 @@ struct type_descr completion_type =
     },
 };
 
+#define WAIT_COMPLETION_PACKET_MODIFY_STATE 0x0001
+#define WAIT_COMPLETION_PACKET_ALL_ACCESS (STANDARD_RIGHTS_REQUIRED | SYNCHRONIZE | 0x0001)
+
+static const WCHAR wait_completion_packet_name[] = {'W','a','i','t','C','o','m','p','l','e','t','i','o','n','P','a','c','k','e','t'};
+
+static struct type_descr wait_completion_packet_type =
+{
+    { wait_completion_packet_name, sizeof(wait_completion_packet_name) },   /* name */
+    WAIT_COMPLETION_PACKET_ALL_ACCESS,                                      /* valid_access */
+    {                                                                       /* mapping */
+        STANDARD_RIGHTS_READ,
+        STANDARD_RIGHTS_WRITE | WAIT_COMPLETION_PACKET_MODIFY_STATE,
+        STANDARD_RIGHTS_EXECUTE | SYNCHRONIZE,
+        WAIT_COMPLETION_PACKET_ALL_ACCESS
+    },
+};
+
 struct completion
 {
     struct object  obj;
@@ -63,6 +82,18 @@ struct completion
     unsigned int   depth;
 };
 
+struct wait_completion_packet
+{
+    struct object       obj;
+    struct completion  *completion;  /* port the packet is queued to */
+    struct thread_wait *wait;        /* pending wait for the target object */
+    struct comp_msg    *msg;         /* message queued to the port */
+    apc_param_t         ckey;
+    apc_param_t         cvalue;
+    apc_param_t         information;
+    unsigned int        status;
+};
+
 static void completion_dump( struct object*, int );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void completion_destroy( struct object * );
@@ -91,6 +122,33 @@ static const struct object_ops completion_ops =
     completion_destroy         /* destroy */
 };
 
+static void wait_completion_packet_dump( struct object *obj, int verbose );
+static void wait_completion_packet_destroy( struct object *obj );
+
+static const struct object_ops wait_completion_packet_ops =
+{
+    sizeof(struct wait_completion_packet), /* size */
+    &wait_completion_packet_type,  /* type */
+    wait_completion_packet_dump,   /* dump */
+    no_add_queue,                  /* add_queue */
+    NULL,                          /* remove_queue */
+    NULL,                          /* signaled */
+    NULL,                          /* satisfied */
+    no_signal,                     /* signal */
+    no_get_fd,                     /* get_fd */
+    default_map_access,            /* map_access */
+    default_get_sd,                /* get_sd */
+    default_set_sd,                /* set_sd */
+    default_get_full_name,         /* get_full_name */
+    no_lookup_name,                /* lookup_name */
+    directory_link_name,           /* link_name */
+    default_unlink_name,           /* unlink_name */
+    no_open_file,                  /* open_file */
+    no_kernel_obj_list,            /* get_kernel_obj_list */
+    no_close_handle,               /* close_handle */
+    wait_completion_packet_destroy /* destroy */
+};
+
 struct comp_msg
 {
     struct   list queue_entry;
@@ -98,6 +156,7 @@ struct comp_msg
     apc_param_t   cvalue;
     apc_param_t   information;
     unsigned int  status;
+    struct wait_completion_packet *packet;  /* wait completion packet that queued the message */
 };
 
 static void completion_destroy( struct object *obj)
@@ -107,6 +166,7 @@ static void completion_destroy( struct object *obj)
 
     LIST_FOR_EACH_ENTRY_SAFE( tmp, next, &completion->queue, struct comp_msg, queue_entry )
     {
+        assert( !tmp->packet );  /* the packet holds a reference to the port */
         free( tmp );
     }
 }
@@ -149,22 +209,76 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
     return (struct completion *) get_handle_obj( process, handle, access, &completion_ops );
 }
 
-void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
-                     unsigned int status, apc_param_t information )
+static struct comp_msg *queue_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
+                                          unsigned int status, apc_param_t information,
+                                          struct wait_completion_packet *packet )
 {
     struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
 
     if (!msg)
-        return;
+        return NULL;
 
     msg->ckey = ckey;
     msg->cvalue = cvalue;
     msg->status = status;
     msg->information = information;
+    msg->packet = packet;
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
     wake_up( &completion->obj, 1 );
+    return msg;
+}
+
+void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
+                     unsigned int status, apc_param_t information )
+{
+    queue_completion( completion, ckey, cvalue, status, information, NULL );
+}
+
+/* detach a wait completion packet from its port once its message is gone */
+static void wait_completion_packet_reset( struct wait_completion_packet *packet )
+{
+    packet->msg = NULL;
+    release_object( packet->completion );
+    packet->completion = NULL;
+}
+
+static void wait_completion_packet_dump( struct object *obj, int verbose )
+{
+    struct wait_completion_packet *packet = (struct wait_completion_packet *)obj;
+
+    assert( obj->ops == &wait_completion_packet_ops );
+    fprintf( stderr, "WaitCompletionPacket port=%p waiting=%d queued=%d\n",
+             packet->completion, packet->wait != NULL, packet->msg != NULL );
+}
+
+static void wait_completion_packet_destroy( struct object *obj )
+{
+    struct wait_completion_packet *packet = (struct wait_completion_packet *)obj;
+
+    assert( obj->ops == &wait_completion_packet_ops );
+    if (packet->wait) cancel_object_wait( packet->wait );
+    /* a queued message stays in the port */
+    if (packet->msg) packet->msg->packet = NULL;
+    if (packet->completion) release_object( packet->completion );
+}
+
+/* the target object of a wait completion packet has been acquired */
+static void wait_completion_packet_signaled( void *private, unsigned int status )
+{
+    struct wait_completion_packet *packet = private;
+
+    packet->wait = NULL;
+    if (!(packet->msg = queue_completion( packet->completion, packet->ckey, packet->cvalue,
+                                          packet->status, packet->information, packet )))
+        wait_completion_packet_reset( packet );
+}
+
+static struct wait_completion_packet *get_wait_completion_packet_obj( struct process *process, obj_handle_t handle,
+                                                                      unsigned int access )
+{
+    return (struct wait_completion_packet *)get_handle_obj( process, handle, access, &wait_completion_packet_ops );
 }
 
 /* create a completion */
@@ -226,6 +340,7 @@ DECL_HANDLER(remove_completion)
         list_remove( entry );
         completion->depth--;
         msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+        if (msg->packet) wait_completion_packet_reset( msg->packet );
         reply->ckey = msg->ckey;
         reply->cvalue = msg->cvalue;
         reply->status = msg->status;
@@ -247,3 +362,103 @@ DECL_HANDLER(query_completion)
 
     release_object( completion );
 }
+
+/* create a wait completion packet */
+DECL_HANDLER(create_wait_completion_packet)
+{
+    struct wait_completion_packet *packet;
+    struct unicode_str name;
+    struct object *root;
+    const struct security_descriptor *sd;
+    const struct object_attributes *objattr = get_req_object_attributes( &sd, &name, &root );
+
+    if (!objattr) return;
+
+    if ((packet = create_named_object( root, &wait_completion_packet_ops, &name, objattr->attributes, sd )))
+    {
+        if (get_error() != STATUS_OBJECT_NAME_EXISTS)
+        {
+            packet->completion = NULL;
+            packet->wait       = NULL;
+            packet->msg        = NULL;
+        }
+        reply->handle = alloc_handle( current->process, packet, req->access, objattr->attributes );
+        release_object( packet );
+    }
+
+    if (root) release_object( root );
+}
+
+/* queue a wait completion packet to a port once an object is signaled */
+DECL_HANDLER(associate_wait_completion_packet)
+{
+    struct wait_completion_packet *packet;
+    struct completion *completion;
+    struct object *obj;
+
+    if (!(packet = get_wait_completion_packet_obj( current->process, req->handle,
+                                                   WAIT_COMPLETION_PACKET_MODIFY_STATE )))
+        return;
+
+    if (packet->completion)
+    {
+        set_error( STATUS_INVALID_PARAMETER_1 );
+        release_object( packet );
+        return;
+    }
+    if (!(completion = get_completion_obj( current->process, req->chandle, IO_COMPLETION_MODIFY_STATE )))
+    {
+        release_object( packet );
+        return;
+    }
+    if (!(obj = get_handle_obj( current->process, req->target, SYNCHRONIZE, NULL )))
+    {
+        release_object( completion );
+        release_object( packet );
+        return;
+    }
+
+    packet->completion  = completion;
+    packet->ckey        = req->ckey;
+    packet->cvalue      = req->cvalue;
+    packet->information = req->information;
+    packet->status      = req->status;
+
+    /* like a regular wait, the calling thread acquires the object, e.g. owns a mutex */
+    if (!(packet->wait = create_object_wait( current, obj, wait_completion_packet_signaled, packet )))
+        wait_completion_packet_reset( packet );
+    else if (wake_object_wait( packet->wait ))
+        reply->signaled = 1;
+
+    release_object( obj );
+    release_object( packet );
+}
+
+/* cancel the wait of a wait completion packet */
+DECL_HANDLER(cancel_wait_completion_packet)
+{
+    struct wait_completion_packet *packet;
+
+    if (!(packet = get_wait_completion_packet_obj( current->process, req->handle,
+                                                   WAIT_COMPLETION_PACKET_MODIFY_STATE )))
+        return;
+
+    if (packet->wait)
+    {
+        cancel_object_wait( packet->wait );
+        packet->wait = NULL;
+        wait_completion_packet_reset( packet );
+    }
+    else if (!packet->msg)
+        set_error( STATUS_CANCELLED );
+    else if (req->remove_signaled)
+    {
+        list_remove( &packet->msg->queue_entry );
+        packet->completion->depth--;
+        free( packet->msg );
+        wait_completion_packet_reset( packet );
+    }
+    else set_error( STATUS_PENDING );
+
+    release_object( packet );
+}
@@ -137,6 +137,7 @@ static const struct object_ops directory_ops =
 
 static struct directory *root_directory;
 static struct directory *dir_objtype;
+static struct shared_type_counts *shared_type_counts;
 
 
 static struct type_descr *types[] =
@@ -163,6 +164,48 @@ static struct type_descr *types[] =
     &key_type,
 };
 
+/* return the index of a type in the object types table, or -1 if it's not a named type */
+int get_object_type_index( const struct type_descr *type )
+{
+    if (type->index >= ARRAY_SIZE(types) || types[type->index] != type) return -1;
+    return type->index;
+}
+
+/* mirror the object and handle counts of a type to the shared counters */
+void update_shared_type_counts( const struct type_descr *type )
+{
+    struct shared_type_counts *counts;
+    int index;
+
+    if (!shared_type_counts || (index = get_object_type_index( type )) == -1) return;
+    counts = &shared_type_counts[index];
+    counts->seq++;
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    counts->obj_count    = type->obj_count;
+    counts->handle_count = type->handle_count;
+    counts->obj_max      = type->obj_max;
+    counts->handle_max   = type->handle_max;
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    counts->seq++;
+}
+
+/* create the mapping holding the shared object type counters */
+static struct object *create_type_counts_mapping( struct object *root, const struct unicode_str *name,
+                                                  unsigned int attr, const struct security_descriptor *sd )
+{
+    struct object *obj;
+    unsigned int i;
+    void *ptr;
+
+    C_ASSERT( ARRAY_SIZE(types) <= SHARED_TYPE_COUNT );
+
+    if (!(obj = create_shared_mapping( root, name, SHARED_TYPE_COUNT * sizeof(*shared_type_counts),
+                                       attr, sd, &ptr ))) return NULL;
+    if ((shared_type_counts = ptr))
+        for (i = 0; i < ARRAY_SIZE(types); i++) update_shared_type_counts( types[i] );
+    return obj;
+}
+
 static void object_type_dump( struct object *obj, int verbose )
 {
     fputs( "Object type\n", stderr );
@@ -440,7 +483,11 @@ void init_directories( struct fd *intl_fd )
     static const WCHAR intlW[] = {'N','l','s','S','e','c','t','i','o','n','L','A','N','G','_','I','N','T','L'};
     static const WCHAR user_dataW[] = {'_','_','w','i','n','e','_','u','s','e','r','_','s','h','a','r','e','d','_','d','a','t','a'};
     static const struct unicode_str intl_str = {intlW, sizeof(intlW)};
+    static const WCHAR registry_stampsW[] = {'_','_','w','i','n','e','_','r','e','g','i','s','t','r','y','_','s','t','a','m','p','s'};
+    static const WCHAR type_countsW[] = {'_','_','w','i','n','e','_','o','b','j','e','c','t','_','t','y','p','e','_','c','o','u','n','t','s'};
     static const struct unicode_str user_data_str = {user_dataW, sizeof(user_dataW)};
+    static const struct unicode_str registry_stamps_str = {registry_stampsW, sizeof(registry_stampsW)};
+    static const struct unicode_str type_counts_str = {type_countsW, sizeof(type_countsW)};
 
     struct directory *dir_driver, *dir_device, *dir_global, *dir_kernel, *dir_nls;
     struct object *named_pipe_device, *mailslot_device, *null_device;
@@ -489,6 +536,8 @@ void init_directories( struct fd *intl_fd )
     /* mappings */
     release_object( create_fd_mapping( &dir_nls->obj, &intl_str, intl_fd, OBJ_PERMANENT, NULL ));
     release_object( create_user_data_mapping( &dir_kernel->obj, &user_data_str, OBJ_PERMANENT, NULL ));
+    release_object( create_registry_stamps_mapping( &dir_kernel->obj, &registry_stamps_str, OBJ_PERMANENT, NULL ));
+    release_object( create_type_counts_mapping( &dir_kernel->obj, &type_counts_str, OBJ_PERMANENT, NULL ));
     release_object( intl_fd );
 
     release_object( named_pipe_device );
@@ -55,7 +55,8 @@ struct event
     struct object  obj;             /* object header */
     struct list    kernel_object;   /* list of kernel object pointers */
     int            manual_reset;    /* is it a manual reset event? */
-    int            signaled;        /* event has been signaled */
+    struct fast_sync_slot *sync;    /* event state, shared with clients or pointing to local */
+    struct fast_sync_slot  local;   /* event state when it isn't shared */
 };
 
 static void event_dump( struct object *obj, int verbose );
@@ -63,6 +64,7 @@ static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int event_signal( struct object *obj, unsigned int access);
 static struct list *event_get_kernel_obj_list( struct object *obj );
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
@@ -85,7 +87,7 @@ static const struct object_ops event_ops =
     no_open_file,              /* open_file */
     event_get_kernel_obj_list, /* get_kernel_obj_list */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -149,7 +151,9 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             /* initialize it if it didn't already exist */
             list_init( &event->kernel_object );
             event->manual_reset = manual_reset;
-            event->signaled     = initial_state;
+            event->sync = alloc_fast_sync( &event->obj, manual_reset ? FAST_SYNC_MANUAL_EVENT : FAST_SYNC_AUTO_EVENT,
+                                           &event->local );
+            event->sync->state  = initial_state;
         }
     }
     return event;
@@ -162,22 +166,30 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
 
 static void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    fast_sync_set_state( event->sync, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    /* clients sleeping on the event never see it signaled, release them through the pulse count */
+    if (event->manual_reset)
+    {
+        fast_sync_set_state( event->sync, 0 );
+        fast_sync_pulse( &event->obj, 0 );
+    }
+    else if (__atomic_exchange_n( &event->sync->state, 0, __ATOMIC_SEQ_CST ))
+        fast_sync_pulse( &event->obj, 1 );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    fast_sync_set_state( event->sync, 1 );
+    fast_sync_wake( &event->obj );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    fast_sync_set_state( event->sync, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
@@ -185,14 +197,14 @@ static void event_dump( struct object *obj, int verbose )
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     fprintf( stderr, "Event manual=%d signaled=%d\n",
-             event->manual_reset, event->signaled );
+             event->manual_reset, fast_sync_get_state( event->sync ));
 }
 
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    return fast_sync_get_state( event->sync );
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -200,7 +212,7 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    if (!event->manual_reset) fast_sync_set_state( event->sync, 0 );
 }
 
 static int event_signal( struct object *obj, unsigned int access )
@@ -223,6 +235,12 @@ static struct list *event_get_kernel_obj_list( struct object *obj )
     return &event->kernel_object;
 }
 
+static void event_destroy( struct object *obj )
+{
+    assert( obj->ops == &event_ops );
+    free_fast_sync( obj );
+}
+
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -316,7 +334,7 @@ DECL_HANDLER(event_op)
     struct event *event;
 
     if (!(event = get_event_obj( current->process, req->handle, EVENT_MODIFY_STATE ))) return;
-    reply->state = event->signaled;
+    reply->state = fast_sync_get_state( event->sync );
     switch(req->op)
     {
     case PULSE_EVENT:
@@ -343,7 +361,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = fast_sync_get_state( event->sync );
 
     release_object( event );
 }
@@ -0,0 +1,286 @@
+/*
+ * Server-side fast synchronization objects
+ *
+ * Copyright (C) the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When WINEFUTEXSYNC is set, the state of events, semaphores and mutexes
+ * lives in a mapping shared with the clients of the session that created
+ * them, which signal and wait on them with atomic operations and futexes.
+ *
+ * The server keeps using the same state for the waits it handles itself.
+ * While checking a wait it sets FAST_SYNC_LOCKED in the state of the
+ * objects, so that wait-all and acquiring an object are atomic with
+ * respect to the clients, which leave a locked state alone until the
+ * server is done with it.
+ *
+ * Clients never acquire a free mutex themselves, the server does it for
+ * them so that it knows the mutexes to abandon when a thread dies.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "process.h"
+#include "thread.h"
+#include "request.h"
+
+#define FUTEX_WAKE 1
+
+/* the index of the session is stored in the upper bits of the object fast_sync field */
+#define MAX_FAST_SYNC_SESSIONS 16
+#define SLOT_INDEX(index)      ((index) % FAST_SYNC_SLOT_COUNT)
+#define SESSION_INDEX(index)   ((index) / FAST_SYNC_SLOT_COUNT)
+
+struct fast_sync_session
+{
+    unsigned int           id;          /* session id */
+    unsigned int           index;       /* index in the sessions array */
+    struct object         *mapping;     /* mapping of the shared slots */
+    struct fast_sync_slot *slots;       /* shared slots */
+    unsigned int          *free_slots;  /* indices of the released slots */
+    unsigned int           free_count;  /* number of released slots */
+    unsigned int           next_slot;   /* next never used slot, slot 0 is never used */
+    unsigned char         *locks;       /* number of times the server locked each slot */
+};
+
+static int fast_sync_enabled;
+static struct fast_sync_session *sessions[MAX_FAST_SYNC_SESSIONS];
+static unsigned int session_count;
+
+void init_fast_sync(void)
+{
+#if defined(__linux__) && defined(__NR_futex)
+    const char *env = getenv( "WINEFUTEXSYNC" );
+
+    fast_sync_enabled = env && atoi( env );
+#endif
+}
+
+/* get the shared slots of a session, creating them on first use */
+static struct fast_sync_session *get_fast_sync_session( unsigned int id )
+{
+    struct fast_sync_session *session;
+    unsigned int i;
+    void *ptr = NULL;
+
+    if (!fast_sync_enabled) return NULL;
+    for (i = 0; i < session_count; i++) if (sessions[i]->id == id) return sessions[i];
+    if (session_count == MAX_FAST_SYNC_SESSIONS) return NULL;
+
+    if (!(session = mem_alloc( sizeof(*session) ))) return NULL;
+    session->id         = id;
+    session->index      = session_count;
+    session->free_count = 0;
+    session->next_slot  = 1;
+    session->free_slots = mem_alloc( FAST_SYNC_SLOT_COUNT * sizeof(*session->free_slots) );
+    session->locks      = mem_alloc( FAST_SYNC_SLOT_COUNT * sizeof(*session->locks) );
+    session->mapping    = NULL;
+    if (session->free_slots && session->locks)
+        session->mapping = create_shared_mapping( NULL, NULL, FAST_SYNC_SLOT_COUNT * sizeof(*session->slots),
+                                                  0, NULL, &ptr );
+    if (!session->mapping || !ptr)
+    {
+        if (session->mapping) release_object( session->mapping );
+        free( session->free_slots );
+        free( session->locks );
+        free( session );
+        return NULL;
+    }
+    session->slots = ptr;
+    memset( session->locks, 0, FAST_SYNC_SLOT_COUNT * sizeof(*session->locks) );
+    sessions[session_count++] = session;
+    return session;
+}
+
+static struct fast_sync_slot *get_object_slot( struct object *obj, struct fast_sync_session **session )
+{
+    *session = sessions[SESSION_INDEX( obj->fast_sync )];
+    return &(*session)->slots[SLOT_INDEX( obj->fast_sync )];
+}
+
+/* allocate a shared slot for an object, falling back to a server-private one */
+struct fast_sync_slot *alloc_fast_sync( struct object *obj, unsigned int type, struct fast_sync_slot *local )
+{
+    struct fast_sync_session *session;
+    struct fast_sync_slot *sync = local;
+    unsigned int index = 0;
+
+    /* objects created by the server itself are only waited on in the server */
+    if (current && (session = get_fast_sync_session( current->process->session_id )))
+    {
+        if (session->free_count) index = session->free_slots[--session->free_count];
+        else if (session->next_slot < FAST_SYNC_SLOT_COUNT) index = session->next_slot++;
+        if (index)
+        {
+            sync = &session->slots[index];
+            index += session->index * FAST_SYNC_SLOT_COUNT;
+        }
+    }
+    /* the futex word and the pulse count are left alone so that a stale waiter can't miss a change */
+    sync->waiters        = 0;
+    sync->server_waiters = 0;
+    sync->type           = type;
+    sync->state          = 0;
+    sync->count          = 0;
+    sync->max            = 0;
+    sync->pulse         &= ~1;
+    sync->abandoned      = 0;
+    obj->fast_sync = index;
+    return sync;
+}
+
+void free_fast_sync( struct object *obj )
+{
+    struct fast_sync_session *session;
+    struct fast_sync_slot *sync;
+
+    if (!obj->fast_sync) return;
+    sync = get_object_slot( obj, &session );
+    assert( !session->locks[SLOT_INDEX( obj->fast_sync )] );
+    sync->type = 0;
+    session->free_slots[session->free_count++] = SLOT_INDEX( obj->fast_sync );
+    obj->fast_sync = 0;
+}
+
+/* get the index of the slot of an object as seen by a process, 0 if it can't use it */
+unsigned int get_fast_sync_index( struct process *process, struct object *obj )
+{
+    if (!obj->fast_sync || sessions[SESSION_INDEX( obj->fast_sync )]->id != process->session_id) return 0;
+    return SLOT_INDEX( obj->fast_sync );
+}
+
+/* get the state of an object, ignoring the server lock */
+unsigned int fast_sync_get_state( struct fast_sync_slot *sync )
+{
+    return __atomic_load_n( &sync->state, __ATOMIC_SEQ_CST ) & ~FAST_SYNC_LOCKED;
+}
+
+/* set the state of an object; clients may change it at the same time unless it is locked */
+void fast_sync_set_state( struct fast_sync_slot *sync, unsigned int state )
+{
+    state |= __atomic_load_n( &sync->state, __ATOMIC_SEQ_CST ) & FAST_SYNC_LOCKED;
+    __atomic_store_n( &sync->state, state, __ATOMIC_SEQ_CST );
+}
+
+/* prevent clients from changing the state of an object while checking a wait on it */
+void fast_sync_lock( struct object *obj )
+{
+    struct fast_sync_session *session;
+    struct fast_sync_slot *sync;
+
+    if (!obj->fast_sync) return;
+    sync = get_object_slot( obj, &session );
+    /* an object may be waited on more than once in the same wait */
+    if (session->locks[SLOT_INDEX( obj->fast_sync )]++) return;
+    /* flag the server waiter before locking the state, clients check it after changing the state */
+    if (!__atomic_load_n( &sync->server_waiters, __ATOMIC_SEQ_CST ))
+        __atomic_store_n( &sync->server_waiters, 1, __ATOMIC_SEQ_CST );
+    __atomic_fetch_or( &sync->state, FAST_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+}
+
+void fast_sync_unlock( struct object *obj )
+{
+    struct fast_sync_session *session;
+    struct fast_sync_slot *sync;
+
+    if (!obj->fast_sync) return;
+    sync = get_object_slot( obj, &session );
+    assert( session->locks[SLOT_INDEX( obj->fast_sync )] );
+    if (--session->locks[SLOT_INDEX( obj->fast_sync )]) return;
+    __atomic_fetch_and( &sync->state, ~FAST_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+}
+
+/* wake the clients sleeping on the futex of an object */
+void fast_sync_wake( struct object *obj )
+{
+    struct fast_sync_session *session;
+    struct fast_sync_slot *sync;
+
+    if (!obj->fast_sync) return;
+    sync = get_object_slot( obj, &session );
+    __atomic_add_fetch( &sync->futex, 1, __ATOMIC_SEQ_CST );
+#if defined(__linux__) && defined(__NR_futex)
+    if (__atomic_load_n( &sync->waiters, __ATOMIC_SEQ_CST ))
+        syscall( __NR_futex, &sync->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+#endif
+}
+
+/* let the clients waiting on an event know that it got pulsed; a pending
+ * pulse releases a single waiter of an auto-reset event */
+void fast_sync_pulse( struct object *obj, int pending )
+{
+    struct fast_sync_session *session;
+    struct fast_sync_slot *sync;
+    unsigned int pulse;
+
+    if (!obj->fast_sync) return;
+    sync = get_object_slot( obj, &session );
+    /* clients only clear the pending bit, so the count can't change under us */
+    pulse = (__atomic_load_n( &sync->pulse, __ATOMIC_SEQ_CST ) & ~1) + 2;
+    __atomic_store_n( &sync->pulse, pulse | !!pending, __ATOMIC_SEQ_CST );
+    fast_sync_wake( obj );
+}
+
+/* get a mapping of the fast sync slots of the session */
+DECL_HANDLER(get_fast_sync_mapping)
+{
+    struct fast_sync_session *session;
+
+    if (!(session = get_fast_sync_session( current->process->session_id )))
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    reply->handle = alloc_handle_no_access_check( current->process, session->mapping,
+                                                  SECTION_MAP_READ | SECTION_MAP_WRITE, 0 );
+}
+
+/* wake the server waiters of an object signaled by a client */
+DECL_HANDLER(fast_sync_wake)
+{
+    struct fast_sync_session *session;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    if (obj->fast_sync)
+    {
+        wake_up( obj, 0 );
+        if (list_empty( &obj->wait_queue ))
+            __atomic_store_n( &get_object_slot( obj, &session )->server_waiters, 0, __ATOMIC_SEQ_CST );
+    }
+    release_object( obj );
+}
@@ -2813,6 +2813,38 @@ DECL_HANDLER(get_handle_fd)
     }
 }
 
+/* get the unix fds of several handles */
+DECL_HANDLER(get_handle_fds)
+{
+    const obj_handle_t *handles = get_req_data();
+    unsigned int i, count = get_req_data_size() / sizeof(*handles);
+    struct handle_fd_info *info;
+    struct fd *fd;
+
+    if (!(info = set_reply_data_size( count * sizeof(*info) ))) return;
+
+    for (i = 0; i < count; i++)
+    {
+        memset( &info[i], 0, sizeof(info[i]) );
+        info[i].handle = handles[i];
+        if ((fd = get_handle_fd_obj( current->process, handles[i], 0 )))
+        {
+            int unix_fd = get_unix_fd( fd );
+            info[i].cacheable = fd->cacheable;
+            if (unix_fd != -1)
+            {
+                info[i].type = fd->fd_ops->get_fd_type( fd );
+                info[i].options = fd->options;
+                info[i].access = get_handle_access( current->process, handles[i] );
+                send_client_fd( current->process, unix_fd, handles[i] );
+            }
+            release_object( fd );
+        }
+        info[i].status = get_error();
+        clear_error();
+    }
+}
+
 /* perform a read on a file object */
 DECL_HANDLER(read)
 {
@@ -2892,7 +2924,8 @@ DECL_HANDLER(register_async)
     {
         if (get_unix_fd( fd ) != -1 && (async = create_async( fd, current, &req->async, NULL )))
         {
-            fd->fd_ops->queue_async( fd, async, req->type, req->count );
+            if (req->direct) reply->wait = async_handoff_direct( async );
+            else fd->fd_ops->queue_async( fd, async, req->type, req->count );
             release_object( async );
         }
         release_object( fd );
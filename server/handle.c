@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -34,6 +35,7 @@
 #include "winternl.h"
 
 #include "handle.h"
+#include "file.h"
 #include "process.h"
 #include "thread.h"
 #include "security.h"
@@ -53,6 +55,8 @@ struct handle_table
     int                  last;        /* last used entry */
     int                  free;        /* first entry that may be free */
     struct handle_entry *entries;     /* handle entries */
+    struct object       *mapping;     /* mapping of the client-visible mirror */
+    struct shared_handle *shared;     /* client-visible mirror of the entries */
 };
 
 static struct handle_table *global_table;
@@ -103,6 +107,7 @@ static struct object *grab_object_for_handle( struct object *obj )
     obj->handle_count++;
     obj->ops->type->handle_count++;
     obj->ops->type->handle_max = max( obj->ops->type->handle_max, obj->ops->type->handle_count );
+    update_shared_type_counts( obj->ops->type );
     return grab_object( obj );
 }
 
@@ -112,9 +117,30 @@ static void release_object_from_handle( struct object *obj )
     assert( obj->handle_count );
     obj->ops->type->handle_count--;
     obj->handle_count--;
+    update_shared_type_counts( obj->ops->type );
     release_object( obj );
 }
 
+/* update the client-visible mirror of a handle entry */
+static void update_shared_handle( struct handle_table *table, const struct handle_entry *entry )
+{
+    struct shared_handle *shared;
+    int index = entry - table->entries, type;
+
+    if (!table->shared || index >= SHARED_HANDLE_COUNT) return;
+    shared = &table->shared[index];
+    if (!entry->ptr)
+    {
+        shared->type = 0;
+        return;
+    }
+    type = get_object_type_index( entry->ptr->ops->type );
+    shared->access    = entry->access & ~RESERVED_ALL;
+    shared->flags     = (entry->access & RESERVED_ALL) >> RESERVED_SHIFT;
+    shared->fast_sync = get_fast_sync_index( table->process, entry->ptr );
+    shared->type      = type == -1 ? SHARED_HANDLE_UNKNOWN_TYPE : type + 1;
+}
+
 static void handle_table_dump( struct object *obj, int verbose );
 static void handle_table_destroy( struct object *obj );
 
@@ -186,6 +212,8 @@ static void handle_table_destroy( struct object *obj )
         }
     }
     free( table->entries );
+    if (table->shared) munmap( table->shared, SHARED_HANDLE_COUNT * sizeof(*table->shared) );
+    if (table->mapping) release_object( table->mapping );
 }
 
 /* close all the process handles and free the handle table */
@@ -209,6 +237,8 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
     table->count   = count;
     table->last    = -1;
     table->free    = 0;
+    table->mapping = NULL;
+    table->shared  = NULL;
     if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
     release_object( table );
     return NULL;
@@ -248,6 +278,7 @@ static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned
     table->free = i + 1;
     entry->ptr    = grab_object_for_handle( obj );
     entry->access = access;
+    update_shared_handle( table, entry );
     return index_to_handle(i);
 }
 
@@ -430,6 +461,7 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
     entry->ptr = NULL;
     table = handle_is_global(handle) ? global_table : process->handles;
+    update_shared_handle( table, entry );
     if (entry < table->entries + table->free) table->free = entry - table->entries;
     if (entry == table->entries + table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
@@ -542,6 +574,7 @@ static int set_handle_flags( struct process *process, obj_handle_t handle, int m
     mask  = (mask << RESERVED_SHIFT) & RESERVED_ALL;
     flags = (flags << RESERVED_SHIFT) & mask;
     entry->access = (entry->access & ~mask) | flags;
+    if (!handle_is_global( handle )) update_shared_handle( process->handles, entry );
     return (old_access & RESERVED_ALL) >> RESERVED_SHIFT;
 }
 
@@ -590,6 +623,7 @@ obj_handle_t duplicate_handle( struct process *src, obj_handle_t src_handle, str
         {
             if (attr & OBJ_INHERIT) access |= RESERVED_INHERIT;
             entry->access = access;
+            if (!handle_is_global( src_handle )) update_shared_handle( src->handles, entry );
             res = src_handle;
         }
         else
@@ -896,3 +930,32 @@ DECL_HANDLER(compare_objects)
     release_object( obj2 );
     release_object( obj1 );
 }
+
+/* get a mapping of the handle table mirror of the current process */
+DECL_HANDLER(get_handle_table_mapping)
+{
+    struct handle_table *table = current->process->handles;
+    void *ptr;
+    int i;
+
+    if (!table)
+    {
+        set_error( STATUS_PROCESS_IS_TERMINATING );
+        return;
+    }
+    if (!table->mapping)
+    {
+        if (!(table->mapping = create_shared_mapping( NULL, NULL, SHARED_HANDLE_COUNT * sizeof(*table->shared),
+                                                      0, NULL, &ptr )))
+            return;
+        if (!(table->shared = ptr))
+        {
+            release_object( table->mapping );
+            table->mapping = NULL;
+            set_error( STATUS_NO_MEMORY );
+            return;
+        }
+        for (i = 0; i <= table->last; i++) update_shared_handle( table, &table->entries[i] );
+    }
+    reply->handle = alloc_handle_no_access_check( current->process, table->mapping, SECTION_MAP_READ, 0 );
+}
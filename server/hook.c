@@ -150,6 +150,7 @@ static struct hook *add_hook( struct desktop *desktop, struct thread *thread, in
     hook->index  = index;
     list_add_head( &table->hooks[index], &hook->chain );
     if (thread) thread->desktop_users++;
+    queue_hooks_changed();
     return hook;
 }
 
@@ -168,6 +169,7 @@ static void free_hook( struct hook *hook )
     release_object( hook->owner );
     list_remove( &hook->chain );
     free( hook );
+    queue_hooks_changed();
 }
 
 /* find a hook from its index and proc */
@@ -295,7 +297,10 @@ static void hook_table_destroy( struct object *obj )
 static void remove_hook( struct hook *hook )
 {
     if (hook->table->counts[hook->index])
+    {
         hook->proc = 0; /* chain is in use, just mark it and return */
+        queue_hooks_changed();
+    }
     else
         free_hook( hook );
 }
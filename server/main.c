@@ -233,6 +233,7 @@ int main( int argc, char *argv[] )
     set_current_time();
     init_signals();
     init_directories( load_intl_file() );
+    init_fast_sync();
     init_registry();
     main_loop();
     return 0;
@@ -1097,21 +1097,34 @@ int get_page_size(void)
     return page_mask + 1;
 }
 
+/* create an anonymous mapping that the server keeps mapped for writing */
+struct object *create_shared_mapping( struct object *root, const struct unicode_str *name, mem_size_t size,
+                                      unsigned int attr, const struct security_descriptor *sd, void **ptr )
+{
+    struct mapping *mapping;
+    void *base;
+
+    *ptr = NULL;
+    if (!(mapping = create_mapping( root, name, attr, size, SEC_COMMIT, 0,
+                                    FILE_READ_DATA | FILE_WRITE_DATA, sd ))) return NULL;
+    base = mmap( NULL, mapping->size, PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (base != MAP_FAILED) *ptr = base;
+    return &mapping->obj;
+}
+
 struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
+    struct object *obj;
     void *ptr;
-    struct mapping *mapping;
 
-    if (!(mapping = create_mapping( root, name, attr, sizeof(KSHARED_USER_DATA),
-                                    SEC_COMMIT, 0, FILE_READ_DATA | FILE_WRITE_DATA, sd ))) return NULL;
-    ptr = mmap( NULL, mapping->size, PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
-    if (ptr != MAP_FAILED)
+    if (!(obj = create_shared_mapping( root, name, sizeof(KSHARED_USER_DATA), attr, sd, &ptr ))) return NULL;
+    if (ptr)
     {
         user_shared_data = ptr;
         user_shared_data->SystemCall = 1;
     }
-    return &mapping->obj;
+    return obj;
 }
 
 /* create a file mapping */
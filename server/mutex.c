@@ -53,10 +53,9 @@ struct type_descr mutex_type =
 struct mutex
 {
     struct object  obj;             /* object header */
-    struct thread *owner;           /* mutex owner */
-    unsigned int   count;           /* recursion count */
-    int            abandoned;       /* has it been abandoned? */
     struct list    entry;           /* entry in owner thread mutex list */
+    struct fast_sync_slot *sync;    /* owner, recursion count and abandoned state */
+    struct fast_sync_slot  local;   /* mutex state when it isn't shared */
 };
 
 static void mutex_dump( struct object *obj, int verbose );
@@ -93,12 +92,13 @@ static const struct object_ops mutex_ops =
 /* grab a mutex for a given thread */
 static void do_grab( struct mutex *mutex, struct thread *thread )
 {
-    assert( !mutex->count || (mutex->owner == thread) );
+    assert( !mutex->sync->count || fast_sync_get_state( mutex->sync ) == thread->id );
 
-    if (!mutex->count++)  /* FIXME: avoid wrap-around */
+    if (!mutex->sync->count++)  /* FIXME: avoid wrap-around */
     {
-        assert( !mutex->owner );
-        mutex->owner = thread;
+        fast_sync_set_state( mutex->sync, thread->id );
+        /* a client may have released it without telling the previous owner thread */
+        list_remove( &mutex->entry );
         list_add_head( &thread->mutex_list, &mutex->entry );
     }
 }
@@ -106,13 +106,21 @@ static void do_grab( struct mutex *mutex, struct thread *thread )
 /* release a mutex once the recursion count is 0 */
 static void do_release( struct mutex *mutex )
 {
-    assert( !mutex->count );
+    assert( !mutex->sync->count );
     /* remove the mutex from the thread list of owned mutexes */
     list_remove( &mutex->entry );
-    mutex->owner = NULL;
+    list_init( &mutex->entry );
+    fast_sync_set_state( mutex->sync, 0 );
+    fast_sync_wake( &mutex->obj );
     wake_up( &mutex->obj, 0 );
 }
 
+/* check if a mutex is owned by the current thread */
+static int is_mutex_owned( struct mutex *mutex )
+{
+    return mutex->sync->count && fast_sync_get_state( mutex->sync ) == current->id;
+}
+
 static struct mutex *create_mutex( struct object *root, const struct unicode_str *name,
                                    unsigned int attr, int owned, const struct security_descriptor *sd )
 {
@@ -123,9 +131,8 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
         if (get_error() != STATUS_OBJECT_NAME_EXISTS)
         {
             /* initialize it if it didn't already exist */
-            mutex->count = 0;
-            mutex->owner = NULL;
-            mutex->abandoned = 0;
+            mutex->sync = alloc_fast_sync( &mutex->obj, FAST_SYNC_MUTEX, &mutex->local );
+            list_init( &mutex->entry );
             if (owned) do_grab( mutex, current );
         }
     }
@@ -139,9 +146,15 @@ void abandon_mutexes( struct thread *thread )
     while ((ptr = list_head( &thread->mutex_list )) != NULL)
     {
         struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
-        assert( mutex->owner == thread );
-        mutex->count = 0;
-        mutex->abandoned = 1;
+        if (fast_sync_get_state( mutex->sync ) != thread->id)
+        {
+            /* released by a client through the shared state */
+            list_remove( &mutex->entry );
+            list_init( &mutex->entry );
+            continue;
+        }
+        mutex->sync->count = 0;
+        mutex->sync->abandoned = 1;
         do_release( mutex );
     }
 }
@@ -150,14 +163,15 @@ static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    fprintf( stderr, "Mutex count=%u owner=%04x\n", mutex->sync->count, fast_sync_get_state( mutex->sync ));
 }
 
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    unsigned int owner = fast_sync_get_state( mutex->sync );
     assert( obj->ops == &mutex_ops );
-    return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
+    return (!owner || owner == get_wait_queue_thread( entry )->id);
 }
 
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -166,8 +180,8 @@ static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry
     assert( obj->ops == &mutex_ops );
 
     do_grab( mutex, get_wait_queue_thread( entry ));
-    if (mutex->abandoned) make_wait_abandoned( entry );
-    mutex->abandoned = 0;
+    if (mutex->sync->abandoned) make_wait_abandoned( entry );
+    mutex->sync->abandoned = 0;
 }
 
 static int mutex_signal( struct object *obj, unsigned int access )
@@ -180,12 +194,12 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
-    if (!mutex->count || (mutex->owner != current))
+    if (!is_mutex_owned( mutex ))
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
         return 0;
     }
-    if (!--mutex->count) do_release( mutex );
+    if (!--mutex->sync->count) do_release( mutex );
     return 1;
 }
 
@@ -194,9 +208,13 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
-    if (!mutex->count) return;
-    mutex->count = 0;
-    do_release( mutex );
+    if (mutex->sync->count)
+    {
+        mutex->sync->count = 0;
+        do_release( mutex );
+    }
+    else list_remove( &mutex->entry );
+    free_fast_sync( obj );
 }
 
 /* create a mutex */
@@ -240,11 +258,11 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
+        if (!is_mutex_owned( mutex )) set_error( STATUS_MUTANT_NOT_OWNED );
         else
         {
-            reply->prev_count = mutex->count;
-            if (!--mutex->count) do_release( mutex );
+            reply->prev_count = mutex->sync->count;
+            if (!--mutex->sync->count) do_release( mutex );
         }
         release_object( mutex );
     }
@@ -258,9 +276,9 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        reply->count = mutex->sync->count;
+        reply->owned = is_mutex_owned( mutex );
+        reply->abandoned = mutex->sync->abandoned;
 
         release_object( mutex );
     }
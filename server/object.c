@@ -202,6 +202,7 @@ void *alloc_object( const struct object_ops *ops )
         obj->refcount     = 1;
         obj->handle_count = 0;
         obj->is_permanent = 0;
+        obj->fast_sync    = 0;
         obj->ops          = ops;
         obj->name         = NULL;
         obj->sd           = NULL;
@@ -211,6 +212,7 @@ void *alloc_object( const struct object_ops *ops )
 #endif
         obj->ops->type->obj_count++;
         obj->ops->type->obj_max = max( obj->ops->type->obj_max, obj->ops->type->obj_count );
+        update_shared_type_counts( obj->ops->type );
         return obj;
     }
     return NULL;
@@ -221,6 +223,7 @@ static void free_object( struct object *obj )
 {
     free( obj->sd );
     obj->ops->type->obj_count--;
+    update_shared_type_counts( obj->ops->type );
 #ifdef DEBUG_OBJECTS
     list_remove( &obj->obj_list );
     memset( obj, 0xaa, obj->ops->size );
@@ -118,6 +118,7 @@ struct object
     struct object_name       *name;
     struct security_descriptor *sd;
     unsigned int              is_permanent:1;
+    unsigned int              fast_sync;   /* index of the fast sync slot and its session, 0 if none */
 #ifdef DEBUG_OBJECTS
     struct list               obj_list;
 #endif
@@ -219,6 +220,20 @@ extern void reset_event( struct event *event );
 
 extern void abandon_mutexes( struct thread *thread );
 
+/* fast sync functions */
+
+extern void init_fast_sync(void);
+extern struct fast_sync_slot *alloc_fast_sync( struct object *obj, unsigned int type,
+                                               struct fast_sync_slot *local );
+extern void free_fast_sync( struct object *obj );
+extern unsigned int get_fast_sync_index( struct process *process, struct object *obj );
+extern unsigned int fast_sync_get_state( struct fast_sync_slot *sync );
+extern void fast_sync_set_state( struct fast_sync_slot *sync, unsigned int state );
+extern void fast_sync_lock( struct object *obj );
+extern void fast_sync_unlock( struct object *obj );
+extern void fast_sync_wake( struct object *obj );
+extern void fast_sync_pulse( struct object *obj, int pending );
+
 /* serial functions */
 
 int get_serial_async_timeout(struct object *obj, int type, int count);
@@ -240,6 +255,8 @@ extern unsigned short supported_machines[8];
 extern unsigned short native_machine;
 extern void init_registry(void);
 extern void flush_registry(void);
+extern struct object *create_registry_stamps_mapping( struct object *root, const struct unicode_str *name,
+                                                      unsigned int attr, const struct security_descriptor *sd );
 
 static inline int is_machine_32bit( unsigned short machine )
 {
@@ -275,6 +292,8 @@ extern void release_global_atom( struct winstation *winstation, atom_t atom );
 extern struct object *get_root_directory(void);
 extern struct object *get_directory_obj( struct process *process, obj_handle_t handle );
 extern int directory_link_name( struct object *obj, struct object_name *name, struct object *parent );
+extern int get_object_type_index( const struct type_descr *type );
+extern void update_shared_type_counts( const struct type_descr *type );
 extern void init_directories( struct fd *intl_fd );
 
 /* symbolic link functions */
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <poll.h>
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -34,6 +35,7 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winternl.h"
+#include "dde.h"
 
 #include "handle.h"
 #include "file.h"
@@ -48,6 +50,9 @@
 enum message_kind { SEND_MESSAGE, POST_MESSAGE };
 #define NB_MSG_KINDS (POST_MESSAGE+1)
 
+#define MAX_HARDWARE_MESSAGES 1024  /* max number of queued hardware messages per thread input */
+#define MAX_MERGE_DISTANCE      64  /* max number of messages to skip when merging a mouse move */
+
 
 struct message_result
 {
@@ -111,6 +116,7 @@ struct thread_input
     user_handle_t          cursor;        /* current cursor */
     int                    cursor_count;  /* cursor show count */
     struct list            msg_list;      /* list of hardware messages */
+    unsigned int           msg_count;     /* count of hardware messages */
     unsigned char          keystate[256]; /* state of each key */
     unsigned char          desktop_keystate[256]; /* desktop keystate when keystate was synced */
     int                    keystate_lock; /* keystate is locked */
@@ -141,6 +147,12 @@ struct msg_queue
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
     int                    keystate_lock;   /* owns an input keystate lock */
+    struct object         *mapping;         /* mapping of the shared queue memory */
+    struct queue_shared_memory *shared;     /* queue memory shared with the owner thread */
+    unsigned int           ring_head;       /* last known head of the shared ring */
+    unsigned int           ring_tail;       /* tail of the shared ring */
+    struct list            shared_entry;    /* entry in the list of queues with shared memory */
+    unsigned int           get_count;       /* last known client message retrieval count */
 };
 
 struct hotkey
@@ -231,6 +243,9 @@ static unsigned int last_input_time;
 static cursor_pos_t cursor_history[64];
 static unsigned int cursor_history_latest;
 
+static struct list shared_queues = LIST_INIT( shared_queues );  /* queues with shared memory */
+static unsigned int hooks_generation;
+
 static void queue_hardware_message( struct desktop *desktop, struct message *msg, int always_queue );
 static void free_message( struct message *msg );
 
@@ -264,6 +279,7 @@ static struct thread_input *create_thread_input( struct thread *thread )
         input->cursor       = 0;
         input->cursor_count = 0;
         list_init( &input->msg_list );
+        input->msg_count    = 0;
         set_caret_window( input, 0 );
         memset( input->keystate, 0, sizeof(input->keystate) );
         input->keystate_lock = 0;
@@ -309,6 +325,11 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
         queue->keystate_lock   = 0;
+        queue->mapping         = NULL;
+        queue->shared          = NULL;
+        queue->ring_head       = 0;
+        queue->ring_tail       = 0;
+        queue->get_count       = 0;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -506,9 +527,66 @@ static inline int is_signaled( struct msg_queue *queue )
     return ((queue->wake_bits & queue->wake_mask) || (queue->changed_bits & queue->changed_mask));
 }
 
+/* tell the queue owners that their bitmap of active hooks may be stale; messages taken
+ * from the shared ring don't go through get_message, which would have refreshed it */
+void queue_hooks_changed(void)
+{
+    struct msg_queue *queue;
+
+    hooks_generation++;
+    LIST_FOR_EACH_ENTRY( queue, &shared_queues, struct msg_queue, shared_entry )
+        __atomic_store_n( &queue->shared->hooks_generation, hooks_generation, __ATOMIC_RELEASE );
+}
+
+/* check if there are posted messages in the shared ring that the client hasn't retrieved yet */
+static int has_ring_messages( struct msg_queue *queue )
+{
+    unsigned int i;
+
+    for (i = queue->ring_head; i != queue->ring_tail; i++)
+        if (!queue->shared->ring[i % QUEUE_RING_SIZE].removed) return 1;
+    return 0;
+}
+
+/* check if there are posted messages in the queue */
+static inline int has_posted_messages( struct msg_queue *queue )
+{
+    return !list_empty( &queue->msg_list[POST_MESSAGE] ) || has_ring_messages( queue );
+}
+
+static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits );
+
+/* pick up the changes made by the client to the shared queue memory */
+static void sync_shared_queue( struct msg_queue *queue )
+{
+    struct queue_shared_memory *shared = queue->shared;
+    unsigned int head, clear_bits, get_count;
+
+    if (!shared) return;
+
+    if ((clear_bits = __atomic_exchange_n( &shared->clear_bits, 0, __ATOMIC_SEQ_CST )))
+        queue->changed_bits &= ~clear_bits;
+
+    if ((get_count = shared->get_count) != queue->get_count)
+    {
+        queue->get_count = get_count;
+        queue->last_get_msg = current_time;
+    }
+
+    /* the client can only move the head forward, up to the tail */
+    head = __atomic_load_n( &shared->head, __ATOMIC_ACQUIRE );
+    if (head != queue->ring_head && head - queue->ring_head <= queue->ring_tail - queue->ring_head)
+    {
+        queue->ring_head = head;
+        if (!queue->quit_message && !has_posted_messages( queue ))
+            clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
+    }
+}
+
 /* set some queue bits */
 static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
+    sync_shared_queue( queue );
     if (bits & (QS_KEY | QS_MOUSEBUTTON))
     {
         if (!queue->keystate_lock) lock_input_keystate( queue->input );
@@ -516,6 +594,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
     }
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    if (queue->shared) queue->shared->wake_bits = queue->wake_bits;
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -524,6 +603,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    if (queue->shared) queue->shared->wake_bits = queue->wake_bits;
     if (!(queue->wake_bits & (QS_KEY | QS_MOUSEBUTTON)))
     {
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
@@ -583,23 +663,36 @@ static inline unsigned int get_unique_id(void)
     return id;
 }
 
-/* try to merge a message with the last in the list; return 1 if successful */
+/* check if a queued hardware message can be reordered with a later mouse move */
+static inline int is_move_independent( struct message *msg )
+{
+    return msg->msg == WM_INPUT || msg->msg == WM_INPUT_DEVICE_CHANGE || is_keyboard_msg( msg );
+}
+
+/* try to merge a mouse move with the last queued one; return 1 if successful */
 static int merge_message( struct thread_input *input, const struct message *msg )
 {
     struct message *prev;
     struct list *ptr;
+    int crossed = 0, distance = 0;
 
     if (msg->msg != WM_MOUSEMOVE) return 0;
+
+    /* look for the last mouse message, skipping the messages that don't depend on the cursor */
     for (ptr = list_tail( &input->msg_list ); ptr; ptr = list_prev( &input->msg_list, ptr ))
     {
         prev = LIST_ENTRY( ptr, struct message, entry );
-        if (prev->msg != WM_INPUT) break;
+        if (!is_move_independent( prev )) break;
+        if (prev->msg != WM_INPUT) crossed = 1;
+        if (++distance > MAX_MERGE_DISTANCE) return 0;
     }
     if (!ptr) return 0;
     if (prev->result) return 0;
     if (prev->win && msg->win && prev->win != msg->win) return 0;
     if (prev->msg != msg->msg) return 0;
     if (prev->type != msg->type) return 0;
+    /* don't reorder a message that has already been returned to the app */
+    if (crossed && prev->unique_id) return 0;
     /* now we can merge it */
     prev->wparam  = msg->wparam;
     prev->lparam  = msg->lparam;
@@ -617,6 +710,29 @@ static int merge_message( struct thread_input *input, const struct message *msg
     return 1;
 }
 
+/* remove (and free) a message from the hardware message list of a thread input */
+static void remove_input_message( struct thread_input *input, struct message *msg )
+{
+    list_remove( &msg->entry );
+    input->msg_count--;
+    free_message( msg );
+}
+
+/* make room in a full hardware message list by dropping the oldest pending mouse move */
+static int drop_input_message( struct thread_input *input )
+{
+    struct message *msg;
+
+    LIST_FOR_EACH_ENTRY( msg, &input->msg_list, struct message, entry )
+    {
+        if (msg->msg != WM_MOUSEMOVE || msg->unique_id || msg->result) continue;
+        remove_input_message( input, msg );
+        input->desktop->dropped_input++;
+        return 1;
+    }
+    return 0;
+}
+
 /* free a result structure */
 static void free_result( struct message_result *result )
 {
@@ -707,7 +823,7 @@ static void remove_queue_message( struct msg_queue *queue, struct message *msg,
         if (list_empty( &queue->msg_list[kind] )) clear_queue_bits( queue, QS_SENDMESSAGE );
         break;
     case POST_MESSAGE:
-        if (list_empty( &queue->msg_list[kind] ) && !queue->quit_message)
+        if (!queue->quit_message && !has_posted_messages( queue ))
             clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (msg->msg == WM_HOTKEY && --queue->hotkey_count == 0)
             clear_queue_bits( queue, QS_HOTKEY );
@@ -864,7 +980,37 @@ static int get_posted_message( struct msg_queue *queue, user_handle_t win,
                                unsigned int first, unsigned int last, unsigned int flags,
                                struct get_message_reply *reply )
 {
+    struct shared_posted_message *entry;
     struct message *msg;
+    unsigned int i;
+
+    /* messages in the shared ring are older than the ones in the list */
+    for (i = queue->ring_head; i != queue->ring_tail; i++)
+    {
+        entry = &queue->shared->ring[i % QUEUE_RING_SIZE];
+        if (entry->removed) continue;
+        if (!match_window( win, entry->win )) continue;
+        if (!check_msg_filter( entry->msg, first, last )) continue;
+
+        reply->total  = 0;
+        reply->type   = MSG_POSTED;
+        reply->win    = entry->win;
+        reply->msg    = entry->msg;
+        reply->wparam = entry->wparam;
+        reply->lparam = entry->lparam;
+        reply->x      = entry->x;
+        reply->y      = entry->y;
+        reply->time   = entry->time;
+
+        if (flags & PM_REMOVE)
+        {
+            /* the client skips removed entries when moving the head */
+            entry->removed = 1;
+            if (!queue->quit_message && !has_posted_messages( queue ))
+                clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
+        }
+        return 1;
+    }
 
     /* check against the filters */
     LIST_FOR_EACH_ENTRY( msg, &queue->msg_list[POST_MESSAGE], struct message, entry )
@@ -924,7 +1070,7 @@ static int get_quit_message( struct msg_queue *queue, unsigned int flags,
         if (flags & PM_REMOVE)
         {
             queue->quit_message = 0;
-            if (list_empty( &queue->msg_list[POST_MESSAGE] ))
+            if (!has_posted_messages( queue ))
                 clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         }
         return 1;
@@ -970,6 +1116,7 @@ static int is_queue_hung( struct msg_queue *queue )
 {
     struct wait_queue_entry *entry;
 
+    sync_shared_queue( queue );
     if (current_time - queue->last_get_msg <= 5 * TICKS_PER_SEC)
         return 0;  /* less than 5 seconds since last get message -> not hung */
 
@@ -1030,6 +1177,7 @@ static int msg_queue_signaled( struct object *obj, struct wait_queue_entry *entr
             /* restart waiting on poll() if we are no longer signaled */
             set_fd_events( queue->fd, POLLIN );
     }
+    sync_shared_queue( queue );
     return ret || is_signaled( queue );
 }
 
@@ -1077,6 +1225,12 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shared)
+    {
+        list_remove( &queue->shared_entry );
+        munmap( queue->shared, sizeof(*queue->shared) );
+    }
+    if (queue->mapping) release_object( queue->mapping );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1092,8 +1246,8 @@ static void msg_queue_poll_event( struct fd *fd, int event )
 static void thread_input_dump( struct object *obj, int verbose )
 {
     struct thread_input *input = (struct thread_input *)obj;
-    fprintf( stderr, "Thread input focus=%08x capture=%08x active=%08x\n",
-             input->focus, input->capture, input->active );
+    fprintf( stderr, "Thread input focus=%08x capture=%08x active=%08x messages=%u\n",
+             input->focus, input->capture, input->active, input->msg_count );
 }
 
 static void thread_input_destroy( struct object *obj )
@@ -1457,8 +1611,7 @@ static void release_hardware_message( struct msg_queue *queue, unsigned int hw_i
     if (clr_bit) clear_queue_bits( queue, clr_bit );
 
     update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
-    list_remove( &msg->entry );
-    free_message( msg );
+    remove_input_message( input, msg );
 }
 
 static int queue_hotkey_message( struct desktop *desktop, struct message *msg )
@@ -1612,11 +1765,26 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     if (win != desktop->cursor.win) always_queue = 1;
     desktop->cursor.win = win;
 
-    if (!always_queue || merge_message( input, msg )) free_message( msg );
+    if (!always_queue) free_message( msg );
+    else if (merge_message( input, msg ))
+    {
+        desktop->merged_moves++;
+        free_message( msg );
+    }
+    else if (input->msg_count >= MAX_HARDWARE_MESSAGES && !drop_input_message( input ) &&
+             msg->msg == WM_MOUSEMOVE)
+    {
+        /* no pending mouse move to make room, drop the new move; button and key
+         * transitions are queued anyway, losing them would leave them stuck */
+        desktop->dropped_input++;
+        update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+        free_message( msg );
+    }
     else
     {
         msg->unique_id = 0;  /* will be set once we return it to the app */
         list_add_tail( &input->msg_list, &msg->entry );
+        input->msg_count++;
         set_queue_bits( thread->queue, get_hardware_msg_bit(msg) );
     }
     release_object( thread );
@@ -2134,8 +2302,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
         {
             /* no window at all, remove it */
             update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
-            list_remove( &msg->entry );
-            free_message( msg );
+            remove_input_message( input, msg );
             continue;
         }
         if (win_thread != thread)
@@ -2150,8 +2317,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
             {
                 /* for another thread input, drop it */
                 update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
-                list_remove( &msg->entry );
-                free_message( msg );
+                remove_input_message( input, msg );
             }
             release_object( win_thread );
             continue;
@@ -2258,10 +2424,66 @@ void queue_cleanup_window( struct thread *thread, user_handle_t win )
             }
         }
     }
+    if (queue->shared)
+    {
+        unsigned int pos;
+
+        sync_shared_queue( queue );
+        for (pos = queue->ring_head; pos != queue->ring_tail; pos++)
+        {
+            struct shared_posted_message *entry = &queue->shared->ring[pos % QUEUE_RING_SIZE];
+            if (entry->win == win) entry->removed = 1;
+        }
+        if (!queue->quit_message && !has_posted_messages( queue ))
+            clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
+    }
 
     thread_input_cleanup_window( queue, win );
 }
 
+/* check if a posted message can be stored in the shared ring */
+static inline int is_ring_message( const struct message *msg )
+{
+    if (msg->data_size || msg->msg == WM_QUIT || msg->msg == WM_HOTKEY) return 0;
+    if (msg->msg >= WM_DDE_FIRST && msg->msg <= WM_DDE_LAST) return 0;
+    return !(msg->msg & 0x80000000);  /* internal messages */
+}
+
+/* add a posted message to a queue, storing it in the shared ring when possible */
+static void queue_posted_message( struct msg_queue *queue, struct message *msg )
+{
+    struct shared_posted_message *entry;
+
+    sync_shared_queue( queue );
+
+    /* the ring can only be used while all the posted messages fit in it */
+    if (queue->shared && list_empty( &queue->msg_list[POST_MESSAGE] ) &&
+        queue->ring_tail - queue->ring_head < QUEUE_RING_SIZE && is_ring_message( msg ))
+    {
+        entry = &queue->shared->ring[queue->ring_tail % QUEUE_RING_SIZE];
+        entry->win     = msg->win;
+        entry->msg     = msg->msg;
+        entry->wparam  = msg->wparam;
+        entry->lparam  = msg->lparam;
+        entry->x       = msg->x;
+        entry->y       = msg->y;
+        entry->time    = msg->time;
+        entry->removed = 0;
+        __atomic_store_n( &queue->shared->tail, ++queue->ring_tail, __ATOMIC_RELEASE );
+        free_message( msg );
+    }
+    else
+    {
+        list_add_tail( &queue->msg_list[POST_MESSAGE], &msg->entry );
+        if (msg->msg == WM_HOTKEY)
+        {
+            set_queue_bits( queue, QS_HOTKEY );
+            queue->hotkey_count++;
+        }
+    }
+    set_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
+}
+
 /* post a message to a window */
 void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lparam_t lparam )
 {
@@ -2283,13 +2505,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
 
         get_message_defaults( thread->queue, &msg->x, &msg->y, &msg->time );
 
-        list_add_tail( &thread->queue->msg_list[POST_MESSAGE], &msg->entry );
-        set_queue_bits( thread->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
-        if (message == WM_HOTKEY)
-        {
-            set_queue_bits( thread->queue, QS_HOTKEY );
-            thread->queue->hotkey_count++;
-        }
+        queue_posted_message( thread->queue, msg );
     }
     release_object( thread );
 }
@@ -2404,6 +2620,33 @@ DECL_HANDLER(get_msg_queue)
 }
 
 
+/* get a mapping of the shared memory of the current thread queue */
+DECL_HANDLER(get_msg_queue_mapping)
+{
+    struct msg_queue *queue = get_current_queue();
+    void *ptr;
+
+    if (!queue) return;
+    if (!queue->mapping)
+    {
+        if (!(queue->mapping = create_shared_mapping( NULL, NULL, sizeof(*queue->shared), 0, NULL, &ptr )))
+            return;
+        if (!(queue->shared = ptr))
+        {
+            release_object( queue->mapping );
+            queue->mapping = NULL;
+            set_error( STATUS_NO_MEMORY );
+            return;
+        }
+        queue->shared->wake_bits = queue->wake_bits;
+        queue->shared->hooks_generation = hooks_generation;
+        list_add_tail( &shared_queues, &queue->shared_entry );
+    }
+    reply->handle = alloc_handle_no_access_check( current->process, queue->mapping,
+                                                  SECTION_MAP_READ | SECTION_MAP_WRITE, 0 );
+}
+
+
 /* set the file descriptor associated to the current thread queue */
 DECL_HANDLER(set_queue_fd)
 {
@@ -2436,6 +2679,7 @@ DECL_HANDLER(set_queue_mask)
 
     if (queue)
     {
+        sync_shared_queue( queue );
         queue->wake_mask    = req->wake_mask;
         queue->changed_mask = req->changed_mask;
         reply->wake_bits    = queue->wake_bits;
@@ -2456,6 +2700,7 @@ DECL_HANDLER(get_queue_status)
     struct msg_queue *queue = current->queue;
     if (queue)
     {
+        sync_shared_queue( queue );
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
@@ -2524,13 +2769,7 @@ DECL_HANDLER(send_message)
             set_queue_bits( recv_queue, QS_SENDMESSAGE );
             break;
         case MSG_POSTED:
-            list_add_tail( &recv_queue->msg_list[POST_MESSAGE], &msg->entry );
-            set_queue_bits( recv_queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
-            if (msg->msg == WM_HOTKEY)
-            {
-                set_queue_bits( recv_queue, QS_HOTKEY );
-                recv_queue->hotkey_count++;
-            }
+            queue_posted_message( recv_queue, msg );
             break;
         case MSG_HARDWARE:  /* should use send_hardware_message instead */
         case MSG_CALLBACK_RESULT:  /* cannot send this one */
@@ -2622,6 +2861,7 @@ DECL_HANDLER(get_message)
     }
 
     if (!queue) return;
+    sync_shared_queue( queue );
     queue->last_get_msg = current_time;
     if (!filter) filter = QS_ALLINPUT;
 
@@ -3358,8 +3598,7 @@ DECL_HANDLER(get_rawinput_buffer)
         }
 
         memcpy( buf + pos, data, data->size );
-        list_remove( &msg->entry );
-        free_message( msg );
+        remove_input_message( input, msg );
 
         size += next_size;
         pos += sizeof(*data) + extra_size;
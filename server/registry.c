@@ -90,6 +90,9 @@ struct key
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    unsigned int      stamp_index; /* index in the shared modification stamps array */
+    struct child_index *subkey_index; /* hash index of the subkeys array */
+    struct child_index *value_index;  /* hash index of the values array */
 };
 
 /* key flags */
@@ -114,6 +117,16 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEXED  64  /* min. number of subkeys or values to build a hash index */
+
+/* hash index of the subkeys or values of a key, mapping names to array indices */
+struct child_index
+{
+    unsigned int size;     /* number of slots */
+    unsigned int count;    /* number of used slots */
+    unsigned int stale;    /* lookups since the index went out of date, 0 if it's up to date */
+    int          slots[1]; /* array indices, -1 if the slot is free */
+};
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -121,6 +134,10 @@ struct key_value
 /* the root of the registry tree */
 static struct key *root_key;
 
+/* key modification stamps, mapped read-only by clients to validate their cached values */
+static unsigned int *registry_stamps;
+static unsigned int next_stamp_index;
+
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
 static struct timeout_user *save_timeout_user;  /* saving timer */
@@ -131,7 +148,7 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index );
 
 /* information about where to save a registry branch */
 struct save_branch_info
@@ -285,12 +302,165 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* get the name of a subkey or value of a key */
+static inline void get_child_name( const struct key *key, int values, int index, struct unicode_str *name )
+{
+    if (values)
+    {
+        name->str = key->values[index].name;
+        name->len = key->values[index].namelen;
+    }
+    else
+    {
+        name->str = key->subkeys[index]->obj.name->name;
+        name->len = key->subkeys[index]->obj.name->len;
+    }
+}
+
+static inline struct child_index **get_child_index_ptr( struct key *key, int values )
+{
+    return values ? &key->value_index : &key->subkey_index;
+}
+
+/* find the slot of a child name in the index, or the free slot where it should go */
+static unsigned int get_child_index_slot( const struct key *key, int values, const struct child_index *index,
+                                          const struct unicode_str *name )
+{
+    struct unicode_str str;
+    unsigned int slot = hash_strW( name->str, name->len, index->size );
+
+    for (; index->slots[slot] != -1; slot = (slot + 1) % index->size)
+    {
+        get_child_name( key, values, index->slots[slot], &str );
+        if (str.len == name->len && !memicmp_strW( str.str, name->str, name->len )) break;
+    }
+    return slot;
+}
+
+/* (re)build the hash index for the subkeys or values of a key, reusing the old one if large enough */
+static struct child_index *build_child_index( struct key *key, int values, struct child_index *index )
+{
+    struct unicode_str name;
+    unsigned int size = 4 * MIN_INDEXED;
+    int i, count = (values ? key->last_value : key->last_subkey) + 1;
+
+    while (size < 2 * count) size *= 2;
+    if (!index || index->size < size)
+    {
+        free( index );
+        if (!(index = malloc( offsetof( struct child_index, slots[size] )))) return NULL;
+        index->size = size;
+    }
+    index->count = count;
+    index->stale = 0;
+    memset( index->slots, 0xff, index->size * sizeof(index->slots[0]) );
+    for (i = 0; i < count; i++)
+    {
+        get_child_name( key, values, i, &name );
+        index->slots[get_child_index_slot( key, values, index, &name )] = i;
+    }
+    return index;
+}
+
+/* look up a child in the hash index, building it if needed; return -1 if not indexed or not found
+ *
+ * An out of date index is only rebuilt once enough lookups have gone to the binary search,
+ * so that the cost of the rebuild is spread over them. */
+static int lookup_child_index( struct key *key, int values, const struct unicode_str *name )
+{
+    struct child_index **index = get_child_index_ptr( key, values );
+    unsigned int count = (values ? key->last_value : key->last_subkey) + 1;
+
+    if (!*index || (*index)->stale)
+    {
+        if (count < MIN_INDEXED) return -1;
+        if (*index && (*index)->stale++ < count / 8) return -1;
+        if (!(*index = build_child_index( key, values, *index ))) return -1;
+    }
+    return (*index)->slots[get_child_index_slot( key, values, *index, name )];
+}
+
+/* mark the hash index as out of date, it will be rebuilt lazily */
+static inline void invalidate_child_index( struct child_index *index )
+{
+    if (!index->stale) index->stale = 1;
+}
+
+/* update the hash index after a child has been inserted in the array at the given position
+ *
+ * Positions are stored in the index, so only appending a child (which is what loading
+ * a sorted registry file does) can be done in place without shifting them. */
+static void insert_child_index( struct key *key, int values, int pos )
+{
+    struct child_index *index = *get_child_index_ptr( key, values );
+    struct unicode_str name;
+    int last = values ? key->last_value : key->last_subkey;
+
+    if (!index || index->stale) return;
+    if (pos != last || 2 * (index->count + 1) > index->size)
+    {
+        invalidate_child_index( index );
+        return;
+    }
+    get_child_name( key, values, pos, &name );
+    index->slots[get_child_index_slot( key, values, index, &name )] = pos;
+    index->count++;
+}
+
+/* update the hash index before a child is removed from the array at the given position */
+static void remove_child_index( struct key *key, int values, int pos )
+{
+    struct child_index *index = *get_child_index_ptr( key, values );
+    struct unicode_str name;
+    unsigned int i, j, home;
+    int last = values ? key->last_value : key->last_subkey;
+
+    if (!index || index->stale) return;
+    if (pos != last)
+    {
+        invalidate_child_index( index );
+        return;
+    }
+    get_child_name( key, values, pos, &name );
+    i = get_child_index_slot( key, values, index, &name );
+    assert( index->slots[i] == pos );
+
+    /* move back the following entries of the probe sequence */
+    for (j = (i + 1) % index->size; index->slots[j] != -1; j = (j + 1) % index->size)
+    {
+        get_child_name( key, values, index->slots[j], &name );
+        home = hash_strW( name.str, name.len, index->size );
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+        {
+            index->slots[i] = index->slots[j];
+            i = j;
+        }
+    }
+    index->slots[i] = -1;
+    index->count--;
+}
+
+/* discard the hash index of the subkeys or values of a key */
+static void free_child_index( struct key *key, int values )
+{
+    struct child_index **index = get_child_index_ptr( key, values );
+
+    free( *index );
+    *index = NULL;
+}
+
 /* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+static struct key *find_subkey( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if ((i = lookup_child_index( key, 0, name )) != -1)
+    {
+        *index = i;
+        return key->subkeys[i];
+    }
+
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -582,7 +752,7 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     struct key *key = (struct key *)obj;
     struct key *parent_key = (struct key *)parent;
     struct unicode_str tmp;
-    int i, index;
+    int index;
 
     if (parent->ops != &key_ops)
     {
@@ -601,9 +771,10 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     tmp.len = name->len;
     find_subkey( parent_key, &tmp, &index );
 
-    for (i = ++parent_key->last_subkey; i > index; i--)
-        parent_key->subkeys[i] = parent_key->subkeys[i - 1];
+    memmove( parent_key->subkeys + index + 1, parent_key->subkeys + index,
+             (++parent_key->last_subkey - index) * sizeof(*parent_key->subkeys) );
     parent_key->subkeys[index] = (struct key *)grab_object( key );
+    insert_child_index( parent_key, 0, index );
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
         parent_key->wow6432node = key;
@@ -615,6 +786,7 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
 {
     struct key *key = (struct key *)obj;
     struct key *parent = (struct key *)name->parent;
+    struct unicode_str tmp;
     int i, nb_subkeys;
 
     if (!parent) return;
@@ -625,9 +797,12 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
-    for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    tmp.str = name->name;
+    tmp.len = name->len;
+    find_subkey( parent, &tmp, &i );
+    assert( i <= parent->last_subkey && parent->subkeys[i] == key );
+    remove_child_index( parent, 0, i );
+    memmove( parent->subkeys + i, parent->subkeys + i + 1, (parent->last_subkey - i) * sizeof(*parent->subkeys) );
     parent->last_subkey--;
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
@@ -646,12 +821,21 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
     }
 }
 
+/* invalidate client-side cached values of a key */
+static inline void update_key_stamp( struct key *key )
+{
+    if (registry_stamps) registry_stamps[key->stamp_index]++;
+}
+
 /* close the notification associated with a handle */
 static int key_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
 {
     struct key * key = (struct key *) obj;
     struct notify *notify = find_notify( key, process, handle );
     if (notify) do_notification( key, notify, 1 );
+    /* the owner drops its cached values itself when closing a handle, but not when
+     * another process closes it with DUPLICATE_CLOSE_SOURCE and the value gets reused */
+    if (current && process != current->process) update_key_stamp( key );
     return 1;  /* ok to close */
 }
 
@@ -669,12 +853,14 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free_child_index( key, 1 );
     for (i = 0; i <= key->last_subkey; i++)
     {
         key->subkeys[i]->obj.name->parent = NULL;
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free_child_index( key, 0 );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -708,6 +894,9 @@ static struct key *create_key_object( struct object *parent, const struct unicod
             key->last_value  = -1;
             key->values      = NULL;
             key->modif       = modif;
+            key->stamp_index = next_stamp_index++ % REGISTRY_STAMP_COUNT;
+            key->subkey_index = NULL;
+            key->value_index  = NULL;
             list_init( &key->notify_list );
 
             if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
@@ -765,6 +954,7 @@ static void touch_key( struct key *key, unsigned int change )
 {
     key->modif = current_time;
     make_dirty( key );
+    update_key_stamp( key );
 
     /* do notifications */
     check_notify( key, change, 1 );
@@ -1050,6 +1240,7 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
 
     free( key->obj.name );
     key->obj.name = new_name_ptr;
+    free_child_index( parent, 0 );
 
     if (debug_level > 1) dump_operation( key, NULL, "Rename" );
     touch_key( key, REG_NOTIFY_CHANGE_NAME );
@@ -1086,6 +1277,7 @@ static int delete_key( struct key *key, int recurse )
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
     key->flags |= KEY_DELETED;
+    update_key_stamp( key );
     unlink_named_object( &key->obj );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 1;
@@ -1117,11 +1309,17 @@ static int grow_values( struct key *key )
 }
 
 /* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if ((i = lookup_child_index( key, 1, name )) != -1)
+    {
+        *index = i;
+        return &key->values[i];
+    }
+
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1147,7 +1345,6 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
 {
     struct key_value *value;
     WCHAR *new_name = NULL;
-    int i;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
@@ -1159,12 +1356,13 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
-    for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
+    memmove( key->values + index + 1, key->values + index, (++key->last_value - index) * sizeof(*key->values) );
     value = &key->values[index];
     value->name    = new_name;
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    insert_child_index( key, 1, index );
     return value;
 }
 
@@ -1309,7 +1507,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    int i, index, nb_values;
+    int index, nb_values;
 
     if (key->flags & KEY_PREDEF)
     {
@@ -1323,9 +1521,10 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
+    remove_child_index( key, 1, index );
     free( value->name );
     free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
+    memmove( key->values + index, key->values + index + 1, (key->last_value - index) * sizeof(*key->values) );
     key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
@@ -1627,6 +1826,7 @@ static int load_value( struct key *key, const char *buffer, struct file_load_inf
     struct key_value *value;
 
     if (!(value = parse_value_name( key, buffer, &len, info ))) return 0;
+    update_key_stamp( key );
     if (!(res = get_data_type( buffer + len, &type, &parse_type ))) goto error;
     buffer += len + res;
 
@@ -2157,6 +2357,17 @@ void flush_registry(void)
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 }
 
+/* create the mapping holding the key modification stamps */
+struct object *create_registry_stamps_mapping( struct object *root, const struct unicode_str *name,
+                                               unsigned int attr, const struct security_descriptor *sd )
+{
+    void *ptr;
+    struct object *obj = create_shared_mapping( root, name, REGISTRY_STAMP_COUNT * sizeof(*registry_stamps),
+                                                attr, sd, &ptr );
+    if (obj) registry_stamps = ptr;
+    return obj;
+}
+
 /* determine if the thread is wow64 (32-bit client running on 64-bit prefix) */
 static int is_wow64_thread( struct thread *thread )
 {
@@ -2284,6 +2495,8 @@ DECL_HANDLER(get_key_value)
     if ((key = get_hkey_obj( req->hkey, KEY_QUERY_VALUE )))
     {
         get_value( key, &name, &reply->type, &reply->total );
+        reply->stamp_index = key->stamp_index;
+        reply->stamp       = registry_stamps ? registry_stamps[key->stamp_index] : 0;
         release_object( key );
     }
 }
@@ -167,6 +167,7 @@ DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
 DECL_HANDLER(get_handle_unix_name);
 DECL_HANDLER(get_handle_fd);
+DECL_HANDLER(get_handle_fds);
 DECL_HANDLER(get_directory_cache_entry);
 DECL_HANDLER(flush);
 DECL_HANDLER(get_file_info);
@@ -226,6 +227,7 @@ DECL_HANDLER(delete_atom);
 DECL_HANDLER(find_atom);
 DECL_HANDLER(get_atom_information);
 DECL_HANDLER(get_msg_queue);
+DECL_HANDLER(get_msg_queue_mapping);
 DECL_HANDLER(set_queue_fd);
 DECL_HANDLER(set_queue_mask);
 DECL_HANDLER(get_queue_status);
@@ -354,6 +356,9 @@ DECL_HANDLER(get_object_info);
 DECL_HANDLER(get_object_name);
 DECL_HANDLER(get_object_type);
 DECL_HANDLER(get_object_types);
+DECL_HANDLER(get_handle_table_mapping);
+DECL_HANDLER(get_fast_sync_mapping);
+DECL_HANDLER(fast_sync_wake);
 DECL_HANDLER(allocate_locally_unique_id);
 DECL_HANDLER(create_device_manager);
 DECL_HANDLER(create_device);
@@ -372,6 +377,9 @@ DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
 DECL_HANDLER(query_completion);
+DECL_HANDLER(create_wait_completion_packet);
+DECL_HANDLER(associate_wait_completion_packet);
+DECL_HANDLER(cancel_wait_completion_packet);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
 DECL_HANDLER(set_fd_completion_mode);
@@ -451,6 +459,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_alloc_file_handle,
     (req_handler)req_get_handle_unix_name,
     (req_handler)req_get_handle_fd,
+    (req_handler)req_get_handle_fds,
     (req_handler)req_get_directory_cache_entry,
     (req_handler)req_flush,
     (req_handler)req_get_file_info,
@@ -510,6 +519,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_find_atom,
     (req_handler)req_get_atom_information,
     (req_handler)req_get_msg_queue,
+    (req_handler)req_get_msg_queue_mapping,
     (req_handler)req_set_queue_fd,
     (req_handler)req_set_queue_mask,
     (req_handler)req_get_queue_status,
@@ -638,6 +648,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_get_object_name,
     (req_handler)req_get_object_type,
     (req_handler)req_get_object_types,
+    (req_handler)req_get_handle_table_mapping,
+    (req_handler)req_get_fast_sync_mapping,
+    (req_handler)req_fast_sync_wake,
     (req_handler)req_allocate_locally_unique_id,
     (req_handler)req_create_device_manager,
     (req_handler)req_create_device,
@@ -656,6 +669,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
     (req_handler)req_query_completion,
+    (req_handler)req_create_wait_completion_packet,
+    (req_handler)req_associate_wait_completion_packet,
+    (req_handler)req_cancel_wait_completion_packet,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
     (req_handler)req_set_fd_completion_mode,
@@ -1017,6 +1033,8 @@ C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, cacheable) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, options) == 20 );
 C_ASSERT( sizeof(struct get_handle_fd_reply) == 24 );
+C_ASSERT( sizeof(struct get_handle_fds_request) == 16 );
+C_ASSERT( sizeof(struct get_handle_fds_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_directory_cache_entry_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_reply, entry) == 8 );
@@ -1221,7 +1239,9 @@ C_ASSERT( FIELD_OFFSET(struct get_key_value_request, hkey) == 12 );
 C_ASSERT( sizeof(struct get_key_value_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, total) == 12 );
-C_ASSERT( sizeof(struct get_key_value_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, stamp_index) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, stamp) == 20 );
+C_ASSERT( sizeof(struct get_key_value_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, hkey) == 12 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, index) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, info_class) == 20 );
@@ -1311,6 +1331,9 @@ C_ASSERT( sizeof(struct get_atom_information_reply) == 24 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
+C_ASSERT( sizeof(struct get_msg_queue_mapping_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_mapping_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_msg_queue_mapping_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_mask_request, wake_mask) == 12 );
@@ -1410,7 +1433,10 @@ C_ASSERT( sizeof(struct cancel_sync_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct register_async_request, type) == 12 );
 C_ASSERT( FIELD_OFFSET(struct register_async_request, async) == 16 );
 C_ASSERT( FIELD_OFFSET(struct register_async_request, count) == 56 );
+C_ASSERT( FIELD_OFFSET(struct register_async_request, direct) == 60 );
 C_ASSERT( sizeof(struct register_async_request) == 64 );
+C_ASSERT( FIELD_OFFSET(struct register_async_reply, wait) == 8 );
+C_ASSERT( sizeof(struct register_async_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct cancel_async_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct cancel_async_request, iosb) == 16 );
 C_ASSERT( FIELD_OFFSET(struct cancel_async_request, only_thread) == 24 );
@@ -2065,6 +2091,14 @@ C_ASSERT( sizeof(struct get_object_type_reply) == 8 );
 C_ASSERT( sizeof(struct get_object_types_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_object_types_reply, count) == 8 );
 C_ASSERT( sizeof(struct get_object_types_reply) == 16 );
+C_ASSERT( sizeof(struct get_handle_table_mapping_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_table_mapping_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_handle_table_mapping_reply) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_mapping_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_mapping_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_fast_sync_mapping_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct fast_sync_wake_request, handle) == 12 );
+C_ASSERT( sizeof(struct fast_sync_wake_request) == 16 );
 C_ASSERT( sizeof(struct allocate_locally_unique_id_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct allocate_locally_unique_id_reply, luid) == 8 );
 C_ASSERT( sizeof(struct allocate_locally_unique_id_reply) == 16 );
@@ -2162,6 +2196,23 @@ C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
 C_ASSERT( sizeof(struct query_completion_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_wait_completion_packet_request, access) == 12 );
+C_ASSERT( sizeof(struct create_wait_completion_packet_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_wait_completion_packet_reply, handle) == 8 );
+C_ASSERT( sizeof(struct create_wait_completion_packet_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, chandle) == 16 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, target) == 20 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, ckey) == 24 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, cvalue) == 32 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, information) == 40 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_request, status) == 48 );
+C_ASSERT( sizeof(struct associate_wait_completion_packet_request) == 56 );
+C_ASSERT( FIELD_OFFSET(struct associate_wait_completion_packet_reply, signaled) == 8 );
+C_ASSERT( sizeof(struct associate_wait_completion_packet_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct cancel_wait_completion_packet_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct cancel_wait_completion_packet_request, remove_signaled) == 16 );
+C_ASSERT( sizeof(struct cancel_wait_completion_packet_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, ckey) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, chandle) == 24 );
@@ -53,14 +53,15 @@ struct type_descr semaphore_type =
 struct semaphore
 {
     struct object  obj;    /* object header */
-    unsigned int   count;  /* current count */
-    unsigned int   max;    /* maximum possible count */
+    struct fast_sync_slot *sync;   /* count and maximum, shared with clients or pointing to local */
+    struct fast_sync_slot  local;  /* count and maximum when they aren't shared */
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signal( struct object *obj, unsigned int access );
+static void semaphore_destroy( struct object *obj );
 
 static const struct object_ops semaphore_ops =
 {
@@ -83,7 +84,7 @@ static const struct object_ops semaphore_ops =
     no_open_file,                  /* open_file */
     no_kernel_obj_list,            /* get_kernel_obj_list */
     no_close_handle,               /* close_handle */
-    no_destroy                     /* destroy */
+    semaphore_destroy              /* destroy */
 };
 
 
@@ -103,8 +104,9 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
         if (get_error() != STATUS_OBJECT_NAME_EXISTS)
         {
             /* initialize it if it didn't already exist */
-            sem->count = initial;
-            sem->max   = max;
+            sem->sync = alloc_fast_sync( &sem->obj, FAST_SYNC_SEMAPHORE, &sem->local );
+            sem->sync->state = initial;
+            sem->sync->max   = max;
         }
     }
     return sem;
@@ -113,22 +115,27 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
-    if (prev) *prev = sem->count;
-    if (sem->count + count < sem->count || sem->count + count > sem->max)
-    {
-        set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
-        return 0;
-    }
-    else if (sem->count)
+    unsigned int state = fast_sync_get_state( sem->sync );
+
+    do
     {
-        /* there cannot be any thread to wake up if the count is != 0 */
-        sem->count += count;
-    }
-    else
+        if (prev) *prev = state;
+        if (state + count < state || state + count > sem->sync->max)
+        {
+            set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n( &sem->sync->state, &state, state + count, 0,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+
+    if (sem->obj.fast_sync)
     {
-        sem->count = count;
+        /* clients wait without the server seeing the count, so there can be waiters even if it was != 0 */
+        fast_sync_wake( &sem->obj );
         wake_up( &sem->obj, count );
     }
+    /* there cannot be any thread to wake up if the count was != 0 */
+    else if (!state) wake_up( &sem->obj, count );
     return 1;
 }
 
@@ -136,22 +143,23 @@ static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d\n", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d\n", fast_sync_get_state( sem->sync ), sem->sync->max );
 }
 
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    return (sem->count > 0);
+    return (fast_sync_get_state( sem->sync ) > 0);
 }
 
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
+    unsigned int count = fast_sync_get_state( sem->sync );
     assert( obj->ops == &semaphore_ops );
-    assert( sem->count );
-    sem->count--;
+    assert( count );
+    fast_sync_set_state( sem->sync, count - 1 );
 }
 
 static int semaphore_signal( struct object *obj, unsigned int access )
@@ -167,6 +175,12 @@ static int semaphore_signal( struct object *obj, unsigned int access )
     return release_semaphore( sem, 1, NULL );
 }
 
+static void semaphore_destroy( struct object *obj )
+{
+    assert( obj->ops == &semaphore_ops );
+    free_fast_sync( obj );
+}
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -221,8 +235,8 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
-        reply->max = sem->max;
+        reply->current = fast_sync_get_state( sem->sync );
+        reply->max = sem->sync->max;
         release_object( sem );
     }
 }
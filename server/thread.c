@@ -61,12 +61,15 @@ struct thread_wait
     int                     count;      /* count of objects */
     int                     flags;
     int                     abandoned;
+    int                     locked;     /* shared state of the satisfied objects is locked */
     enum select_op          select;
     client_ptr_t            key;        /* wait key for keyed events */
     client_ptr_t            cookie;     /* magic cookie to return to client */
     abstime_t               when;
     struct timeout_user    *user;
     int                     status;     /* status to return (unless STATUS_PENDING) */
+    object_wait_callback    callback;   /* callback for object waits, NULL for thread waits */
+    void                   *private;    /* private data for the callback */
     struct wait_queue_entry queues[1];
 };
 
@@ -759,12 +762,17 @@ static unsigned int end_wait( struct thread *thread, unsigned int status )
         {
             for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
                 entry->obj->ops->satisfied( entry->obj, entry );
+            if (wait->locked)
+                for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+                    fast_sync_unlock( entry->obj );
         }
         else
         {
             entry = wait->queues + status;
             entry->obj->ops->satisfied( entry->obj, entry );
+            if (wait->locked) fast_sync_unlock( entry->obj );
         }
+        wait->locked = 0;
         status = wait->status;
         if (wait->abandoned) status += STATUS_ABANDONED_WAIT_0;
     }
@@ -793,6 +801,9 @@ static int wait_on( const select_op_t *select_op, unsigned int count, struct obj
     wait->user    = NULL;
     wait->when = when;
     wait->abandoned = 0;
+    wait->locked = 0;
+    wait->callback = NULL;
+    wait->private = NULL;
     current->wait = wait;
 
     for (i = 0, entry = wait->queues; i < count; i++, entry++)
@@ -828,6 +839,80 @@ static int wait_on_handles( const select_op_t *select_op, unsigned int count, co
     return ret;
 }
 
+/* wait for an object on behalf of a thread without blocking it, the thread owns
+ * what gets acquired; the callback is invoked and the wait freed once the object
+ * has been acquired */
+struct thread_wait *create_object_wait( struct thread *thread, struct object *obj,
+                                        object_wait_callback callback, void *private )
+{
+    struct thread_wait *wait;
+    struct wait_queue_entry *entry;
+
+    if (!(wait = mem_alloc( sizeof(*wait) ))) return NULL;
+    wait->next      = NULL;
+    wait->thread    = (struct thread *)grab_object( thread );
+    wait->count     = 1;
+    wait->flags     = 0;
+    wait->select    = SELECT_WAIT;
+    wait->key       = 0;
+    wait->cookie    = 0;
+    wait->user      = NULL;
+    wait->when      = TIMEOUT_INFINITE;
+    wait->abandoned = 0;
+    wait->locked    = 0;
+    wait->callback  = callback;
+    wait->private   = private;
+
+    entry = wait->queues;
+    entry->wait = wait;
+    if (!obj->ops->add_queue( obj, entry ))
+    {
+        release_object( wait->thread );
+        free( wait );
+        return NULL;
+    }
+    return wait;
+}
+
+/* cancel a pending object wait */
+void cancel_object_wait( struct thread_wait *wait )
+{
+    struct wait_queue_entry *entry = wait->queues;
+
+    entry->obj->ops->remove_queue( entry->obj, entry );
+    release_object( wait->thread );
+    free( wait );
+}
+
+/* acquire the object of an object wait if it is signaled; return 1 if the wait got satisfied */
+int wake_object_wait( struct thread_wait *wait )
+{
+    struct wait_queue_entry *entry = wait->queues;
+    struct thread *thread;
+    unsigned int status;
+
+    fast_sync_lock( entry->obj );
+    if (!entry->obj->ops->signaled( entry->obj, entry ))
+    {
+        fast_sync_unlock( entry->obj );
+        return 0;
+    }
+
+    wait->status = STATUS_WAIT_0;
+    entry->obj->ops->satisfied( entry->obj, entry );
+    fast_sync_unlock( entry->obj );
+    status = wait->status;
+    if (wait->abandoned) status += STATUS_ABANDONED_WAIT_0;
+    wait->callback( wait->private, status );
+
+    thread = (struct thread *)grab_object( wait->thread );
+    cancel_object_wait( wait );
+    /* the owner is already gone, so it can't release what it just acquired */
+    if (thread->state == TERMINATED) abandon_mutexes( thread );
+    release_object( thread );
+    return 1;
+}
+
 /* check if the thread waiting condition is satisfied */
 static int check_wait( struct thread *thread )
 {
@@ -846,16 +931,33 @@ static int check_wait( struct thread *thread )
     if (wait->select == SELECT_WAIT_ALL)
     {
         int not_ok = 0;
+        /* keep clients from changing the shared state until the objects have been acquired */
+        for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+            fast_sync_lock( entry->obj );
         /* Note: we must check them all anyway, as some objects may
          * want to do something when signaled, even if others are not */
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             not_ok |= !entry->obj->ops->signaled( entry->obj, entry );
-        if (!not_ok) return STATUS_WAIT_0;
+        if (!not_ok)
+        {
+            wait->locked = 1;
+            return STATUS_WAIT_0;
+        }
+        for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+            fast_sync_unlock( entry->obj );
     }
     else
     {
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
-            if (entry->obj->ops->signaled( entry->obj, entry )) return i;
+        {
+            fast_sync_lock( entry->obj );
+            if (entry->obj->ops->signaled( entry->obj, entry ))
+            {
+                wait->locked = 1;
+                return i;
+            }
+            fast_sync_unlock( entry->obj );
+        }
     }
 
     if ((wait->flags & SELECT_ALERTABLE) && !list_empty(&thread->user_apc)) return STATUS_USER_APC;
@@ -1065,7 +1167,9 @@ void wake_up( struct object *obj, int max )
     LIST_FOR_EACH( ptr, &obj->wait_queue )
     {
         struct wait_queue_entry *entry = LIST_ENTRY( ptr, struct wait_queue_entry, entry );
-        if (!(ret = wake_thread( get_wait_queue_thread( entry )))) continue;
+        if (entry->wait->callback) ret = wake_object_wait( entry->wait );
+        else ret = wake_thread( get_wait_queue_thread( entry ));
+        if (!ret) continue;
         if (ret > 0 && max && !--max) break;
         /* restart at the head of the list since a wake up can change the object wait queue */
         ptr = &obj->wait_queue;
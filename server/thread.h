@@ -94,6 +94,8 @@ struct thread
 
 extern struct thread *current;
 
+typedef void (*object_wait_callback)( void *private, unsigned int status );
+
 /* thread functions */
 
 extern struct thread *create_thread( int fd, struct process *process,
@@ -110,6 +112,10 @@ extern void set_wait_status( struct wait_queue_entry *entry, int status );
 extern void stop_thread( struct thread *thread );
 extern int wake_thread( struct thread *thread );
 extern int wake_thread_queue_entry( struct wait_queue_entry *entry );
+extern struct thread_wait *create_object_wait( struct thread *thread, struct object *obj,
+                                               object_wait_callback callback, void *private );
+extern void cancel_object_wait( struct thread_wait *wait );
+extern int wake_object_wait( struct thread_wait *wait );
 extern int add_queue( struct object *obj, struct wait_queue_entry *entry );
 extern void remove_queue( struct object *obj, struct wait_queue_entry *entry );
 extern void kill_thread( struct thread *thread, int violent_death );
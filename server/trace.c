@@ -1356,6 +1356,23 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_handle_fds( const char *prefix, data_size_t size )
+{
+    const struct handle_fd_info *info;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*info))
+    {
+        info = cur_data;
+        fprintf( stderr, "{handle=%04x,status=%08x,type=%d,cacheable=%d,access=%08x,options=%08x}",
+                 info->handle, info->status, info->type, info->cacheable, info->access, info->options );
+        size -= sizeof(*info);
+        remove_data( sizeof(*info) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 typedef void (*dump_func)( const void *req );
 
 /* Everything below this line is generated automatically by tools/make_requests */
@@ -1968,6 +1985,16 @@ static void dump_get_handle_fd_reply( const struct get_handle_fd_reply *req )
     fprintf( stderr, ", options=%08x", req->options );
 }
 
+static void dump_get_handle_fds_request( const struct get_handle_fds_request *req )
+{
+    dump_varargs_uints( " handles=", cur_size );
+}
+
+static void dump_get_handle_fds_reply( const struct get_handle_fds_reply *req )
+{
+    dump_varargs_handle_fds( " fds=", cur_size );
+}
+
 static void dump_get_directory_cache_entry_request( const struct get_directory_cache_entry_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -2386,6 +2413,8 @@ static void dump_get_key_value_reply( const struct get_key_value_reply *req )
 {
     fprintf( stderr, " type=%d", req->type );
     fprintf( stderr, ", total=%u", req->total );
+    fprintf( stderr, ", stamp_index=%08x", req->stamp_index );
+    fprintf( stderr, ", stamp=%08x", req->stamp );
     dump_varargs_bytes( ", data=", cur_size );
 }
 
@@ -2590,6 +2619,15 @@ static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_msg_queue_mapping_request( const struct get_msg_queue_mapping_request *req )
+{
+}
+
+static void dump_get_msg_queue_mapping_reply( const struct get_msg_queue_mapping_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -2775,6 +2813,12 @@ static void dump_register_async_request( const struct register_async_request *re
     fprintf( stderr, " type=%d", req->type );
     dump_async_data( ", async=", &req->async );
     fprintf( stderr, ", count=%d", req->count );
+    fprintf( stderr, ", direct=%d", req->direct );
+}
+
+static void dump_register_async_reply( const struct register_async_reply *req )
+{
+    fprintf( stderr, " wait=%04x", req->wait );
 }
 
 static void dump_cancel_async_request( const struct cancel_async_request *req )
@@ -4100,6 +4144,29 @@ static void dump_get_object_types_reply( const struct get_object_types_reply *re
     dump_varargs_object_types_info( ", info=", cur_size );
 }
 
+static void dump_get_handle_table_mapping_request( const struct get_handle_table_mapping_request *req )
+{
+}
+
+static void dump_get_handle_table_mapping_reply( const struct get_handle_table_mapping_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fast_sync_mapping_request( const struct get_fast_sync_mapping_request *req )
+{
+}
+
+static void dump_get_fast_sync_mapping_reply( const struct get_fast_sync_mapping_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_fast_sync_wake_request( const struct fast_sync_wake_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_allocate_locally_unique_id_request( const struct allocate_locally_unique_id_request *req )
 {
 }
@@ -4292,6 +4359,39 @@ static void dump_query_completion_reply( const struct query_completion_reply *re
     fprintf( stderr, " depth=%08x", req->depth );
 }
 
+static void dump_create_wait_completion_packet_request( const struct create_wait_completion_packet_request *req )
+{
+    fprintf( stderr, " access=%08x", req->access );
+    dump_varargs_object_attributes( ", objattr=", cur_size );
+}
+
+static void dump_create_wait_completion_packet_reply( const struct create_wait_completion_packet_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_associate_wait_completion_packet_request( const struct associate_wait_completion_packet_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", chandle=%04x", req->chandle );
+    fprintf( stderr, ", target=%04x", req->target );
+    dump_uint64( ", ckey=", &req->ckey );
+    dump_uint64( ", cvalue=", &req->cvalue );
+    dump_uint64( ", information=", &req->information );
+    fprintf( stderr, ", status=%08x", req->status );
+}
+
+static void dump_associate_wait_completion_packet_reply( const struct associate_wait_completion_packet_reply *req )
+{
+    fprintf( stderr, " signaled=%d", req->signaled );
+}
+
+static void dump_cancel_wait_completion_packet_request( const struct cancel_wait_completion_packet_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", remove_signaled=%d", req->remove_signaled );
+}
+
 static void dump_set_completion_info_request( const struct set_completion_info_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4561,6 +4661,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_alloc_file_handle_request,
     (dump_func)dump_get_handle_unix_name_request,
     (dump_func)dump_get_handle_fd_request,
+    (dump_func)dump_get_handle_fds_request,
     (dump_func)dump_get_directory_cache_entry_request,
     (dump_func)dump_flush_request,
     (dump_func)dump_get_file_info_request,
@@ -4620,6 +4721,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_find_atom_request,
     (dump_func)dump_get_atom_information_request,
     (dump_func)dump_get_msg_queue_request,
+    (dump_func)dump_get_msg_queue_mapping_request,
     (dump_func)dump_set_queue_fd_request,
     (dump_func)dump_set_queue_mask_request,
     (dump_func)dump_get_queue_status_request,
@@ -4748,6 +4850,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_object_name_request,
     (dump_func)dump_get_object_type_request,
     (dump_func)dump_get_object_types_request,
+    (dump_func)dump_get_handle_table_mapping_request,
+    (dump_func)dump_get_fast_sync_mapping_request,
+    (dump_func)dump_fast_sync_wake_request,
     (dump_func)dump_allocate_locally_unique_id_request,
     (dump_func)dump_create_device_manager_request,
     (dump_func)dump_create_device_request,
@@ -4766,6 +4871,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
     (dump_func)dump_query_completion_request,
+    (dump_func)dump_create_wait_completion_packet_request,
+    (dump_func)dump_associate_wait_completion_packet_request,
+    (dump_func)dump_cancel_wait_completion_packet_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
     (dump_func)dump_set_fd_completion_mode_request,
@@ -4842,6 +4950,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_alloc_file_handle_reply,
     (dump_func)dump_get_handle_unix_name_reply,
     (dump_func)dump_get_handle_fd_reply,
+    (dump_func)dump_get_handle_fds_reply,
     (dump_func)dump_get_directory_cache_entry_reply,
     (dump_func)dump_flush_reply,
     (dump_func)dump_get_file_info_reply,
@@ -4901,6 +5010,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_find_atom_reply,
     (dump_func)dump_get_atom_information_reply,
     (dump_func)dump_get_msg_queue_reply,
+    (dump_func)dump_get_msg_queue_mapping_reply,
     NULL,
     (dump_func)dump_set_queue_mask_reply,
     (dump_func)dump_get_queue_status_reply,
@@ -4918,7 +5028,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_serial_info_reply,
     NULL,
     NULL,
-    NULL,
+    (dump_func)dump_register_async_reply,
     NULL,
     (dump_func)dump_get_async_result_reply,
     (dump_func)dump_set_async_direct_result_reply,
@@ -5029,6 +5139,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_object_name_reply,
     (dump_func)dump_get_object_type_reply,
     (dump_func)dump_get_object_types_reply,
+    (dump_func)dump_get_handle_table_mapping_reply,
+    (dump_func)dump_get_fast_sync_mapping_reply,
+    NULL,
     (dump_func)dump_allocate_locally_unique_id_reply,
     (dump_func)dump_create_device_manager_reply,
     NULL,
@@ -5047,6 +5160,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_remove_completion_reply,
     (dump_func)dump_query_completion_reply,
+    (dump_func)dump_create_wait_completion_packet_reply,
+    (dump_func)dump_associate_wait_completion_packet_reply,
+    NULL,
     NULL,
     NULL,
     NULL,
@@ -5123,6 +5239,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "alloc_file_handle",
     "get_handle_unix_name",
     "get_handle_fd",
+    "get_handle_fds",
     "get_directory_cache_entry",
     "flush",
     "get_file_info",
@@ -5182,6 +5299,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "find_atom",
     "get_atom_information",
     "get_msg_queue",
+    "get_msg_queue_mapping",
     "set_queue_fd",
     "set_queue_mask",
     "get_queue_status",
@@ -5310,6 +5428,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "get_object_name",
     "get_object_type",
     "get_object_types",
+    "get_handle_table_mapping",
+    "get_fast_sync_mapping",
+    "fast_sync_wake",
     "allocate_locally_unique_id",
     "create_device_manager",
     "create_device",
@@ -5328,6 +5449,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "add_completion",
     "remove_completion",
     "query_completion",
+    "create_wait_completion_packet",
+    "associate_wait_completion_packet",
+    "cancel_wait_completion_packet",
     "set_completion_info",
     "add_fd_completion",
     "set_fd_completion_mode",
@@ -5425,6 +5549,7 @@ static const struct
     { "INVALID_LOCK_SEQUENCE",       STATUS_INVALID_LOCK_SEQUENCE },
     { "INVALID_OWNER",               STATUS_INVALID_OWNER },
     { "INVALID_PARAMETER",           STATUS_INVALID_PARAMETER },
+    { "INVALID_PARAMETER_1",         STATUS_INVALID_PARAMETER_1 },
     { "INVALID_PIPE_STATE",          STATUS_INVALID_PIPE_STATE },
     { "INVALID_READ_MODE",           STATUS_INVALID_READ_MODE },
     { "INVALID_SECURITY_DESCR",      STATUS_INVALID_SECURITY_DESCR },
@@ -77,6 +77,8 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    unsigned int         merged_moves;     /* count of mouse moves merged with a queued one */
+    unsigned int         dropped_input;    /* count of hardware messages dropped from full queues */
 };
 
 /* user handles functions */
@@ -105,6 +107,7 @@ extern struct thread *get_first_global_hook( int id );
 extern void free_msg_queue( struct thread *thread );
 extern struct hook_table *get_queue_hooks( struct thread *thread );
 extern void set_queue_hooks( struct thread *thread, struct hook_table *hooks );
+extern void queue_hooks_changed(void);
 extern void inc_queue_paint_count( struct thread *thread, int incr );
 extern void queue_cleanup_window( struct thread *thread, user_handle_t win );
 extern int init_thread_queue( struct thread *thread );
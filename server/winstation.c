@@ -237,6 +237,8 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             desktop->users = 0;
             memset( &desktop->cursor, 0, sizeof(desktop->cursor) );
             memset( desktop->keystate, 0, sizeof(desktop->keystate) );
+            desktop->merged_moves = 0;
+            desktop->dropped_input = 0;
             list_add_tail( &winstation->desktops, &desktop->entry );
             list_init( &desktop->hotkeys );
         }
@@ -249,8 +251,9 @@ static void desktop_dump( struct object *obj, int verbose )
 {
     struct desktop *desktop = (struct desktop *)obj;
 
-    fprintf( stderr, "Desktop flags=%x winstation=%p top_win=%p hooks=%p\n",
-             desktop->flags, desktop->winstation, desktop->top_window, desktop->global_hooks );
+    fprintf( stderr, "Desktop flags=%x winstation=%p top_win=%p hooks=%p merged=%u dropped=%u\n",
+             desktop->flags, desktop->winstation, desktop->top_window, desktop->global_hooks,
+             desktop->merged_moves, desktop->dropped_input );
 }
 
 static int desktop_link_name( struct object *obj, struct object_name *name, struct object *parent )